@@ -0,0 +1,3 @@
+// Relative import to be able to reuse the C sources.
+// See the comment in ../ffmpeg_streamer.podspec for more information.
+#include "../src/ffmpeg_lz4.c"
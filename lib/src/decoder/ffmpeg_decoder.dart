@@ -1,6 +1,10 @@
+import 'dart:async';
 import 'dart:ffi';
+import 'dart:io' show Platform;
+import 'dart:math' show Rectangle, max, min;
 import 'dart:typed_data';
 import 'package:ffi/ffi.dart';
+import 'package:flutter/services.dart' show MethodChannel;
 import '../ffi/lotterwise_ffmpeg_bindings.dart' as ffi_bindings;
 import '../models/frame_data.dart';
 
@@ -10,6 +14,26 @@ typedef OnFrameCallback = void Function(MediaFrame? frame);
 /// Callback type for frame range progress updates.
 typedef OnProgressCallback = void Function(int current, int total);
 
+/// Orientation of decoded video frames.
+///
+/// The values match the native `VideoRotation` enum.
+enum VideoRotation {
+  /// Follow the rotation stored in the video stream (phone videos).
+  auto,
+
+  /// Keep the stored orientation.
+  none,
+
+  /// Rotate 90 degrees clockwise.
+  clockwise90,
+
+  /// Rotate 180 degrees.
+  clockwise180,
+
+  /// Rotate 270 degrees clockwise.
+  clockwise270,
+}
+
 /// FFmpeg-based decoder for media files with async API.
 /// All frame retrieval is asynchronous using native threads for optimal performance.
 class FfmpegDecoder {
@@ -23,12 +47,26 @@ class FfmpegDecoder {
   int _videoHeight = 0;
   double _fps = 0;
   int _totalFrames = 0;
+  int _rotation = 0;
 
   int _audioSampleRate = 0;
   int _audioChannels = 0;
 
   // Callback management
   final Map<int, _PendingRequest> _pendingRequests = {};
+  final Map<int, _PendingJob<SpriteSheet>> _pendingSpriteSheets = {};
+  final Map<int, _PendingJob<EncodedVideoFrame>> _pendingEncodedFrames = {};
+  final Map<int, _PendingJob<SceneDetectionResult>> _pendingSceneDetections = {};
+  final Map<int, _PendingJob<VideoPacketStats>> _pendingPacketStats = {};
+  final Map<int, _PendingJob<BlackFreezeResult>> _pendingBlackFreeze = {};
+  final Map<int, _PendingJob<MotionVectorTrack>> _pendingMotionVectors = {};
+  final Map<int, _PendingJob<int>> _pendingShmStreams = {};
+  final Map<int, _PendingJob<bool>> _pendingProxies = {};
+  final Map<int, _PendingJob<bool>> _pendingExports = {};
+
+  // Linux texture output
+  static const MethodChannel _channel = MethodChannel('ffmpeg_streamer');
+  int? _textureId;
   int _nextCallbackId = 1;
 
   // Native callbacks (use static methods with NativeCallable for thread safety)
@@ -38,6 +76,24 @@ class FfmpegDecoder {
       _audioFrameCallable;
   static late final NativeCallable<ffi_bindings.NativeOnFrameRangeProgressCallback>
       _progressCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnSpriteSheetCallback>
+      _spriteSheetCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnEncodedFrameCallback>
+      _encodedFrameCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnSceneCutsCallback>
+      _sceneCutsCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnPacketStatsCallback>
+      _packetStatsCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnBlackFreezeCallback>
+      _blackFreezeCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnMotionVectorsCallback>
+      _motionVectorsCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnShmStreamCallback>
+      _shmStreamCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnProxyCallback>
+      _proxyCallable;
+  static late final NativeCallable<ffi_bindings.NativeOnExportCallback>
+      _exportCallable;
 
   static late final Pointer<NativeFunction<ffi_bindings.NativeOnVideoFrameCallback>>
       _videoFrameCallbackPointer;
@@ -46,6 +102,24 @@ class FfmpegDecoder {
   static late final Pointer<
           NativeFunction<ffi_bindings.NativeOnFrameRangeProgressCallback>>
       _progressCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnSpriteSheetCallback>>
+      _spriteSheetCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnEncodedFrameCallback>>
+      _encodedFrameCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnSceneCutsCallback>>
+      _sceneCutsCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnPacketStatsCallback>>
+      _packetStatsCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnBlackFreezeCallback>>
+      _blackFreezeCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnMotionVectorsCallback>>
+      _motionVectorsCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnShmStreamCallback>>
+      _shmStreamCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnProxyCallback>>
+      _proxyCallbackPointer;
+  static late final Pointer<NativeFunction<ffi_bindings.NativeOnExportCallback>>
+      _exportCallbackPointer;
   
   static bool _callbacksInitialized = false;
 
@@ -72,10 +146,46 @@ class FfmpegDecoder {
       _progressCallable = NativeCallable<ffi_bindings.NativeOnFrameRangeProgressCallback>.listener(
         _onProgressCallback,
       );
+      _spriteSheetCallable = NativeCallable<ffi_bindings.NativeOnSpriteSheetCallback>.listener(
+        _onSpriteSheetCallback,
+      );
+      _encodedFrameCallable = NativeCallable<ffi_bindings.NativeOnEncodedFrameCallback>.listener(
+        _onEncodedFrameCallback,
+      );
+      _sceneCutsCallable = NativeCallable<ffi_bindings.NativeOnSceneCutsCallback>.listener(
+        _onSceneCutsCallback,
+      );
+      _packetStatsCallable = NativeCallable<ffi_bindings.NativeOnPacketStatsCallback>.listener(
+        _onPacketStatsCallback,
+      );
+      _blackFreezeCallable = NativeCallable<ffi_bindings.NativeOnBlackFreezeCallback>.listener(
+        _onBlackFreezeCallback,
+      );
+      _motionVectorsCallable = NativeCallable<ffi_bindings.NativeOnMotionVectorsCallback>.listener(
+        _onMotionVectorsCallback,
+      );
+      _shmStreamCallable = NativeCallable<ffi_bindings.NativeOnShmStreamCallback>.listener(
+        _onShmStreamCallback,
+      );
+      _proxyCallable = NativeCallable<ffi_bindings.NativeOnProxyCallback>.listener(
+        _onProxyCallback,
+      );
+      _exportCallable = NativeCallable<ffi_bindings.NativeOnExportCallback>.listener(
+        _onExportCallback,
+      );
 
       _videoFrameCallbackPointer = _videoFrameCallable.nativeFunction;
       _audioFrameCallbackPointer = _audioFrameCallable.nativeFunction;
       _progressCallbackPointer = _progressCallable.nativeFunction;
+      _spriteSheetCallbackPointer = _spriteSheetCallable.nativeFunction;
+      _encodedFrameCallbackPointer = _encodedFrameCallable.nativeFunction;
+      _sceneCutsCallbackPointer = _sceneCutsCallable.nativeFunction;
+      _packetStatsCallbackPointer = _packetStatsCallable.nativeFunction;
+      _blackFreezeCallbackPointer = _blackFreezeCallable.nativeFunction;
+      _motionVectorsCallbackPointer = _motionVectorsCallable.nativeFunction;
+      _shmStreamCallbackPointer = _shmStreamCallable.nativeFunction;
+      _proxyCallbackPointer = _proxyCallable.nativeFunction;
+      _exportCallbackPointer = _exportCallable.nativeFunction;
 
       _callbacksInitialized = true;
     }
@@ -114,6 +224,38 @@ class FfmpegDecoder {
     return false;
   }
 
+  /// Opens numbered images as media, one image per frame at [fps].
+  ///
+  /// [pattern] is printf style (`shot_%04d.png`, numbered from the first of
+  /// 0 to 4 that exists up to the first missing number) or a glob
+  /// (`shot_*.exr`, in name order; unsupported on Windows and on Android
+  /// before API 28). Frames are decoded straight from their files, and
+  /// range requests decode images in parallel.
+  ///
+  /// Returns [true] if the sequence was opened successfully.
+  Future<bool> openImageSequence(String pattern, {double fps = 25.0}) async {
+    if (!_isInitialized) {
+      _initialize();
+    }
+
+    // Close any previously opened media
+    if (_isOpened) {
+      await release();
+    }
+
+    final patternC = pattern.toNativeUtf8();
+    final result = _bindings.openImageSequence(patternC.cast(), fps);
+    calloc.free(patternC);
+
+    if (result == 0) {
+      _isOpened = true;
+      _loadMediaInfo();
+      return true;
+    }
+
+    return false;
+  }
+
   /// Loads media information after opening a file.
   void _loadMediaInfo() {
     final mediaInfo = _bindings.getMediaInfo();
@@ -122,6 +264,7 @@ class FfmpegDecoder {
     _videoHeight = mediaInfo.height;
     _fps = mediaInfo.fps;
     _totalFrames = mediaInfo.totalFrames;
+    _rotation = mediaInfo.rotation;
     _audioSampleRate = mediaInfo.audioSampleRate;
     _audioChannels = mediaInfo.audioChannels;
   }
@@ -135,6 +278,11 @@ class FfmpegDecoder {
   /// Returns the video height.
   int get videoHeight => _videoHeight;
 
+  /// Returns the clockwise rotation stored in the video stream, in degrees.
+  ///
+  /// [videoWidth] and [videoHeight] are the stored (unrotated) size.
+  int get rotation => _rotation;
+
   /// Returns the video frame rate (frames per second).
   double get fps => _fps;
 
@@ -154,6 +302,740 @@ class FfmpegDecoder {
   /// Returns whether the media file has audio.
   bool get hasAudio => _audioSampleRate > 0 && _audioChannels > 0;
 
+  /// Enables or disables HDR to SDR tone mapping for 10-bit sources.
+  ///
+  /// Enabled by default. PQ and HLG video is tone mapped to SDR so previews
+  /// don't look washed out; 10-bit SDR video gets a faster direct conversion.
+  void setHdrToneMapping(bool enabled) {
+    _bindings.setHdrToneMapping(enabled ? 1 : 0);
+  }
+
+  /// Sets the orientation, crop and size of video frames requested after
+  /// this call.
+  ///
+  /// By default frames follow the rotation stored in the stream, so phone
+  /// videos come out upright. Flips are applied after the rotation.
+  ///
+  /// [crop] selects a region in rotated frame coordinates; only that region
+  /// is converted. [outputWidth] and [outputHeight] scale the (cropped)
+  /// result; when only one is given the other keeps the aspect ratio.
+  ///
+  /// [pyramidLevels] adds that many half-size copies (1/2, 1/4, ...) to
+  /// each frame, see [VideoFrame.levels].
+  ///
+  /// [frameStats] fills [VideoFrame.stats] from the decoded luma plane,
+  /// which costs a fraction of the RGBA conversion.
+  ///
+  /// [pixelFormat] set to [VideoPixelFormat.gray8] returns the luma plane
+  /// only and skips the RGBA conversion; pyramid levels are RGBA only.
+  ///
+  /// Frame width and height are reported after rotation, crop and scaling.
+  /// Requests already queued keep the settings they were made with.
+  void setVideoOutputOptions({
+    VideoRotation rotation = VideoRotation.auto,
+    bool flipHorizontal = false,
+    bool flipVertical = false,
+    Rectangle<int>? crop,
+    int outputWidth = 0,
+    int outputHeight = 0,
+    int pyramidLevels = 0,
+    bool frameStats = false,
+    VideoPixelFormat pixelFormat = VideoPixelFormat.rgba,
+  }) {
+    final options = calloc<ffi_bindings.VideoOutputOptions>();
+    options.ref.rotation = rotation.index;
+    options.ref.flipHorizontal = flipHorizontal ? 1 : 0;
+    options.ref.flipVertical = flipVertical ? 1 : 0;
+    if (crop != null) {
+      options.ref.cropX = crop.left;
+      options.ref.cropY = crop.top;
+      options.ref.cropWidth = crop.width;
+      options.ref.cropHeight = crop.height;
+    }
+    options.ref.outputWidth = outputWidth;
+    options.ref.outputHeight = outputHeight;
+    options.ref.pyramidLevels = pyramidLevels;
+    options.ref.frameStats = frameStats ? 1 : 0;
+    options.ref.pixelFormat = pixelFormat.index;
+    _bindings.setVideoOutputOptions(options);
+    calloc.free(options);
+  }
+
+  /// Keeps up to [maxBytes] of decoded frames in native memory.
+  ///
+  /// A request for a frame decoded earlier, including the frames a seek
+  /// decoded on its way to the target, then only pays for the conversion.
+  /// The cache holds frames of every media opened, so switching back to a
+  /// file finds them again. 0, the default, turns it off.
+  void setFrameCacheSize(int maxBytes) {
+    _bindings.setFrameCacheSize(maxBytes);
+  }
+
+  /// Keeps up to [maxBytes] of compressed frames behind the frame cache.
+  ///
+  /// Frames evicted from [setFrameCacheSize]'s budget are LZ4 compressed
+  /// instead of dropped, so more of the timeline stays resident: flat UI
+  /// and screen content shrinks several times, camera footage much less.
+  /// Reading one back costs a decompression, not a seek and decode. 0, the
+  /// default, turns it off.
+  void setCompressedFrameCacheSize(int maxBytes) {
+    _bindings.setCompressedFrameCacheSize(maxBytes);
+  }
+
+  /// Spills frames leaving the in-memory caches to a file at [path] instead
+  /// of dropping them, so memory-constrained devices read them back from
+  /// local storage rather than decoding a long GOP again.
+  ///
+  /// The file is preallocated to [maxBytes] and overwrites its oldest
+  /// frames once full. Frames are keyed by file and timestamp, so they
+  /// survive reopening a clip. With [persistent] the file is kept and
+  /// reused by the next run, and only takes frames of local files and image
+  /// sequences, whose changes it can detect. Needs [setFrameCacheSize]; a
+  /// null [path] turns spilling off.
+  ///
+  /// Returns false on failure, and always on Windows.
+  bool setFrameSpillFile(String? path,
+      {int maxBytes = 0, bool persistent = false}) {
+    final pathPtr = path != null ? path.toNativeUtf8() : nullptr;
+    final result =
+        _bindings.setFrameSpillFile(pathPtr, maxBytes, persistent ? 1 : 0);
+    if (path != null) calloc.free(pathPtr);
+    return result == 0;
+  }
+
+  /// Decodes frames from [startMs] to [endMs] every [stepMs] straight into
+  /// model input tensors of [width] x [height].
+  ///
+  /// With [letterbox] the aspect ratio is kept and the border is filled with
+  /// [padValue]; otherwise frames are stretched. Float tensors are
+  /// normalized as `(value / 255 - mean) / std` per channel. Rotation and
+  /// crop follow [setVideoOutputOptions].
+  ///
+  /// At most [maxFrames] frames are decoded. This call is synchronous and
+  /// decodes the whole batch, so run it off the UI isolate.
+  VideoTensorBatch? getVideoTensorsByTimestamp({
+    required int startMs,
+    required int endMs,
+    required int stepMs,
+    required int width,
+    required int height,
+    TensorFormat format = TensorFormat.float32Nchw,
+    bool letterbox = true,
+    int padValue = 114,
+    bool bgr = false,
+    List<double> mean = const [0, 0, 0],
+    List<double> std = const [1, 1, 1],
+    int maxFrames = 64,
+  }) {
+    if (!_isOpened || stepMs <= 0 || endMs < startMs) return null;
+
+    final options = calloc<ffi_bindings.TensorOptions>();
+    options.ref.width = width;
+    options.ref.height = height;
+    options.ref.format = format.index;
+    options.ref.letterbox = letterbox ? 1 : 0;
+    options.ref.padValue = padValue;
+    options.ref.bgr = bgr ? 1 : 0;
+    for (var c = 0; c < 3; c++) {
+      options.ref.mean[c] = mean[c];
+      options.ref.std[c] = std[c];
+    }
+
+    final tensorSize = _bindings.getTensorSize(options);
+    final frames = min(maxFrames, (endMs - startMs) ~/ stepMs + 1);
+    if (tensorSize == 0 || frames <= 0) {
+      calloc.free(options);
+      return null;
+    }
+
+    // The tensor buffer is handed to Dart as is and freed with the list
+    final data = malloc<Uint8>(tensorSize * frames);
+    final pts = calloc<Int64>(frames);
+    final batch = calloc<ffi_bindings.TensorBatch>();
+    batch.ref.data = data.cast();
+    batch.ref.dataSize = tensorSize * frames;
+    batch.ref.ptsMs = pts;
+
+    final count = _bindings.getVideoTensorsRangeByTimestamp(
+        startMs, endMs, stepMs, options, batch);
+
+    VideoTensorBatch? result;
+    if (count > 0) {
+      final TypedData tensors = format == TensorFormat.float32Nchw
+          ? data.cast<Float>().asTypedList(count * tensorSize ~/ 4,
+              finalizer: malloc.nativeFree)
+          : data.asTypedList(count * tensorSize, finalizer: malloc.nativeFree);
+      result = VideoTensorBatch(
+        data: tensors,
+        count: count,
+        pts: List.generate(count, (i) => Duration(milliseconds: pts[i])),
+        content: Rectangle(batch.ref.contentX, batch.ref.contentY,
+            batch.ref.contentWidth, batch.ref.contentHeight),
+      );
+    } else {
+      malloc.free(data);
+    }
+
+    calloc.free(pts);
+    calloc.free(batch);
+    calloc.free(options);
+    return result;
+  }
+
+  /// Builds a thumbnail sprite sheet of [columns] x [rows] tiles.
+  ///
+  /// Tiles are evenly spaced between [start] and [end] (the end of the media
+  /// by default) and decoded in parallel on separate native readers, so
+  /// playback and other requests keep going meanwhile. [keyframeAligned]
+  /// shows the keyframe before each timestamp, which is much faster on long
+  /// GOPs. A [tileHeight] of 0 follows the video aspect ratio. With an
+  /// [imageFormat] the atlas is also encoded, ready to be saved or served.
+  ///
+  /// Returns null on failure.
+  Future<SpriteSheet?> generateSpriteSheet({
+    required int columns,
+    required int rows,
+    int tileWidth = 160,
+    int tileHeight = 0,
+    Duration start = Duration.zero,
+    Duration? end,
+    bool keyframeAligned = false,
+    int threads = 0,
+    ImageFormat imageFormat = ImageFormat.none,
+    int quality = 0,
+  }) {
+    if (!_isOpened || columns <= 0 || rows <= 0) return Future.value(null);
+
+    final options = calloc<ffi_bindings.SpriteSheetOptions>();
+    options.ref.columns = columns;
+    options.ref.rows = rows;
+    options.ref.tileWidth = tileWidth;
+    options.ref.tileHeight = tileHeight;
+    options.ref.startMs = start.inMilliseconds;
+    options.ref.endMs = end?.inMilliseconds ?? 0;
+    options.ref.keyframeAligned = keyframeAligned ? 1 : 0;
+    options.ref.threads = threads;
+    options.ref.imageFormat = imageFormat.index;
+    options.ref.quality = quality;
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<SpriteSheet>();
+    _pendingSpriteSheets[callbackId] = request;
+
+    request.requestId = _bindings.generateSpriteSheetAsync(
+      options,
+      _spriteSheetCallbackPointer,
+      userData.cast(),
+    );
+    calloc.free(options);
+
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingSpriteSheets.remove(callbackId);
+      return Future.value(null);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Finds shot boundaries between [start] and [end] (the end of the media
+  /// by default).
+  ///
+  /// The range is split into segments decoded in parallel on separate
+  /// native readers, and frames are compared on a small luma image, so this
+  /// runs well above real time without blocking other requests. Raise
+  /// [threshold] (0-1, 0 for the default) for fewer cuts; [minSceneLength]
+  /// drops cuts that follow the previous one too closely.
+  ///
+  /// Returns null on failure.
+  Future<SceneDetectionResult?> detectScenes({
+    Duration start = Duration.zero,
+    Duration? end,
+    double threshold = 0,
+    Duration minSceneLength = Duration.zero,
+    int analysisWidth = 0,
+    int threads = 0,
+  }) {
+    if (!_isOpened) return Future.value(null);
+
+    final options = calloc<ffi_bindings.SceneDetectOptions>();
+    options.ref.threshold = threshold;
+    options.ref.analysisWidth = analysisWidth;
+    options.ref.startMs = start.inMilliseconds;
+    options.ref.endMs = end?.inMilliseconds ?? 0;
+    options.ref.minSceneMs = minSceneLength.inMilliseconds;
+    options.ref.threads = threads;
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<SceneDetectionResult>();
+    _pendingSceneDetections[callbackId] = request;
+
+    request.requestId = _bindings.detectScenesAsync(
+      options,
+      _sceneCutsCallbackPointer,
+      userData.cast(),
+    );
+    calloc.free(options);
+
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingSceneDetections.remove(callbackId);
+      return Future.value(null);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Finds black and frozen ranges between [start] and [end] (the end of
+  /// the media by default).
+  ///
+  /// Frames are measured on the decoded luma plane, as with
+  /// [VideoFrame.stats], on separate native readers decoding segments in
+  /// parallel. A frame is black when at least [blackRatio] of its pixels
+  /// are dark, and frozen when its mean luma difference to the previous
+  /// frame is at most [freezeDifference] (0-255). Ranges shorter than
+  /// [minBlackLength] or [minFreezeLength] are dropped. Zero picks the
+  /// defaults (0.98, 0.5 and one second).
+  ///
+  /// Returns null on failure.
+  Future<BlackFreezeResult?> detectBlackAndFrozen({
+    Duration start = Duration.zero,
+    Duration? end,
+    double blackRatio = 0,
+    double freezeDifference = 0,
+    Duration minBlackLength = Duration.zero,
+    Duration minFreezeLength = Duration.zero,
+    int threads = 0,
+  }) {
+    if (!_isOpened) return Future.value(null);
+
+    final options = calloc<ffi_bindings.BlackFreezeOptions>();
+    options.ref.startMs = start.inMilliseconds;
+    options.ref.endMs = end?.inMilliseconds ?? 0;
+    options.ref.blackRatio = blackRatio;
+    options.ref.freezeDifference = freezeDifference;
+    options.ref.minBlackMs = minBlackLength.inMilliseconds;
+    options.ref.minFreezeMs = minFreezeLength.inMilliseconds;
+    options.ref.threads = threads;
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<BlackFreezeResult>();
+    _pendingBlackFreeze[callbackId] = request;
+
+    request.requestId = _bindings.detectBlackFreezeAsync(
+      options,
+      _blackFreezeCallbackPointer,
+      userData.cast(),
+    );
+    calloc.free(options);
+
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingBlackFreeze.remove(callbackId);
+      return Future.value(null);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Collects the codec motion vectors of the frames between [start] and
+  /// [end] (the end of the media by default).
+  ///
+  /// Frames are decoded with motion vector export on separate native
+  /// readers and never converted to RGBA, so this runs at about decoding
+  /// speed. Each frame reports its mean and largest motion; with
+  /// [includeVectors] the individual vectors are returned as well, which
+  /// takes 12 bytes per block.
+  ///
+  /// Returns null on failure.
+  Future<MotionVectorTrack?> getMotionVectors({
+    Duration start = Duration.zero,
+    Duration? end,
+    bool includeVectors = false,
+    int threads = 0,
+  }) {
+    if (!_isOpened) return Future.value(null);
+
+    final options = calloc<ffi_bindings.MotionVectorOptions>();
+    options.ref.startMs = start.inMilliseconds;
+    options.ref.endMs = end?.inMilliseconds ?? 0;
+    options.ref.includeVectors = includeVectors ? 1 : 0;
+    options.ref.threads = threads;
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<MotionVectorTrack>();
+    _pendingMotionVectors[callbackId] = request;
+
+    request.requestId = _bindings.getMotionVectorsAsync(
+      options,
+      _motionVectorsCallbackPointer,
+      userData.cast(),
+    );
+    calloc.free(options);
+
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingMotionVectors.remove(callbackId);
+      return Future.value(null);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Creates the POSIX shared memory object [name] (e.g. `/frames`) as a
+  /// frame ring for consumers in other processes.
+  ///
+  /// Each of the [slotCount] slots holds [slotCapacity] pixel bytes, e.g.
+  /// width * height * 4 for RGBA. With [blocking] the writer waits for the
+  /// reader instead of overwriting frames it has not read. The layout is
+  /// described in `ffmpeg_core.h`, which also has a reader for native
+  /// consumers. Replaces any open ring.
+  ///
+  /// Returns false on failure, and always on Windows and Android.
+  bool openSharedMemorySink(String name,
+      {int slotCount = 4, required int slotCapacity, bool blocking = false}) {
+    final namePtr = name.toNativeUtf8();
+    final result =
+        _bindings.shmSinkOpen(namePtr, slotCount, slotCapacity, blocking ? 1 : 0);
+    calloc.free(namePtr);
+    return result == 0;
+  }
+
+  /// Closes and unlinks the ring made by [openSharedMemorySink].
+  void closeSharedMemorySink() {
+    _bindings.shmSinkClose();
+  }
+
+  /// Decodes every frame between [start] and [end] (the end of the media
+  /// by default) straight into the shared memory ring.
+  ///
+  /// Frames follow [setVideoOutputOptions] as RGBA or GRAY8, without
+  /// pyramid levels, and never reach Dart. The stream ends with an end of
+  /// stream slot.
+  ///
+  /// Returns the number of frames written, or null on failure, when a
+  /// frame does not fit a slot, or when no ring is open.
+  Future<int?> streamToSharedMemory({
+    Duration start = Duration.zero,
+    Duration? end,
+  }) {
+    if (!_isOpened) return Future.value(null);
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<int>();
+    _pendingShmStreams[callbackId] = request;
+
+    request.requestId = _bindings.streamToShmAsync(
+      start.inMilliseconds,
+      end?.inMilliseconds ?? -1,
+      _shmStreamCallbackPointer,
+      userData.cast(),
+    );
+
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingShmStreams.remove(callbackId);
+      return Future.value(null);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Transcodes the open media into a low resolution, all-intra MJPEG
+  /// proxy at [outputPath], in the background.
+  ///
+  /// Every proxy frame is a keyframe, so seeking in it costs one decode
+  /// instead of up to a whole GOP. Once written the proxy is attached:
+  /// [presentFrameAtTimestamp] and [generateSpriteSheet] read from it,
+  /// while every other request keeps decoding the original at full
+  /// resolution. The container follows the extension of [outputPath]
+  /// (.mkv, .mov, ...). [height] is in lines (0 for 360, never above the
+  /// source) and [quality] is 1-100 (0 for the default).
+  /// [progressCallback] receives the milliseconds transcoded so far and
+  /// the duration.
+  ///
+  /// Completes with false on failure or when cancelled with [cancelProxy].
+  Future<bool> generateProxy(
+    String outputPath, {
+    int height = 0,
+    int quality = 0,
+    OnProgressCallback? progressCallback,
+  }) {
+    if (!_isOpened) return Future.value(false);
+
+    final options = calloc<ffi_bindings.ProxyOptions>();
+    options.ref.height = height;
+    options.ref.quality = quality;
+    final pathPtr = outputPath.toNativeUtf8();
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<bool>()..progressCallback = progressCallback;
+    _pendingProxies[callbackId] = request;
+
+    request.requestId = _bindings.generateProxyAsync(
+      pathPtr,
+      options,
+      _proxyCallbackPointer,
+      progressCallback != null ? _progressCallbackPointer : nullptr,
+      userData.cast(),
+    );
+    calloc.free(options);
+    calloc.free(pathPtr);
+
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingProxies.remove(callbackId);
+      return Future.value(false);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Stops every running [generateProxy] job and removes its partial file.
+  void cancelProxy() {
+    for (final request in _pendingProxies.values) {
+      _bindings.cancelRequest(request.requestId);
+    }
+  }
+
+  /// Serves scrubbing and thumbnails from an existing proxy at [path], as
+  /// made by [generateProxy] for this media. A null [path] detaches it.
+  /// Closing the media detaches it too.
+  ///
+  /// Returns false if no media is open or the proxy cannot be opened.
+  bool attachProxy(String? path) {
+    final pathPtr = path != null ? path.toNativeUtf8() : nullptr;
+    final result = _bindings.attachProxy(pathPtr);
+    if (path != null) calloc.free(pathPtr);
+    return result == 0;
+  }
+
+  /// Copies [start] to [end] of the open media into [outputPath] without
+  /// re-encoding, in the background.
+  ///
+  /// Packets are copied as they are, so this runs at disk speed. Video
+  /// starts at the keyframe at or before [start] and the export's
+  /// timestamps start at 0. With [exact], MP4 and MOV exports keep the
+  /// frames before [start] for decoding but hide them with an edit list;
+  /// other containers start at the keyframe regardless. With [smart], the
+  /// export starts and ends on the exact frames in any container, with
+  /// [start] at timestamp 0: only the partial GOPs at the cuts are
+  /// re-encoded, with the source's codec and settings, and the rest is
+  /// copied (H.264, HEVC and codecs without extradata). [smart] takes precedence over [exact]. The container
+  /// follows the extension of [outputPath] (.mp4, .mkv, ...), and every
+  /// video, audio and subtitle stream it can hold is copied.
+  /// [progressCallback] receives the milliseconds copied so far and the
+  /// length of the range.
+  ///
+  /// Completes with false on failure or when cancelled with
+  /// [cancelExport].
+  Future<bool> exportRange(
+    String outputPath, {
+    required Duration start,
+    required Duration end,
+    bool exact = false,
+    bool smart = false,
+    OnProgressCallback? progressCallback,
+  }) {
+    if (!_isOpened) return Future.value(false);
+
+    final options = calloc<ffi_bindings.ExportOptions>();
+    options.ref.exact = exact ? 1 : 0;
+    options.ref.smart = smart ? 1 : 0;
+    final pathPtr = outputPath.toNativeUtf8();
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<bool>()..progressCallback = progressCallback;
+    _pendingExports[callbackId] = request;
+
+    request.requestId = _bindings.exportRangeAsync(
+      start.inMilliseconds,
+      end.inMilliseconds,
+      pathPtr,
+      options,
+      _exportCallbackPointer,
+      progressCallback != null ? _progressCallbackPointer : nullptr,
+      userData.cast(),
+    );
+    calloc.free(options);
+    calloc.free(pathPtr);
+
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingExports.remove(callbackId);
+      return Future.value(false);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Stops every running [exportRange] job and removes its partial file.
+  void cancelExport() {
+    for (final request in _pendingExports.values) {
+      _bindings.cancelRequest(request.requestId);
+    }
+  }
+
+  /// Reads per-packet statistics of the video stream without decoding.
+  ///
+  /// This runs at demuxer speed on a separate native reader and is meant
+  /// as a cheap first pass: packet sizes, picture types and keyframes,
+  /// plus a bitrate curve, the GOP structure and likely cuts, to decide
+  /// which segments deserve a full decode. [cutSensitivity] is how many
+  /// times larger than its neighbours a packet must be to count as a cut
+  /// (0 for the default). [progressCallback] receives the packets read so
+  /// far and the frame count of the stream (0 when unknown).
+  ///
+  /// Returns null on failure.
+  Future<VideoPacketStats?> getPacketStats({
+    Duration start = Duration.zero,
+    Duration? end,
+    Duration bitrateWindow = const Duration(seconds: 1),
+    double cutSensitivity = 0,
+    OnProgressCallback? progressCallback,
+  }) {
+    if (!_isOpened) return Future.value(null);
+
+    final options = calloc<ffi_bindings.PacketStatsOptions>();
+    options.ref.startMs = start.inMilliseconds;
+    options.ref.endMs = end?.inMilliseconds ?? 0;
+    options.ref.bitrateWindowMs = bitrateWindow.inMilliseconds;
+    options.ref.cutSensitivity = cutSensitivity;
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<VideoPacketStats>()
+      ..progressCallback = progressCallback;
+    _pendingPacketStats[callbackId] = request;
+
+    request.requestId = _bindings.getPacketStatsAsync(
+      options,
+      _packetStatsCallbackPointer,
+      progressCallback != null ? _progressCallbackPointer : nullptr,
+      userData.cast(),
+    );
+    calloc.free(options);
+
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingPacketStats.remove(callbackId);
+      return Future.value(null);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Decodes the video frame at [timestampMs] and encodes it natively.
+  ///
+  /// Decoding and encoding both run on the native worker thread, and only
+  /// the compressed bytes reach Dart. The frame follows
+  /// [setVideoOutputOptions]. [quality] (1-100, 0 for the default) applies
+  /// to JPEG and WebP.
+  ///
+  /// Returns null on failure.
+  Future<EncodedVideoFrame?> getEncodedFrameAtTimestamp(
+    int timestampMs, {
+    ImageFormat format = ImageFormat.jpeg,
+    int quality = 0,
+  }) {
+    return _requestEncodedFrame(format, (userData) => _bindings
+        .getEncodedFrameAtTimestampAsync(timestampMs, format.index, quality,
+            _encodedFrameCallbackPointer, userData));
+  }
+
+  /// Decodes the video frame at [index] and encodes it natively.
+  ///
+  /// See [getEncodedFrameAtTimestamp].
+  Future<EncodedVideoFrame?> getEncodedFrameAtIndex(
+    int index, {
+    ImageFormat format = ImageFormat.jpeg,
+    int quality = 0,
+  }) {
+    return _requestEncodedFrame(format, (userData) => _bindings
+        .getEncodedFrameAtIndexAsync(index, format.index, quality,
+            _encodedFrameCallbackPointer, userData));
+  }
+
+  Future<EncodedVideoFrame?> _requestEncodedFrame(
+      ImageFormat format, int Function(Pointer<Void> userData) submit) {
+    if (!_isOpened || format == ImageFormat.none) return Future.value(null);
+
+    final callbackId = _nextCallbackId++;
+    final userData = calloc<Int64>();
+    userData.value = callbackId;
+
+    final request = _PendingJob<EncodedVideoFrame>();
+    _pendingEncodedFrames[callbackId] = request;
+
+    request.requestId = submit(userData.cast());
+    if (request.requestId < 0) {
+      calloc.free(userData);
+      _pendingEncodedFrames.remove(callbackId);
+      return Future.value(null);
+    }
+
+    return request.completer.future;
+  }
+
+  /// Creates the display texture and returns its id for a `Texture` widget.
+  ///
+  /// Frames shown with [presentFrameAtTimestamp] go from the native worker
+  /// straight into the texture; no pixels cross into Dart. Only Linux has
+  /// a texture plugin, so other platforms get null and should keep using
+  /// the frame callbacks.
+  Future<int?> createTexture() async {
+    if (!Platform.isLinux) return null;
+    return _textureId ??= await _channel.invokeMethod<int>('createTexture');
+  }
+
+  /// Unregisters the texture made by [createTexture].
+  Future<void> disposeTexture() async {
+    if (_textureId == null) return;
+    _textureId = null;
+    await _channel.invokeMethod<void>('disposeTexture');
+  }
+
+  /// Decodes the frame at [timestamp] into the display texture.
+  ///
+  /// The frame is RGBA and follows [setVideoOutputOptions]. A newer call
+  /// replaces the shown frame when it completes; requests are not
+  /// coalesced, so a player should cancel ones it no longer needs.
+  ///
+  /// Returns a request id for [cancelPresent], or -1.
+  int presentFrameAtTimestamp(Duration timestamp) {
+    if (!_isOpened || timestamp.isNegative) return -1;
+    return _bindings
+        .presentVideoFrameAtTimestampAsync(timestamp.inMilliseconds);
+  }
+
+  /// Cancels a [presentFrameAtTimestamp] request that has not run yet.
+  void cancelPresent(int requestId) {
+    if (requestId > 0) _bindings.cancelRequest(requestId);
+  }
+
   /// Retrieves a specific frame by its index (ASYNC with callback).
   ///
   /// This method uses native threading for optimal performance.
@@ -351,13 +1233,291 @@ class FfmpegDecoder {
     _FfmpegDecoderRegistry._handleProgress(callbackId, current, total);
   }
 
+  static void _onSpriteSheetCallback(
+      Pointer<Void> userData, Pointer<ffi_bindings.SpriteSheet> sheet, int errorCode) {
+    if (userData == nullptr) return;
+
+    // Sprite sheets get exactly one callback, so the id can go now
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handleSpriteSheet(callbackId, sheet, errorCode);
+  }
+
+  static void _onEncodedFrameCallback(
+      Pointer<Void> userData, Pointer<ffi_bindings.EncodedFrame> frame, int errorCode) {
+    if (userData == nullptr) return;
+
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handleEncodedFrame(callbackId, frame, errorCode);
+  }
+
+  static void _onSceneCutsCallback(
+      Pointer<Void> userData, Pointer<ffi_bindings.SceneCutList> cuts, int errorCode) {
+    if (userData == nullptr) return;
+
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handleSceneCuts(callbackId, cuts, errorCode);
+  }
+
+  static void _onBlackFreezeCallback(Pointer<Void> userData,
+      Pointer<ffi_bindings.BlackFreezeResult> result, int errorCode) {
+    if (userData == nullptr) return;
+
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handleBlackFreeze(callbackId, result, errorCode);
+  }
+
+  static void _onMotionVectorsCallback(Pointer<Void> userData,
+      Pointer<ffi_bindings.MotionVectorTrack> track, int errorCode) {
+    if (userData == nullptr) return;
+
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handleMotionVectors(callbackId, track, errorCode);
+  }
+
+  static void _onShmStreamCallback(
+      Pointer<Void> userData, int framesWritten, int errorCode) {
+    if (userData == nullptr) return;
+
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handleShmStream(callbackId, framesWritten, errorCode);
+  }
+
+  static void _onProxyCallback(Pointer<Void> userData, int errorCode) {
+    if (userData == nullptr) return;
+
+    // Progress callbacks share the id and are delivered first
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handleProxy(callbackId, errorCode);
+  }
+
+  static void _onExportCallback(Pointer<Void> userData, int errorCode) {
+    if (userData == nullptr) return;
+
+    // Progress callbacks share the id and are delivered first
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handleExport(callbackId, errorCode);
+  }
+
+  static void _onPacketStatsCallback(
+      Pointer<Void> userData, Pointer<ffi_bindings.PacketStats> stats, int errorCode) {
+    if (userData == nullptr) return;
+
+    // Progress callbacks share the id and are delivered first
+    final callbackId = userData.cast<Int64>().value;
+    calloc.free(userData);
+    _FfmpegDecoderRegistry._handlePacketStats(callbackId, stats, errorCode);
+  }
+
+  void _handlePacketStatsInternal(
+      int callbackId, Pointer<ffi_bindings.PacketStats> statsPtr, int errorCode) {
+    final request = _pendingPacketStats.remove(callbackId);
+    if (request == null) return;
+
+    VideoPacketStats? result;
+    if (errorCode >= 0 && statsPtr != nullptr) {
+      final stats = statsPtr.ref;
+      result = VideoPacketStats(
+        packets: List.generate(stats.packetCount, (i) {
+          final packet = stats.packets[i];
+          return VideoPacketInfo(
+            pts: packet.ptsMs < 0 ? null : Duration(milliseconds: packet.ptsMs),
+            dts: packet.dtsMs < 0 ? null : Duration(milliseconds: packet.dtsMs),
+            size: packet.size,
+            keyframe: packet.keyframe != 0,
+            pictureType: packet.pictType < PictureType.values.length
+                ? PictureType.values[packet.pictType]
+                : PictureType.unknown,
+            activity: packet.activity,
+          );
+        }),
+        bitrateKbps: Float32List.fromList(
+            stats.bitrateKbps.asTypedList(stats.bitrateCount)),
+        bitrateWindow: Duration(milliseconds: stats.bitrateWindowMs),
+        gopCount: stats.gopCount,
+        minGopLength: stats.minGopLength,
+        maxGopLength: stats.maxGopLength,
+        averageGopLength: stats.averageGopLength,
+        likelyCuts: List.generate(stats.likelyCutCount,
+            (i) => Duration(milliseconds: stats.likelyCutsMs[i])),
+      );
+    }
+    _bindings.freePacketStats(statsPtr);
+
+    request.completer.complete(result);
+  }
+
+  void _handleBlackFreezeInternal(int callbackId,
+      Pointer<ffi_bindings.BlackFreezeResult> resultPtr, int errorCode) {
+    final request = _pendingBlackFreeze.remove(callbackId);
+    if (request == null) return;
+
+    BlackFreezeResult? result;
+    if (errorCode >= 0 && resultPtr != nullptr) {
+      final scan = resultPtr.ref;
+      TimeRange toRange(ffi_bindings.TimeInterval interval) => TimeRange(
+            start: Duration(milliseconds: interval.startMs),
+            end: Duration(milliseconds: interval.endMs),
+          );
+      result = BlackFreezeResult(
+        black: List.generate(scan.blackCount, (i) => toRange(scan.black[i])),
+        frozen: List.generate(scan.frozenCount, (i) => toRange(scan.frozen[i])),
+        framesAnalyzed: scan.framesAnalyzed,
+      );
+    }
+    _bindings.freeBlackFreeze(resultPtr);
+
+    request.completer.complete(result);
+  }
+
+  void _handleMotionVectorsInternal(int callbackId,
+      Pointer<ffi_bindings.MotionVectorTrack> trackPtr, int errorCode) {
+    final request = _pendingMotionVectors.remove(callbackId);
+    if (request == null) return;
+
+    MotionVectorTrack? result;
+    if (errorCode >= 0 && trackPtr != nullptr) {
+      final track = trackPtr.ref;
+      final vectors = MotionVectors(ByteData.sublistView(track.vectorCount > 0
+          ? Uint8List.fromList(track.vectors.asTypedList(track.vectorCount * 12))
+          : Uint8List(0)));
+      result = MotionVectorTrack(
+        frames: List.generate(track.frameCount, (i) {
+          final frame = track.frames[i];
+          return MotionFrameInfo(
+            pts: Duration(milliseconds: frame.ptsMs),
+            pictureType: frame.pictType < PictureType.values.length
+                ? PictureType.values[frame.pictType]
+                : PictureType.unknown,
+            meanMagnitude: frame.meanMagnitude,
+            maxMagnitude: frame.maxMagnitude,
+            vectors: vectors.sublist(
+                frame.vectorOffset, frame.vectorOffset + frame.vectorCount),
+          );
+        }),
+        width: track.width,
+        height: track.height,
+      );
+    }
+    _bindings.freeMotionVectors(trackPtr);
+
+    request.completer.complete(result);
+  }
+
+  void _handleShmStreamInternal(int callbackId, int framesWritten, int errorCode) {
+    final request = _pendingShmStreams.remove(callbackId);
+    if (request == null) return;
+
+    request.completer.complete(errorCode >= 0 ? framesWritten : null);
+  }
+
+  void _handleProxyInternal(int callbackId, int errorCode) {
+    final request = _pendingProxies.remove(callbackId);
+    if (request == null) return;
+
+    request.completer.complete(errorCode == 0);
+  }
+
+  void _handleExportInternal(int callbackId, int errorCode) {
+    final request = _pendingExports.remove(callbackId);
+    if (request == null) return;
+
+    request.completer.complete(errorCode == 0);
+  }
+
+  void _handleSceneCutsInternal(
+      int callbackId, Pointer<ffi_bindings.SceneCutList> listPtr, int errorCode) {
+    final request = _pendingSceneDetections.remove(callbackId);
+    if (request == null) return;
+
+    SceneDetectionResult? result;
+    if (errorCode >= 0 && listPtr != nullptr) {
+      final list = listPtr.ref;
+      result = SceneDetectionResult(
+        cuts: List.generate(list.count, (i) {
+          final cut = list.cuts[i];
+          return SceneCut(
+            pts: Duration(milliseconds: cut.ptsMs),
+            score: cut.score,
+            sad: cut.sad,
+            histogramDistance: cut.histogram,
+          );
+        }),
+        framesAnalyzed: list.framesAnalyzed,
+      );
+    }
+    _bindings.freeSceneCuts(listPtr);
+
+    request.completer.complete(result);
+  }
+
+  void _handleEncodedFrameInternal(
+      int callbackId, Pointer<ffi_bindings.EncodedFrame> framePtr, int errorCode) {
+    final request = _pendingEncodedFrames.remove(callbackId);
+    if (request == null) return;
+
+    EncodedVideoFrame? result;
+    if (errorCode >= 0 && framePtr != nullptr) {
+      final frame = framePtr.ref;
+      result = EncodedVideoFrame(
+        bytes: Uint8List.fromList(frame.data.asTypedList(frame.size)),
+        format: ImageFormat.values[frame.format],
+        width: frame.width,
+        height: frame.height,
+        pts: Duration(milliseconds: frame.ptsMs),
+        frameId: frame.frameId,
+      );
+    }
+    _bindings.freeEncodedFrame(framePtr);
+
+    request.completer.complete(result);
+  }
+
+  void _handleSpriteSheetInternal(
+      int callbackId, Pointer<ffi_bindings.SpriteSheet> sheetPtr, int errorCode) {
+    final request = _pendingSpriteSheets.remove(callbackId);
+    if (request == null) return;
+
+    SpriteSheet? result;
+    if (errorCode >= 0 && sheetPtr != nullptr) {
+      final sheet = sheetPtr.ref;
+      result = SpriteSheet(
+        rgbaBytes: Uint8List.fromList(
+            sheet.data.asTypedList(sheet.linesize * sheet.height)),
+        imageBytes: sheet.imageData == nullptr
+            ? null
+            : Uint8List.fromList(sheet.imageData.asTypedList(sheet.imageSize)),
+        width: sheet.width,
+        height: sheet.height,
+        columns: sheet.columns,
+        rows: sheet.rows,
+        tileWidth: sheet.tileWidth,
+        tileHeight: sheet.tileHeight,
+        tilePts: List.generate(sheet.tileCount, (i) {
+          final ptsMs = sheet.tilePtsMs[i];
+          return ptsMs < 0 ? null : Duration(milliseconds: ptsMs);
+        }),
+      );
+    }
+    _bindings.freeSpriteSheet(sheetPtr);
+
+    request.completer.complete(result);
+  }
+
   void _handleVideoFrameInternal(int callbackId, Pointer<ffi_bindings.VideoFrame> framePtr, int errorCode) {
     final request = _pendingRequests[callbackId];
     if (request == null) return;
 
     if (errorCode >= 0 && framePtr != nullptr) {
       try {
-        request.videoFrame = _convertAndFreeVideoFrame(framePtr);
+        request.videoFrame = _wrapVideoFrame(framePtr);
       } catch (e) {
         request.videoFrame = null;
       }
@@ -428,39 +1588,68 @@ class FfmpegDecoder {
     _pendingRequests.remove(callbackId);
   }
 
-  /// Converts a native video frame to a Dart VideoFrame and frees the native memory.
-  VideoFrame _convertAndFreeVideoFrame(Pointer<ffi_bindings.VideoFrame> framePtr) {
+  /// Wraps a native video frame in a Dart VideoFrame without copying.
+  ///
+  /// The pixel lists are external typed data over the native buffer, which
+  /// is handed to `ffmpeg_free_video_frame` once the last of them is
+  /// garbage collected. Padded rows (GRAY8 planes shared with the decoder)
+  /// are the exception: they are compacted into a Dart copy and the native
+  /// frame is freed right away.
+  VideoFrame _wrapVideoFrame(Pointer<ffi_bindings.VideoFrame> framePtr) {
     final frame = framePtr.ref;
 
-    final dataSize = frame.linesize * frame.height;
+    final format = frame.format < VideoPixelFormat.values.length
+        ? VideoPixelFormat.values[frame.format]
+        : VideoPixelFormat.rgba;
+    final rowBytes = frame.width * (format == VideoPixelFormat.gray8 ? 1 : 4);
+    final dataSize = rowBytes * frame.height;
     if (dataSize <= 0 || dataSize > 100 * 1024 * 1024) {
       throw StateError('Invalid video frame data size: $dataSize bytes');
     }
 
-    final rgbaBytes = Uint8List(dataSize);
-
     if (frame.data == nullptr) {
       throw StateError('Native frame data pointer is null');
     }
 
     final nativePtr = frame.data.cast<Uint8>();
+    final padded = frame.linesize != rowBytes;
+
+    // One external list spans the frame and its pyramid levels; the views
+    // below keep it, and so the native frame, alive
+    var bufferSize = dataSize;
+    for (int i = 1; i < frame.levelCount; i++) {
+      final level = frame.levels[i];
+      bufferSize = max(bufferSize, level.offset + level.linesize * level.height);
+    }
 
-    try {
-      const chunkSize = 4096;
-      int offset = 0;
-
-      while (offset < dataSize) {
-        final remaining = dataSize - offset;
-        final currentChunk = remaining < chunkSize ? remaining : chunkSize;
-
-        for (int i = 0; i < currentChunk; i++) {
-          rgbaBytes[offset + i] = nativePtr[offset + i];
-        }
-
-        offset += currentChunk;
+    late final Uint8List buffer;
+    final Uint8List rgbaBytes;
+    if (padded) {
+      // Decoder planes are padded, keep the visible part of each row
+      rgbaBytes = Uint8List(dataSize);
+      for (int y = 0; y < frame.height; y++) {
+        rgbaBytes.setRange(y * rowBytes, (y + 1) * rowBytes,
+            (nativePtr + y * frame.linesize).asTypedList(rowBytes));
       }
-    } catch (e) {
-      throw StateError('Failed to copy video frame data: $e');
+    } else {
+      buffer = nativePtr.asTypedList(
+        bufferSize,
+        finalizer: _bindings.freeVideoFramePointer,
+        token: framePtr.cast(),
+      );
+      rgbaBytes = Uint8List.sublistView(buffer, 0, dataSize);
+    }
+
+    // Level 0 is the frame itself
+    final levels = <VideoFrameLevel>[];
+    for (int i = 1; i < frame.levelCount && !padded; i++) {
+      final level = frame.levels[i];
+      levels.add(VideoFrameLevel(
+        width: level.width,
+        height: level.height,
+        rgbaBytes: Uint8List.sublistView(
+            buffer, level.offset, level.offset + level.linesize * level.height),
+      ));
     }
 
     final videoFrame = VideoFrame(
@@ -469,9 +1658,21 @@ class FfmpegDecoder {
       rgbaBytes: rgbaBytes,
       pts: Duration(milliseconds: frame.ptsMs),
       frameId: frame.frameId,
+      levels: levels,
+      format: format,
+      stats: frame.stats.valid != 0
+          ? FrameStats(
+              mean: frame.stats.mean,
+              variance: frame.stats.variance,
+              blackRatio: frame.stats.blackRatio,
+              difference:
+                  frame.stats.difference < 0 ? null : frame.stats.difference,
+              histogram: List.generate(16, (i) => frame.stats.histogram[i]),
+            )
+          : null,
     );
 
-    _bindings.freeVideoFrame(framePtr);
+    if (padded) _bindings.freeVideoFrame(framePtr);
 
     return videoFrame;
   }
@@ -529,6 +1730,21 @@ class FfmpegDecoder {
     for (final callbackId in _pendingRequests.keys.toList()) {
       cancelRequest(callbackId);
     }
+    // Jobs still call back once cancelled, which completes them
+    for (final request in [
+      ..._pendingSpriteSheets.values,
+      ..._pendingEncodedFrames.values,
+      ..._pendingSceneDetections.values,
+      ..._pendingPacketStats.values,
+      ..._pendingBlackFreeze.values,
+      ..._pendingMotionVectors.values,
+      ..._pendingShmStreams.values,
+      ..._pendingProxies.values,
+      ..._pendingExports.values,
+    ]) {
+      _bindings.cancelRequest(request.requestId);
+    }
+    await disposeTexture();
 
     if (_isOpened) {
       _bindings.stop();
@@ -578,6 +1794,13 @@ class _PendingRequest {
   });
 }
 
+/// Internal class to track a pending native job with a single result.
+class _PendingJob<T> {
+  int requestId = 0;
+  OnProgressCallback? progressCallback;
+  final Completer<T?> completer = Completer();
+}
+
 /// Global registry to manage decoder instances and route callbacks.
 class _FfmpegDecoderRegistry {
   static final Map<int, FfmpegDecoder> _decoders = {};
@@ -611,12 +1834,106 @@ class _FfmpegDecoderRegistry {
     }
   }
 
+  static void _handleSpriteSheet(
+      int callbackId, Pointer<ffi_bindings.SpriteSheet> sheet, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingSpriteSheets.containsKey(callbackId)) {
+        decoder._handleSpriteSheetInternal(callbackId, sheet, errorCode);
+        break;
+      }
+    }
+  }
+
+  static void _handlePacketStats(
+      int callbackId, Pointer<ffi_bindings.PacketStats> stats, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingPacketStats.containsKey(callbackId)) {
+        decoder._handlePacketStatsInternal(callbackId, stats, errorCode);
+        break;
+      }
+    }
+  }
+
+  static void _handleBlackFreeze(int callbackId,
+      Pointer<ffi_bindings.BlackFreezeResult> result, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingBlackFreeze.containsKey(callbackId)) {
+        decoder._handleBlackFreezeInternal(callbackId, result, errorCode);
+        break;
+      }
+    }
+  }
+
+  static void _handleMotionVectors(int callbackId,
+      Pointer<ffi_bindings.MotionVectorTrack> track, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingMotionVectors.containsKey(callbackId)) {
+        decoder._handleMotionVectorsInternal(callbackId, track, errorCode);
+        break;
+      }
+    }
+  }
+
+  static void _handleShmStream(int callbackId, int framesWritten, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingShmStreams.containsKey(callbackId)) {
+        decoder._handleShmStreamInternal(callbackId, framesWritten, errorCode);
+        break;
+      }
+    }
+  }
+
+  static void _handleProxy(int callbackId, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingProxies.containsKey(callbackId)) {
+        decoder._handleProxyInternal(callbackId, errorCode);
+        break;
+      }
+    }
+  }
+
+  static void _handleExport(int callbackId, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingExports.containsKey(callbackId)) {
+        decoder._handleExportInternal(callbackId, errorCode);
+        break;
+      }
+    }
+  }
+
+  static void _handleSceneCuts(
+      int callbackId, Pointer<ffi_bindings.SceneCutList> cuts, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingSceneDetections.containsKey(callbackId)) {
+        decoder._handleSceneCutsInternal(callbackId, cuts, errorCode);
+        break;
+      }
+    }
+  }
+
+  static void _handleEncodedFrame(
+      int callbackId, Pointer<ffi_bindings.EncodedFrame> frame, int errorCode) {
+    for (final decoder in _decoders.values) {
+      if (decoder._pendingEncodedFrames.containsKey(callbackId)) {
+        decoder._handleEncodedFrameInternal(callbackId, frame, errorCode);
+        break;
+      }
+    }
+  }
+
   static void _handleProgress(int callbackId, int current, int total) {
     for (final decoder in _decoders.values) {
       if (decoder._pendingRequests.containsKey(callbackId)) {
         decoder._handleProgressInternal(callbackId, current, total);
         break;
       }
+      final job = decoder._pendingPacketStats[callbackId] ??
+          decoder._pendingProxies[callbackId] ??
+          decoder._pendingExports[callbackId];
+      if (job != null) {
+        job.progressCallback?.call(current, total);
+        break;
+      }
     }
   }
 }
@@ -22,6 +22,51 @@ typedef NativeOnFrameRangeProgressCallback = Void Function(
 typedef DartOnFrameRangeProgressCallback = void Function(
     Pointer<Void> userData, int current, int total);
 
+typedef NativeOnSpriteSheetCallback = Void Function(
+    Pointer<Void> userData, Pointer<SpriteSheet> sheet, Int32 errorCode);
+typedef DartOnSpriteSheetCallback = void Function(
+    Pointer<Void> userData, Pointer<SpriteSheet> sheet, int errorCode);
+
+typedef NativeOnSceneCutsCallback = Void Function(
+    Pointer<Void> userData, Pointer<SceneCutList> cuts, Int32 errorCode);
+typedef DartOnSceneCutsCallback = void Function(
+    Pointer<Void> userData, Pointer<SceneCutList> cuts, int errorCode);
+
+typedef NativeOnPacketStatsCallback = Void Function(
+    Pointer<Void> userData, Pointer<PacketStats> stats, Int32 errorCode);
+typedef DartOnPacketStatsCallback = void Function(
+    Pointer<Void> userData, Pointer<PacketStats> stats, int errorCode);
+
+typedef NativeOnBlackFreezeCallback = Void Function(Pointer<Void> userData,
+    Pointer<BlackFreezeResult> result, Int32 errorCode);
+typedef DartOnBlackFreezeCallback = void Function(Pointer<Void> userData,
+    Pointer<BlackFreezeResult> result, int errorCode);
+
+typedef NativeOnMotionVectorsCallback = Void Function(Pointer<Void> userData,
+    Pointer<MotionVectorTrack> track, Int32 errorCode);
+typedef DartOnMotionVectorsCallback = void Function(Pointer<Void> userData,
+    Pointer<MotionVectorTrack> track, int errorCode);
+
+typedef NativeOnShmStreamCallback = Void Function(
+    Pointer<Void> userData, Int32 framesWritten, Int32 errorCode);
+typedef DartOnShmStreamCallback = void Function(
+    Pointer<Void> userData, int framesWritten, int errorCode);
+
+typedef NativeOnProxyCallback = Void Function(
+    Pointer<Void> userData, Int32 errorCode);
+typedef DartOnProxyCallback = void Function(
+    Pointer<Void> userData, int errorCode);
+
+typedef NativeOnExportCallback = Void Function(
+    Pointer<Void> userData, Int32 errorCode);
+typedef DartOnExportCallback = void Function(
+    Pointer<Void> userData, int errorCode);
+
+typedef NativeOnEncodedFrameCallback = Void Function(
+    Pointer<Void> userData, Pointer<EncodedFrame> frame, Int32 errorCode);
+typedef DartOnEncodedFrameCallback = void Function(
+    Pointer<Void> userData, Pointer<EncodedFrame> frame, int errorCode);
+
 // --- Structs ---
 
 final class MediaInfo extends Struct {
@@ -45,6 +90,131 @@ final class MediaInfo extends Struct {
 
   @Int64()
   external int totalFrames;
+
+  @Int32()
+  external int rotation;
+}
+
+final class VideoOutputOptions extends Struct {
+  @Int32()
+  external int rotation;
+
+  @Int32()
+  external int flipHorizontal;
+
+  @Int32()
+  external int flipVertical;
+
+  @Int32()
+  external int cropX;
+
+  @Int32()
+  external int cropY;
+
+  @Int32()
+  external int cropWidth;
+
+  @Int32()
+  external int cropHeight;
+
+  @Int32()
+  external int outputWidth;
+
+  @Int32()
+  external int outputHeight;
+
+  @Int32()
+  external int pyramidLevels;
+
+  @Int32()
+  external int frameStats;
+
+  @Int32()
+  external int pixelFormat;
+}
+
+final class TensorOptions extends Struct {
+  @Int32()
+  external int width;
+
+  @Int32()
+  external int height;
+
+  @Int32()
+  external int format;
+
+  @Int32()
+  external int letterbox;
+
+  @Int32()
+  external int padValue;
+
+  @Int32()
+  external int bgr;
+
+  @Array(3)
+  external Array<Float> mean;
+
+  @Array(3)
+  external Array<Float> std;
+}
+
+final class TensorBatch extends Struct {
+  external Pointer<Void> data;
+
+  @Size()
+  external int dataSize;
+
+  external Pointer<Int64> ptsMs;
+
+  @Int32()
+  external int count;
+
+  @Int32()
+  external int contentX;
+
+  @Int32()
+  external int contentY;
+
+  @Int32()
+  external int contentWidth;
+
+  @Int32()
+  external int contentHeight;
+}
+
+final class FrameStats extends Struct {
+  @Int32()
+  external int valid;
+
+  @Float()
+  external double mean;
+
+  @Float()
+  external double variance;
+
+  @Float()
+  external double blackRatio;
+
+  @Float()
+  external double difference;
+
+  @Array(16)
+  external Array<Uint32> histogram;
+}
+
+final class VideoFrameLevel extends Struct {
+  @Size()
+  external int offset;
+
+  @Int32()
+  external int width;
+
+  @Int32()
+  external int height;
+
+  @Int32()
+  external int linesize;
 }
 
 final class VideoFrame extends Struct {
@@ -64,6 +234,332 @@ final class VideoFrame extends Struct {
 
   @Int64()
   external int frameId;
+
+  @Int32()
+  external int levelCount;
+
+  external Pointer<VideoFrameLevel> levels;
+
+  external FrameStats stats;
+
+  @Int32()
+  external int format;
+
+  external Pointer<Void> sourceFrame;
+}
+
+final class SpriteSheetOptions extends Struct {
+  @Int32()
+  external int columns;
+
+  @Int32()
+  external int rows;
+
+  @Int32()
+  external int tileWidth;
+
+  @Int32()
+  external int tileHeight;
+
+  @Int64()
+  external int startMs;
+
+  @Int64()
+  external int endMs;
+
+  @Int32()
+  external int keyframeAligned;
+
+  @Int32()
+  external int threads;
+
+  @Int32()
+  external int imageFormat;
+
+  @Int32()
+  external int quality;
+}
+
+final class SpriteSheet extends Struct {
+  external Pointer<Uint8> data;
+
+  @Int32()
+  external int width;
+
+  @Int32()
+  external int height;
+
+  @Int32()
+  external int linesize;
+
+  @Int32()
+  external int columns;
+
+  @Int32()
+  external int rows;
+
+  @Int32()
+  external int tileWidth;
+
+  @Int32()
+  external int tileHeight;
+
+  @Int32()
+  external int tileCount;
+
+  external Pointer<Int64> tilePtsMs;
+
+  external Pointer<Uint8> imageData;
+
+  @Size()
+  external int imageSize;
+}
+
+final class EncodedFrame extends Struct {
+  external Pointer<Uint8> data;
+
+  @Size()
+  external int size;
+
+  @Int32()
+  external int format;
+
+  @Int32()
+  external int width;
+
+  @Int32()
+  external int height;
+
+  @Int64()
+  external int ptsMs;
+
+  @Int64()
+  external int frameId;
+}
+
+final class SceneDetectOptions extends Struct {
+  @Float()
+  external double threshold;
+
+  @Int32()
+  external int analysisWidth;
+
+  @Int64()
+  external int startMs;
+
+  @Int64()
+  external int endMs;
+
+  @Int64()
+  external int minSceneMs;
+
+  @Int32()
+  external int threads;
+}
+
+final class SceneCut extends Struct {
+  @Int64()
+  external int ptsMs;
+
+  @Float()
+  external double score;
+
+  @Float()
+  external double sad;
+
+  @Float()
+  external double histogram;
+}
+
+final class SceneCutList extends Struct {
+  external Pointer<SceneCut> cuts;
+
+  @Int32()
+  external int count;
+
+  @Int32()
+  external int framesAnalyzed;
+}
+
+final class PacketStatsOptions extends Struct {
+  @Int64()
+  external int startMs;
+
+  @Int64()
+  external int endMs;
+
+  @Int64()
+  external int bitrateWindowMs;
+
+  @Float()
+  external double cutSensitivity;
+}
+
+final class PacketInfo extends Struct {
+  @Int64()
+  external int ptsMs;
+
+  @Int64()
+  external int dtsMs;
+
+  @Int32()
+  external int size;
+
+  @Int32()
+  external int keyframe;
+
+  @Int32()
+  external int pictType;
+
+  @Float()
+  external double activity;
+}
+
+final class PacketStats extends Struct {
+  external Pointer<PacketInfo> packets;
+
+  @Int32()
+  external int packetCount;
+
+  external Pointer<Float> bitrateKbps;
+
+  @Int32()
+  external int bitrateCount;
+
+  @Int64()
+  external int bitrateWindowMs;
+
+  @Int32()
+  external int gopCount;
+
+  @Int32()
+  external int minGopLength;
+
+  @Int32()
+  external int maxGopLength;
+
+  @Float()
+  external double averageGopLength;
+
+  external Pointer<Int64> likelyCutsMs;
+
+  @Int32()
+  external int likelyCutCount;
+}
+
+final class BlackFreezeOptions extends Struct {
+  @Int64()
+  external int startMs;
+
+  @Int64()
+  external int endMs;
+
+  @Float()
+  external double blackRatio;
+
+  @Float()
+  external double freezeDifference;
+
+  @Int64()
+  external int minBlackMs;
+
+  @Int64()
+  external int minFreezeMs;
+
+  @Int32()
+  external int threads;
+}
+
+final class TimeInterval extends Struct {
+  @Int64()
+  external int startMs;
+
+  @Int64()
+  external int endMs;
+}
+
+final class BlackFreezeResult extends Struct {
+  external Pointer<TimeInterval> black;
+
+  @Int32()
+  external int blackCount;
+
+  external Pointer<TimeInterval> frozen;
+
+  @Int32()
+  external int frozenCount;
+
+  @Int32()
+  external int framesAnalyzed;
+}
+
+final class MotionVectorOptions extends Struct {
+  @Int64()
+  external int startMs;
+
+  @Int64()
+  external int endMs;
+
+  @Int32()
+  external int includeVectors;
+
+  @Int32()
+  external int threads;
+}
+
+final class MotionFrame extends Struct {
+  @Int64()
+  external int ptsMs;
+
+  @Int32()
+  external int pictType;
+
+  @Int32()
+  external int vectorOffset;
+
+  @Int32()
+  external int vectorCount;
+
+  @Float()
+  external double meanMagnitude;
+
+  @Float()
+  external double maxMagnitude;
+}
+
+final class MotionVectorTrack extends Struct {
+  external Pointer<MotionFrame> frames;
+
+  @Int32()
+  external int frameCount;
+
+  /// Packed MotionVector records, 12 bytes each.
+  external Pointer<Uint8> vectors;
+
+  @Int32()
+  external int vectorCount;
+
+  @Int32()
+  external int width;
+
+  @Int32()
+  external int height;
+}
+
+final class ProxyOptions extends Struct {
+  @Int32()
+  external int height;
+
+  @Int32()
+  external int quality;
+}
+
+final class ExportOptions extends Struct {
+  @Int32()
+  external int exact;
+
+  @Int32()
+  external int smart;
 }
 
 final class AudioFrame extends Struct {
@@ -96,6 +592,11 @@ typedef DartFfmpegRelease = void Function();
 typedef NativeFfmpegOpenMedia = Int32 Function(Pointer<Utf8> url);
 typedef DartFfmpegOpenMedia = int Function(Pointer<Utf8> url);
 
+typedef NativeFfmpegOpenImageSequence = Int32 Function(
+    Pointer<Utf8> pattern, Double fps);
+typedef DartFfmpegOpenImageSequence = int Function(
+    Pointer<Utf8> pattern, double fps);
+
 typedef NativeFfmpegGetMediaInfo = MediaInfo Function();
 typedef DartFfmpegGetMediaInfo = MediaInfo Function();
 
@@ -108,6 +609,23 @@ typedef DartFfmpegFreeVideoFrame = void Function(Pointer<VideoFrame> frame);
 typedef NativeFfmpegFreeAudioFrame = Void Function(Pointer<AudioFrame> frame);
 typedef DartFfmpegFreeAudioFrame = void Function(Pointer<AudioFrame> frame);
 
+typedef NativeFfmpegSetHdrToneMapping = Void Function(Int32 enabled);
+typedef DartFfmpegSetHdrToneMapping = void Function(int enabled);
+
+typedef NativeFfmpegSetVideoOutputOptions = Void Function(
+    Pointer<VideoOutputOptions> options);
+typedef DartFfmpegSetVideoOutputOptions = void Function(
+    Pointer<VideoOutputOptions> options);
+
+typedef NativeFfmpegSetFrameCacheSize = Void Function(Size maxBytes);
+typedef DartFfmpegSetFrameCacheSize = void Function(int maxBytes);
+typedef NativeFfmpegSetCompressedFrameCacheSize = Void Function(Size maxBytes);
+typedef DartFfmpegSetCompressedFrameCacheSize = void Function(int maxBytes);
+typedef NativeFfmpegSetFrameSpillFile = Int32 Function(
+    Pointer<Utf8> path, Size maxBytes, Int32 persistent);
+typedef DartFfmpegSetFrameSpillFile = int Function(
+    Pointer<Utf8> path, int maxBytes, int persistent);
+
 // --- Async Frame Retrieval Functions ---
 
 typedef NativeFfmpegGetVideoFrameAtTimestampAsync = Int64 Function(
@@ -164,6 +682,215 @@ typedef DartFfmpegGetVideoFramesRangeAsync = int Function(
 typedef NativeFfmpegCancelRequest = Void Function(Int64 requestId);
 typedef DartFfmpegCancelRequest = void Function(int requestId);
 
+// --- Tensor Output Functions ---
+
+typedef NativeFfmpegGetTensorSize = Size Function(
+    Pointer<TensorOptions> options);
+typedef DartFfmpegGetTensorSize = int Function(Pointer<TensorOptions> options);
+
+typedef NativeFfmpegGetVideoTensorsRangeByIndex = Int32 Function(
+    Int32 startIndex,
+    Int32 endIndex,
+    Pointer<TensorOptions> options,
+    Pointer<TensorBatch> outBatch);
+typedef DartFfmpegGetVideoTensorsRangeByIndex = int Function(
+    int startIndex,
+    int endIndex,
+    Pointer<TensorOptions> options,
+    Pointer<TensorBatch> outBatch);
+
+typedef NativeFfmpegGetVideoTensorsRangeByTimestamp = Int32 Function(
+    Int64 startMs,
+    Int64 endMs,
+    Int64 stepMs,
+    Pointer<TensorOptions> options,
+    Pointer<TensorBatch> outBatch);
+typedef DartFfmpegGetVideoTensorsRangeByTimestamp = int Function(
+    int startMs,
+    int endMs,
+    int stepMs,
+    Pointer<TensorOptions> options,
+    Pointer<TensorBatch> outBatch);
+
+// --- Sprite Sheet Functions ---
+
+typedef NativeFfmpegGenerateSpriteSheetAsync = Int64 Function(
+    Pointer<SpriteSheetOptions> options,
+    Pointer<NativeFunction<NativeOnSpriteSheetCallback>> callback,
+    Pointer<Void> userData);
+typedef DartFfmpegGenerateSpriteSheetAsync = int Function(
+    Pointer<SpriteSheetOptions> options,
+    Pointer<NativeFunction<NativeOnSpriteSheetCallback>> callback,
+    Pointer<Void> userData);
+
+typedef NativeFfmpegFreeSpriteSheet = Void Function(Pointer<SpriteSheet> sheet);
+typedef DartFfmpegFreeSpriteSheet = void Function(Pointer<SpriteSheet> sheet);
+
+// --- Encoded Frame Functions ---
+
+typedef NativeFfmpegGetEncodedFrameAtTimestampAsync = Int64 Function(
+    Int64 timestampMs,
+    Int32 imageFormat,
+    Int32 quality,
+    Pointer<NativeFunction<NativeOnEncodedFrameCallback>> callback,
+    Pointer<Void> userData);
+typedef DartFfmpegGetEncodedFrameAtTimestampAsync = int Function(
+    int timestampMs,
+    int imageFormat,
+    int quality,
+    Pointer<NativeFunction<NativeOnEncodedFrameCallback>> callback,
+    Pointer<Void> userData);
+
+typedef NativeFfmpegGetEncodedFrameAtIndexAsync = Int64 Function(
+    Int32 frameIndex,
+    Int32 imageFormat,
+    Int32 quality,
+    Pointer<NativeFunction<NativeOnEncodedFrameCallback>> callback,
+    Pointer<Void> userData);
+typedef DartFfmpegGetEncodedFrameAtIndexAsync = int Function(
+    int frameIndex,
+    int imageFormat,
+    int quality,
+    Pointer<NativeFunction<NativeOnEncodedFrameCallback>> callback,
+    Pointer<Void> userData);
+
+typedef NativeFfmpegFreeEncodedFrame = Void Function(
+    Pointer<EncodedFrame> frame);
+typedef DartFfmpegFreeEncodedFrame = void Function(Pointer<EncodedFrame> frame);
+
+// --- Scene Detection Functions ---
+
+typedef NativeFfmpegDetectScenesAsync = Int64 Function(
+    Pointer<SceneDetectOptions> options,
+    Pointer<NativeFunction<NativeOnSceneCutsCallback>> callback,
+    Pointer<Void> userData);
+typedef DartFfmpegDetectScenesAsync = int Function(
+    Pointer<SceneDetectOptions> options,
+    Pointer<NativeFunction<NativeOnSceneCutsCallback>> callback,
+    Pointer<Void> userData);
+
+typedef NativeFfmpegFreeSceneCuts = Void Function(Pointer<SceneCutList> cuts);
+typedef DartFfmpegFreeSceneCuts = void Function(Pointer<SceneCutList> cuts);
+
+// --- Black and Freeze Detection Functions ---
+
+typedef NativeFfmpegDetectBlackFreezeAsync = Int64 Function(
+    Pointer<BlackFreezeOptions> options,
+    Pointer<NativeFunction<NativeOnBlackFreezeCallback>> callback,
+    Pointer<Void> userData);
+typedef DartFfmpegDetectBlackFreezeAsync = int Function(
+    Pointer<BlackFreezeOptions> options,
+    Pointer<NativeFunction<NativeOnBlackFreezeCallback>> callback,
+    Pointer<Void> userData);
+
+typedef NativeFfmpegFreeBlackFreeze = Void Function(
+    Pointer<BlackFreezeResult> result);
+typedef DartFfmpegFreeBlackFreeze = void Function(
+    Pointer<BlackFreezeResult> result);
+
+// --- Motion Vector Functions ---
+
+typedef NativeFfmpegGetMotionVectorsAsync = Int64 Function(
+    Pointer<MotionVectorOptions> options,
+    Pointer<NativeFunction<NativeOnMotionVectorsCallback>> callback,
+    Pointer<Void> userData);
+typedef DartFfmpegGetMotionVectorsAsync = int Function(
+    Pointer<MotionVectorOptions> options,
+    Pointer<NativeFunction<NativeOnMotionVectorsCallback>> callback,
+    Pointer<Void> userData);
+
+typedef NativeFfmpegFreeMotionVectors = Void Function(
+    Pointer<MotionVectorTrack> track);
+typedef DartFfmpegFreeMotionVectors = void Function(
+    Pointer<MotionVectorTrack> track);
+
+// --- Packet Statistics Functions ---
+
+typedef NativeFfmpegGetPacketStatsAsync = Int64 Function(
+    Pointer<PacketStatsOptions> options,
+    Pointer<NativeFunction<NativeOnPacketStatsCallback>> callback,
+    Pointer<NativeFunction<NativeOnFrameRangeProgressCallback>>
+        progressCallback,
+    Pointer<Void> userData);
+typedef DartFfmpegGetPacketStatsAsync = int Function(
+    Pointer<PacketStatsOptions> options,
+    Pointer<NativeFunction<NativeOnPacketStatsCallback>> callback,
+    Pointer<NativeFunction<NativeOnFrameRangeProgressCallback>>
+        progressCallback,
+    Pointer<Void> userData);
+
+typedef NativeFfmpegFreePacketStats = Void Function(Pointer<PacketStats> stats);
+typedef DartFfmpegFreePacketStats = void Function(Pointer<PacketStats> stats);
+
+// --- Display Output Functions ---
+
+typedef NativeFfmpegPresentVideoFrameAtTimestampAsync = Int64 Function(
+    Int64 timestampMs);
+typedef DartFfmpegPresentVideoFrameAtTimestampAsync = int Function(
+    int timestampMs);
+
+// --- Shared Memory Ring Functions ---
+
+typedef NativeFfmpegShmSinkOpen = Int32 Function(
+    Pointer<Utf8> name, Int32 slotCount, Size slotCapacity, Int32 blocking);
+typedef DartFfmpegShmSinkOpen = int Function(
+    Pointer<Utf8> name, int slotCount, int slotCapacity, int blocking);
+
+typedef NativeFfmpegShmSinkClose = Void Function();
+typedef DartFfmpegShmSinkClose = void Function();
+
+typedef NativeFfmpegStreamToShmAsync = Int64 Function(
+    Int64 startMs,
+    Int64 endMs,
+    Pointer<NativeFunction<NativeOnShmStreamCallback>> callback,
+    Pointer<Void> userData);
+typedef DartFfmpegStreamToShmAsync = int Function(
+    int startMs,
+    int endMs,
+    Pointer<NativeFunction<NativeOnShmStreamCallback>> callback,
+    Pointer<Void> userData);
+
+// --- Proxy Functions ---
+
+typedef NativeFfmpegGenerateProxyAsync = Int64 Function(
+    Pointer<Utf8> outputPath,
+    Pointer<ProxyOptions> options,
+    Pointer<NativeFunction<NativeOnProxyCallback>> callback,
+    Pointer<NativeFunction<NativeOnFrameRangeProgressCallback>>
+        progressCallback,
+    Pointer<Void> userData);
+typedef DartFfmpegGenerateProxyAsync = int Function(
+    Pointer<Utf8> outputPath,
+    Pointer<ProxyOptions> options,
+    Pointer<NativeFunction<NativeOnProxyCallback>> callback,
+    Pointer<NativeFunction<NativeOnFrameRangeProgressCallback>>
+        progressCallback,
+    Pointer<Void> userData);
+
+typedef NativeFfmpegAttachProxy = Int32 Function(Pointer<Utf8> path);
+typedef DartFfmpegAttachProxy = int Function(Pointer<Utf8> path);
+
+// --- Export Functions ---
+
+typedef NativeFfmpegExportRangeAsync = Int64 Function(
+    Int64 startMs,
+    Int64 endMs,
+    Pointer<Utf8> outputPath,
+    Pointer<ExportOptions> options,
+    Pointer<NativeFunction<NativeOnExportCallback>> callback,
+    Pointer<NativeFunction<NativeOnFrameRangeProgressCallback>>
+        progressCallback,
+    Pointer<Void> userData);
+typedef DartFfmpegExportRangeAsync = int Function(
+    int startMs,
+    int endMs,
+    Pointer<Utf8> outputPath,
+    Pointer<ExportOptions> options,
+    Pointer<NativeFunction<NativeOnExportCallback>> callback,
+    Pointer<NativeFunction<NativeOnFrameRangeProgressCallback>>
+        progressCallback,
+    Pointer<Void> userData);
+
 // --- Bindings Class ---
 
 class LotterwiseFfmpegBindings {
@@ -172,10 +899,19 @@ class LotterwiseFfmpegBindings {
   late final DartFfmpegInit init;
   late final DartFfmpegRelease release;
   late final DartFfmpegOpenMedia openMedia;
+  late final DartFfmpegOpenImageSequence openImageSequence;
   late final DartFfmpegGetMediaInfo getMediaInfo;
   late final DartFfmpegStop stop;
   late final DartFfmpegFreeVideoFrame freeVideoFrame;
+
+  /// ffmpeg_free_video_frame as a finalizer for external typed data.
+  late final Pointer<NativeFinalizerFunction> freeVideoFramePointer;
   late final DartFfmpegFreeAudioFrame freeAudioFrame;
+  late final DartFfmpegSetHdrToneMapping setHdrToneMapping;
+  late final DartFfmpegSetVideoOutputOptions setVideoOutputOptions;
+  late final DartFfmpegSetFrameCacheSize setFrameCacheSize;
+  late final DartFfmpegSetCompressedFrameCacheSize setCompressedFrameCacheSize;
+  late final DartFfmpegSetFrameSpillFile setFrameSpillFile;
 
   // Async functions
   late final DartFfmpegGetVideoFrameAtTimestampAsync
@@ -187,6 +923,53 @@ class LotterwiseFfmpegBindings {
   late final DartFfmpegGetVideoFramesRangeAsync getVideoFramesRangeAsync;
   late final DartFfmpegCancelRequest cancelRequest;
 
+  // Tensor output
+  late final DartFfmpegGetTensorSize getTensorSize;
+  late final DartFfmpegGetVideoTensorsRangeByIndex getVideoTensorsRangeByIndex;
+  late final DartFfmpegGetVideoTensorsRangeByTimestamp
+      getVideoTensorsRangeByTimestamp;
+
+  // Sprite sheets
+  late final DartFfmpegGenerateSpriteSheetAsync generateSpriteSheetAsync;
+  late final DartFfmpegFreeSpriteSheet freeSpriteSheet;
+
+  // Encoded frames
+  late final DartFfmpegGetEncodedFrameAtTimestampAsync
+      getEncodedFrameAtTimestampAsync;
+  late final DartFfmpegGetEncodedFrameAtIndexAsync
+      getEncodedFrameAtIndexAsync;
+  late final DartFfmpegFreeEncodedFrame freeEncodedFrame;
+
+  // Scene detection
+  late final DartFfmpegDetectScenesAsync detectScenesAsync;
+  late final DartFfmpegFreeSceneCuts freeSceneCuts;
+
+  // Black and freeze detection
+  late final DartFfmpegDetectBlackFreezeAsync detectBlackFreezeAsync;
+  late final DartFfmpegFreeBlackFreeze freeBlackFreeze;
+
+  // Motion vectors
+  late final DartFfmpegGetMotionVectorsAsync getMotionVectorsAsync;
+  late final DartFfmpegFreeMotionVectors freeMotionVectors;
+
+  // Packet statistics
+  late final DartFfmpegGetPacketStatsAsync getPacketStatsAsync;
+  late final DartFfmpegFreePacketStats freePacketStats;
+
+  // Display output
+  late final DartFfmpegPresentVideoFrameAtTimestampAsync
+      presentVideoFrameAtTimestampAsync;
+
+  // Shared memory ring
+  late final DartFfmpegShmSinkOpen shmSinkOpen;
+  late final DartFfmpegShmSinkClose shmSinkClose;
+  late final DartFfmpegStreamToShmAsync streamToShmAsync;
+
+  // Proxies
+  late final DartFfmpegGenerateProxyAsync generateProxyAsync;
+  late final DartFfmpegAttachProxy attachProxy;
+  late final DartFfmpegExportRangeAsync exportRangeAsync;
+
   LotterwiseFfmpegBindings() {
     _dylib = _loadDynamicLibrary();
 
@@ -196,13 +979,32 @@ class LotterwiseFfmpegBindings {
         'ffmpeg_release');
     openMedia = _dylib.lookupFunction<NativeFfmpegOpenMedia,
         DartFfmpegOpenMedia>('ffmpeg_open_media');
+    openImageSequence = _dylib.lookupFunction<NativeFfmpegOpenImageSequence,
+        DartFfmpegOpenImageSequence>('ffmpeg_open_image_sequence');
     getMediaInfo = _dylib.lookupFunction<NativeFfmpegGetMediaInfo,
         DartFfmpegGetMediaInfo>('ffmpeg_get_media_info');
     stop = _dylib.lookupFunction<NativeFfmpegStop, DartFfmpegStop>('ffmpeg_stop');
     freeVideoFrame = _dylib.lookupFunction<NativeFfmpegFreeVideoFrame,
         DartFfmpegFreeVideoFrame>('ffmpeg_free_video_frame');
+    freeVideoFramePointer = _dylib
+        .lookup<NativeFunction<NativeFfmpegFreeVideoFrame>>(
+            'ffmpeg_free_video_frame')
+        .cast();
     freeAudioFrame = _dylib.lookupFunction<NativeFfmpegFreeAudioFrame,
         DartFfmpegFreeAudioFrame>('ffmpeg_free_audio_frame');
+    setHdrToneMapping = _dylib.lookupFunction<NativeFfmpegSetHdrToneMapping,
+        DartFfmpegSetHdrToneMapping>('ffmpeg_set_hdr_tone_mapping');
+    setVideoOutputOptions = _dylib.lookupFunction<
+        NativeFfmpegSetVideoOutputOptions,
+        DartFfmpegSetVideoOutputOptions>('ffmpeg_set_video_output_options');
+    setFrameCacheSize = _dylib.lookupFunction<NativeFfmpegSetFrameCacheSize,
+        DartFfmpegSetFrameCacheSize>('ffmpeg_set_frame_cache_size');
+    setCompressedFrameCacheSize = _dylib.lookupFunction<
+        NativeFfmpegSetCompressedFrameCacheSize,
+        DartFfmpegSetCompressedFrameCacheSize>(
+        'ffmpeg_set_compressed_frame_cache_size');
+    setFrameSpillFile = _dylib.lookupFunction<NativeFfmpegSetFrameSpillFile,
+        DartFfmpegSetFrameSpillFile>('ffmpeg_set_frame_spill_file');
 
     // Async functions
     getVideoFrameAtTimestampAsync = _dylib.lookupFunction<
@@ -227,6 +1029,87 @@ class LotterwiseFfmpegBindings {
         'ffmpeg_get_video_frames_range_async');
     cancelRequest = _dylib.lookupFunction<NativeFfmpegCancelRequest,
         DartFfmpegCancelRequest>('ffmpeg_cancel_request');
+
+    // Tensor output
+    getTensorSize = _dylib.lookupFunction<NativeFfmpegGetTensorSize,
+        DartFfmpegGetTensorSize>('ffmpeg_get_tensor_size');
+    getVideoTensorsRangeByIndex = _dylib.lookupFunction<
+        NativeFfmpegGetVideoTensorsRangeByIndex,
+        DartFfmpegGetVideoTensorsRangeByIndex>(
+        'ffmpeg_get_video_tensors_range_by_index');
+    getVideoTensorsRangeByTimestamp = _dylib.lookupFunction<
+        NativeFfmpegGetVideoTensorsRangeByTimestamp,
+        DartFfmpegGetVideoTensorsRangeByTimestamp>(
+        'ffmpeg_get_video_tensors_range_by_timestamp');
+
+    // Sprite sheets
+    generateSpriteSheetAsync = _dylib.lookupFunction<
+        NativeFfmpegGenerateSpriteSheetAsync,
+        DartFfmpegGenerateSpriteSheetAsync>(
+        'ffmpeg_generate_sprite_sheet_async');
+    freeSpriteSheet = _dylib.lookupFunction<NativeFfmpegFreeSpriteSheet,
+        DartFfmpegFreeSpriteSheet>('ffmpeg_free_sprite_sheet');
+
+    // Encoded frames
+    getEncodedFrameAtTimestampAsync = _dylib.lookupFunction<
+        NativeFfmpegGetEncodedFrameAtTimestampAsync,
+        DartFfmpegGetEncodedFrameAtTimestampAsync>(
+        'ffmpeg_get_encoded_frame_at_timestamp_async');
+    getEncodedFrameAtIndexAsync = _dylib.lookupFunction<
+        NativeFfmpegGetEncodedFrameAtIndexAsync,
+        DartFfmpegGetEncodedFrameAtIndexAsync>(
+        'ffmpeg_get_encoded_frame_at_index_async');
+    freeEncodedFrame = _dylib.lookupFunction<NativeFfmpegFreeEncodedFrame,
+        DartFfmpegFreeEncodedFrame>('ffmpeg_free_encoded_frame');
+
+    // Scene detection
+    detectScenesAsync = _dylib.lookupFunction<NativeFfmpegDetectScenesAsync,
+        DartFfmpegDetectScenesAsync>('ffmpeg_detect_scenes_async');
+    freeSceneCuts = _dylib.lookupFunction<NativeFfmpegFreeSceneCuts,
+        DartFfmpegFreeSceneCuts>('ffmpeg_free_scene_cuts');
+
+    // Black and freeze detection
+    detectBlackFreezeAsync = _dylib.lookupFunction<
+        NativeFfmpegDetectBlackFreezeAsync,
+        DartFfmpegDetectBlackFreezeAsync>('ffmpeg_detect_black_freeze_async');
+    freeBlackFreeze = _dylib.lookupFunction<NativeFfmpegFreeBlackFreeze,
+        DartFfmpegFreeBlackFreeze>('ffmpeg_free_black_freeze');
+
+    // Motion vectors
+    getMotionVectorsAsync = _dylib.lookupFunction<
+        NativeFfmpegGetMotionVectorsAsync,
+        DartFfmpegGetMotionVectorsAsync>('ffmpeg_get_motion_vectors_async');
+    freeMotionVectors = _dylib.lookupFunction<NativeFfmpegFreeMotionVectors,
+        DartFfmpegFreeMotionVectors>('ffmpeg_free_motion_vectors');
+
+    // Packet statistics
+    getPacketStatsAsync = _dylib.lookupFunction<NativeFfmpegGetPacketStatsAsync,
+        DartFfmpegGetPacketStatsAsync>('ffmpeg_get_packet_stats_async');
+    freePacketStats = _dylib.lookupFunction<NativeFfmpegFreePacketStats,
+        DartFfmpegFreePacketStats>('ffmpeg_free_packet_stats');
+
+    // Display output
+    presentVideoFrameAtTimestampAsync = _dylib.lookupFunction<
+        NativeFfmpegPresentVideoFrameAtTimestampAsync,
+        DartFfmpegPresentVideoFrameAtTimestampAsync>(
+        'ffmpeg_present_video_frame_at_timestamp_async');
+
+    // Shared memory ring
+    shmSinkOpen = _dylib.lookupFunction<NativeFfmpegShmSinkOpen,
+        DartFfmpegShmSinkOpen>('ffmpeg_shm_sink_open');
+    shmSinkClose = _dylib.lookupFunction<NativeFfmpegShmSinkClose,
+        DartFfmpegShmSinkClose>('ffmpeg_shm_sink_close');
+    streamToShmAsync = _dylib.lookupFunction<NativeFfmpegStreamToShmAsync,
+        DartFfmpegStreamToShmAsync>('ffmpeg_stream_to_shm_async');
+
+    // Proxies
+    generateProxyAsync = _dylib.lookupFunction<NativeFfmpegGenerateProxyAsync,
+        DartFfmpegGenerateProxyAsync>('ffmpeg_generate_proxy_async');
+    attachProxy =
+        _dylib.lookupFunction<NativeFfmpegAttachProxy, DartFfmpegAttachProxy>(
+            'ffmpeg_attach_proxy');
+    exportRangeAsync = _dylib.lookupFunction<NativeFfmpegExportRangeAsync,
+        DartFfmpegExportRangeAsync>('ffmpeg_export_range_async');
   }
 
   static DynamicLibrary _loadDynamicLibrary() {
@@ -1,10 +1,25 @@
+import 'dart:math' show Rectangle;
 import 'dart:typed_data';
 
+/// Pixel layout of decoded video frames.
+///
+/// The values match the native `VideoPixelFormat` enum.
+enum VideoPixelFormat {
+  /// Four bytes per pixel.
+  rgba,
+
+  /// Luma only, one byte per pixel, straight from the decoded Y plane.
+  gray8,
+}
+
 /// Represents a single decoded video frame.
 class VideoFrame {
-  /// The raw RGBA bytes of the frame.
+  /// The raw pixel bytes of the frame, RGBA unless [format] says otherwise.
   final Uint8List rgbaBytes;
 
+  /// The layout of [rgbaBytes].
+  final VideoPixelFormat format;
+
   /// The width of the frame in pixels.
   final int width;
 
@@ -17,12 +32,446 @@ class VideoFrame {
   /// The frame ID (derived from timestamp and FPS).
   final int frameId;
 
+  /// Smaller copies of the frame (1/2, 1/4, ...) when pyramid levels were
+  /// requested. Empty otherwise.
+  final List<VideoFrameLevel> levels;
+
+  /// Luma statistics of the decoded frame when they were requested with
+  /// `frameStats`, null otherwise.
+  final FrameStats? stats;
+
   VideoFrame({
     required this.rgbaBytes,
     required this.width,
     required this.height,
     required this.pts,
     required this.frameId,
+    this.levels = const [],
+    this.stats,
+    this.format = VideoPixelFormat.rgba,
+  });
+}
+
+/// Luma statistics of a decoded frame, read from its Y plane before any
+/// conversion. Values use an 8-bit scale whatever the bit depth.
+class FrameStats {
+  /// The mean luma, 0 to 255.
+  final double mean;
+
+  /// The luma variance.
+  final double variance;
+
+  /// The share of pixels within 10% of the black level, 0 to 1.
+  final double blackRatio;
+
+  /// The mean absolute luma difference to the previously returned frame,
+  /// 0 to 255, or null for the first one.
+  final double? difference;
+
+  /// A 16 bin luma histogram.
+  final List<int> histogram;
+
+  FrameStats({
+    required this.mean,
+    required this.variance,
+    required this.blackRatio,
+    required this.difference,
+    required this.histogram,
+  });
+}
+
+/// A reduced size copy of a video frame.
+class VideoFrameLevel {
+  /// The raw RGBA bytes of the level.
+  final Uint8List rgbaBytes;
+
+  /// The width of the level in pixels.
+  final int width;
+
+  /// The height of the level in pixels.
+  final int height;
+
+  VideoFrameLevel({
+    required this.rgbaBytes,
+    required this.width,
+    required this.height,
+  });
+}
+
+/// Layout of model input tensors.
+enum TensorFormat {
+  /// Planar float32 (N, C, H, W), normalized with mean and std.
+  float32Nchw,
+
+  /// Packed 8-bit (N, H, W, C), not normalized.
+  uint8Nhwc,
+}
+
+/// A batch of video frames converted to model input tensors.
+class VideoTensorBatch {
+  /// All tensors back to back: a [Float32List] for [TensorFormat.float32Nchw]
+  /// or a [Uint8List] for [TensorFormat.uint8Nhwc].
+  final TypedData data;
+
+  /// The number of frames in [data].
+  final int count;
+
+  /// The presentation timestamp of each frame.
+  final List<Duration> pts;
+
+  /// Where the image sits inside each tensor. Smaller than the tensor when
+  /// letterboxed.
+  final Rectangle<int> content;
+
+  VideoTensorBatch({
+    required this.data,
+    required this.count,
+    required this.pts,
+    required this.content,
+  });
+}
+
+/// Encoding applied to a generated sprite sheet.
+enum ImageFormat {
+  /// Raw RGBA only.
+  none,
+
+  /// JPEG, via the FFmpeg MJPEG encoder.
+  jpeg,
+
+  /// Lossless PNG.
+  png,
+
+  /// WebP, needs an FFmpeg build with libwebp.
+  webp,
+}
+
+/// A video frame compressed in native code.
+class EncodedVideoFrame {
+  /// The encoded image bytes.
+  final Uint8List bytes;
+
+  /// The encoding of [bytes].
+  final ImageFormat format;
+
+  /// The width of the image in pixels.
+  final int width;
+
+  /// The height of the image in pixels.
+  final int height;
+
+  /// The presentation timestamp of the frame.
+  final Duration pts;
+
+  /// The frame number.
+  final int frameId;
+
+  EncodedVideoFrame({
+    required this.bytes,
+    required this.format,
+    required this.width,
+    required this.height,
+    required this.pts,
+    required this.frameId,
+  });
+}
+
+/// A grid of video thumbnails built in one pass.
+class SpriteSheet {
+  /// The raw RGBA bytes of the whole atlas.
+  final Uint8List rgbaBytes;
+
+  /// The encoded atlas, when an [ImageFormat] was requested.
+  final Uint8List? imageBytes;
+
+  /// The width of the atlas in pixels.
+  final int width;
+
+  /// The height of the atlas in pixels.
+  final int height;
+
+  /// The number of tile columns.
+  final int columns;
+
+  /// The number of tile rows.
+  final int rows;
+
+  /// The width of one tile in pixels.
+  final int tileWidth;
+
+  /// The height of one tile in pixels.
+  final int tileHeight;
+
+  /// The timestamp shown by each tile in row-major order, null for tiles
+  /// that could not be decoded.
+  final List<Duration?> tilePts;
+
+  SpriteSheet({
+    required this.rgbaBytes,
+    this.imageBytes,
+    required this.width,
+    required this.height,
+    required this.columns,
+    required this.rows,
+    required this.tileWidth,
+    required this.tileHeight,
+    required this.tilePts,
+  });
+
+  /// The area of tile [index] inside the atlas.
+  Rectangle<int> tileRect(int index) => Rectangle(
+      (index % columns) * tileWidth, (index ~/ columns) * tileHeight,
+      tileWidth, tileHeight);
+}
+
+/// A shot boundary found by scene detection.
+class SceneCut {
+  /// The timestamp of the first frame of the new shot.
+  final Duration pts;
+
+  /// The combined score that was compared against the threshold, 0 to 1.
+  final double score;
+
+  /// The mean absolute luma difference to the previous frame, 0 to 1.
+  final double sad;
+
+  /// The luma histogram distance to the previous frame, 0 to 1.
+  final double histogramDistance;
+
+  SceneCut({
+    required this.pts,
+    required this.score,
+    required this.sad,
+    required this.histogramDistance,
+  });
+}
+
+/// The result of a scene detection pass.
+class SceneDetectionResult {
+  /// The cuts in timestamp order.
+  final List<SceneCut> cuts;
+
+  /// The number of frames that were compared.
+  final int framesAnalyzed;
+
+  SceneDetectionResult({
+    required this.cuts,
+    required this.framesAnalyzed,
+  });
+}
+
+/// A time range in the media, end exclusive.
+class TimeRange {
+  /// The start of the range.
+  final Duration start;
+
+  /// The end of the range.
+  final Duration end;
+
+  TimeRange({
+    required this.start,
+    required this.end,
+  });
+}
+
+/// The result of a black and freeze detection pass.
+class BlackFreezeResult {
+  /// Ranges where the picture is black, in timestamp order.
+  final List<TimeRange> black;
+
+  /// Ranges where the picture does not change, in timestamp order.
+  final List<TimeRange> frozen;
+
+  /// The number of frames that were analyzed.
+  final int framesAnalyzed;
+
+  BlackFreezeResult({
+    required this.black,
+    required this.frozen,
+    required this.framesAnalyzed,
+  });
+}
+
+/// The codec motion vectors of a range of frames, stored packed.
+///
+/// Vector `i` is the block centred on ([x], [y]) whose reference block is
+/// [dx], [dy] pixels away, in a past ([source] < 0) or future frame.
+class MotionVectors {
+  /// The packed native records, [_stride] bytes each.
+  final ByteData data;
+
+  /// The number of vectors.
+  final int length;
+
+  static const int _stride = 12;
+
+  MotionVectors(this.data) : length = data.lengthInBytes ~/ _stride;
+
+  /// The horizontal block centre in pixels.
+  int x(int i) => data.getInt16(i * _stride, Endian.host);
+
+  /// The vertical block centre in pixels.
+  int y(int i) => data.getInt16(i * _stride + 2, Endian.host);
+
+  /// The horizontal offset to the reference block in pixels.
+  double dx(int i) => data.getInt16(i * _stride + 4, Endian.host) / 4;
+
+  /// The vertical offset to the reference block in pixels.
+  double dy(int i) => data.getInt16(i * _stride + 6, Endian.host) / 4;
+
+  /// The block width in pixels.
+  int blockWidth(int i) => data.getUint8(i * _stride + 8);
+
+  /// The block height in pixels.
+  int blockHeight(int i) => data.getUint8(i * _stride + 9);
+
+  /// Negative for a past reference, positive for a future one.
+  int source(int i) => data.getInt8(i * _stride + 10);
+
+  /// The vectors from [start] to [end], sharing the same bytes.
+  MotionVectors sublist(int start, int end) => MotionVectors(ByteData.sublistView(
+      data, start * _stride, end * _stride));
+}
+
+/// The motion of one frame, from its codec motion vectors.
+class MotionFrameInfo {
+  /// The presentation timestamp of the frame.
+  final Duration pts;
+
+  /// The picture type of the frame. Intra frames have no vectors.
+  final PictureType pictureType;
+
+  /// The block area weighted mean vector length, in pixels.
+  final double meanMagnitude;
+
+  /// The longest vector, in pixels.
+  final double maxMagnitude;
+
+  /// The vectors of the frame, empty unless they were requested.
+  final MotionVectors vectors;
+
+  MotionFrameInfo({
+    required this.pts,
+    required this.pictureType,
+    required this.meanMagnitude,
+    required this.maxMagnitude,
+    required this.vectors,
+  });
+}
+
+/// The result of a motion vector pass.
+class MotionVectorTrack {
+  /// The frames in timestamp order.
+  final List<MotionFrameInfo> frames;
+
+  /// The coded frame width the vector positions refer to.
+  final int width;
+
+  /// The coded frame height the vector positions refer to.
+  final int height;
+
+  MotionVectorTrack({
+    required this.frames,
+    required this.width,
+    required this.height,
+  });
+}
+
+/// Picture type of a coded video frame.
+///
+/// The values match FFmpeg's `AVPictureType`.
+enum PictureType {
+  /// Not reported by the parser.
+  unknown,
+
+  /// Intra coded.
+  i,
+
+  /// Predicted.
+  p,
+
+  /// Bidirectionally predicted.
+  b,
+
+  /// S(GMC)-VOP in MPEG-4.
+  s,
+
+  /// Switching intra.
+  si,
+
+  /// Switching predicted.
+  sp,
+
+  /// BI type.
+  bi,
+}
+
+/// Statistics of one compressed video packet.
+class VideoPacketInfo {
+  /// The presentation timestamp, null if unknown.
+  final Duration? pts;
+
+  /// The decode timestamp, null if unknown.
+  final Duration? dts;
+
+  /// The compressed size in bytes.
+  final int size;
+
+  /// Whether the packet is a keyframe.
+  final bool keyframe;
+
+  /// The picture type found by the bitstream parser.
+  final PictureType pictureType;
+
+  /// The size relative to the median of nearby packets of the same type.
+  /// High values suggest a cut or a burst of motion.
+  final double activity;
+
+  VideoPacketInfo({
+    required this.pts,
+    required this.dts,
+    required this.size,
+    required this.keyframe,
+    required this.pictureType,
+    required this.activity,
+  });
+}
+
+/// Compressed-domain statistics of the video stream, read without decoding.
+class VideoPacketStats {
+  /// The packets in decode order.
+  final List<VideoPacketInfo> packets;
+
+  /// The bitrate in kbit/s per [bitrateWindow], from the start of the range.
+  final Float32List bitrateKbps;
+
+  /// The duration covered by each [bitrateKbps] value.
+  final Duration bitrateWindow;
+
+  /// The number of complete GOPs.
+  final int gopCount;
+
+  /// The shortest GOP in packets.
+  final int minGopLength;
+
+  /// The longest GOP in packets.
+  final int maxGopLength;
+
+  /// The average GOP length in packets.
+  final double averageGopLength;
+
+  /// Likely shot boundaries, from size spikes and off-cadence keyframes.
+  final List<Duration> likelyCuts;
+
+  VideoPacketStats({
+    required this.packets,
+    required this.bitrateKbps,
+    required this.bitrateWindow,
+    required this.gopCount,
+    required this.minGopLength,
+    required this.maxGopLength,
+    required this.averageGopLength,
+    required this.likelyCuts,
   });
 }
 
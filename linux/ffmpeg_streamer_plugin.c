@@ -0,0 +1,163 @@
+#include "include/ffmpeg_streamer/ffmpeg_streamer_plugin.h"
+
+#include <flutter_linux/flutter_linux.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ffmpeg_core.h"
+
+#define FFMPEG_STREAMER_CHANNEL "ffmpeg_streamer"
+
+// --- Frame Texture ---
+
+// Pixel buffer texture showing the display frame of the core. The engine
+// pulls it on the raster thread; Dart never sees the pixels.
+#define FFMPEG_TYPE_FRAME_TEXTURE ffmpeg_frame_texture_get_type()
+G_DECLARE_FINAL_TYPE(FfmpegFrameTexture, ffmpeg_frame_texture, FFMPEG, FRAME_TEXTURE,
+                     FlPixelBufferTexture)
+
+struct _FfmpegFrameTexture {
+  FlPixelBufferTexture parent_instance;
+  uint8_t *buffer;  // Copy handed to the engine, reused across frames
+  size_t capacity;
+};
+
+G_DEFINE_TYPE(FfmpegFrameTexture, ffmpeg_frame_texture, fl_pixel_buffer_texture_get_type())
+
+static gboolean ffmpeg_frame_texture_copy_pixels(FlPixelBufferTexture *texture,
+                                                 const uint8_t **out_buffer,
+                                                 uint32_t *width, uint32_t *height,
+                                                 GError **error) {
+  FfmpegFrameTexture *self = FFMPEG_FRAME_TEXTURE(texture);
+
+  int frame_width, frame_height;
+  if (ffmpeg_copy_display_frame(&self->buffer, &self->capacity,
+                                &frame_width, &frame_height) < 0) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "No frame presented");
+    return FALSE;
+  }
+
+  *out_buffer = self->buffer;
+  *width = (uint32_t)frame_width;
+  *height = (uint32_t)frame_height;
+  return TRUE;
+}
+
+static void ffmpeg_frame_texture_dispose(GObject *object) {
+  FfmpegFrameTexture *self = FFMPEG_FRAME_TEXTURE(object);
+  free(self->buffer);
+  self->buffer = NULL;
+  self->capacity = 0;
+  G_OBJECT_CLASS(ffmpeg_frame_texture_parent_class)->dispose(object);
+}
+
+static void ffmpeg_frame_texture_class_init(FfmpegFrameTextureClass *klass) {
+  FL_PIXEL_BUFFER_TEXTURE_CLASS(klass)->copy_pixels = ffmpeg_frame_texture_copy_pixels;
+  G_OBJECT_CLASS(klass)->dispose = ffmpeg_frame_texture_dispose;
+}
+
+static void ffmpeg_frame_texture_init(FfmpegFrameTexture *self) {
+  self->buffer = NULL;
+  self->capacity = 0;
+}
+
+// --- Plugin ---
+
+#define FFMPEG_STREAMER_PLUGIN(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), ffmpeg_streamer_plugin_get_type(), FfmpegStreamerPlugin))
+
+struct _FfmpegStreamerPlugin {
+  GObject parent_instance;
+  FlTextureRegistrar *texture_registrar;
+  FfmpegFrameTexture *texture;  // NULL until createTexture
+};
+
+G_DEFINE_TYPE(FfmpegStreamerPlugin, ffmpeg_streamer_plugin, g_object_get_type())
+
+// Main thread side of on_display_frame
+static gboolean mark_frame_available(gpointer user_data) {
+  FfmpegStreamerPlugin *self = FFMPEG_STREAMER_PLUGIN(user_data);
+  if (self->texture) {
+    fl_texture_registrar_mark_texture_frame_available(self->texture_registrar,
+                                                      FL_TEXTURE(self->texture));
+  }
+  g_object_unref(self);
+  return G_SOURCE_REMOVE;
+}
+
+// Runs on the decoder's worker thread after each presented frame. The
+// texture may be disposed on the main thread at any time, so hop there.
+// dispose_texture removes the listener before self can go away, and that
+// waits for a call in progress, so self is alive here.
+static void on_display_frame(void *user_data) {
+  g_idle_add(mark_frame_available, g_object_ref(FFMPEG_STREAMER_PLUGIN(user_data)));
+}
+
+static void dispose_texture(FfmpegStreamerPlugin *self) {
+  if (!self->texture) return;
+  ffmpeg_set_display_listener(NULL, NULL);
+  fl_texture_registrar_unregister_texture(self->texture_registrar, FL_TEXTURE(self->texture));
+  g_clear_object(&self->texture);
+}
+
+static void ffmpeg_streamer_plugin_handle_method_call(FfmpegStreamerPlugin *self,
+                                                      FlMethodCall *method_call) {
+  g_autoptr(FlMethodResponse) response = NULL;
+  const gchar *method = fl_method_call_get_name(method_call);
+
+  if (strcmp(method, "createTexture") == 0) {
+    // There is one display frame, so one texture is shared by all callers
+    if (!self->texture) {
+      self->texture = FFMPEG_FRAME_TEXTURE(g_object_new(FFMPEG_TYPE_FRAME_TEXTURE, NULL));
+      fl_texture_registrar_register_texture(self->texture_registrar, FL_TEXTURE(self->texture));
+      ffmpeg_set_display_listener(on_display_frame, self);
+    }
+    g_autoptr(FlValue) result = fl_value_new_int(fl_texture_get_id(FL_TEXTURE(self->texture)));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "disposeTexture") == 0) {
+    dispose_texture(self);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(NULL));
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  fl_method_call_respond(method_call, response, NULL);
+}
+
+static void ffmpeg_streamer_plugin_dispose(GObject *object) {
+  FfmpegStreamerPlugin *self = FFMPEG_STREAMER_PLUGIN(object);
+  dispose_texture(self);
+  g_clear_object(&self->texture_registrar);
+  G_OBJECT_CLASS(ffmpeg_streamer_plugin_parent_class)->dispose(object);
+}
+
+static void ffmpeg_streamer_plugin_class_init(FfmpegStreamerPluginClass *klass) {
+  G_OBJECT_CLASS(klass)->dispose = ffmpeg_streamer_plugin_dispose;
+}
+
+static void ffmpeg_streamer_plugin_init(FfmpegStreamerPlugin *self) {
+  self->texture_registrar = NULL;
+  self->texture = NULL;
+}
+
+static void method_call_cb(FlMethodChannel *channel, FlMethodCall *method_call,
+                           gpointer user_data) {
+  (void)channel;
+  ffmpeg_streamer_plugin_handle_method_call(FFMPEG_STREAMER_PLUGIN(user_data), method_call);
+}
+
+void ffmpeg_streamer_plugin_register_with_registrar(FlPluginRegistrar *registrar) {
+  FfmpegStreamerPlugin *plugin =
+      FFMPEG_STREAMER_PLUGIN(g_object_new(ffmpeg_streamer_plugin_get_type(), NULL));
+  plugin->texture_registrar =
+      FL_TEXTURE_REGISTRAR(g_object_ref(fl_plugin_registrar_get_texture_registrar(registrar)));
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_autoptr(FlMethodChannel) channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            FFMPEG_STREAMER_CHANNEL, FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(channel, method_call_cb, g_object_ref(plugin),
+                                            g_object_unref);
+
+  g_object_unref(plugin);
+}
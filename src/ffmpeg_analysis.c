@@ -0,0 +1,1186 @@
+#include "ffmpeg_analysis.h"
+#include "ffmpeg_convert.h"
+#include "ffmpeg_reader.h"
+
+#include <libavutil/cpu.h>
+#include <libavutil/motion_vector.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANALYSIS_HAVE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define ANALYSIS_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define ANALYSIS_DEFAULT_WIDTH 128
+#define ANALYSIS_HISTOGRAM_BINS 64
+#define SCENE_DEFAULT_THRESHOLD 0.25f
+#define BLACK_DEFAULT_RATIO 0.98f
+#define FREEZE_DEFAULT_DIFFERENCE 0.5f
+#define BLACK_FREEZE_DEFAULT_MIN_MS 1000
+
+// --- Kernels ---
+
+uint64_t analysis_sad(const uint8_t *a, const uint8_t *b, int n) {
+  uint64_t sum = 0;
+  int i = 0;
+
+#if defined(ANALYSIS_HAVE_SSE2)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+  }
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i *)lanes, acc);
+  sum = lanes[0] + lanes[1];
+#elif defined(ANALYSIS_HAVE_NEON)
+  uint32x4_t acc = vdupq_n_u32(0);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    acc = vpadalq_u16(acc, vpaddlq_u8(diff));
+  }
+  uint64x2_t acc64 = vpaddlq_u32(acc);
+  sum = vgetq_lane_u64(acc64, 0) + vgetq_lane_u64(acc64, 1);
+#endif
+
+  for (; i < n; i++) {
+    sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+  }
+  return sum;
+}
+
+// Four interleaved tables so consecutive equal pixels do not serialize on
+// the same counter; there is no useful SIMD scatter on SSE2 or NEON.
+static void analysis_histogram(const uint8_t *luma, int n, uint32_t *hist) {
+  uint32_t partial[4][ANALYSIS_HISTOGRAM_BINS];
+  memset(partial, 0, sizeof(partial));
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    partial[0][luma[i] >> 2]++;
+    partial[1][luma[i + 1] >> 2]++;
+    partial[2][luma[i + 2] >> 2]++;
+    partial[3][luma[i + 3] >> 2]++;
+  }
+  for (; i < n; i++) {
+    partial[0][luma[i] >> 2]++;
+  }
+
+  for (int b = 0; b < ANALYSIS_HISTOGRAM_BINS; b++) {
+    hist[b] = partial[0][b] + partial[1][b] + partial[2][b] + partial[3][b];
+  }
+}
+
+// Half the L1 distance of two histograms over n pixels, 0 (same) to 1
+static float analysis_histogram_distance(const uint32_t *a, const uint32_t *b, int n) {
+  uint64_t sum = 0;
+  for (int i = 0; i < ANALYSIS_HISTOGRAM_BINS; i++) {
+    sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+  }
+  return (float)sum / (2.0f * n);
+}
+
+// --- Frame Statistics ---
+
+#define FRAME_STATS_ROW_CHUNK 16384  // Pixels per 32-bit SIMD accumulation
+
+typedef struct {
+  uint64_t sum;
+  uint64_t sum_squares;
+  uint64_t dark;
+  uint64_t difference;
+} LumaSums;
+
+// Accumulate n 8-bit luma samples. previous may be NULL.
+static void frame_stats_row_8(const uint8_t *row, const uint8_t *previous, int n,
+                              uint8_t dark_level, LumaSums *sums) {
+  int i = 0;
+
+#if defined(ANALYSIS_HAVE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i dark = _mm_set1_epi8((char)dark_level);
+  while (i + 16 <= n) {
+    int chunk_end = i + FRAME_STATS_ROW_CHUNK < n ? i + FRAME_STATS_ROW_CHUNK : n;
+    __m128i sum = zero, squares = zero, dark_count = zero, difference = zero;
+    for (; i + 16 <= chunk_end; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(row + i));
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(v, zero));
+
+      __m128i lo = _mm_unpacklo_epi8(v, zero);
+      __m128i hi = _mm_unpackhi_epi8(v, zero);
+      squares = _mm_add_epi32(squares, _mm_add_epi32(_mm_madd_epi16(lo, lo),
+                                                     _mm_madd_epi16(hi, hi)));
+
+      // v <= dark_level exactly where min(v, dark_level) == v
+      __m128i is_dark = _mm_cmpeq_epi8(_mm_min_epu8(v, dark), v);
+      dark_count = _mm_add_epi64(dark_count, _mm_sad_epu8(_mm_and_si128(is_dark, one), zero));
+
+      if (previous) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(previous + i));
+        difference = _mm_add_epi64(difference, _mm_sad_epu8(v, p));
+      }
+    }
+    uint64_t lanes[2];
+    uint32_t square_lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, sum);
+    sums->sum += lanes[0] + lanes[1];
+    _mm_storeu_si128((__m128i *)square_lanes, squares);
+    sums->sum_squares += (uint64_t)square_lanes[0] + square_lanes[1] + square_lanes[2] + square_lanes[3];
+    _mm_storeu_si128((__m128i *)lanes, dark_count);
+    sums->dark += lanes[0] + lanes[1];
+    _mm_storeu_si128((__m128i *)lanes, difference);
+    sums->difference += lanes[0] + lanes[1];
+  }
+#elif defined(ANALYSIS_HAVE_NEON)
+  const uint8x16_t dark = vdupq_n_u8(dark_level);
+  while (i + 16 <= n) {
+    int chunk_end = i + FRAME_STATS_ROW_CHUNK < n ? i + FRAME_STATS_ROW_CHUNK : n;
+    uint32x4_t sum = vdupq_n_u32(0), squares = vdupq_n_u32(0);
+    uint32x4_t dark_count = vdupq_n_u32(0), difference = vdupq_n_u32(0);
+    for (; i + 16 <= chunk_end; i += 16) {
+      uint8x16_t v = vld1q_u8(row + i);
+      sum = vpadalq_u16(sum, vpaddlq_u8(v));
+
+      uint8x8_t lo = vget_low_u8(v);
+      uint8x8_t hi = vget_high_u8(v);
+      squares = vpadalq_u16(squares, vmull_u8(lo, lo));
+      squares = vpadalq_u16(squares, vmull_u8(hi, hi));
+
+      uint8x16_t is_dark = vshrq_n_u8(vcleq_u8(v, dark), 7);
+      dark_count = vpadalq_u16(dark_count, vpaddlq_u8(is_dark));
+
+      if (previous) {
+        uint8x16_t diff = vabdq_u8(v, vld1q_u8(previous + i));
+        difference = vpadalq_u16(difference, vpaddlq_u8(diff));
+      }
+    }
+    uint64x2_t wide = vpaddlq_u32(sum);
+    sums->sum += vgetq_lane_u64(wide, 0) + vgetq_lane_u64(wide, 1);
+    wide = vpaddlq_u32(squares);
+    sums->sum_squares += vgetq_lane_u64(wide, 0) + vgetq_lane_u64(wide, 1);
+    wide = vpaddlq_u32(dark_count);
+    sums->dark += vgetq_lane_u64(wide, 0) + vgetq_lane_u64(wide, 1);
+    wide = vpaddlq_u32(difference);
+    sums->difference += vgetq_lane_u64(wide, 0) + vgetq_lane_u64(wide, 1);
+  }
+#endif
+
+  for (; i < n; i++) {
+    uint32_t v = row[i];
+    sums->sum += v;
+    sums->sum_squares += v * v;
+    sums->dark += v <= dark_level;
+    if (previous) sums->difference += v > previous[i] ? v - previous[i] : previous[i] - v;
+  }
+}
+
+// Same as frame_stats_row_8 for 9 to 16-bit samples, scaled down to 8 bits
+static void frame_stats_row_16(const uint16_t *row, const uint16_t *previous, int n,
+                               int shift, uint8_t dark_level, LumaSums *sums,
+                               uint32_t *histogram) {
+  for (int i = 0; i < n; i++) {
+    uint32_t v = (row[i] >> shift) & 0xFF;
+    sums->sum += v;
+    sums->sum_squares += v * v;
+    sums->dark += v <= dark_level;
+    histogram[v >> 4]++;
+    if (previous) {
+      uint32_t p = (previous[i] >> shift) & 0xFF;
+      sums->difference += v > p ? v - p : p - v;
+    }
+  }
+}
+
+static int frame_stats_full_range(const AVFrame *frame) {
+  switch (frame->format) {
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUVJ444P:
+    case AV_PIX_FMT_YUVJ440P:
+    case AV_PIX_FMT_YUVJ411P:
+    case AV_PIX_FMT_GRAY8:
+      return 1;
+    default:
+      return frame->color_range == AVCOL_RANGE_JPEG;
+  }
+}
+
+void analysis_frame_stats(const AVFrame *frame, const AVFrame *previous, FrameStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->difference = -1.0f;
+
+  // Planar luma in native endianness: the Y plane is read in place
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+  if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL |
+                               AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL))) {
+    return;
+  }
+  int depth = desc->comp[0].depth;
+  int sample_size = depth > 8 ? 2 : 1;
+  if (desc->nb_components < 1 || desc->comp[0].plane != 0 ||
+      desc->comp[0].step != sample_size || depth > 16) {
+    return;
+  }
+  const uint16_t endian_probe = 1;
+  int big_endian = *(const uint8_t *)&endian_probe == 0;
+  if (sample_size == 2 && !!(desc->flags & AV_PIX_FMT_FLAG_BE) != big_endian) return;
+
+  int width = frame->width;
+  int height = frame->height;
+  if (width <= 0 || height <= 0 || !frame->data[0]) return;
+
+  if (previous && (previous->width != width || previous->height != height ||
+                   previous->format != frame->format || !previous->data[0])) {
+    previous = NULL;
+  }
+
+  // Dark means within 10% of the nominal range (0-255 or 16-235) above black
+  uint8_t dark_level = frame_stats_full_range(frame) ? 25 : 37;
+
+  LumaSums sums = { 0, 0, 0, 0 };
+  for (int y = 0; y < height; y++) {
+    const uint8_t *row = frame->data[0] + (ptrdiff_t)y * frame->linesize[0];
+    const uint8_t *previous_row = previous
+        ? previous->data[0] + (ptrdiff_t)y * previous->linesize[0] : NULL;
+
+    if (sample_size == 1) {
+      frame_stats_row_8(row, previous_row, width, dark_level, &sums);
+      for (int x = 0; x < width; x++) {
+        stats->histogram[row[x] >> 4]++;
+      }
+    } else {
+      frame_stats_row_16((const uint16_t *)row, (const uint16_t *)previous_row, width,
+                         desc->comp[0].shift + depth - 8, dark_level, &sums,
+                         stats->histogram);
+    }
+  }
+
+  double n = (double)width * height;
+  double mean = sums.sum / n;
+  double variance = sums.sum_squares / n - mean * mean;
+  stats->valid = 1;
+  stats->mean = (float)mean;
+  stats->variance = (float)(variance > 0 ? variance : 0);
+  stats->black_ratio = (float)(sums.dark / n);
+  if (previous) stats->difference = (float)(sums.difference / n);
+}
+
+// --- Segment Workers ---
+
+// Per-frame result of a black and freeze scan
+typedef struct {
+  int64_t pts_ms;
+  uint8_t black;
+  uint8_t frozen;
+} FrameFlags;
+
+typedef struct {
+  const char *url;
+  const SceneDetectOptions *options;            // Scene detection pass
+  const BlackFreezeOptions *black_freeze;       // Black and freeze pass
+  const MotionVectorOptions *motion;            // Motion vector pass
+  const bool *cancelled;
+  int64_t start_ms;      // Cuts are reported for frames in [start_ms, end_ms)
+  int64_t end_ms;
+  int last_segment;      // Runs to the end of the stream
+  ReaderOptions reader_options;
+
+  MediaReader reader;
+  int reader_open;
+  struct SwsContext *sws_ctx;
+
+  // Downscaled luma of the current and previous frame
+  int width;
+  int height;
+  uint8_t *luma[2];
+  uint32_t hist[2][ANALYSIS_HISTOGRAM_BINS];
+  int current;
+  int have_previous;
+  float previous_sad;
+
+  // Full resolution previous frame of the black and freeze pass
+  AVFrame *previous;
+
+  SceneCut *cuts;
+  int cut_count;
+  int cut_capacity;
+  FrameFlags *flags;
+  int flag_count;
+  int flag_capacity;
+  MotionFrame *motion_frames;
+  int motion_frame_count;
+  int motion_frame_capacity;
+  MotionVector *vectors;
+  int vector_count;
+  int vector_capacity;
+  int frames;
+  int error;
+} AnalysisWorker;
+
+// Reduce the reader's frame to the analysis luma image
+static int analysis_extract_luma(AnalysisWorker *worker, uint8_t *dst) {
+  const AVFrame *frame = worker->reader.frame;
+
+  // Scaling only the Y plane skips the chroma work entirely
+  enum AVPixelFormat src_format = convert_has_plain_luma(frame->format)
+                                      ? AV_PIX_FMT_GRAY8 : (enum AVPixelFormat)frame->format;
+  worker->sws_ctx = sws_getCachedContext(worker->sws_ctx, frame->width, frame->height,
+                                         src_format, worker->width, worker->height,
+                                         AV_PIX_FMT_GRAY8, SWS_AREA, NULL, NULL, NULL);
+  if (!worker->sws_ctx) return -1;
+
+  uint8_t *dst_data[4] = { dst, NULL, NULL, NULL };
+  int dst_linesize[4] = { worker->width, 0, 0, 0 };
+  return sws_scale(worker->sws_ctx, (const uint8_t *const *)frame->data, frame->linesize, 0,
+                   frame->height, dst_data, dst_linesize) < 0 ? -1 : 0;
+}
+
+static int analysis_add_cut(AnalysisWorker *worker, const SceneCut *cut) {
+  if (worker->cut_count == worker->cut_capacity) {
+    int capacity = worker->cut_capacity ? worker->cut_capacity * 2 : 16;
+    SceneCut *cuts = (SceneCut *)realloc(worker->cuts, capacity * sizeof(SceneCut));
+    if (!cuts) return -1;
+    worker->cuts = cuts;
+    worker->cut_capacity = capacity;
+  }
+  worker->cuts[worker->cut_count++] = *cut;
+  return 0;
+}
+
+// Compare the current luma image with the previous one
+static int analysis_process_frame(AnalysisWorker *worker, int64_t pts_ms) {
+  int n = worker->width * worker->height;
+  int cur = worker->current;
+  int prev = cur ^ 1;
+
+  analysis_histogram(worker->luma[cur], n, worker->hist[cur]);
+
+  if (worker->have_previous) {
+    float sad = (float)analysis_sad(worker->luma[cur], worker->luma[prev], n) / (255.0f * n);
+    float histogram = analysis_histogram_distance(worker->hist[cur], worker->hist[prev], n);
+
+    // Steady motion keeps the SAD high on every frame, a cut is a jump in
+    // it. Taking the smaller of the SAD and its change filters pans out.
+    float sad_change = sad > worker->previous_sad ? sad - worker->previous_sad
+                                                  : worker->previous_sad - sad;
+    float score = 0.5f * ((sad < sad_change ? sad : sad_change) + histogram);
+    float threshold = worker->options->threshold > 0 ? worker->options->threshold
+                                                     : SCENE_DEFAULT_THRESHOLD;
+    worker->previous_sad = sad;
+
+    if (pts_ms >= worker->start_ms && score >= threshold) {
+      SceneCut cut = { pts_ms, score, sad, histogram };
+      if (analysis_add_cut(worker, &cut) < 0) return -3;
+    }
+  }
+
+  worker->have_previous = 1;
+  worker->current = prev;
+  return 0;
+}
+
+static int analysis_process_black_freeze(AnalysisWorker *worker, int64_t pts_ms) {
+  const AVFrame *frame = worker->reader.frame;
+  const BlackFreezeOptions *options = worker->black_freeze;
+
+  FrameStats stats;
+  analysis_frame_stats(frame, worker->have_previous ? worker->previous : NULL, &stats);
+
+  // Keep a reference instead of a copy; the decoder allocates a new buffer
+  // for the next frame
+  av_frame_unref(worker->previous);
+  worker->have_previous = av_frame_ref(worker->previous, frame) == 0;
+
+  if (pts_ms < worker->start_ms) return 0;
+
+  if (worker->flag_count == worker->flag_capacity) {
+    int capacity = worker->flag_capacity ? worker->flag_capacity * 2 : 256;
+    FrameFlags *flags = (FrameFlags *)realloc(worker->flags, capacity * sizeof(FrameFlags));
+    if (!flags) return -3;
+    worker->flags = flags;
+    worker->flag_capacity = capacity;
+  }
+
+  float black_ratio = options->black_ratio > 0 ? options->black_ratio : BLACK_DEFAULT_RATIO;
+  float freeze_difference = options->freeze_difference > 0 ? options->freeze_difference
+                                                           : FREEZE_DEFAULT_DIFFERENCE;
+  FrameFlags *flags = &worker->flags[worker->flag_count++];
+  flags->pts_ms = pts_ms;
+  flags->black = stats.valid && stats.black_ratio >= black_ratio;
+  flags->frozen = stats.valid && stats.difference >= 0 && stats.difference <= freeze_difference;
+  return 0;
+}
+
+static int analysis_process_motion(AnalysisWorker *worker, int64_t pts_ms) {
+  if (pts_ms < worker->start_ms) return 0;
+
+  const AVFrame *frame = worker->reader.frame;
+  const AVFrameSideData *side = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+  const AVMotionVector *mvs = side ? (const AVMotionVector *)side->data : NULL;
+  int count = side ? (int)(side->size / sizeof(AVMotionVector)) : 0;
+  int include_vectors = worker->motion->include_vectors;
+
+  if (worker->motion_frame_count == worker->motion_frame_capacity) {
+    int capacity = worker->motion_frame_capacity ? worker->motion_frame_capacity * 2 : 256;
+    MotionFrame *frames = (MotionFrame *)realloc(worker->motion_frames,
+                                                 capacity * sizeof(MotionFrame));
+    if (!frames) return -3;
+    worker->motion_frames = frames;
+    worker->motion_frame_capacity = capacity;
+  }
+  if (include_vectors && worker->vector_count + count > worker->vector_capacity) {
+    int capacity = worker->vector_capacity ? worker->vector_capacity : 4096;
+    while (capacity < worker->vector_count + count) capacity *= 2;
+    MotionVector *vectors = (MotionVector *)realloc(worker->vectors,
+                                                    capacity * sizeof(MotionVector));
+    if (!vectors) return -3;
+    worker->vectors = vectors;
+    worker->vector_capacity = capacity;
+  }
+
+  MotionFrame *motion = &worker->motion_frames[worker->motion_frame_count++];
+  motion->pts_ms = pts_ms;
+  motion->pict_type = frame->pict_type;
+  motion->vector_offset = include_vectors ? worker->vector_count : 0;
+  motion->vector_count = include_vectors ? count : 0;
+
+  double weighted = 0.0;
+  double area = 0.0;
+  float max_magnitude = 0.0f;
+  for (int i = 0; i < count; i++) {
+    const AVMotionVector *mv = &mvs[i];
+    int scale = mv->motion_scale ? mv->motion_scale : 1;
+    float dx = (float)mv->motion_x / scale;
+    float dy = (float)mv->motion_y / scale;
+    float magnitude = sqrtf(dx * dx + dy * dy);
+    weighted += (double)magnitude * mv->w * mv->h;
+    area += (double)mv->w * mv->h;
+    if (magnitude > max_magnitude) max_magnitude = magnitude;
+
+    if (include_vectors) {
+      MotionVector *v = &worker->vectors[worker->vector_count++];
+      v->x = mv->dst_x;
+      v->y = mv->dst_y;
+      v->dx = (int16_t)(mv->motion_x * 4 / scale);
+      v->dy = (int16_t)(mv->motion_y * 4 / scale);
+      v->width = mv->w;
+      v->height = mv->h;
+      v->source = mv->source < 0 ? -1 : 1;
+      v->reserved = 0;
+    }
+  }
+  motion->mean_magnitude = area > 0 ? (float)(weighted / area) : 0.0f;
+  motion->max_magnitude = max_magnitude;
+  return 0;
+}
+
+static void *analysis_worker_run(void *arg) {
+  AnalysisWorker *worker = (AnalysisWorker *)arg;
+
+  if (!worker->reader_open) {
+    if (reader_open_with(&worker->reader, worker->url, &worker->reader_options) < 0) {
+      worker->error = -2;
+      return NULL;
+    }
+    worker->reader_open = 1;
+  }
+
+  if (worker->black_freeze) {
+    worker->previous = av_frame_alloc();
+    if (!worker->previous) {
+      worker->error = -3;
+      return NULL;
+    }
+  } else if (!worker->motion) {
+    int n = worker->width * worker->height;
+    worker->luma[0] = (uint8_t *)malloc(n);
+    worker->luma[1] = (uint8_t *)malloc(n);
+    if (!worker->luma[0] || !worker->luma[1]) {
+      worker->error = -3;
+      return NULL;
+    }
+  }
+
+  // Frames before start_ms only prime the history. Seeking just before it
+  // makes sure a change on the first frame (often a keyframe) has a
+  // previous frame to compare with.
+  if (reader_seek(&worker->reader, worker->start_ms > 0 ? worker->start_ms - 1 : 0) < 0) {
+    worker->error = -2;
+    return NULL;
+  }
+
+  while (reader_next_frame(&worker->reader) == 0) {
+    if (worker->cancelled && *worker->cancelled) break;
+
+    int64_t pts_ms = reader_frame_ts_ms(&worker->reader);
+    if (!worker->last_segment && pts_ms >= worker->end_ms) break;
+    if (worker->last_segment && worker->end_ms > 0 && pts_ms >= worker->end_ms) break;
+
+    int ret;
+    if (worker->black_freeze) {
+      ret = analysis_process_black_freeze(worker, pts_ms);
+    } else if (worker->motion) {
+      ret = analysis_process_motion(worker, pts_ms);
+    } else {
+      if (analysis_extract_luma(worker, worker->luma[worker->current]) < 0) continue;
+      ret = analysis_process_frame(worker, pts_ms);
+    }
+    if (ret < 0) {
+      worker->error = ret;
+      break;
+    }
+    if (pts_ms >= worker->start_ms) worker->frames++;
+  }
+
+  return NULL;
+}
+
+static void analysis_worker_cleanup(AnalysisWorker *worker) {
+  if (worker->reader_open) reader_close(&worker->reader);
+  worker->reader_open = 0;
+  if (worker->sws_ctx) sws_freeContext(worker->sws_ctx);
+  worker->sws_ctx = NULL;
+  free(worker->luma[0]);
+  free(worker->luma[1]);
+  worker->luma[0] = worker->luma[1] = NULL;
+  free(worker->cuts);
+  worker->cuts = NULL;
+  free(worker->flags);
+  worker->flags = NULL;
+  free(worker->motion_frames);
+  worker->motion_frames = NULL;
+  free(worker->vectors);
+  worker->vectors = NULL;
+  av_frame_free(&worker->previous);
+}
+
+// Open the first worker's reader as the probe and split [start_ms, end_ms)
+// into one segment per worker. end_ms <= 0 runs to the end of the media.
+// Readers decode as reader_options says, with the thread count chosen here.
+static int analysis_workers_create(const char *url, int threads, int64_t start_ms,
+                                   int64_t end_ms, const ReaderOptions *reader_options,
+                                   const bool *cancelled, AnalysisWorker **out_workers,
+                                   int *out_count) {
+  int thread_count = threads > 0 ? threads : av_cpu_count();
+  if (thread_count < 1) thread_count = 1;
+
+  AnalysisWorker *workers = (AnalysisWorker *)calloc(thread_count, sizeof(AnalysisWorker));
+  if (!workers) return -3;
+
+  ReaderOptions options = *reader_options;
+  options.decoder_threads = thread_count > 1 ? 1 : 0;
+  if (reader_open_with(&workers[0].reader, url, &options) < 0) {
+    free(workers);
+    return -2;
+  }
+  workers[0].reader_open = 1;
+
+  if (start_ms < 0) start_ms = 0;
+  int64_t duration = workers[0].reader.fmt_ctx->duration;
+  int64_t range_end_ms = end_ms > 0 ? end_ms
+                                    : (duration > 0 ? duration / (AV_TIME_BASE / 1000) : 0);
+
+  // Without a known duration the stream can not be split
+  if (range_end_ms <= start_ms) thread_count = 1;
+
+  for (int i = 0; i < thread_count; i++) {
+    AnalysisWorker *worker = &workers[i];
+    worker->url = url;
+    worker->cancelled = cancelled;
+    worker->reader_options = options;
+    worker->start_ms = start_ms + (range_end_ms - start_ms) * i / thread_count;
+    worker->end_ms = start_ms + (range_end_ms - start_ms) * (i + 1) / thread_count;
+    worker->last_segment = i == thread_count - 1;
+    if (worker->last_segment) worker->end_ms = end_ms;
+  }
+
+  *out_workers = workers;
+  *out_count = thread_count;
+  return 0;
+}
+
+// Run every worker to completion and return the first error
+static int analysis_workers_run(AnalysisWorker *workers, int thread_count) {
+  ReaderThreads *threads = reader_threads_create(thread_count);
+  reader_threads_run(threads, analysis_worker_run, workers, sizeof(AnalysisWorker), thread_count);
+  reader_threads_destroy(&threads);
+
+  for (int i = 0; i < thread_count; i++) {
+    if (workers[i].error < 0) return workers[i].error;
+  }
+  return 0;
+}
+
+// --- Scene Detection ---
+
+int analysis_detect_scenes(const char *url, const SceneDetectOptions *options,
+                           const bool *cancelled, SceneCutList **out_cuts) {
+  *out_cuts = NULL;
+  if (!url || !options) return -1;
+
+  AnalysisWorker *workers = NULL;
+  int thread_count = 0;
+  // Deblocking does not change where cuts are, skip it for speed
+  ReaderOptions reader_options = {0};
+  reader_options.skip_loop_filter = 1;
+  int result = analysis_workers_create(url, options->threads, options->start_ms, options->end_ms,
+                                       &reader_options, cancelled, &workers, &thread_count);
+  if (result < 0) return result;
+
+  // SIMD friendly width, height from the coded aspect ratio
+  const AVCodecContext *codec = workers[0].reader.codec_ctx;
+  int width = options->analysis_width > 0 ? options->analysis_width : ANALYSIS_DEFAULT_WIDTH;
+  width = width < 16 ? 16 : width & ~15;
+  int height = codec->width > 0 ? (int)((int64_t)width * codec->height / codec->width) : width;
+  if (height < 1) height = 1;
+
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].options = options;
+    workers[i].width = width;
+    workers[i].height = height;
+  }
+
+  result = analysis_workers_run(workers, thread_count);
+
+  int total_cuts = 0;
+  for (int i = 0; i < thread_count; i++) {
+    total_cuts += workers[i].cut_count;
+  }
+  if (cancelled && *cancelled) result = -6;
+
+  SceneCutList *list = NULL;
+  if (result == 0) {
+    list = (SceneCutList *)calloc(1, sizeof(SceneCutList));
+    if (list && total_cuts > 0) {
+      list->cuts = (SceneCut *)malloc(total_cuts * sizeof(SceneCut));
+      if (!list->cuts) {
+        free(list);
+        list = NULL;
+      }
+    }
+    if (!list) result = -3;
+  }
+
+  // Segments are in time order; drop cuts closer than min_scene_ms
+  int64_t last_cut_ms = INT64_MIN;
+  for (int i = 0; i < thread_count; i++) {
+    AnalysisWorker *worker = &workers[i];
+    if (list) {
+      list->frames_analyzed += worker->frames;
+      for (int c = 0; c < worker->cut_count; c++) {
+        const SceneCut *cut = &worker->cuts[c];
+        if (last_cut_ms != INT64_MIN && cut->pts_ms - last_cut_ms < options->min_scene_ms) {
+          continue;
+        }
+        list->cuts[list->count++] = *cut;
+        last_cut_ms = cut->pts_ms;
+      }
+    }
+    analysis_worker_cleanup(worker);
+  }
+  free(workers);
+
+  *out_cuts = list;
+  return result;
+}
+
+void analysis_free_scene_cuts(SceneCutList *cuts) {
+  if (!cuts) return;
+  free(cuts->cuts);
+  free(cuts);
+}
+
+// --- Black and Freeze Detection ---
+
+// Append the runs of flags (black or frozen) lasting at least min_ms.
+// A run ends at the next frame; at the end of the scan the last frame is
+// given the duration of the one before it. Frozen runs start at the frame
+// the first frozen one repeats.
+static int black_freeze_intervals(const FrameFlags *flags, int count, int frozen,
+                                  int64_t min_ms, TimeInterval **out, int *out_count) {
+  *out = NULL;
+  *out_count = 0;
+  int capacity = 0;
+
+  int i = 0;
+  while (i < count) {
+    int set = frozen ? flags[i].frozen : flags[i].black;
+    if (!set) {
+      i++;
+      continue;
+    }
+
+    int first = i;
+    while (i < count && (frozen ? flags[i].frozen : flags[i].black)) i++;
+
+    int64_t start_ms = frozen && first > 0 ? flags[first - 1].pts_ms : flags[first].pts_ms;
+    int64_t end_ms;
+    if (i < count) {
+      end_ms = flags[i].pts_ms;
+    } else if (count > 1) {
+      end_ms = flags[count - 1].pts_ms * 2 - flags[count - 2].pts_ms;
+    } else {
+      end_ms = flags[count - 1].pts_ms;
+    }
+    if (end_ms - start_ms < min_ms) continue;
+
+    if (*out_count == capacity) {
+      capacity = capacity ? capacity * 2 : 8;
+      TimeInterval *intervals = (TimeInterval *)realloc(*out, capacity * sizeof(TimeInterval));
+      if (!intervals) {
+        free(*out);
+        *out = NULL;
+        *out_count = 0;
+        return -3;
+      }
+      *out = intervals;
+    }
+    (*out)[*out_count].start_ms = start_ms;
+    (*out)[*out_count].end_ms = end_ms;
+    (*out_count)++;
+  }
+  return 0;
+}
+
+int analysis_detect_black_freeze(const char *url, const BlackFreezeOptions *options,
+                                 const bool *cancelled, BlackFreezeResult **out_result) {
+  *out_result = NULL;
+  if (!url || !options) return -1;
+
+  AnalysisWorker *workers = NULL;
+  int thread_count = 0;
+  ReaderOptions reader_options = {0};
+  int result = analysis_workers_create(url, options->threads, options->start_ms, options->end_ms,
+                                       &reader_options, cancelled, &workers, &thread_count);
+  if (result < 0) return result;
+
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].black_freeze = options;
+  }
+
+  result = analysis_workers_run(workers, thread_count);
+  if (cancelled && *cancelled) result = -6;
+
+  // Segments are in time order, so runs continue across their boundaries
+  int total_flags = 0;
+  for (int i = 0; i < thread_count; i++) {
+    total_flags += workers[i].flag_count;
+  }
+
+  FrameFlags *flags = NULL;
+  if (result == 0 && total_flags > 0) {
+    flags = (FrameFlags *)malloc(total_flags * sizeof(FrameFlags));
+    if (!flags) result = -3;
+  }
+
+  int flag_count = 0;
+  for (int i = 0; i < thread_count; i++) {
+    if (flags) {
+      memcpy(flags + flag_count, workers[i].flags, workers[i].flag_count * sizeof(FrameFlags));
+      flag_count += workers[i].flag_count;
+    }
+    analysis_worker_cleanup(&workers[i]);
+  }
+  free(workers);
+
+  BlackFreezeResult *scan = NULL;
+  if (result == 0) {
+    scan = (BlackFreezeResult *)calloc(1, sizeof(BlackFreezeResult));
+    if (!scan) result = -3;
+  }
+  if (scan) {
+    scan->frames_analyzed = flag_count;
+    int64_t min_black_ms = options->min_black_ms > 0 ? options->min_black_ms
+                                                     : BLACK_FREEZE_DEFAULT_MIN_MS;
+    int64_t min_freeze_ms = options->min_freeze_ms > 0 ? options->min_freeze_ms
+                                                       : BLACK_FREEZE_DEFAULT_MIN_MS;
+    if (black_freeze_intervals(flags, flag_count, 0, min_black_ms,
+                               &scan->black, &scan->black_count) < 0 ||
+        black_freeze_intervals(flags, flag_count, 1, min_freeze_ms,
+                               &scan->frozen, &scan->frozen_count) < 0) {
+      analysis_free_black_freeze(scan);
+      scan = NULL;
+      result = -3;
+    }
+  }
+  free(flags);
+
+  *out_result = scan;
+  return result;
+}
+
+void analysis_free_black_freeze(BlackFreezeResult *result) {
+  if (!result) return;
+  free(result->black);
+  free(result->frozen);
+  free(result);
+}
+
+// --- Motion Vectors ---
+
+int analysis_motion_vectors(const char *url, const MotionVectorOptions *options,
+                            const bool *cancelled, MotionVectorTrack **out_track) {
+  *out_track = NULL;
+  if (!url || !options) return -1;
+
+  AnalysisWorker *workers = NULL;
+  int thread_count = 0;
+  // Vectors come from the bitstream, the pixels are never read
+  ReaderOptions reader_options = {0};
+  reader_options.export_motion_vectors = 1;
+  reader_options.skip_loop_filter = 1;
+  int result = analysis_workers_create(url, options->threads, options->start_ms, options->end_ms,
+                                       &reader_options, cancelled, &workers, &thread_count);
+  if (result < 0) return result;
+
+  int width = workers[0].reader.codec_ctx->width;
+  int height = workers[0].reader.codec_ctx->height;
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].motion = options;
+  }
+
+  result = analysis_workers_run(workers, thread_count);
+  if (cancelled && *cancelled) result = -6;
+
+  int total_frames = 0;
+  int total_vectors = 0;
+  for (int i = 0; i < thread_count; i++) {
+    total_frames += workers[i].motion_frame_count;
+    total_vectors += workers[i].vector_count;
+  }
+
+  MotionVectorTrack *track = NULL;
+  if (result == 0) {
+    track = (MotionVectorTrack *)calloc(1, sizeof(MotionVectorTrack));
+    if (track && total_frames > 0) {
+      track->frames = (MotionFrame *)malloc(total_frames * sizeof(MotionFrame));
+      if (!track->frames) {
+        free(track);
+        track = NULL;
+      }
+    }
+    if (track && total_vectors > 0) {
+      track->vectors = (MotionVector *)malloc(total_vectors * sizeof(MotionVector));
+      if (!track->vectors) {
+        free(track->frames);
+        free(track);
+        track = NULL;
+      }
+    }
+    if (!track) result = -3;
+  }
+
+  // Segments are in time order; vector offsets move with the merge
+  for (int i = 0; i < thread_count; i++) {
+    AnalysisWorker *worker = &workers[i];
+    if (track) {
+      for (int f = 0; f < worker->motion_frame_count; f++) {
+        MotionFrame *frame = &track->frames[track->frame_count++];
+        *frame = worker->motion_frames[f];
+        if (frame->vector_count > 0) frame->vector_offset += track->vector_count;
+      }
+      if (worker->vector_count > 0) {
+        memcpy(track->vectors + track->vector_count, worker->vectors,
+               worker->vector_count * sizeof(MotionVector));
+        track->vector_count += worker->vector_count;
+      }
+    }
+    analysis_worker_cleanup(worker);
+  }
+  free(workers);
+
+  if (track) {
+    track->width = width;
+    track->height = height;
+  }
+  *out_track = track;
+  return result;
+}
+
+void analysis_free_motion_vectors(MotionVectorTrack *track) {
+  if (!track) return;
+  free(track->frames);
+  free(track->vectors);
+  free(track);
+}
+
+// --- Packet Statistics ---
+
+#define PACKET_MEDIAN_RADIUS 15
+#define PACKET_DEFAULT_SENSITIVITY 3.0f
+#define PACKET_DEFAULT_WINDOW_MS 1000
+#define PACKET_CUT_MERGE_MS 250
+#define PACKET_PROGRESS_INTERVAL 256
+
+static int compare_int(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+static int compare_int64(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Median size of the nearby packets of the same kind. I, P and B frames
+// differ in size by design, so they are only compared with their own.
+static float packet_local_median(const PacketInfo *packets, int count, int index, int *scratch) {
+  const PacketInfo *p = &packets[index];
+  int n = 0;
+  int first = index > PACKET_MEDIAN_RADIUS ? index - PACKET_MEDIAN_RADIUS : 0;
+  int last = index + PACKET_MEDIAN_RADIUS < count ? index + PACKET_MEDIAN_RADIUS : count - 1;
+
+  for (int j = first; j <= last; j++) {
+    if (j == index || packets[j].keyframe != p->keyframe ||
+        packets[j].pict_type != p->pict_type) {
+      continue;
+    }
+    scratch[n++] = packets[j].size;
+  }
+  if (n == 0) return 0.0f;
+
+  qsort(scratch, n, sizeof(int), compare_int);
+  return n & 1 ? (float)scratch[n / 2] : 0.5f * (scratch[n / 2 - 1] + scratch[n / 2]);
+}
+
+static int packet_stats_append(PacketStats *stats, int *capacity, const PacketInfo *info) {
+  if (stats->packet_count == *capacity) {
+    int new_capacity = *capacity ? *capacity * 2 : 1024;
+    PacketInfo *packets = (PacketInfo *)realloc(stats->packets, new_capacity * sizeof(PacketInfo));
+    if (!packets) return -1;
+    stats->packets = packets;
+    *capacity = new_capacity;
+  }
+  stats->packets[stats->packet_count++] = *info;
+  return 0;
+}
+
+// Activity, GOP structure, bitrate curve and likely cuts
+static int packet_stats_derive(PacketStats *stats, const PacketStatsOptions *options) {
+  PacketInfo *packets = stats->packets;
+  int count = stats->packet_count;
+  if (count == 0) return 0;
+
+  int scratch[2 * PACKET_MEDIAN_RADIUS];
+  for (int i = 0; i < count; i++) {
+    float median = packet_local_median(packets, count, i, scratch);
+    packets[i].activity = median > 0 ? packets[i].size / median : 1.0f;
+  }
+
+  // keys holds keyframe positions, gops[k] the distance from keys[k] to
+  // keys[k + 1]. The open GOP at the end is left out.
+  int *keys = (int *)malloc(count * sizeof(int));
+  int *gops = (int *)malloc(count * sizeof(int));
+  int64_t *cuts = (int64_t *)malloc(count * sizeof(int64_t));
+  if (!keys || !gops || !cuts) {
+    free(keys);
+    free(gops);
+    free(cuts);
+    return -3;
+  }
+
+  int key_count = 0;
+  for (int i = 0; i < count; i++) {
+    if (packets[i].keyframe) keys[key_count++] = i;
+  }
+  int gop_count = key_count > 0 ? key_count - 1 : 0;
+
+  int64_t gop_total = 0;
+  stats->min_gop_length = 0;
+  stats->max_gop_length = 0;
+  for (int k = 0; k < gop_count; k++) {
+    gops[k] = keys[k + 1] - keys[k];
+    gop_total += gops[k];
+    if (k == 0 || gops[k] < stats->min_gop_length) stats->min_gop_length = gops[k];
+    if (gops[k] > stats->max_gop_length) stats->max_gop_length = gops[k];
+  }
+  stats->gop_count = gop_count;
+  stats->average_gop_length = gop_count > 0 ? (float)gop_total / gop_count : 0.0f;
+
+  float sensitivity = options->cut_sensitivity > 0 ? options->cut_sensitivity
+                                                   : PACKET_DEFAULT_SENSITIVITY;
+  int cut_count = 0;
+
+  // Encoders insert keyframes at scene changes, so with a regular GOP
+  // cadence a keyframe arriving early marks a cut
+  if (gop_count >= 3) {
+    int *sorted = (int *)malloc(gop_count * sizeof(int));
+    if (sorted) {
+      memcpy(sorted, gops, gop_count * sizeof(int));
+      qsort(sorted, gop_count, sizeof(int), compare_int);
+      int cadence = sorted[gop_count / 2];
+      free(sorted);
+
+      for (int k = 0; k < gop_count; k++) {
+        const PacketInfo *p = &packets[keys[k + 1]];
+        int64_t ts = p->pts_ms >= 0 ? p->pts_ms : p->dts_ms;
+        if (ts >= 0 && gops[k] * 5 < cadence * 4) cuts[cut_count++] = ts;
+      }
+    }
+  }
+  free(keys);
+  free(gops);
+
+  // Size spikes catch cuts coded without a keyframe
+  for (int i = 0; i < count; i++) {
+    const PacketInfo *p = &packets[i];
+    int64_t ts = p->pts_ms >= 0 ? p->pts_ms : p->dts_ms;
+    if (!p->keyframe && ts >= 0 && p->activity >= sensitivity) cuts[cut_count++] = ts;
+  }
+
+  qsort(cuts, cut_count, sizeof(int64_t), compare_int64);
+  int merged = 0;
+  for (int i = 0; i < cut_count; i++) {
+    if (merged > 0 && cuts[i] - cuts[merged - 1] < PACKET_CUT_MERGE_MS) continue;
+    cuts[merged++] = cuts[i];
+  }
+  stats->likely_cuts_ms = cuts;
+  stats->likely_cut_count = merged;
+
+  // Bitrate by decode time, which is monotonic
+  int64_t window = options->bitrate_window_ms > 0 ? options->bitrate_window_ms
+                                                  : PACKET_DEFAULT_WINDOW_MS;
+  int64_t origin = options->start_ms > 0 ? options->start_ms : 0;
+  int64_t last_ms = origin;
+  for (int i = 0; i < count; i++) {
+    int64_t ts = packets[i].dts_ms >= 0 ? packets[i].dts_ms : packets[i].pts_ms;
+    if (ts > last_ms) last_ms = ts;
+  }
+
+  int buckets = (int)((last_ms - origin) / window) + 1;
+  uint64_t *bytes = (uint64_t *)calloc(buckets, sizeof(uint64_t));
+  stats->bitrate_kbps = (float *)malloc(buckets * sizeof(float));
+  if (!bytes || !stats->bitrate_kbps) {
+    free(bytes);
+    return -3;
+  }
+  for (int i = 0; i < count; i++) {
+    int64_t ts = packets[i].dts_ms >= 0 ? packets[i].dts_ms : packets[i].pts_ms;
+    if (ts < origin) ts = origin;
+    bytes[(ts - origin) / window] += packets[i].size;
+  }
+  for (int i = 0; i < buckets; i++) {
+    stats->bitrate_kbps[i] = (float)(bytes[i] * 8) / window;  // bits per ms = kbit/s
+  }
+  stats->bitrate_count = buckets;
+  stats->bitrate_window_ms = window;
+  free(bytes);
+
+  return 0;
+}
+
+int analysis_packet_stats(const char *url, const PacketStatsOptions *options,
+                          const bool *cancelled,
+                          OnFrameRangeProgressCallback progress, void *progress_user_data,
+                          PacketStats **out_stats) {
+  *out_stats = NULL;
+  if (!url || !options) return -1;
+
+  MediaReader reader;
+  if (reader_open_demuxer(&reader, url) < 0) return -2;
+
+  PacketStats *stats = (PacketStats *)calloc(1, sizeof(PacketStats));
+  if (!stats) {
+    reader_close(&reader);
+    return -3;
+  }
+
+  // Parsers recover the picture type from the bitstream headers
+  const AVStream *stream = reader.fmt_ctx->streams[reader.stream_idx];
+  AVCodecParserContext *parser = av_parser_init(stream->codecpar->codec_id);
+  AVCodecContext *parser_ctx = NULL;
+  if (parser) {
+    parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+    parser_ctx = avcodec_alloc_context3(NULL);
+    if (!parser_ctx || avcodec_parameters_to_context(parser_ctx, stream->codecpar) < 0) {
+      av_parser_close(parser);
+      parser = NULL;
+    }
+  }
+
+  int64_t start_ms = options->start_ms > 0 ? options->start_ms : 0;
+  int total = stream->nb_frames > 0 && stream->nb_frames < INT32_MAX ? (int)stream->nb_frames : 0;
+  int result = 0;
+  int capacity = 0;
+
+  if (start_ms > 0 && reader_seek(&reader, start_ms) < 0) result = -2;
+
+  while (result == 0 && reader_read_packet(&reader) == 0) {
+    AVPacket *pkt = reader.packet;
+    if (cancelled && *cancelled) {
+      av_packet_unref(pkt);
+      result = -6;
+      break;
+    }
+
+    PacketInfo info;
+    info.pts_ms = pkt->pts != AV_NOPTS_VALUE
+                      ? av_rescale_q(pkt->pts, reader.time_base, (AVRational){1, 1000}) : -1;
+    info.dts_ms = pkt->dts != AV_NOPTS_VALUE
+                      ? av_rescale_q(pkt->dts, reader.time_base, (AVRational){1, 1000}) : -1;
+    info.size = pkt->size;
+    info.keyframe = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+    info.pict_type = info.keyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    info.activity = 1.0f;
+
+    // Range checks on decode order, presentation order jumps around
+    int64_t ts = info.dts_ms >= 0 ? info.dts_ms : info.pts_ms;
+    if (options->end_ms > 0 && ts >= options->end_ms) {
+      av_packet_unref(pkt);
+      break;
+    }
+
+    if (parser) {
+      uint8_t *out_data = NULL;
+      int out_size = 0;
+      av_parser_parse2(parser, parser_ctx, &out_data, &out_size, pkt->data, pkt->size,
+                       pkt->pts, pkt->dts, pkt->pos);
+      if (parser->pict_type != AV_PICTURE_TYPE_NONE) info.pict_type = parser->pict_type;
+    }
+    av_packet_unref(pkt);
+
+    // The seek lands on the keyframe before start_ms
+    if (ts >= 0 && ts < start_ms) continue;
+
+    if (packet_stats_append(stats, &capacity, &info) < 0) {
+      result = -3;
+      break;
+    }
+    if (progress && stats->packet_count % PACKET_PROGRESS_INTERVAL == 0) {
+      progress(progress_user_data, stats->packet_count, total);
+    }
+  }
+
+  if (parser) av_parser_close(parser);
+  avcodec_free_context(&parser_ctx);
+  reader_close(&reader);
+
+  if (result == 0) result = packet_stats_derive(stats, options);
+  if (result < 0) {
+    analysis_free_packet_stats(stats);
+    return result;
+  }
+
+  if (progress) progress(progress_user_data, stats->packet_count, total);
+  *out_stats = stats;
+  return 0;
+}
+
+void analysis_free_packet_stats(PacketStats *stats) {
+  if (!stats) return;
+  free(stats->packets);
+  free(stats->bitrate_kbps);
+  free(stats->likely_cuts_ms);
+  free(stats);
+}
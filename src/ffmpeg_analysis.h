@@ -0,0 +1,63 @@
+#ifndef FFMPEG_ANALYSIS_H
+#define FFMPEG_ANALYSIS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libavutil/frame.h>
+
+#include "ffmpeg_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Video Analysis ---
+//
+// Sequential passes over a time range, split into segments decoded in
+// parallel on private readers. Frames are reduced to a small luma image
+// before any metric is computed.
+
+// Sum of absolute differences of two n byte buffers.
+uint64_t analysis_sad(const uint8_t *a, const uint8_t *b, int n);
+
+// Luma statistics of a decoded frame, read from its Y plane. previous is
+// the frame to diff against and may be NULL. stats->valid stays 0 for
+// formats without a planar luma plane (RGB, paletted, hardware).
+void analysis_frame_stats(const AVFrame *frame, const AVFrame *previous, FrameStats *stats);
+
+// Find shot boundaries in url. cancelled is polled between frames and may
+// be NULL.
+// Returns 0 on success, negative on failure:
+// -1 invalid options, -2 open failed, -3 out of memory, -6 cancelled.
+int analysis_detect_scenes(const char *url, const SceneDetectOptions *options,
+                           const bool *cancelled, SceneCutList **out_cuts);
+
+void analysis_free_scene_cuts(SceneCutList *cuts);
+
+// Find black and frozen intervals in url. Error codes as above.
+int analysis_detect_black_freeze(const char *url, const BlackFreezeOptions *options,
+                                 const bool *cancelled, BlackFreezeResult **out_result);
+
+void analysis_free_black_freeze(BlackFreezeResult *result);
+
+// Collect the codec motion vectors of url. Error codes as above.
+int analysis_motion_vectors(const char *url, const MotionVectorOptions *options,
+                            const bool *cancelled, MotionVectorTrack **out_track);
+
+void analysis_free_motion_vectors(MotionVectorTrack *track);
+
+// Collect packet statistics of url without decoding. progress may be
+// NULL. Error codes as above.
+int analysis_packet_stats(const char *url, const PacketStatsOptions *options,
+                          const bool *cancelled,
+                          OnFrameRangeProgressCallback progress, void *progress_user_data,
+                          PacketStats **out_stats);
+
+void analysis_free_packet_stats(PacketStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_ANALYSIS_H
@@ -0,0 +1,506 @@
+#include "ffmpeg_cache.h"
+#include "ffmpeg_lz4.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+
+typedef struct {
+  AVFrame *frame;   // Raw tier: the decoded frame. Packed tier: its properties, no buffers
+  uint8_t *packed;  // Packed tier: LZ4 block of the visible plane rows, NULL when raw
+  size_t packed_size;
+  uint64_t media_key;
+  int64_t ts_ms;
+  size_t size;
+  uint64_t last_used;
+} FrameCacheEntry;
+
+struct FrameCache {
+  FrameCacheEntry *entries;
+  int count;
+  int capacity;
+  size_t bytes;
+  size_t max_bytes;
+  size_t packed_bytes;
+  size_t max_packed_bytes;
+  uint64_t clock;  // Bumped on every use, for LRU order
+  uint8_t *scratch;  // Planes laid out row after row, then their LZ4 block
+  size_t scratch_size;
+  FrameSpill *spill;
+};
+
+FrameCache *frame_cache_alloc(void) {
+  return (FrameCache *)calloc(1, sizeof(FrameCache));
+}
+
+// Bytes a frame keeps alive: its buffers, whatever the pool sized them to
+static size_t frame_cache_frame_size(const AVFrame *frame) {
+  size_t size = 0;
+  for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++) {
+    size += frame->buf[i]->size;
+  }
+  return size;
+}
+
+static void frame_cache_remove(FrameCache *cache, int index) {
+  FrameCacheEntry *entry = &cache->entries[index];
+  if (entry->packed) {
+    cache->packed_bytes -= entry->packed_size;
+    free(entry->packed);
+  } else {
+    cache->bytes -= entry->size;
+  }
+  av_frame_free(&entry->frame);
+  cache->entries[index] = cache->entries[--cache->count];
+}
+
+void frame_cache_free(FrameCache **cache) {
+  if (!cache || !*cache) return;
+  while ((*cache)->count > 0) frame_cache_remove(*cache, 0);
+  frame_spill_close(&(*cache)->spill);
+  free((*cache)->entries);
+  free((*cache)->scratch);
+  free(*cache);
+  *cache = NULL;
+}
+
+// --- Plane Packing ---
+
+// Row width and row count of each plane, without the linesize padding.
+// Returns the plane count, or -1 for formats that cannot be packed.
+static int frame_cache_plane_layout(int format, int width, int height, int row_bytes[4],
+                                    int rows[4]) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((enum AVPixelFormat)format);
+  if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL))) return -1;
+
+  int planes = av_pix_fmt_count_planes((enum AVPixelFormat)format);
+  if (planes <= 0 || planes > 4) return -1;
+  for (int p = 0; p < planes; p++) {
+    row_bytes[p] = av_image_get_linesize((enum AVPixelFormat)format, width, p);
+    rows[p] = (p == 1 || p == 2) ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h) : height;
+    if (row_bytes[p] <= 0 || rows[p] <= 0) return -1;
+  }
+  return planes;
+}
+
+static size_t frame_cache_rows_size(int planes, const int row_bytes[4], const int rows[4]) {
+  size_t size = 0;
+  for (int p = 0; p < planes; p++) size += (size_t)row_bytes[p] * rows[p];
+  return size;
+}
+
+static uint8_t *frame_cache_scratch(FrameCache *cache, size_t size) {
+  if (cache->scratch_size < size) {
+    uint8_t *scratch = (uint8_t *)realloc(cache->scratch, size);
+    if (!scratch) return NULL;
+    cache->scratch = scratch;
+    cache->scratch_size = size;
+  }
+  return cache->scratch;
+}
+
+// Lay frame's planes out row after row at the start of the scratch buffer
+// and LZ4 compress them right behind. Returns the compressed size, or 0 if
+// compression failed; *raw_size is the rows' size, 0 when the frame cannot
+// be packed at all.
+static size_t frame_cache_compress(FrameCache *cache, const AVFrame *frame, size_t *raw_size) {
+  *raw_size = 0;
+  int row_bytes[4], rows[4];
+  int planes =
+      frame_cache_plane_layout(frame->format, frame->width, frame->height, row_bytes, rows);
+  if (planes < 0) return 0;
+  for (int p = 0; p < planes; p++) {
+    if (!frame->data[p]) return 0;
+  }
+
+  size_t size = frame_cache_rows_size(planes, row_bytes, rows);
+  size_t bound = lz4_compress_bound(size);
+  uint8_t *scratch = frame_cache_scratch(cache, size + bound);
+  if (!scratch) return 0;
+
+  uint8_t *rows_out = scratch;
+  for (int p = 0; p < planes; p++) {
+    av_image_copy_plane(rows_out, row_bytes[p], frame->data[p], frame->linesize[p],
+                        row_bytes[p], rows[p]);
+    rows_out += (size_t)row_bytes[p] * rows[p];
+  }
+
+  *raw_size = size;
+  return lz4_compress(scratch, size, scratch + size, bound);
+}
+
+// New frame of format and size, its planes filled from rows laid out as by
+// frame_cache_compress, LZ4 compressed or not. Properties are left unset.
+static AVFrame *frame_cache_expand(FrameCache *cache, int format, int width, int height,
+                                   const uint8_t *data, size_t size, bool compressed) {
+  int row_bytes[4], rows[4];
+  int planes = frame_cache_plane_layout(format, width, height, row_bytes, rows);
+  if (planes < 0) return NULL;
+  size_t raw_size = frame_cache_rows_size(planes, row_bytes, rows);
+
+  const uint8_t *rows_in = data;
+  if (compressed) {
+    uint8_t *scratch = frame_cache_scratch(cache, raw_size);
+    if (!scratch || lz4_decompress(data, size, scratch, raw_size) < 0) return NULL;
+    rows_in = scratch;
+  } else if (size != raw_size) {
+    return NULL;
+  }
+
+  AVFrame *frame = av_frame_alloc();
+  if (!frame) return NULL;
+  frame->format = format;
+  frame->width = width;
+  frame->height = height;
+  if (av_frame_get_buffer(frame, 0) < 0) {
+    av_frame_free(&frame);
+    return NULL;
+  }
+
+  for (int p = 0; p < planes; p++) {
+    av_image_copy_plane(frame->data[p], frame->linesize[p], rows_in, row_bytes[p],
+                        row_bytes[p], rows[p]);
+    rows_in += (size_t)row_bytes[p] * rows[p];
+  }
+  return frame;
+}
+
+// Compress entry's frame into the packed tier. Returns -1, leaving the entry
+// raw, when the format is unsupported or the planes do not compress.
+static int frame_cache_pack(FrameCache *cache, FrameCacheEntry *entry) {
+  const AVFrame *frame = entry->frame;
+  size_t raw_size;
+  size_t packed_size = frame_cache_compress(cache, frame, &raw_size);
+  // Not worth keeping unless it saves at least an eighth
+  if (packed_size == 0 || packed_size > raw_size - raw_size / 8) return -1;
+
+  uint8_t *packed = (uint8_t *)malloc(packed_size);
+  AVFrame *props = av_frame_alloc();
+  if (!packed || !props || av_frame_copy_props(props, frame) < 0) {
+    free(packed);
+    av_frame_free(&props);
+    return -1;
+  }
+  memcpy(packed, cache->scratch + raw_size, packed_size);
+  props->format = frame->format;
+  props->width = frame->width;
+  props->height = frame->height;
+
+  cache->bytes -= entry->size;
+  av_frame_free(&entry->frame);
+  entry->frame = props;
+  entry->packed = packed;
+  entry->packed_size = packed_size;
+  cache->packed_bytes += packed_size;
+  return 0;
+}
+
+// Decompress entry back into a frame of its own and return it to the raw
+// tier. The caller brings the raw tier back under budget.
+static int frame_cache_unpack(FrameCache *cache, FrameCacheEntry *entry) {
+  const AVFrame *props = entry->frame;
+  AVFrame *frame = frame_cache_expand(cache, props->format, props->width, props->height,
+                                      entry->packed, entry->packed_size, true);
+  if (!frame || av_frame_copy_props(frame, props) < 0) {
+    av_frame_free(&frame);
+    return -1;
+  }
+
+  cache->packed_bytes -= entry->packed_size;
+  free(entry->packed);
+  entry->packed = NULL;
+  entry->packed_size = 0;
+  av_frame_free(&entry->frame);
+  entry->frame = frame;
+  entry->size = frame_cache_frame_size(frame);
+  cache->bytes += entry->size;
+  return 0;
+}
+
+// --- Spill Tier ---
+
+static void frame_cache_record_props(FrameSpillRecord *record, const AVFrame *frame) {
+  record->format = frame->format;
+  record->width = frame->width;
+  record->height = frame->height;
+  record->pts = frame->pts;
+  record->duration = frame->duration;
+  record->sample_aspect_num = frame->sample_aspect_ratio.num;
+  record->sample_aspect_den = frame->sample_aspect_ratio.den;
+  record->color_range = frame->color_range;
+  record->color_primaries = frame->color_primaries;
+  record->color_trc = frame->color_trc;
+  record->colorspace = frame->colorspace;
+  record->frame_flags = frame->flags;
+}
+
+static void frame_cache_apply_props(AVFrame *frame, const FrameSpillRecord *record) {
+  frame->pts = record->pts;
+  frame->duration = record->duration;
+  frame->sample_aspect_ratio.num = record->sample_aspect_num;
+  frame->sample_aspect_ratio.den = record->sample_aspect_den;
+  frame->color_range = (enum AVColorRange)record->color_range;
+  frame->color_primaries = (enum AVColorPrimaries)record->color_primaries;
+  frame->color_trc = (enum AVColorTransferCharacteristic)record->color_trc;
+  frame->colorspace = (enum AVColorSpace)record->colorspace;
+  frame->flags = record->frame_flags;
+}
+
+// Whether frames of media_key go to the spill file. A persistent one only
+// takes media it can tell apart from a later change.
+static bool frame_cache_spills(const FrameCache *cache, uint64_t media_key) {
+  if (!cache->spill) return false;
+  return !(media_key & FRAME_CACHE_KEY_VOLATILE) || !frame_spill_persistent(cache->spill);
+}
+
+// Write entry to the spill file on its way out of memory. Packed entries go
+// as they are; raw ones are compressed when that saves anything.
+static void frame_cache_spill(FrameCache *cache, const FrameCacheEntry *entry) {
+  if (!frame_cache_spills(cache, entry->media_key) ||
+      frame_spill_contains(cache->spill, entry->media_key, entry->ts_ms)) {
+    return;
+  }
+
+  FrameSpillRecord record;
+  memset(&record, 0, sizeof(record));
+  record.media_key = entry->media_key;
+  record.ts_ms = entry->ts_ms;
+  frame_cache_record_props(&record, entry->frame);
+
+  if (entry->packed) {
+    record.flags = FRAME_SPILL_LZ4;
+    frame_spill_store(cache->spill, &record, entry->packed, entry->packed_size);
+    return;
+  }
+
+  size_t raw_size;
+  size_t packed_size = frame_cache_compress(cache, entry->frame, &raw_size);
+  if (raw_size == 0) return;
+  if (packed_size > 0 && packed_size < raw_size) {
+    record.flags = FRAME_SPILL_LZ4;
+    frame_spill_store(cache->spill, &record, cache->scratch + raw_size, packed_size);
+  } else {
+    frame_spill_store(cache->spill, &record, cache->scratch, raw_size);
+  }
+}
+
+void frame_cache_set_spill(FrameCache *cache, FrameSpill *spill) {
+  if (!cache) {
+    frame_spill_close(&spill);
+    return;
+  }
+  frame_spill_close(&cache->spill);
+  cache->spill = spill;
+}
+
+// --- Eviction ---
+
+static int frame_cache_oldest(const FrameCache *cache, int packed) {
+  int oldest = -1;
+  for (int i = 0; i < cache->count; i++) {
+    const FrameCacheEntry *entry = &cache->entries[i];
+    if ((entry->packed != NULL) != packed) continue;
+    if (oldest < 0 || entry->last_used < cache->entries[oldest].last_used) oldest = i;
+  }
+  return oldest;
+}
+
+static void frame_cache_evict_packed(FrameCache *cache, size_t max_bytes) {
+  while (cache->packed_bytes > max_bytes) {
+    int oldest = frame_cache_oldest(cache, 1);
+    if (oldest < 0) break;
+    frame_cache_spill(cache, &cache->entries[oldest]);
+    frame_cache_remove(cache, oldest);
+  }
+}
+
+// Bring the raw tier under max_bytes. Evicted frames move to the packed tier
+// while it has a budget, and otherwise to the spill file, if any.
+static void frame_cache_evict(FrameCache *cache, size_t max_bytes) {
+  while (cache->bytes > max_bytes) {
+    int oldest = frame_cache_oldest(cache, 0);
+    if (oldest < 0) break;
+    if (cache->max_packed_bytes == 0 || frame_cache_pack(cache, &cache->entries[oldest]) < 0) {
+      frame_cache_spill(cache, &cache->entries[oldest]);
+      frame_cache_remove(cache, oldest);
+      continue;
+    }
+    frame_cache_evict_packed(cache, cache->max_packed_bytes);
+  }
+}
+
+void frame_cache_set_budget(FrameCache *cache, size_t max_bytes) {
+  if (!cache) return;
+  cache->max_bytes = max_bytes;
+  if (max_bytes == 0) {
+    while (cache->count > 0) frame_cache_remove(cache, 0);
+    return;
+  }
+  frame_cache_evict(cache, max_bytes);
+}
+
+void frame_cache_set_packed_budget(FrameCache *cache, size_t max_bytes) {
+  if (!cache) return;
+  cache->max_packed_bytes = max_bytes;
+  frame_cache_evict_packed(cache, max_bytes);
+}
+
+// --- Insert and Lookup ---
+
+// Add frame, which the cache takes over, to the raw tier
+static void frame_cache_add(FrameCache *cache, uint64_t media_key, AVFrame *frame,
+                            int64_t ts_ms) {
+  size_t size = frame_cache_frame_size(frame);
+  if (size > cache->max_bytes) {
+    av_frame_free(&frame);
+    return;
+  }
+
+  if (cache->count == cache->capacity) {
+    int capacity = cache->capacity ? cache->capacity * 2 : 64;
+    FrameCacheEntry *entries =
+        (FrameCacheEntry *)realloc(cache->entries, capacity * sizeof(FrameCacheEntry));
+    if (!entries) {
+      av_frame_free(&frame);
+      return;
+    }
+    cache->entries = entries;
+    cache->capacity = capacity;
+  }
+
+  frame_cache_evict(cache, cache->max_bytes - size);
+
+  FrameCacheEntry *entry = &cache->entries[cache->count++];
+  memset(entry, 0, sizeof(*entry));
+  entry->frame = frame;
+  entry->media_key = media_key;
+  entry->ts_ms = ts_ms;
+  entry->size = size;
+  entry->last_used = ++cache->clock;
+  cache->bytes += size;
+}
+
+void frame_cache_insert(FrameCache *cache, uint64_t media_key, const AVFrame *frame,
+                        int64_t ts_ms) {
+  if (!cache || cache->max_bytes == 0 || !frame->buf[0]) return;
+
+  for (int i = 0; i < cache->count; i++) {
+    FrameCacheEntry *entry = &cache->entries[i];
+    if (entry->media_key == media_key && entry->ts_ms == ts_ms) {
+      entry->last_used = ++cache->clock;
+      return;
+    }
+  }
+
+  if (frame_cache_frame_size(frame) > cache->max_bytes) return;
+
+  AVFrame *ref = av_frame_clone(frame);
+  if (!ref) return;
+  frame_cache_add(cache, media_key, ref, ts_ms);
+}
+
+// Rebuild a spilled frame into dst and bring it back into memory
+static int frame_cache_lookup_spill(FrameCache *cache, uint64_t media_key, int64_t ts_ms,
+                                    int64_t tolerance_ms, AVFrame *dst) {
+  FrameSpillRecord record;
+  const uint8_t *payload;
+  size_t size;
+  if (!frame_cache_spills(cache, media_key) || cache->max_bytes == 0 ||
+      frame_spill_find(cache->spill, media_key, ts_ms, tolerance_ms, &record, &payload,
+                       &size) < 0) {
+    return -1;
+  }
+
+  AVFrame *frame = frame_cache_expand(cache, record.format, record.width, record.height,
+                                      payload, size, (record.flags & FRAME_SPILL_LZ4) != 0);
+  if (!frame) return -1;
+  frame_cache_apply_props(frame, &record);
+
+  av_frame_unref(dst);
+  int ret = av_frame_ref(dst, frame);
+  frame_cache_add(cache, record.media_key, frame, record.ts_ms);
+  return ret < 0 ? -1 : 0;
+}
+
+int frame_cache_lookup(FrameCache *cache, uint64_t media_key, int64_t ts_ms,
+                       int64_t tolerance_ms, AVFrame *dst) {
+  if (!cache) return -1;
+
+  int best = -1;
+  for (int i = 0; i < cache->count; i++) {
+    FrameCacheEntry *entry = &cache->entries[i];
+    if (entry->media_key != media_key || entry->ts_ms < ts_ms ||
+        entry->ts_ms >= ts_ms + tolerance_ms) {
+      continue;
+    }
+    if (best < 0 || entry->ts_ms < cache->entries[best].ts_ms) best = i;
+  }
+  if (best < 0) return frame_cache_lookup_spill(cache, media_key, ts_ms, tolerance_ms, dst);
+
+  FrameCacheEntry *entry = &cache->entries[best];
+  if (entry->packed && frame_cache_unpack(cache, entry) < 0) {
+    frame_cache_remove(cache, best);
+    return -1;
+  }
+
+  av_frame_unref(dst);
+  int ret = av_frame_ref(dst, entry->frame);
+  entry->last_used = ++cache->clock;
+  // Eviction may move entries, so only after dst holds its reference
+  frame_cache_evict(cache, cache->max_bytes);
+  return ret < 0 ? -1 : 0;
+}
+
+bool frame_cache_contains(const FrameCache *cache, uint64_t media_key, int64_t ts_ms,
+                          int64_t tolerance_ms) {
+  if (!cache || cache->max_bytes == 0) return false;
+
+  for (int i = 0; i < cache->count; i++) {
+    const FrameCacheEntry *entry = &cache->entries[i];
+    if (entry->media_key == media_key && entry->ts_ms >= ts_ms &&
+        entry->ts_ms < ts_ms + tolerance_ms) {
+      return true;
+    }
+  }
+  if (!frame_cache_spills(cache, media_key)) return false;
+
+  FrameSpillRecord record;
+  const uint8_t *payload;
+  size_t size;
+  return frame_spill_find(cache->spill, media_key, ts_ms, tolerance_ms, &record, &payload,
+                          &size) == 0;
+}
+
+uint64_t frame_cache_media_key(const char *url) {
+  return frame_cache_files_key(url, &url, 1);
+}
+
+uint64_t frame_cache_files_key(const char *url, const char *const *paths, int count) {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+    hash ^= *p;
+    hash *= 0x100000001b3ULL;
+  }
+
+  // Files also hash their size and modification time, so a spill file kept
+  // across runs does not serve frames of a file since replaced
+  bool identified = count > 0;
+  for (int i = 0; i < count; i++) {
+    struct stat st;
+    if (stat(paths[i], &st) != 0) {
+      identified = false;
+      continue;
+    }
+    uint64_t identity[2] = { (uint64_t)st.st_size, (uint64_t)st.st_mtime };
+    const unsigned char *bytes = (const unsigned char *)identity;
+    for (size_t j = 0; j < sizeof(identity); j++) {
+      hash ^= bytes[j];
+      hash *= 0x100000001b3ULL;
+    }
+  }
+  return identified ? hash & ~FRAME_CACHE_KEY_VOLATILE : hash | FRAME_CACHE_KEY_VOLATILE;
+}
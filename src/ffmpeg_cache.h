@@ -0,0 +1,77 @@
+#ifndef FFMPEG_CACHE_H
+#define FFMPEG_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libavutil/frame.h>
+
+#include "ffmpeg_spill.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Decoded Frame Cache ---
+//
+// References to decoded frames, keyed by media and timestamp, evicted least
+// recently used first once their buffers pass the byte budget. Frames are
+// held by reference, so caching costs no copy; the decoder allocates new
+// buffers while old ones are kept. Frames evicted this way can move to a
+// second, compressed tier with a budget of its own, and from there to a
+// spill file on disk. Not thread safe.
+
+typedef struct FrameCache FrameCache;
+
+FrameCache *frame_cache_alloc(void);
+void frame_cache_free(FrameCache **cache);
+
+// Byte budget for the frame buffers. 0 disables the cache and drops every
+// frame in it.
+void frame_cache_set_budget(FrameCache *cache, size_t max_bytes);
+
+// Byte budget for the packed tier. While it is above 0, frames evicted by
+// the byte budget are LZ4 compressed rather than dropped, and a lookup that
+// hits one decompresses it into a new frame. Hardware frames, and frames
+// that save less than an eighth, are still dropped. 0, the default, drops
+// the packed frames.
+void frame_cache_set_packed_budget(FrameCache *cache, size_t max_bytes);
+
+// Hand over the spill file that frames leaving memory are written to, and
+// that lookups fall back to; NULL for none. Closes the previous one. Only
+// frames evicted by a budget spill: disabling the cache does not.
+void frame_cache_set_spill(FrameCache *cache, FrameSpill *spill);
+
+// Reference frame, shown at ts_ms, under media_key. Does nothing while
+// the cache is disabled.
+void frame_cache_insert(FrameCache *cache, uint64_t media_key, const AVFrame *frame,
+                        int64_t ts_ms);
+
+// Reference into dst the earliest cached frame of media_key shown in
+// [ts_ms, ts_ms + tolerance_ms). Returns 0 on a hit, -1 otherwise.
+int frame_cache_lookup(FrameCache *cache, uint64_t media_key, int64_t ts_ms,
+                       int64_t tolerance_ms, AVFrame *dst);
+
+// Whether frame_cache_lookup would hit, without unpacking the frame or
+// counting it as used.
+bool frame_cache_contains(const FrameCache *cache, uint64_t media_key, int64_t ts_ms,
+                          int64_t tolerance_ms);
+
+// Set in keys with nothing on disk to tell a changed media by, such as
+// URLs. Their frames are kept out of a persistent spill file, which could
+// otherwise serve them for whatever the URL names in a later run.
+#define FRAME_CACHE_KEY_VOLATILE 1ULL
+
+// Key for a media path or URL. Local files also key on their size and
+// modification time.
+uint64_t frame_cache_media_key(const char *url);
+
+// Key for url that also hashes the size and modification time of count
+// files, e.g. the images of a sequence. Volatile if any cannot be stat'd.
+uint64_t frame_cache_files_key(const char *url, const char *const *paths, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_CACHE_H
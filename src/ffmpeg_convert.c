@@ -0,0 +1,781 @@
+#include "ffmpeg_convert.h"
+
+#include <libavutil/cpu.h>
+#include <libavutil/pixdesc.h>
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- SIMD Availability ---
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CONVERT_HAVE_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define CONVERT_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define CONVERT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CONVERT_TARGET_SSE41
+#define CONVERT_TARGET_AVX2
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define CONVERT_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef void (*YuvPlanarRowFunc)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                 uint8_t *dst, int width, const YuvToRgbCoeffs *c);
+typedef void (*YuvSemiPlanarRowFunc)(const uint8_t *y, const uint8_t *uv,
+                                     uint8_t *dst, int width, const YuvToRgbCoeffs *c);
+typedef void (*DownsampleRowFunc)(const uint8_t *row0, const uint8_t *row1,
+                                  uint8_t *dst, int dst_width);
+
+// --- Scalar Kernels ---
+//
+// The scalar code mirrors the SIMD arithmetic step by step (Q14 rounding
+// high multiply, Q6 accumulation), so every kernel set produces identical
+// output and the scalar version doubles as the reference for row tails.
+
+static inline int mul_hrs(int a, int b) {
+  return (a * b + (1 << 14)) >> 15;
+}
+
+static inline uint8_t clamp_q6(int v) {
+  v = (v + 32) >> 6;
+  return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static inline void yuv_to_rgba_pixel(int y, int u, int v, uint8_t *dst,
+                                     const YuvToRgbCoeffs *c) {
+  int cu = u - 128;
+  int cv = v - 128;
+  int yy = mul_hrs((y - c->y_offset) * 128, c->y_coeff);
+  int vr = mul_hrs(cv * 128, c->v_to_r);
+  int gs = mul_hrs(cu * 128, c->u_to_g) + mul_hrs(cv * 128, c->v_to_g);
+  int ub = mul_hrs(cu * 128, c->u_to_b) + cu * 64;
+
+  dst[0] = clamp_q6(yy + vr);
+  dst[1] = clamp_q6(yy - gs);
+  dst[2] = clamp_q6(yy + ub);
+  dst[3] = 255;
+}
+
+static void yuv420p_row_c(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                          uint8_t *dst, int width, const YuvToRgbCoeffs *c) {
+  for (int x = 0; x < width; x++) {
+    yuv_to_rgba_pixel(y[x], u[x >> 1], v[x >> 1], dst + x * 4, c);
+  }
+}
+
+static void nv12_row_c(const uint8_t *y, const uint8_t *uv,
+                       uint8_t *dst, int width, const YuvToRgbCoeffs *c) {
+  for (int x = 0; x < width; x++) {
+    int cx = (x >> 1) * 2;
+    yuv_to_rgba_pixel(y[x], uv[cx], uv[cx + 1], dst + x * 4, c);
+  }
+}
+
+// Averages 2x2 RGBA blocks of two source rows into one destination row,
+// rounding to nearest: (a + b + c + d + 2) >> 2 per channel.
+static void downsample_row_c(const uint8_t *row0, const uint8_t *row1,
+                             uint8_t *dst, int dst_width) {
+  for (int x = 0; x < dst_width; x++) {
+    const uint8_t *a = row0 + x * 8;
+    const uint8_t *b = row1 + x * 8;
+    for (int c = 0; c < 4; c++) {
+      dst[x * 4 + c] = (uint8_t)((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+    }
+  }
+}
+
+// --- SSE4.1 / AVX2 Kernels ---
+
+#if defined(CONVERT_HAVE_X86)
+
+// Converts 16 pixels: 16 luma bytes and 8 chroma samples widened to int16.
+CONVERT_TARGET_SSE41
+static inline void yuv_to_rgba16_sse41(uint8_t *dst, __m128i y8, __m128i u16, __m128i v16,
+                                       const YuvToRgbCoeffs *c) {
+  const __m128i bias = _mm_set1_epi16(128);
+  const __m128i round = _mm_set1_epi16(32);
+  const __m128i zero = _mm_setzero_si128();
+
+  __m128i cu = _mm_sub_epi16(u16, bias);
+  __m128i cv = _mm_sub_epi16(v16, bias);
+  __m128i cu7 = _mm_slli_epi16(cu, 7);
+  __m128i cv7 = _mm_slli_epi16(cv, 7);
+
+  __m128i vr = _mm_mulhrs_epi16(cv7, _mm_set1_epi16(c->v_to_r));
+  __m128i gs = _mm_add_epi16(_mm_mulhrs_epi16(cu7, _mm_set1_epi16(c->u_to_g)),
+                             _mm_mulhrs_epi16(cv7, _mm_set1_epi16(c->v_to_g)));
+  __m128i ub = _mm_add_epi16(_mm_mulhrs_epi16(cu7, _mm_set1_epi16(c->u_to_b)),
+                             _mm_slli_epi16(cu, 6));
+
+  // Duplicate each chroma term for the two luma samples it covers
+  __m128i vr_lo = _mm_unpacklo_epi16(vr, vr), vr_hi = _mm_unpackhi_epi16(vr, vr);
+  __m128i gs_lo = _mm_unpacklo_epi16(gs, gs), gs_hi = _mm_unpackhi_epi16(gs, gs);
+  __m128i ub_lo = _mm_unpacklo_epi16(ub, ub), ub_hi = _mm_unpackhi_epi16(ub, ub);
+
+  const __m128i y_off = _mm_set1_epi16(c->y_offset);
+  const __m128i y_coeff = _mm_set1_epi16(c->y_coeff);
+  __m128i y_lo = _mm_cvtepu8_epi16(y8);
+  __m128i y_hi = _mm_unpackhi_epi8(y8, zero);
+  y_lo = _mm_mulhrs_epi16(_mm_slli_epi16(_mm_sub_epi16(y_lo, y_off), 7), y_coeff);
+  y_hi = _mm_mulhrs_epi16(_mm_slli_epi16(_mm_sub_epi16(y_hi, y_off), 7), y_coeff);
+
+  __m128i r_lo = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(y_lo, vr_lo), round), 6);
+  __m128i r_hi = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(y_hi, vr_hi), round), 6);
+  __m128i g_lo = _mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(y_lo, gs_lo), round), 6);
+  __m128i g_hi = _mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(y_hi, gs_hi), round), 6);
+  __m128i b_lo = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(y_lo, ub_lo), round), 6);
+  __m128i b_hi = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(y_hi, ub_hi), round), 6);
+
+  __m128i r8 = _mm_packus_epi16(r_lo, r_hi);
+  __m128i g8 = _mm_packus_epi16(g_lo, g_hi);
+  __m128i b8 = _mm_packus_epi16(b_lo, b_hi);
+  __m128i a8 = _mm_set1_epi8((char)0xFF);
+
+  __m128i rg_lo = _mm_unpacklo_epi8(r8, g8), rg_hi = _mm_unpackhi_epi8(r8, g8);
+  __m128i ba_lo = _mm_unpacklo_epi8(b8, a8), ba_hi = _mm_unpackhi_epi8(b8, a8);
+
+  _mm_storeu_si128((__m128i *)(dst + 0), _mm_unpacklo_epi16(rg_lo, ba_lo));
+  _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(rg_lo, ba_lo));
+  _mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi16(rg_hi, ba_hi));
+  _mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi16(rg_hi, ba_hi));
+}
+
+CONVERT_TARGET_SSE41
+static void yuv420p_row_sse41(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                              uint8_t *dst, int width, const YuvToRgbCoeffs *c) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i y8 = _mm_loadu_si128((const __m128i *)(y + x));
+    __m128i u16 = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(u + x / 2)));
+    __m128i v16 = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(v + x / 2)));
+    yuv_to_rgba16_sse41(dst + x * 4, y8, u16, v16, c);
+  }
+  if (x < width) {
+    yuv420p_row_c(y + x, u + x / 2, v + x / 2, dst + x * 4, width - x, c);
+  }
+}
+
+CONVERT_TARGET_SSE41
+static void nv12_row_sse41(const uint8_t *y, const uint8_t *uv,
+                           uint8_t *dst, int width, const YuvToRgbCoeffs *c) {
+  const __m128i low_mask = _mm_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i y8 = _mm_loadu_si128((const __m128i *)(y + x));
+    __m128i uv8 = _mm_loadu_si128((const __m128i *)(uv + x));
+    __m128i u16 = _mm_and_si128(uv8, low_mask);
+    __m128i v16 = _mm_srli_epi16(uv8, 8);
+    yuv_to_rgba16_sse41(dst + x * 4, y8, u16, v16, c);
+  }
+  if (x < width) {
+    nv12_row_c(y + x, uv + x, dst + x * 4, width - x, c);
+  }
+}
+
+// Converts 32 pixels: 32 luma bytes and 16 chroma samples widened to int16.
+CONVERT_TARGET_AVX2
+static inline void yuv_to_rgba32_avx2(uint8_t *dst, __m256i y8, __m256i u16, __m256i v16,
+                                      const YuvToRgbCoeffs *c) {
+  const __m256i bias = _mm256_set1_epi16(128);
+  const __m256i round = _mm256_set1_epi16(32);
+
+  __m256i cu = _mm256_sub_epi16(u16, bias);
+  __m256i cv = _mm256_sub_epi16(v16, bias);
+  __m256i cu7 = _mm256_slli_epi16(cu, 7);
+  __m256i cv7 = _mm256_slli_epi16(cv, 7);
+
+  __m256i vr = _mm256_mulhrs_epi16(cv7, _mm256_set1_epi16(c->v_to_r));
+  __m256i gs = _mm256_add_epi16(_mm256_mulhrs_epi16(cu7, _mm256_set1_epi16(c->u_to_g)),
+                                _mm256_mulhrs_epi16(cv7, _mm256_set1_epi16(c->v_to_g)));
+  __m256i ub = _mm256_add_epi16(_mm256_mulhrs_epi16(cu7, _mm256_set1_epi16(c->u_to_b)),
+                                _mm256_slli_epi16(cu, 6));
+
+  // Unpacks work per 128-bit lane: reorder qwords so that lo/hi come out
+  // as chroma for pixels 0-15 and 16-31 respectively.
+  vr = _mm256_permute4x64_epi64(vr, 0xD8);
+  gs = _mm256_permute4x64_epi64(gs, 0xD8);
+  ub = _mm256_permute4x64_epi64(ub, 0xD8);
+  __m256i vr_lo = _mm256_unpacklo_epi16(vr, vr), vr_hi = _mm256_unpackhi_epi16(vr, vr);
+  __m256i gs_lo = _mm256_unpacklo_epi16(gs, gs), gs_hi = _mm256_unpackhi_epi16(gs, gs);
+  __m256i ub_lo = _mm256_unpacklo_epi16(ub, ub), ub_hi = _mm256_unpackhi_epi16(ub, ub);
+
+  const __m256i y_off = _mm256_set1_epi16(c->y_offset);
+  const __m256i y_coeff = _mm256_set1_epi16(c->y_coeff);
+  __m256i y_lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(y8));
+  __m256i y_hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(y8, 1));
+  y_lo = _mm256_mulhrs_epi16(_mm256_slli_epi16(_mm256_sub_epi16(y_lo, y_off), 7), y_coeff);
+  y_hi = _mm256_mulhrs_epi16(_mm256_slli_epi16(_mm256_sub_epi16(y_hi, y_off), 7), y_coeff);
+
+  __m256i r_lo = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y_lo, vr_lo), round), 6);
+  __m256i r_hi = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y_hi, vr_hi), round), 6);
+  __m256i g_lo = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_subs_epi16(y_lo, gs_lo), round), 6);
+  __m256i g_hi = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_subs_epi16(y_hi, gs_hi), round), 6);
+  __m256i b_lo = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y_lo, ub_lo), round), 6);
+  __m256i b_hi = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y_hi, ub_hi), round), 6);
+
+  // Packing interleaves lanes; permute back to pixel order 0-31
+  __m256i r8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(r_lo, r_hi), 0xD8);
+  __m256i g8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(g_lo, g_hi), 0xD8);
+  __m256i b8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(b_lo, b_hi), 0xD8);
+  __m256i a8 = _mm256_set1_epi8((char)0xFF);
+
+  __m256i rg_lo = _mm256_unpacklo_epi8(r8, g8), rg_hi = _mm256_unpackhi_epi8(r8, g8);
+  __m256i ba_lo = _mm256_unpacklo_epi8(b8, a8), ba_hi = _mm256_unpackhi_epi8(b8, a8);
+  __m256i p0 = _mm256_unpacklo_epi16(rg_lo, ba_lo);  // px 0-3   | 16-19
+  __m256i p1 = _mm256_unpackhi_epi16(rg_lo, ba_lo);  // px 4-7   | 20-23
+  __m256i p2 = _mm256_unpacklo_epi16(rg_hi, ba_hi);  // px 8-11  | 24-27
+  __m256i p3 = _mm256_unpackhi_epi16(rg_hi, ba_hi);  // px 12-15 | 28-31
+
+  _mm256_storeu_si256((__m256i *)(dst + 0), _mm256_permute2x128_si256(p0, p1, 0x20));
+  _mm256_storeu_si256((__m256i *)(dst + 32), _mm256_permute2x128_si256(p2, p3, 0x20));
+  _mm256_storeu_si256((__m256i *)(dst + 64), _mm256_permute2x128_si256(p0, p1, 0x31));
+  _mm256_storeu_si256((__m256i *)(dst + 96), _mm256_permute2x128_si256(p2, p3, 0x31));
+}
+
+CONVERT_TARGET_AVX2
+static void yuv420p_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                             uint8_t *dst, int width, const YuvToRgbCoeffs *c) {
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    __m256i y8 = _mm256_loadu_si256((const __m256i *)(y + x));
+    __m256i u16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + x / 2)));
+    __m256i v16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + x / 2)));
+    yuv_to_rgba32_avx2(dst + x * 4, y8, u16, v16, c);
+  }
+  if (x < width) {
+    yuv420p_row_c(y + x, u + x / 2, v + x / 2, dst + x * 4, width - x, c);
+  }
+}
+
+CONVERT_TARGET_AVX2
+static void nv12_row_avx2(const uint8_t *y, const uint8_t *uv,
+                          uint8_t *dst, int width, const YuvToRgbCoeffs *c) {
+  const __m256i low_mask = _mm256_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    __m256i y8 = _mm256_loadu_si256((const __m256i *)(y + x));
+    __m256i uv8 = _mm256_loadu_si256((const __m256i *)(uv + x));
+    __m256i u16 = _mm256_and_si256(uv8, low_mask);
+    __m256i v16 = _mm256_srli_epi16(uv8, 8);
+    yuv_to_rgba32_avx2(dst + x * 4, y8, u16, v16, c);
+  }
+  if (x < width) {
+    nv12_row_c(y + x, uv + x, dst + x * 4, width - x, c);
+  }
+}
+
+// 8 source pixels per row -> 4 destination pixels. Only needs SSE2, but
+// lives with the SSE4.1 set so it shares the dispatch.
+CONVERT_TARGET_SSE41
+static void downsample_row_sse41(const uint8_t *row0, const uint8_t *row1,
+                                 uint8_t *dst, int dst_width) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi16(2);
+  int x = 0;
+
+  for (; x + 4 <= dst_width; x += 4) {
+    __m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+    __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + x * 8 + 16));
+    __m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+    __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + x * 8 + 16));
+
+    // Vertical sums, one 16-bit RGBA pixel per 64-bit half
+    __m128i v0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+    __m128i v1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+    __m128i v2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+    __m128i v3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+    // Horizontal pairs: add the two halves of each register
+    __m128i h01 = _mm_add_epi16(_mm_unpacklo_epi64(v0, v1), _mm_unpackhi_epi64(v0, v1));
+    __m128i h23 = _mm_add_epi16(_mm_unpacklo_epi64(v2, v3), _mm_unpackhi_epi64(v2, v3));
+
+    h01 = _mm_srli_epi16(_mm_add_epi16(h01, round), 2);
+    h23 = _mm_srli_epi16(_mm_add_epi16(h23, round), 2);
+    _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(h01, h23));
+  }
+  if (x < dst_width) {
+    downsample_row_c(row0 + x * 8, row1 + x * 8, dst + x * 4, dst_width - x);
+  }
+}
+
+#endif // CONVERT_HAVE_X86
+
+// --- NEON Kernels ---
+
+#if defined(CONVERT_HAVE_NEON)
+
+// Converts 16 pixels: 16 luma bytes and 8 chroma samples widened to int16.
+static inline void yuv_to_rgba16_neon(uint8_t *dst, uint8x16_t y8, int16x8_t u16, int16x8_t v16,
+                                      const YuvToRgbCoeffs *c) {
+  const int16x8_t bias = vdupq_n_s16(128);
+
+  int16x8_t cu = vsubq_s16(u16, bias);
+  int16x8_t cv = vsubq_s16(v16, bias);
+  int16x8_t cu7 = vshlq_n_s16(cu, 7);
+  int16x8_t cv7 = vshlq_n_s16(cv, 7);
+
+  // vqrdmulh computes (2 * a * b + 2^15) >> 16, the same as _mm_mulhrs_epi16
+  int16x8_t vr = vqrdmulhq_n_s16(cv7, c->v_to_r);
+  int16x8_t gs = vaddq_s16(vqrdmulhq_n_s16(cu7, c->u_to_g), vqrdmulhq_n_s16(cv7, c->v_to_g));
+  int16x8_t ub = vaddq_s16(vqrdmulhq_n_s16(cu7, c->u_to_b), vshlq_n_s16(cu, 6));
+
+  int16x8x2_t vr2 = vzipq_s16(vr, vr);
+  int16x8x2_t gs2 = vzipq_s16(gs, gs);
+  int16x8x2_t ub2 = vzipq_s16(ub, ub);
+
+  const int16x8_t y_off = vdupq_n_s16(c->y_offset);
+  int16x8_t y_lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y8)));
+  int16x8_t y_hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y8)));
+  y_lo = vqrdmulhq_n_s16(vshlq_n_s16(vsubq_s16(y_lo, y_off), 7), c->y_coeff);
+  y_hi = vqrdmulhq_n_s16(vshlq_n_s16(vsubq_s16(y_hi, y_off), 7), c->y_coeff);
+
+  uint8x16x4_t px;
+  px.val[0] = vcombine_u8(vqrshrun_n_s16(vqaddq_s16(y_lo, vr2.val[0]), 6),
+                          vqrshrun_n_s16(vqaddq_s16(y_hi, vr2.val[1]), 6));
+  px.val[1] = vcombine_u8(vqrshrun_n_s16(vqsubq_s16(y_lo, gs2.val[0]), 6),
+                          vqrshrun_n_s16(vqsubq_s16(y_hi, gs2.val[1]), 6));
+  px.val[2] = vcombine_u8(vqrshrun_n_s16(vqaddq_s16(y_lo, ub2.val[0]), 6),
+                          vqrshrun_n_s16(vqaddq_s16(y_hi, ub2.val[1]), 6));
+  px.val[3] = vdupq_n_u8(255);
+  vst4q_u8(dst, px);
+}
+
+static void yuv420p_row_neon(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                             uint8_t *dst, int width, const YuvToRgbCoeffs *c) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x16_t y8 = vld1q_u8(y + x);
+    int16x8_t u16 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + x / 2)));
+    int16x8_t v16 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + x / 2)));
+    yuv_to_rgba16_neon(dst + x * 4, y8, u16, v16, c);
+  }
+  if (x < width) {
+    yuv420p_row_c(y + x, u + x / 2, v + x / 2, dst + x * 4, width - x, c);
+  }
+}
+
+static void nv12_row_neon(const uint8_t *y, const uint8_t *uv,
+                          uint8_t *dst, int width, const YuvToRgbCoeffs *c) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x16_t y8 = vld1q_u8(y + x);
+    uint8x8x2_t uv8 = vld2_u8(uv + x);
+    int16x8_t u16 = vreinterpretq_s16_u16(vmovl_u8(uv8.val[0]));
+    int16x8_t v16 = vreinterpretq_s16_u16(vmovl_u8(uv8.val[1]));
+    yuv_to_rgba16_neon(dst + x * 4, y8, u16, v16, c);
+  }
+  if (x < width) {
+    nv12_row_c(y + x, uv + x, dst + x * 4, width - x, c);
+  }
+}
+
+// 16 source pixels per row -> 8 destination pixels.
+static void downsample_row_neon(const uint8_t *row0, const uint8_t *row1,
+                                uint8_t *dst, int dst_width) {
+  int x = 0;
+  for (; x + 8 <= dst_width; x += 8) {
+    // Split even and odd pixels, then widen and add all four neighbours
+    uint32x4x2_t a0 = vld2q_u32((const uint32_t *)(row0 + x * 8));
+    uint32x4x2_t a1 = vld2q_u32((const uint32_t *)(row0 + x * 8 + 32));
+    uint32x4x2_t b0 = vld2q_u32((const uint32_t *)(row1 + x * 8));
+    uint32x4x2_t b1 = vld2q_u32((const uint32_t *)(row1 + x * 8 + 32));
+
+    uint8x16_t ae0 = vreinterpretq_u8_u32(a0.val[0]), ao0 = vreinterpretq_u8_u32(a0.val[1]);
+    uint8x16_t be0 = vreinterpretq_u8_u32(b0.val[0]), bo0 = vreinterpretq_u8_u32(b0.val[1]);
+    uint8x16_t ae1 = vreinterpretq_u8_u32(a1.val[0]), ao1 = vreinterpretq_u8_u32(a1.val[1]);
+    uint8x16_t be1 = vreinterpretq_u8_u32(b1.val[0]), bo1 = vreinterpretq_u8_u32(b1.val[1]);
+
+    uint16x8_t s0 = vaddq_u16(vaddl_u8(vget_low_u8(ae0), vget_low_u8(ao0)),
+                              vaddl_u8(vget_low_u8(be0), vget_low_u8(bo0)));
+    uint16x8_t s1 = vaddq_u16(vaddl_u8(vget_high_u8(ae0), vget_high_u8(ao0)),
+                              vaddl_u8(vget_high_u8(be0), vget_high_u8(bo0)));
+    uint16x8_t s2 = vaddq_u16(vaddl_u8(vget_low_u8(ae1), vget_low_u8(ao1)),
+                              vaddl_u8(vget_low_u8(be1), vget_low_u8(bo1)));
+    uint16x8_t s3 = vaddq_u16(vaddl_u8(vget_high_u8(ae1), vget_high_u8(ao1)),
+                              vaddl_u8(vget_high_u8(be1), vget_high_u8(bo1)));
+
+    // vrshrn rounds: (sum + 2) >> 2
+    vst1q_u8(dst + x * 4, vcombine_u8(vrshrn_n_u16(s0, 2), vrshrn_n_u16(s1, 2)));
+    vst1q_u8(dst + x * 4 + 16, vcombine_u8(vrshrn_n_u16(s2, 2), vrshrn_n_u16(s3, 2)));
+  }
+  if (x < dst_width) {
+    downsample_row_c(row0 + x * 8, row1 + x * 8, dst + x * 4, dst_width - x);
+  }
+}
+
+#endif // CONVERT_HAVE_NEON
+
+// --- Runtime Dispatch ---
+
+static YuvPlanarRowFunc g_yuv420p_row = yuv420p_row_c;
+static YuvSemiPlanarRowFunc g_nv12_row = nv12_row_c;
+static DownsampleRowFunc g_downsample_row = downsample_row_c;
+static const char *g_kernel_name = "c";
+static pthread_once_t g_convert_once = PTHREAD_ONCE_INIT;
+
+static void convert_select_kernels(void) {
+  int cpu_flags = av_get_cpu_flags();
+  (void)cpu_flags;
+
+#if defined(CONVERT_HAVE_X86)
+  if (cpu_flags & AV_CPU_FLAG_AVX2) {
+    g_yuv420p_row = yuv420p_row_avx2;
+    g_nv12_row = nv12_row_avx2;
+    g_downsample_row = downsample_row_sse41;
+    g_kernel_name = "avx2";
+  } else if (cpu_flags & AV_CPU_FLAG_SSE4) {
+    g_yuv420p_row = yuv420p_row_sse41;
+    g_nv12_row = nv12_row_sse41;
+    g_downsample_row = downsample_row_sse41;
+    g_kernel_name = "sse4.1";
+  }
+#elif defined(CONVERT_HAVE_NEON)
+  if (cpu_flags & AV_CPU_FLAG_NEON) {
+    g_yuv420p_row = yuv420p_row_neon;
+    g_nv12_row = nv12_row_neon;
+    g_downsample_row = downsample_row_neon;
+    g_kernel_name = "neon";
+  }
+#endif
+}
+
+void convert_init(void) {
+  pthread_once(&g_convert_once, convert_select_kernels);
+}
+
+const char *convert_get_kernel_name(void) {
+  convert_init();
+  return g_kernel_name;
+}
+
+// --- Public Helpers ---
+
+void convert_source_from_frame(ConvertSource *src, const AVFrame *frame) {
+  for (int i = 0; i < 4; i++) {
+    src->data[i] = frame->data[i];
+    src->linesize[i] = frame->linesize[i];
+  }
+  src->width = frame->width;
+  src->height = frame->height;
+  src->format = (enum AVPixelFormat)frame->format;
+  src->colorspace = frame->colorspace;
+  src->color_range = frame->color_range;
+  src->color_primaries = frame->color_primaries;
+  src->color_trc = frame->color_trc;
+}
+
+int convert_has_plain_luma(enum AVPixelFormat format) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+  return desc && !(desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL |
+                                  AV_PIX_FMT_FLAG_HWACCEL)) &&
+         desc->nb_components >= 1 && desc->comp[0].plane == 0 &&
+         desc->comp[0].step == 1 && desc->comp[0].depth == 8;
+}
+
+int convert_supports_fast_path(enum AVPixelFormat format) {
+  return format == AV_PIX_FMT_YUV420P ||
+         format == AV_PIX_FMT_YUVJ420P ||
+         format == AV_PIX_FMT_NV12;
+}
+
+int convert_is_full_range(const ConvertSource *src) {
+  return src->color_range == AVCOL_RANGE_JPEG || src->format == AV_PIX_FMT_YUVJ420P;
+}
+
+void convert_get_coeffs(enum AVColorSpace colorspace, int full_range,
+                        YuvToRgbCoeffs *coeffs) {
+  // Unspecified and unknown matrices fall back to BT.601, like swscale does
+  double kr = 0.299;
+  double kb = 0.114;
+  switch (colorspace) {
+    case AVCOL_SPC_BT709:
+      kr = 0.2126;
+      kb = 0.0722;
+      break;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+      kr = 0.2627;
+      kb = 0.0593;
+      break;
+    case AVCOL_SPC_SMPTE240M:
+      kr = 0.212;
+      kb = 0.087;
+      break;
+    case AVCOL_SPC_FCC:
+      kr = 0.30;
+      kb = 0.11;
+      break;
+    default:
+      break;
+  }
+
+  double kg = 1.0 - kr - kb;
+  double y_scale = full_range ? 1.0 : 255.0 / 219.0;
+  double c_scale = full_range ? 1.0 : 255.0 / 224.0;
+
+  coeffs->y_offset = full_range ? 0 : 16;
+  coeffs->y_coeff = (int16_t)lrint(y_scale * 16384.0);
+  coeffs->v_to_r = (int16_t)lrint(2.0 * (1.0 - kr) * c_scale * 16384.0);
+  coeffs->u_to_g = (int16_t)lrint(2.0 * kb * (1.0 - kb) / kg * c_scale * 16384.0);
+  coeffs->v_to_g = (int16_t)lrint(2.0 * kr * (1.0 - kr) / kg * c_scale * 16384.0);
+  coeffs->u_to_b = (int16_t)lrint((2.0 * (1.0 - kb) * c_scale - 1.0) * 16384.0);
+}
+
+// --- Output Transform ---
+
+// Source rows buffered before a rotated flush. 16 rows keep the scatter
+// writing 64 contiguous bytes per destination row on 90/270 rotations.
+#define CONVERT_TILE_ROWS 16
+
+struct ConvertContext {
+  uint8_t *scratch;
+  size_t scratch_size;
+};
+
+ConvertContext *convert_alloc(void) {
+  return (ConvertContext *)calloc(1, sizeof(ConvertContext));
+}
+
+void convert_free(ConvertContext **ctx) {
+  if (!ctx || !*ctx) return;
+  free((*ctx)->scratch);
+  free(*ctx);
+  *ctx = NULL;
+}
+
+static uint8_t *convert_get_scratch(ConvertContext *ctx, size_t size) {
+  if (size > ctx->scratch_size) {
+    uint8_t *scratch = (uint8_t *)realloc(ctx->scratch, size);
+    if (!scratch) return NULL;
+    ctx->scratch = scratch;
+    ctx->scratch_size = size;
+  }
+  return ctx->scratch;
+}
+
+int convert_normalize_rotation(int degrees) {
+  int r = ((degrees % 360) + 360) % 360;
+  // Snap to the nearest quarter turn
+  return ((r + 45) / 90 % 4) * 90;
+}
+
+void convert_get_output_size(const ConvertTransform *transform, int width, int height,
+                             int *out_width, int *out_height) {
+  int rotation = transform ? convert_normalize_rotation(transform->rotation) : 0;
+  if (rotation == 90 || rotation == 270) {
+    *out_width = height;
+    *out_height = width;
+  } else {
+    *out_width = width;
+    *out_height = height;
+  }
+}
+
+// Fill the sink's affine mapping from source to destination coordinates
+static void convert_get_mapping(const ConvertTransform *transform, int w, int h,
+                                ConvertRowSink *map) {
+  int rotation = transform ? convert_normalize_rotation(transform->rotation) : 0;
+
+  switch (rotation) {
+    case 90:
+      map->ax = 0; map->bx = -1; map->cx = h - 1;
+      map->ay = 1; map->by = 0; map->cy = 0;
+      break;
+    case 180:
+      map->ax = -1; map->bx = 0; map->cx = w - 1;
+      map->ay = 0; map->by = -1; map->cy = h - 1;
+      break;
+    case 270:
+      map->ax = 0; map->bx = 1; map->cx = 0;
+      map->ay = -1; map->by = 0; map->cy = w - 1;
+      break;
+    default:
+      map->ax = 1; map->bx = 0; map->cx = 0;
+      map->ay = 0; map->by = 1; map->cy = 0;
+      break;
+  }
+
+  int out_w, out_h;
+  convert_get_output_size(transform, w, h, &out_w, &out_h);
+  if (transform && transform->flip_horizontal) {
+    map->ax = -map->ax;
+    map->bx = -map->bx;
+    map->cx = out_w - 1 - map->cx;
+  }
+  if (transform && transform->flip_vertical) {
+    map->ay = -map->ay;
+    map->by = -map->by;
+    map->cy = out_h - 1 - map->cy;
+  }
+}
+
+void convert_map_rect_to_source(const ConvertTransform *transform, int src_width, int src_height,
+                                int *x, int *y, int *width, int *height) {
+  ConvertRowSink map;
+  convert_get_mapping(transform, src_width, src_height, &map);
+
+  // The mapping only swaps and mirrors axes, so inverting two opposite
+  // corners is enough
+  int dx[2] = { *x, *x + *width - 1 };
+  int dy[2] = { *y, *y + *height - 1 };
+  int sx[2], sy[2];
+  for (int i = 0; i < 2; i++) {
+    if (map.ay == 0) {
+      sx[i] = (dx[i] - map.cx) * map.ax;
+      sy[i] = (dy[i] - map.cy) * map.by;
+    } else {
+      sx[i] = (dy[i] - map.cy) * map.ay;
+      sy[i] = (dx[i] - map.cx) * map.bx;
+    }
+  }
+
+  *x = sx[0] < sx[1] ? sx[0] : sx[1];
+  *y = sy[0] < sy[1] ? sy[0] : sy[1];
+  *width = abs(sx[1] - sx[0]) + 1;
+  *height = abs(sy[1] - sy[0]) + 1;
+}
+
+int convert_sink_init(ConvertRowSink *sink, ConvertContext *ctx,
+                      const ConvertTransform *transform, int src_width, int src_height,
+                      uint8_t *dst, int dst_linesize) {
+  memset(sink, 0, sizeof(*sink));
+  sink->dst = dst;
+  sink->dst_linesize = dst_linesize;
+  sink->src_width = src_width;
+  sink->src_height = src_height;
+  convert_get_mapping(transform, src_width, src_height, sink);
+
+  sink->identity = sink->ax == 1 && sink->by == 1 && sink->cx == 0 && sink->cy == 0;
+  if (sink->identity) return 0;
+
+  if (!ctx) return -1;
+  sink->tile_linesize = src_width * 4;
+  sink->tile = convert_get_scratch(ctx, (size_t)sink->tile_linesize * CONVERT_TILE_ROWS);
+  return sink->tile ? 0 : -1;
+}
+
+void convert_sink_store_rows(ConvertRowSink *sink, const uint8_t *rows, int linesize,
+                             int y, int count) {
+  int w = sink->src_width;
+
+  if (sink->ay == 0) {
+    // Rows stay rows, possibly reordered and mirrored
+    for (int r = 0; r < count; r++) {
+      const uint8_t *in = rows + (ptrdiff_t)r * linesize;
+      uint8_t *out = sink->dst + (ptrdiff_t)(sink->by * (y + r) + sink->cy) * sink->dst_linesize;
+      if (sink->ax == 1) {
+        memcpy(out, in, (size_t)w * 4);
+      } else {
+        const uint32_t *in32 = (const uint32_t *)in;
+        uint32_t *out32 = (uint32_t *)out;
+        for (int x = 0; x < w; x++) {
+          out32[w - 1 - x] = in32[x];
+        }
+      }
+    }
+  } else {
+    // Transposed: source column x becomes a destination row, and the
+    // buffered source rows land next to each other in it
+    int col = sink->bx * y + sink->cx;
+    for (int x = 0; x < w; x++) {
+      uint32_t *out32 = (uint32_t *)(sink->dst +
+          (ptrdiff_t)(sink->ay * x + sink->cy) * sink->dst_linesize);
+      const uint8_t *in = rows + (ptrdiff_t)x * 4;
+      for (int r = 0; r < count; r++) {
+        out32[col + sink->bx * r] = *(const uint32_t *)(in + (ptrdiff_t)r * linesize);
+      }
+    }
+  }
+}
+
+void convert_transform_gray(const uint8_t *src, int src_linesize, int src_width, int src_height,
+                            const ConvertTransform *transform, uint8_t *dst, int dst_linesize) {
+  ConvertRowSink map;
+  convert_get_mapping(transform, src_width, src_height, &map);
+
+  for (int y = 0; y < src_height; y++) {
+    const uint8_t *in = src + (ptrdiff_t)y * src_linesize;
+    if (map.ay == 0) {
+      uint8_t *out = dst + (ptrdiff_t)(map.by * y + map.cy) * dst_linesize;
+      if (map.ax == 1) {
+        memcpy(out, in, src_width);
+      } else {
+        for (int x = 0; x < src_width; x++) {
+          out[src_width - 1 - x] = in[x];
+        }
+      }
+    } else {
+      // Source row y becomes destination column bx * y + cx
+      uint8_t *out = dst + (map.bx * y + map.cx);
+      for (int x = 0; x < src_width; x++) {
+        out[(ptrdiff_t)(map.ay * x + map.cy) * dst_linesize] = in[x];
+      }
+    }
+  }
+}
+
+void convert_sink_finish(ConvertRowSink *sink) {
+  if (sink->identity || sink->tile_count == 0) return;
+  convert_sink_store_rows(sink, sink->tile, sink->tile_linesize, sink->tile_y,
+                          sink->tile_count);
+  sink->tile_count = 0;
+}
+
+uint8_t *convert_sink_row(ConvertRowSink *sink, int y) {
+  if (sink->identity) {
+    return sink->dst + (ptrdiff_t)y * sink->dst_linesize;
+  }
+  if (sink->tile_count == CONVERT_TILE_ROWS) {
+    convert_sink_finish(sink);
+  }
+  if (sink->tile_count == 0) {
+    sink->tile_y = y;
+  }
+  return sink->tile + (ptrdiff_t)(sink->tile_count++) * sink->tile_linesize;
+}
+
+// --- Frame Conversion ---
+
+int convert_frame_to_rgba(const ConvertSource *src, ConvertRowSink *sink) {
+  if (!src || !sink || !convert_supports_fast_path(src->format)) return -1;
+
+  convert_init();
+
+  YuvToRgbCoeffs coeffs;
+  convert_get_coeffs(src->colorspace, convert_is_full_range(src), &coeffs);
+
+  if (src->format == AV_PIX_FMT_NV12) {
+    for (int y = 0; y < src->height; y++) {
+      g_nv12_row(src->data[0] + (ptrdiff_t)y * src->linesize[0],
+                 src->data[1] + (ptrdiff_t)(y >> 1) * src->linesize[1],
+                 convert_sink_row(sink, y), src->width, &coeffs);
+    }
+  } else {
+    for (int y = 0; y < src->height; y++) {
+      g_yuv420p_row(src->data[0] + (ptrdiff_t)y * src->linesize[0],
+                    src->data[1] + (ptrdiff_t)(y >> 1) * src->linesize[1],
+                    src->data[2] + (ptrdiff_t)(y >> 1) * src->linesize[2],
+                    convert_sink_row(sink, y), src->width, &coeffs);
+    }
+  }
+
+  return 0;
+}
+
+void convert_downsample_rgba(const uint8_t *src, int src_linesize, int src_width, int src_height,
+                             uint8_t *dst, int dst_linesize) {
+  convert_init();
+
+  int dst_width = src_width / 2;
+  int dst_height = src_height / 2;
+  for (int y = 0; y < dst_height; y++) {
+    const uint8_t *row0 = src + (ptrdiff_t)(y * 2) * src_linesize;
+    g_downsample_row(row0, row0 + src_linesize, dst + (ptrdiff_t)y * dst_linesize, dst_width);
+  }
+}
@@ -0,0 +1,147 @@
+#ifndef FFMPEG_CONVERT_H
+#define FFMPEG_CONVERT_H
+
+#include <stdint.h>
+
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Pixel Conversion ---
+//
+// Dedicated no-scale conversion kernels for the pixel formats that make up
+// nearly all of our media. Anything not handled here goes through sws_scale.
+
+// Plane pointers and color properties of a frame to convert.
+typedef struct {
+  const uint8_t *data[4];
+  int linesize[4];
+  int width;
+  int height;
+  enum AVPixelFormat format;
+  enum AVColorSpace colorspace;
+  enum AVColorRange color_range;
+  enum AVColorPrimaries color_primaries;
+  enum AVColorTransferCharacteristic color_trc;
+} ConvertSource;
+
+// Fixed-point YUV -> RGB coefficients. Inputs are pre-shifted left by 7 and
+// multiplied with a rounding high multiply, so every coefficient is Q14 and
+// results land in Q6 before the final rounding shift.
+typedef struct {
+  int16_t y_offset;
+  int16_t y_coeff;
+  int16_t v_to_r;
+  int16_t u_to_g;
+  int16_t v_to_g;
+  int16_t u_to_b;  // Minus 1.0, the unit part is added as (u << 6)
+} YuvToRgbCoeffs;
+
+// Output orientation, applied while the converted rows are written out.
+// The rotation is applied first, then the flips.
+typedef struct {
+  int rotation;         // Clockwise degrees: 0, 90, 180 or 270
+  int flip_horizontal;
+  int flip_vertical;
+} ConvertTransform;
+
+// Reusable scratch memory for the conversion stage.
+typedef struct ConvertContext ConvertContext;
+
+// Destination for converted rows. Producers ask for one row at a time, in
+// source order; identity transforms hand out the destination row itself,
+// anything else collects a small tile of rows and scatters it rotated or
+// flipped into the destination, so the output is still written once.
+typedef struct {
+  uint8_t *dst;
+  int dst_linesize;
+  int src_width;
+  int src_height;
+
+  // dst_x = ax * x + bx * y + cx, dst_y = ay * x + by * y + cy
+  int ax, bx, cx;
+  int ay, by, cy;
+  int identity;
+
+  uint8_t *tile;
+  int tile_linesize;
+  int tile_y;      // Source row of the first buffered row
+  int tile_count;  // Buffered rows
+} ConvertRowSink;
+
+ConvertContext *convert_alloc(void);
+void convert_free(ConvertContext **ctx);
+
+// Normalize a rotation in degrees to 0, 90, 180 or 270.
+int convert_normalize_rotation(int degrees);
+
+// Output size of a width x height source after the transform.
+void convert_get_output_size(const ConvertTransform *transform, int width, int height,
+                             int *out_width, int *out_height);
+
+// Map a rectangle given in output coordinates back to the source image.
+void convert_map_rect_to_source(const ConvertTransform *transform, int src_width, int src_height,
+                                int *x, int *y, int *width, int *height);
+
+// Prepare a sink writing a src_width x src_height image into dst. dst must
+// be sized for the transformed output (see convert_get_output_size).
+// Returns 0 on success, -1 on allocation failure.
+int convert_sink_init(ConvertRowSink *sink, ConvertContext *ctx,
+                      const ConvertTransform *transform, int src_width, int src_height,
+                      uint8_t *dst, int dst_linesize);
+
+// Buffer to write source row y into. Rows must be requested in order.
+uint8_t *convert_sink_row(ConvertRowSink *sink, int y);
+
+// Write count already converted rows, starting at source row y, without
+// going through the tile.
+void convert_sink_store_rows(ConvertRowSink *sink, const uint8_t *rows, int linesize,
+                             int y, int count);
+
+// Flush the rows still buffered in the tile.
+void convert_sink_finish(ConvertRowSink *sink);
+
+// Select the conversion kernels for the running CPU. Safe to call repeatedly.
+void convert_init(void);
+
+// Fill a ConvertSource from a decoded frame.
+void convert_source_from_frame(ConvertSource *src, const AVFrame *frame);
+
+// Whether plane 0 holds 8-bit luma that can be read as a GRAY8 image.
+int convert_has_plain_luma(enum AVPixelFormat format);
+
+// Whether the fast path can convert this pixel format.
+int convert_supports_fast_path(enum AVPixelFormat format);
+
+// Compute the coefficients for a colorspace and range.
+void convert_get_coeffs(enum AVColorSpace colorspace, int full_range,
+                        YuvToRgbCoeffs *coeffs);
+
+// Whether the source is full range (JPEG) rather than limited (MPEG) range.
+int convert_is_full_range(const ConvertSource *src);
+
+// Convert to RGBA without scaling, writing every row through the sink.
+// Returns 0 on success, -1 if the format is not supported by the fast path.
+int convert_frame_to_rgba(const ConvertSource *src, ConvertRowSink *sink);
+
+// Halve an RGBA image with a 2x2 box filter. Odd trailing rows and columns
+// are dropped; dst is (src_width / 2) x (src_height / 2).
+void convert_downsample_rgba(const uint8_t *src, int src_linesize, int src_width, int src_height,
+                             uint8_t *dst, int dst_linesize);
+
+// Copy a one byte per pixel image into dst with the transform applied.
+// dst must be sized for the transformed output.
+void convert_transform_gray(const uint8_t *src, int src_linesize, int src_width, int src_height,
+                            const ConvertTransform *transform, uint8_t *dst, int dst_linesize);
+
+// Name of the kernel set selected by convert_init ("c", "sse4.1", "avx2", "neon").
+const char *convert_get_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_CONVERT_H
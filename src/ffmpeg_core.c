@@ -1,8 +1,23 @@
 #include "ffmpeg_core.h"
+#include "ffmpeg_analysis.h"
+#include "ffmpeg_cache.h"
+#include "ffmpeg_convert.h"
+#include "ffmpeg_export.h"
+#include "ffmpeg_image.h"
+#include "ffmpeg_intra.h"
+#include "ffmpeg_proxy.h"
+#include "ffmpeg_reader.h"
+#include "ffmpeg_sequence.h"
+#include "ffmpeg_shm.h"
+#include "ffmpeg_sprite.h"
+#include "ffmpeg_tensor.h"
+#include "ffmpeg_tonemap.h"
 
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libavutil/display.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
 #include <stdlib.h>
@@ -10,6 +25,15 @@
 #include <pthread.h>
 #include <unistd.h>
 
+// Requests this far ahead of the decoder are decoded to instead of seeked to
+#define SEQUENTIAL_DECODE_WINDOW_MS 1000
+
+// Images of a sequence read ahead of the one requested
+#define SEQUENCE_READ_AHEAD 8
+
+// Queued single frame requests decoded ahead together on a pool
+#define DECODE_AHEAD_MAX 16
+
 // --- Async Task Queue ---
 
 typedef enum {
@@ -17,7 +41,18 @@ typedef enum {
   TASK_VIDEO_AT_INDEX,
   TASK_AUDIO_AT_TIMESTAMP,
   TASK_AUDIO_AT_INDEX,
-  TASK_VIDEO_RANGE
+  TASK_VIDEO_RANGE,
+  TASK_SPRITE_SHEET,
+  TASK_ENCODED_AT_TIMESTAMP,
+  TASK_ENCODED_AT_INDEX,
+  TASK_SCENE_DETECT,
+  TASK_PACKET_STATS,
+  TASK_BLACK_FREEZE,
+  TASK_MOTION_VECTORS,
+  TASK_HANDLE_AT_TIMESTAMP,
+  TASK_HANDLE_AT_INDEX,
+  TASK_PRESENT_AT_TIMESTAMP,
+  TASK_SHM_STREAM
 } TaskType;
 
 typedef struct AsyncTask {
@@ -34,12 +69,38 @@ typedef struct AsyncTask {
       int start_index;
       int end_index;
     } range;
+    SpriteSheetOptions sprite;
+    SceneDetectOptions scene;
+    PacketStatsOptions packet_stats;
+    BlackFreezeOptions black_freeze;
+    MotionVectorOptions motion;
+    struct {
+      int64_t timestamp_ms;
+      int frame_index;
+      int image_format;
+      int quality;
+    } encode;
+    struct {
+      int64_t start_ms;
+      int64_t end_ms;
+    } shm;
   } params;
   
+  // Output options at the time the request was made
+  VideoOutputOptions output_options;
+  
   // Callbacks
   OnVideoFrameCallback video_callback;
   OnAudioFrameCallback audio_callback;
   OnFrameRangeProgressCallback progress_callback;
+  OnSpriteSheetCallback sprite_callback;
+  OnEncodedFrameCallback encoded_callback;
+  OnSceneCutsCallback scene_callback;
+  OnPacketStatsCallback packet_stats_callback;
+  OnBlackFreezeCallback black_freeze_callback;
+  OnMotionVectorsCallback motion_callback;
+  OnFrameHandleCallback handle_callback;
+  OnShmStreamCallback shm_callback;
   void *user_data;
   
   // Control
@@ -58,29 +119,431 @@ typedef struct {
   RequestId next_request_id;
 } TaskQueue;
 
+typedef enum {
+  FILE_JOB_PROXY,
+  FILE_JOB_EXPORT,
+  FILE_JOB_TASK
+} FileJobType;
+
+// Jobs that write a file (proxies, exports) or read the whole media
+// (sprite sheets, analysis passes, shared memory streams) run for minutes,
+// so each gets a thread of its own instead of holding up the queue. They
+// take their ids from the queue's sequence. A FILE_JOB_TASK runs task and
+// reports through its callbacks.
+typedef struct FileJob {
+  RequestId id;
+  FileJobType type;
+  AsyncTask *task;
+  char *url;
+  char *output_path;
+  ProxyOptions proxy_options;
+  ExportOptions export_options;
+  int64_t start_ms;
+  int64_t end_ms;
+  void (*callback)(void *user_data, int error_code);
+  OnFrameRangeProgressCallback progress_callback;
+  void *user_data;
+  bool cancelled;
+  struct FileJob *next;
+} FileJob;
+
 // --- Global State ---
 
 static FFmpegState g_state = {0};
 static TaskQueue g_task_queue = {0};
 
+// Kept apart from g_state.mutex so setting options never waits on a decode
+static VideoOutputOptions g_output_options = {0};
+static pthread_mutex_t g_output_options_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Displayed frame, with its own lock so texture reads never wait on a decode
+static VideoFrame *g_display_frame = NULL;
+static OnDisplayFrameCallback g_display_listener = NULL;
+static void *g_display_listener_data = NULL;
+static pthread_mutex_t g_display_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Shared memory sink. g_shm_mutex guards the pointer; a stream holds
+// g_shm_write_mutex while it writes, so a replaced ring is only unmapped
+// once the stream has let go of it.
+static ShmRing *g_shm_ring = NULL;
+static pthread_mutex_t g_shm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_shm_write_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Running file jobs; g_file_job_cond is signalled as each one leaves the list
+static FileJob *g_file_jobs = NULL;
+static pthread_mutex_t g_file_job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_file_job_cond = PTHREAD_COND_INITIALIZER;
+
 // --- Helper Functions ---
 
-static VideoFrame* create_video_frame_copy(void) {
+// Keep the swscale fallback on the same matrix/range as the fast path
+static void update_sws_colorspace(void) {
+  enum AVColorSpace colorspace = g_state.video_frame->colorspace;
+  int full_range = g_state.video_frame->color_range == AVCOL_RANGE_JPEG;
+  
+  if (colorspace == g_state.sws_colorspace && full_range == g_state.sws_full_range) {
+    return;
+  }
+  
+  int sws_cs = SWS_CS_DEFAULT;
+  if (colorspace == AVCOL_SPC_BT709) {
+    sws_cs = SWS_CS_ITU709;
+  } else if (colorspace == AVCOL_SPC_BT2020_NCL || colorspace == AVCOL_SPC_BT2020_CL) {
+    sws_cs = SWS_CS_BT2020;
+  }
+  
+  sws_setColorspaceDetails(g_state.sws_ctx, sws_getCoefficients(sws_cs), full_range,
+                           sws_getCoefficients(SWS_CS_DEFAULT), 1, 0, 1 << 16, 1 << 16);
+  g_state.sws_colorspace = colorspace;
+  g_state.sws_full_range = full_range;
+}
+
+static void get_output_options(VideoOutputOptions *options) {
+  pthread_mutex_lock(&g_output_options_mutex);
+  *options = g_output_options;
+  pthread_mutex_unlock(&g_output_options_mutex);
+}
+
+// Read the rotation and mirroring from the stream's display matrix
+static void read_display_matrix(const AVStream *stream) {
+  reader_get_display_orientation(stream, &g_state.display_rotation, &g_state.display_flip);
+}
+
+// Combine the stream orientation with the requested options
+static void resolve_output_transform(const VideoOutputOptions *options,
+                                     ConvertTransform *transform) {
+  transform->rotation = 0;
+  transform->flip_horizontal = 0;
+  transform->flip_vertical = 0;
+  
+  if (options->rotation >= VIDEO_ROTATION_0 && options->rotation <= VIDEO_ROTATION_270) {
+    transform->rotation = (options->rotation - VIDEO_ROTATION_0) * 90;
+  } else if (g_state.display_flip) {
+    // Mirroring then rotating equals rotating the other way then mirroring
+    transform->rotation = (360 - g_state.display_rotation) % 360;
+    transform->flip_horizontal = 1;
+  } else {
+    transform->rotation = g_state.display_rotation;
+  }
+  
+  if (options->flip_horizontal) transform->flip_horizontal ^= 1;
+  if (options->flip_vertical) transform->flip_vertical ^= 1;
+}
+
+// (Re)create the swscale context when the input or output geometry changes
+static int ensure_sws_context(int src_width, int src_height, enum AVPixelFormat src_format,
+                              int dst_width, int dst_height) {
+  if (g_state.sws_ctx &&
+      g_state.sws_src_width == src_width && g_state.sws_src_height == src_height &&
+      g_state.sws_src_format == src_format &&
+      g_state.sws_dst_width == dst_width && g_state.sws_dst_height == dst_height) {
+    return 0;
+  }
+  
+  SwsContext *ctx = sws_getContext(src_width, src_height, src_format,
+                                   dst_width, dst_height, AV_PIX_FMT_RGBA,
+                                   SWS_BILINEAR, NULL, NULL, NULL);
+  if (!ctx) return -1;
+  
+  if (g_state.sws_ctx) sws_freeContext(g_state.sws_ctx);
+  g_state.sws_ctx = ctx;
+  g_state.sws_src_width = src_width;
+  g_state.sws_src_height = src_height;
+  g_state.sws_src_format = src_format;
+  g_state.sws_dst_width = dst_width;
+  g_state.sws_dst_height = dst_height;
+  g_state.sws_colorspace = AVCOL_SPC_UNSPECIFIED;
+  g_state.sws_full_range = 0;
+  return 0;
+}
+
+// Point video_frame_rgba at a buffer large enough for width x height
+static int prepare_rgba_buffer(int width, int height) {
+  int size = av_image_get_buffer_size(AV_PIX_FMT_RGBA, width, height, 1);
+  if (size < 0) return -1;
+  
+  if (size > g_state.video_buffer_size) {
+    uint8_t *buffer = (uint8_t *)av_malloc(size);
+    if (!buffer) return -1;
+    av_free(g_state.video_buffer);
+    g_state.video_buffer = buffer;
+    g_state.video_buffer_size = size;
+  }
+  
+  av_image_fill_arrays(
+      g_state.video_frame_rgba->data, g_state.video_frame_rgba->linesize,
+      g_state.video_buffer, AV_PIX_FMT_RGBA, width, height, 1);
+  return 0;
+}
+
+// Crop the decoded frame in place by offsetting its plane pointers. The
+// rectangle is in output coordinates; the source offset is snapped to the
+// chroma grid so subsampled planes stay in step with luma.
+static int apply_crop(AVFrame *frame, const VideoOutputOptions *options,
+                      const ConvertTransform *transform) {
+  if (options->crop_width <= 0 || options->crop_height <= 0) return 0;
+  
+  int full_width, full_height;
+  convert_get_output_size(transform, frame->width, frame->height, &full_width, &full_height);
+  
+  int x0 = FFMAX(options->crop_x, 0);
+  int y0 = FFMAX(options->crop_y, 0);
+  int x1 = (int)FFMIN((int64_t)options->crop_x + options->crop_width, full_width);
+  int y1 = (int)FFMIN((int64_t)options->crop_y + options->crop_height, full_height);
+  if (x1 <= x0 || y1 <= y0) return -1;
+  
+  int x = x0, y = y0, width = x1 - x0, height = y1 - y0;
+  convert_map_rect_to_source(transform, frame->width, frame->height, &x, &y, &width, &height);
+  
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((enum AVPixelFormat)frame->format);
+  if (desc) {
+    x &= ~((1 << desc->log2_chroma_w) - 1);
+    y &= ~((1 << desc->log2_chroma_h) - 1);
+  }
+  
+  frame->crop_left = x;
+  frame->crop_top = y;
+  frame->crop_right = frame->width - x - width;
+  frame->crop_bottom = frame->height - y - height;
+  return av_frame_apply_cropping(frame, AV_FRAME_CROP_UNALIGNED);
+}
+
+// Size to scale the (cropped) source to, before rotation
+static void get_scaled_size(const VideoOutputOptions *options, const ConvertTransform *transform,
+                            int width, int height, int *scaled_width, int *scaled_height) {
+  int requested_width = options->output_width;
+  int requested_height = options->output_height;
+  if (transform->rotation == 90 || transform->rotation == 270) {
+    requested_width = options->output_height;
+    requested_height = options->output_width;
+  }
+  
+  if (requested_width <= 0 && requested_height <= 0) {
+    *scaled_width = width;
+    *scaled_height = height;
+  } else if (requested_height <= 0) {
+    *scaled_width = requested_width;
+    *scaled_height = (int)FFMAX(1, ((int64_t)requested_width * height + width / 2) / width);
+  } else if (requested_width <= 0) {
+    *scaled_width = (int)FFMAX(1, ((int64_t)requested_height * width + height / 2) / height);
+    *scaled_height = requested_height;
+  } else {
+    *scaled_width = requested_width;
+    *scaled_height = requested_height;
+  }
+}
+
+// Run sws_ctx into the sink, going through a temporary image when the
+// output is rotated or flipped
+static int scale_into_sink(uint8_t *const data[], const int linesize[], int src_height,
+                           ConvertRowSink *sink) {
+  if (sink->identity) {
+    uint8_t *dst_data[4] = { sink->dst, NULL, NULL, NULL };
+    int dst_linesize[4] = { sink->dst_linesize, 0, 0, 0 };
+    return sws_scale(g_state.sws_ctx, (const uint8_t *const *)data, linesize, 0, src_height,
+                     dst_data, dst_linesize) < 0 ? -1 : 0;
+  }
+  
+  int tmp_linesize = sink->src_width * 4;
+  uint8_t *tmp = (uint8_t *)av_malloc((size_t)tmp_linesize * sink->src_height);
+  if (!tmp) return -1;
+  
+  uint8_t *dst_data[4] = { tmp, NULL, NULL, NULL };
+  int dst_linesize[4] = { tmp_linesize, 0, 0, 0 };
+  int ret = sws_scale(g_state.sws_ctx, (const uint8_t *const *)data, linesize, 0, src_height,
+                      dst_data, dst_linesize);
+  if (ret >= 0) {
+    convert_sink_store_rows(sink, tmp, tmp_linesize, 0, sink->src_height);
+  }
+  av_free(tmp);
+  return ret < 0 ? -1 : 0;
+}
+
+// Geometry of one converted video frame
+typedef struct {
+  ConvertTransform transform;
+  int src_width;      // Source size after crop
+  int src_height;
+  int scaled_width;   // Size before rotation
+  int scaled_height;
+  int out_width;      // Size after rotation
+  int out_height;
+} VideoOutputPlan;
+
+// Work out the output geometry of g_state.video_frame. Crops the frame.
+static int plan_video_output(const VideoOutputOptions *options, VideoOutputPlan *plan) {
+  AVFrame *frame = g_state.video_frame;
+  
+  resolve_output_transform(options, &plan->transform);
+  
+  // Crop first, so only the region of interest is converted
+  if (apply_crop(frame, options, &plan->transform) < 0) return -1;
+  
+  plan->src_width = frame->width;
+  plan->src_height = frame->height;
+  get_scaled_size(options, &plan->transform, plan->src_width, plan->src_height,
+                  &plan->scaled_width, &plan->scaled_height);
+  convert_get_output_size(&plan->transform, plan->scaled_width, plan->scaled_height,
+                          &plan->out_width, &plan->out_height);
+  return 0;
+}
+
+// Change the final (rotated) output size of a plan
+static void plan_set_output_size(VideoOutputPlan *plan, int width, int height) {
+  if (plan->transform.rotation == 90 || plan->transform.rotation == 270) {
+    plan->scaled_width = height;
+    plan->scaled_height = width;
+  } else {
+    plan->scaled_width = width;
+    plan->scaled_height = height;
+  }
+  plan->out_width = width;
+  plan->out_height = height;
+}
+
+// Convert g_state.video_frame to RGBA as described by the plan
+static int render_video_output(const VideoOutputPlan *plan, uint8_t *dst, int dst_linesize) {
+  AVFrame *frame = g_state.video_frame;
+  enum AVPixelFormat src_format = (enum AVPixelFormat)frame->format;
+  int src_width = plan->src_width;
+  int src_height = plan->src_height;
+  int scaling = plan->scaled_width != src_width || plan->scaled_height != src_height;
+  
+  // Rotation and flips are applied while the rows are written out
+  ConvertRowSink sink;
+  if (convert_sink_init(&sink, g_state.convert, &plan->transform,
+                        plan->scaled_width, plan->scaled_height, dst, dst_linesize) < 0) {
+    return -1;
+  }
+  
+  int result;
+  if (!scaling && convert_supports_fast_path(src_format)) {
+    // No scaling needed: convert 8-bit 4:2:0 straight into the output buffer
+    ConvertSource src;
+    convert_source_from_frame(&src, frame);
+    result = convert_frame_to_rgba(&src, &sink);
+  } else if (g_state.tone_mapping_enabled && g_state.tone_map &&
+             tonemap_supports_format(src_format)) {
+    // 10-bit sources: LUT based tone mapping (identity LUTs for SDR)
+    ConvertSource src;
+    convert_source_from_frame(&src, frame);
+    double peak = tonemap_get_source_peak(frame);
+    
+    if (!scaling) {
+      result = tonemap_frame_to_rgba(g_state.tone_map, &src, peak, &sink);
+    } else {
+      // Tone map at source size, then let swscale resize the RGBA image
+      ConvertRowSink rgba_sink;
+      result = prepare_rgba_buffer(src_width, src_height);
+      if (result >= 0) {
+        convert_sink_init(&rgba_sink, NULL, NULL, src_width, src_height,
+                          g_state.video_frame_rgba->data[0],
+                          g_state.video_frame_rgba->linesize[0]);
+        result = tonemap_frame_to_rgba(g_state.tone_map, &src, peak, &rgba_sink);
+      }
+      if (result >= 0) {
+        result = ensure_sws_context(src_width, src_height, AV_PIX_FMT_RGBA,
+                                    plan->scaled_width, plan->scaled_height);
+      }
+      if (result >= 0) {
+        result = scale_into_sink(g_state.video_frame_rgba->data,
+                                 g_state.video_frame_rgba->linesize, src_height, &sink);
+      }
+    }
+  } else {
+    // Everything else (and any scaling) goes through swscale
+    result = ensure_sws_context(src_width, src_height, src_format,
+                                plan->scaled_width, plan->scaled_height);
+    if (result >= 0) {
+      update_sws_colorspace();
+      result = scale_into_sink(frame->data, frame->linesize, src_height, &sink);
+    }
+  }
+  convert_sink_finish(&sink);
+  
+  return result < 0 ? -1 : 0;
+}
+
+// Point vf at the luma of g_state.video_frame as described by the plan.
+// The decoder's Y plane is referenced in place when it can be handed out
+// as is; anything else is scaled to GRAY8 and then rotated.
+static int render_gray_output(const VideoOutputPlan *plan, VideoFrame *vf) {
+  AVFrame *frame = g_state.video_frame;
+  int plain_luma = convert_has_plain_luma((enum AVPixelFormat)frame->format);
+  int scaling = plan->scaled_width != plan->src_width || plan->scaled_height != plan->src_height;
+  int identity = plan->transform.rotation == 0 && !plan->transform.flip_horizontal &&
+                 !plan->transform.flip_vertical;
+  
+  if (plain_luma && !scaling && identity && frame->buf[0]) {
+    vf->source_frame = av_frame_clone(frame);
+    if (!vf->source_frame) return -1;
+    vf->data = vf->source_frame->data[0];
+    vf->linesize = vf->source_frame->linesize[0];
+    return 0;
+  }
+  
+  const uint8_t *luma = frame->data[0];
+  int luma_linesize = frame->linesize[0];
+  uint8_t *scaled = NULL;
+  
+  if (scaling || !plain_luma) {
+    // Reading only the Y plane as GRAY8 skips the chroma entirely
+    enum AVPixelFormat src_format = plain_luma ? AV_PIX_FMT_GRAY8
+                                               : (enum AVPixelFormat)frame->format;
+    int flags = plan->scaled_width < plan->src_width ? SWS_AREA : SWS_BILINEAR;
+    g_state.gray_sws_ctx = sws_getCachedContext(
+        g_state.gray_sws_ctx, plan->src_width, plan->src_height, src_format,
+        plan->scaled_width, plan->scaled_height, AV_PIX_FMT_GRAY8, flags, NULL, NULL, NULL);
+    if (!g_state.gray_sws_ctx) return -1;
+    
+    scaled = (uint8_t *)malloc((size_t)plan->scaled_width * plan->scaled_height);
+    if (!scaled) return -1;
+    
+    uint8_t *dst_data[4] = { scaled, NULL, NULL, NULL };
+    int dst_linesize[4] = { plan->scaled_width, 0, 0, 0 };
+    if (sws_scale(g_state.gray_sws_ctx, (const uint8_t *const *)frame->data, frame->linesize,
+                  0, plan->src_height, dst_data, dst_linesize) < 0) {
+      free(scaled);
+      return -1;
+    }
+    luma = scaled;
+    luma_linesize = plan->scaled_width;
+  }
+  
+  if (scaled && identity) {
+    vf->data = scaled;
+    vf->linesize = plan->scaled_width;
+    return 0;
+  }
+  
+  vf->data = (uint8_t *)malloc((size_t)plan->out_width * plan->out_height);
+  if (!vf->data) {
+    free(scaled);
+    return -1;
+  }
+  vf->linesize = plan->out_width;
+  convert_transform_gray(luma, luma_linesize, plan->scaled_width, plan->scaled_height,
+                         &plan->transform, vf->data, vf->linesize);
+  free(scaled);
+  return 0;
+}
+
+static int64_t get_frame_ts_ms(const AVFrame *frame) {
+  AVRational time_base = g_state.fmt_ctx->streams[g_state.video_stream_idx]->time_base;
+  return frame->pts * 1000 * time_base.num / time_base.den;
+}
+
+static int64_t get_video_frame_ts_ms(void) {
+  return get_frame_ts_ms(g_state.video_frame);
+}
+
+static VideoFrame* create_video_frame_copy(const VideoOutputOptions *options) {
   if (!g_state.video_codec_ctx || !g_state.video_frame || !g_state.video_frame_rgba) {
     return NULL;
   }
   
-  // Convert to RGBA
-  sws_scale(g_state.sws_ctx,
-            (const uint8_t *const *)g_state.video_frame->data,
-            g_state.video_frame->linesize, 0,
-            g_state.video_codec_ctx->height,
-            g_state.video_frame_rgba->data,
-            g_state.video_frame_rgba->linesize);
-  
   // Calculate frame timestamp and ID
-  AVRational time_base = g_state.fmt_ctx->streams[g_state.video_stream_idx]->time_base;
-  int64_t frame_ts_ms = g_state.video_frame->pts * 1000 * time_base.num / time_base.den;
+  int64_t frame_ts_ms = get_video_frame_ts_ms();
   
   int64_t frame_id = 0;
   double fps = 0.0;
@@ -91,8 +554,64 @@ static VideoFrame* create_video_frame_copy(void) {
     frame_id = (int64_t)(frame_ts_ms * fps / 1000.0);
   }
   
-  // Allocate and copy frame data
-  int buffer_size = g_state.video_codec_ctx->width * g_state.video_codec_ctx->height * 4;
+  // Statistics cover the whole decoded frame, so take them before the
+  // crop is applied
+  FrameStats stats;
+  memset(&stats, 0, sizeof(stats));
+  if (options->frame_stats) {
+    if (!g_state.previous_video_frame) g_state.previous_video_frame = av_frame_alloc();
+    AVFrame *previous = g_state.previous_video_frame;
+    analysis_frame_stats(g_state.video_frame,
+                         previous && previous->buf[0] ? previous : NULL, &stats);
+    if (previous) {
+      av_frame_unref(previous);
+      av_frame_ref(previous, g_state.video_frame);
+    }
+  }
+  
+  VideoOutputPlan plan;
+  if (plan_video_output(options, &plan) < 0) return NULL;
+  
+  if (options->pixel_format == VIDEO_PIXEL_FORMAT_GRAY8) {
+    VideoFrame *vf = (VideoFrame *)calloc(1, sizeof(VideoFrame));
+    if (!vf) return NULL;
+    if (render_gray_output(&plan, vf) < 0) {
+      free(vf);
+      return NULL;
+    }
+    vf->width = plan.out_width;
+    vf->height = plan.out_height;
+    vf->pts_ms = frame_ts_ms;
+    vf->frame_id = frame_id;
+    vf->stats = stats;
+    vf->format = VIDEO_PIXEL_FORMAT_GRAY8;
+    return vf;
+  }
+  
+  // Lay out the pyramid levels one after the other, then the level table
+  VideoFrameLevel levels[VIDEO_FRAME_MAX_LEVELS];
+  int level_count = 0;
+  size_t buffer_size = (size_t)plan.out_width * plan.out_height * 4;
+  
+  if (options->pyramid_levels > 0) {
+    int max_levels = FFMIN(options->pyramid_levels + 1, VIDEO_FRAME_MAX_LEVELS);
+    int width = plan.out_width;
+    int height = plan.out_height;
+    buffer_size = 0;
+    
+    while (level_count < max_levels && width >= 1 && height >= 1) {
+      levels[level_count].offset = buffer_size;
+      levels[level_count].width = width;
+      levels[level_count].height = height;
+      levels[level_count].linesize = width * 4;
+      buffer_size += (size_t)width * height * 4;
+      level_count++;
+      width /= 2;
+      height /= 2;
+    }
+    buffer_size = (buffer_size + 7) & ~(size_t)7;
+    buffer_size += level_count * sizeof(VideoFrameLevel);
+  }
   
   VideoFrame *vf = (VideoFrame *)malloc(sizeof(VideoFrame));
   if (!vf) return NULL;
@@ -103,24 +622,127 @@ static VideoFrame* create_video_frame_copy(void) {
     return NULL;
   }
   
-  // Copy row by row to handle potential line size differences
-  for (int y = 0; y < g_state.video_codec_ctx->height; y++) {
-    memcpy(
-        vf->data + y * g_state.video_codec_ctx->width * 4,
-        g_state.video_frame_rgba->data[0] + y * g_state.video_frame_rgba->linesize[0],
-        g_state.video_codec_ctx->width * 4
-    );
+  if (render_video_output(&plan, vf->data, plan.out_width * 4) < 0) {
+    free(vf->data);
+    free(vf);
+    return NULL;
+  }
+  
+  // Each level comes from the previous one while it is still in cache
+  for (int i = 1; i < level_count; i++) {
+    convert_downsample_rgba(vf->data + levels[i - 1].offset, levels[i - 1].linesize,
+                            levels[i - 1].width, levels[i - 1].height,
+                            vf->data + levels[i].offset, levels[i].linesize);
   }
   
-  vf->width = g_state.video_codec_ctx->width;
-  vf->height = g_state.video_codec_ctx->height;
-  vf->linesize = g_state.video_codec_ctx->width * 4;
+  vf->level_count = level_count;
+  vf->levels = NULL;
+  if (level_count > 0) {
+    vf->levels = (VideoFrameLevel *)(vf->data + buffer_size - level_count * sizeof(VideoFrameLevel));
+    memcpy(vf->levels, levels, level_count * sizeof(VideoFrameLevel));
+  }
+  
+  vf->width = plan.out_width;
+  vf->height = plan.out_height;
+  vf->linesize = plan.out_width * 4;
   vf->pts_ms = frame_ts_ms;
   vf->frame_id = frame_id;
+  vf->stats = stats;
+  vf->format = VIDEO_PIXEL_FORMAT_RGBA;
+  vf->source_frame = NULL;
   
   return vf;
 }
 
+// Convert g_state.video_frame into one tensor of a batch
+static int write_video_tensor(const VideoOutputOptions *options, const TensorOptions *tensor,
+                              const TensorWriter *writer, uint8_t **scratch, size_t *scratch_size,
+                              void *dst, TensorBatch *batch) {
+  VideoOutputPlan plan;
+  if (plan_video_output(options, &plan) < 0) return -1;
+  
+  // Fit the frame into the tensor, keeping its aspect ratio when letterboxing
+  int width = tensor->width;
+  int height = tensor->height;
+  if (tensor->letterbox) {
+    if ((int64_t)plan.out_width * tensor->height > (int64_t)plan.out_height * tensor->width) {
+      height = (int)FFMAX(1, ((int64_t)plan.out_height * tensor->width + plan.out_width / 2) /
+                                 plan.out_width);
+    } else {
+      width = (int)FFMAX(1, ((int64_t)plan.out_width * tensor->height + plan.out_height / 2) /
+                                plan.out_height);
+    }
+  }
+  plan_set_output_size(&plan, width, height);
+  
+  size_t size = (size_t)width * height * 4;
+  if (size > *scratch_size) {
+    uint8_t *buffer = (uint8_t *)realloc(*scratch, size);
+    if (!buffer) return -1;
+    *scratch = buffer;
+    *scratch_size = size;
+  }
+  
+  if (render_video_output(&plan, *scratch, width * 4) < 0) return -1;
+  
+  int x = (tensor->width - width) / 2;
+  int y = (tensor->height - height) / 2;
+  tensor_writer_write(writer, *scratch, width * 4, width, height, x, y, dst);
+  
+  batch->content_x = x;
+  batch->content_y = y;
+  batch->content_width = width;
+  batch->content_height = height;
+  return 0;
+}
+
+static double get_video_fps(void) {
+  AVRational rate = g_state.fmt_ctx->streams[g_state.video_stream_idx]->avg_frame_rate;
+  return rate.den != 0 ? av_q2d(rate) : 0.0;
+}
+
+// Render the current video frame and compress it with the session encoder
+static EncodedFrame* create_encoded_frame(const VideoOutputOptions *options,
+                                          int image_format, int quality) {
+  enum AVCodecID codec_id = image_codec_id(image_format);
+  if (codec_id == AV_CODEC_ID_NONE || !g_state.video_frame) return NULL;
+  
+  if (!g_state.image_encoder) {
+    g_state.image_encoder = image_encoder_alloc();
+    if (!g_state.image_encoder) return NULL;
+  }
+  
+  int64_t frame_ts_ms = get_video_frame_ts_ms();
+  double fps = get_video_fps();
+  
+  VideoOutputPlan plan;
+  if (plan_video_output(options, &plan) < 0) return NULL;
+  
+  int linesize = plan.out_width * 4;
+  uint8_t *rgba = (uint8_t *)malloc((size_t)linesize * plan.out_height);
+  if (!rgba) return NULL;
+  
+  EncodedFrame *ef = NULL;
+  if (render_video_output(&plan, rgba, linesize) >= 0) {
+    ef = (EncodedFrame *)calloc(1, sizeof(EncodedFrame));
+  }
+  if (ef && image_encoder_encode(g_state.image_encoder, codec_id, quality, rgba, linesize,
+                                 plan.out_width, plan.out_height, &ef->data, &ef->size) < 0) {
+    free(ef);
+    ef = NULL;
+  }
+  free(rgba);
+  if (!ef) return NULL;
+  
+  ef->format = image_format;
+  ef->width = plan.out_width;
+  ef->height = plan.out_height;
+  ef->pts_ms = frame_ts_ms;
+  ef->frame_id = fps > 0 ? (int64_t)(frame_ts_ms * fps / 1000.0) : 0;
+  
+  return ef;
+}
+
 static AudioFrame* create_audio_frame_copy(void) {
   if (!g_state.audio_codec_ctx || !g_state.audio_frame || !g_state.swr_ctx) {
     return NULL;
@@ -168,6 +790,7 @@ static int seek_to_frame_before_ts(int64_t target_ts_ms) {
   
   int64_t target_ts = target_ts_ms * (AV_TIME_BASE / 1000);
   
+  g_state.decode_position_ms = INT64_MIN;
   if (av_seek_frame(g_state.fmt_ctx, -1, target_ts, AVSEEK_FLAG_BACKWARD) < 0) {
     return -1;
   }
@@ -179,43 +802,504 @@ static int seek_to_frame_before_ts(int64_t target_ts_ms) {
     avcodec_flush_buffers(g_state.audio_codec_ctx);
   }
   
-  return 0;
-}
-
-static int decode_video_until_ts(int64_t target_ts_ms, VideoFrame **out_frame) {
-  if (!g_state.video_codec_ctx || !g_state.video_frame) return -1;
+  return 0;
+}
+
+// Decode until g_state.video_frame holds the first frame at or after the target
+static int decode_video_frame_until_ts(int64_t target_ts_ms) {
+  if (!g_state.video_codec_ctx || !g_state.video_frame) return -1;
+  
+  while (av_read_frame(g_state.fmt_ctx, g_state.work_packet) >= 0) {
+    if (g_state.work_packet->stream_index == g_state.video_stream_idx) {
+      int ret = avcodec_send_packet(g_state.video_codec_ctx, g_state.work_packet);
+      if (ret < 0) {
+        av_packet_unref(g_state.work_packet);
+        continue;
+      }
+      
+      while (ret >= 0) {
+        ret = avcodec_receive_frame(g_state.video_codec_ctx, g_state.video_frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+          break;
+        } else if (ret < 0) {
+          av_packet_unref(g_state.work_packet);
+          return -1;
+        }
+        
+        g_state.decode_position_ms = get_video_frame_ts_ms();
+        frame_cache_insert(g_state.frame_cache, g_state.media_key, g_state.video_frame,
+                           g_state.decode_position_ms);
+        if (g_state.decode_position_ms >= target_ts_ms) {
+          av_packet_unref(g_state.work_packet);
+          return 0;
+        }
+      }
+    }
+    av_packet_unref(g_state.work_packet);
+  }
+  
+  g_state.decode_position_ms = INT64_MIN;
+  return -1;
+}
+
+// Decode only the frame at or after target_ts_ms, found through the index
+static int fetch_intra_frame_at_ts(int64_t target_ts_ms) {
+  // The demuxer moves, so audio restarts from wherever it lands
+  if (g_state.audio_codec_ctx) {
+    avcodec_flush_buffers(g_state.audio_codec_ctx);
+  }
+  
+  if (intra_decode_at(g_state.fmt_ctx, g_state.video_stream_idx, g_state.video_codec_ctx,
+                      g_state.work_packet, g_state.video_frame, target_ts_ms) < 0) {
+    g_state.decode_position_ms = INT64_MIN;
+    return -1;
+  }
+  
+  g_state.decode_position_ms = get_video_frame_ts_ms();
+  frame_cache_insert(g_state.frame_cache, g_state.media_key, g_state.video_frame,
+                     g_state.decode_position_ms);
+  return 0;
+}
+
+// Index of the first sequence image shown at or after ts_ms. image2
+// counts frames in its time base.
+static int64_t sequence_index_at_ts(int64_t ts_ms) {
+  AVRational time_base = g_state.fmt_ctx->streams[g_state.video_stream_idx]->time_base;
+  return av_rescale_q_rnd(ts_ms, (AVRational){1, 1000}, time_base, AV_ROUND_UP);
+}
+
+// Decode the image of the frame at or after target_ts_ms from its file
+static int fetch_sequence_frame_at_ts(int64_t target_ts_ms) {
+  int64_t index = sequence_index_at_ts(target_ts_ms);
+  if (index < 0 || index >= sequence_count(g_state.sequence)) return -1;
+  
+  // The demuxer stays where it was, so decoding on from it seeks first
+  g_state.decode_position_ms = INT64_MIN;
+  avcodec_flush_buffers(g_state.video_codec_ctx);
+  if (sequence_decode_image(g_state.sequence, index, g_state.video_codec_ctx,
+                            g_state.work_packet, g_state.video_frame) < 0) {
+    return -1;
+  }
+  
+  // Playback and scrubbing mostly carry on forward
+  sequence_prefetch(g_state.sequence, index + 1, SEQUENCE_READ_AHEAD);
+  frame_cache_insert(g_state.frame_cache, g_state.media_key, g_state.video_frame,
+                     get_video_frame_ts_ms());
+  return 0;
+}
+
+// A cached frame within one frame duration is the one decoding would find
+static int64_t get_cache_tolerance_ms(void) {
+  double fps = get_video_fps();
+  return fps > 0 ? (int64_t)(1000.0 / fps + 0.999) : 1;
+}
+
+// Index of the frame decoded ahead for target_ts_ms, -1 if there is none
+static int find_decoded_ahead(int64_t target_ts_ms) {
+  // The pool is still writing them
+  if (g_state.pool_busy) return -1;
+  
+  for (int i = 0; i < g_state.ahead_count; i++) {
+    if (g_state.ahead_targets[i] == target_ts_ms && g_state.ahead_frames[i]->buf[0]) return i;
+  }
+  return -1;
+}
+
+// Leave the first frame at or after target_ts_ms in g_state.video_frame,
+// taking it from the frame cache when it is there
+static int fetch_video_frame_at_ts(int64_t target_ts_ms) {
+  if (!g_state.video_codec_ctx || !g_state.video_frame) return -1;
+  
+  if (frame_cache_lookup(g_state.frame_cache, g_state.media_key, target_ts_ms,
+                         get_cache_tolerance_ms(), g_state.video_frame) == 0) {
+    return 0;
+  }
+  
+  // Decoded on the pool along with the requests queued behind it
+  int ahead = find_decoded_ahead(target_ts_ms);
+  if (ahead >= 0) {
+    av_frame_unref(g_state.video_frame);
+    av_frame_move_ref(g_state.video_frame, g_state.ahead_frames[ahead]);
+    return 0;
+  }
+  
+  // Intra-only frames are read straight through the index; decoding on
+  // would decode every frame in between
+  if (g_state.intra_only && fetch_intra_frame_at_ts(target_ts_ms) == 0) return 0;
+  if (g_state.sequence && fetch_sequence_frame_at_ts(target_ts_ms) == 0) return 0;
+  
+  // Just ahead of the decoder, decoding on is cheaper than going back to
+  // a keyframe. This keeps frame by frame requests linear.
+  int64_t position_ms = g_state.decode_position_ms;
+  if (position_ms == INT64_MIN || target_ts_ms <= position_ms ||
+      target_ts_ms - position_ms > SEQUENTIAL_DECODE_WINDOW_MS) {
+    if (seek_to_frame_before_ts(target_ts_ms) < 0) return -1;
+  }
+  return decode_video_frame_until_ts(target_ts_ms);
+}
+
+static int fetch_video_at_ts(int64_t target_ts_ms, const VideoOutputOptions *options,
+                             VideoFrame **out_frame) {
+  if (fetch_video_frame_at_ts(target_ts_ms) < 0) return -1;
+  
+  *out_frame = create_video_frame_copy(options);
+  return *out_frame ? 0 : -1;
+}
+
+// Like fetch_video_at_ts, from the attached proxy. The crop rectangle is
+// in output pixels of the original, so it is scaled down to the proxy.
+// Returns -1 without a proxy, for the caller to fall back to the original.
+static int fetch_proxy_at_ts(int64_t target_ts_ms, const VideoOutputOptions *options,
+                             VideoFrame **out_frame) {
+  if (!g_state.proxy) return -1;
+  
+  const AVStream *stream = g_state.fmt_ctx->streams[g_state.video_stream_idx];
+  if (proxy_source_decode_at(g_state.proxy, target_ts_ms, stream->time_base,
+                             g_state.video_frame) < 0) {
+    return -1;
+  }
+  
+  // Statistics against the previous original frame would be meaningless
+  VideoOutputOptions proxy_options = *options;
+  proxy_options.frame_stats = 0;
+  
+  if (options->crop_width > 0 && options->crop_height > 0) {
+    ConvertTransform transform;
+    resolve_output_transform(options, &transform);
+    int source_width, source_height, proxy_width, proxy_height;
+    convert_get_output_size(&transform, stream->codecpar->width, stream->codecpar->height,
+                            &source_width, &source_height);
+    convert_get_output_size(&transform, g_state.video_frame->width, g_state.video_frame->height,
+                            &proxy_width, &proxy_height);
+    if (source_width <= 0 || source_height <= 0) return -1;
+    
+    proxy_options.crop_x = (int)((int64_t)options->crop_x * proxy_width / source_width);
+    proxy_options.crop_y = (int)((int64_t)options->crop_y * proxy_height / source_height);
+    proxy_options.crop_width = (int)FFMAX(
+        1, ((int64_t)options->crop_width * proxy_width + source_width - 1) / source_width);
+    proxy_options.crop_height = (int)FFMAX(
+        1, ((int64_t)options->crop_height * proxy_height + source_height - 1) / source_height);
+  }
+  
+  *out_frame = create_video_frame_copy(&proxy_options);
+  return *out_frame ? 0 : -1;
+}
+
+// Frames of a batch request, in order. Image sequences and intra-only
+// media decode them ahead on their pool, one frame per worker per round;
+// anything else decodes on from a single seek.
+typedef struct {
+  // Target i is frame start_index + i at fps, or start_ms + i * step_ms
+  int start_index;
+  double fps;
+  int64_t start_ms;
+  int64_t step_ms;
+  int count;
+  int next;
+  
+  const bool *cancelled;
+  AVFrame **frames;   // Decoded round, NULL when sequential
+  int64_t *targets;
+  int round_size;
+  int round_start;
+  int round_count;
+} FrameBatch;
+
+static int64_t frame_batch_target(const FrameBatch *batch, int i) {
+  if (batch->fps > 0) return (int64_t)(((batch->start_index + i) / batch->fps) * 1000.0);
+  return batch->start_ms + i * batch->step_ms;
+}
+
+// Targets from start_ms to end_ms inclusive
+static int frame_batch_count(int64_t start_ms, int64_t end_ms, int64_t step_ms) {
+  if (end_ms < start_ms || step_ms <= 0) return 0;
+  return (int)FFMIN((end_ms - start_ms) / step_ms + 1, INT32_MAX);
+}
+
+// Wait out a decode ahead, which runs on the pools without g_state.mutex.
+// Call with g_state.mutex held.
+static void wait_for_pool(void) {
+  while (g_state.pool_busy) pthread_cond_wait(&g_state.pool_idle, &g_state.mutex);
+}
+
+static int ensure_intra_pool(void) {
+  if (g_state.intra_pool) return 0;
+  if (!g_state.intra_only || !g_state.media_url || g_state.intra_pool_failed) return -1;
+  
+  // Not retried: a failed open would fail again on every batch
+  if (intra_pool_open(g_state.media_url, g_state.video_stream_idx, 0,
+                      &g_state.intra_pool) < 0) {
+    g_state.intra_pool_failed = 1;
+    return -1;
+  }
+  return 0;
+}
+
+static int ensure_sequence_pool(void) {
+  if (g_state.sequence_pool) return 0;
+  if (!g_state.sequence || g_state.sequence_pool_failed) return -1;
+  
+  const AVStream *stream = g_state.fmt_ctx->streams[g_state.video_stream_idx];
+  if (sequence_pool_open(g_state.sequence, stream->codecpar, 0, &g_state.sequence_pool) < 0) {
+    g_state.sequence_pool_failed = 1;
+    return -1;
+  }
+  return 0;
+}
+
+// Workers of the pool batches decode on, 0 without one
+static int frame_batch_pool_size(void) {
+  wait_for_pool();
+  if (g_state.sequence) {
+    return ensure_sequence_pool() == 0 ? sequence_pool_worker_count(g_state.sequence_pool) : 0;
+  }
+  return ensure_intra_pool() == 0 ? intra_pool_worker_count(g_state.intra_pool) : 0;
+}
+
+// Decode the round's targets into batch->frames on the pool
+static void frame_batch_decode_round(FrameBatch *batch) {
+  if (!g_state.sequence) {
+    intra_pool_decode(g_state.intra_pool, batch->targets, batch->round_count, batch->frames,
+                      batch->cancelled);
+    return;
+  }
+  
+  for (int k = 0; k < batch->round_count; k++) {
+    batch->targets[k] = sequence_index_at_ts(batch->targets[k]);
+  }
+  // The next round's files load while this one decodes
+  int next = batch->round_start + batch->round_count;
+  for (int k = next; k < FFMIN(next + batch->round_size, batch->count); k++) {
+    sequence_prefetch(g_state.sequence, sequence_index_at_ts(frame_batch_target(batch, k)), 1);
+  }
+  sequence_pool_decode(g_state.sequence_pool, batch->targets, batch->round_count, batch->frames,
+                       batch->cancelled);
+}
+
+static void frame_batch_end(FrameBatch *batch) {
+  if (batch->frames) {
+    for (int i = 0; i < batch->round_size; i++) av_frame_free(&batch->frames[i]);
+  }
+  free(batch->frames);
+  free(batch->targets);
+  batch->frames = NULL;
+  batch->targets = NULL;
+  batch->round_size = 0;
+}
+
+static int frame_batch_start(FrameBatch *batch, int count, const bool *cancelled) {
+  batch->count = count;
+  batch->next = 0;
+  batch->cancelled = cancelled;
+  batch->frames = NULL;
+  batch->targets = NULL;
+  batch->round_size = 0;
+  batch->round_start = 0;
+  batch->round_count = 0;
+  
+  int pool_size = count > 1 ? frame_batch_pool_size() : 0;
+  if (pool_size > 0) {
+    int size = FFMIN(pool_size, count);
+    batch->frames = (AVFrame **)calloc(size, sizeof(AVFrame *));
+    batch->targets = (int64_t *)malloc(size * sizeof(int64_t));
+    batch->round_size = size;
+    bool allocated = batch->frames && batch->targets;
+    for (int i = 0; allocated && i < size; i++) {
+      batch->frames[i] = av_frame_alloc();
+      allocated = batch->frames[i] != NULL;
+    }
+    if (allocated) return 0;
+    // Decode sequentially instead
+    frame_batch_end(batch);
+  }
+  
+  return seek_to_frame_before_ts(frame_batch_target(batch, 0));
+}
+
+// Set up a batch of frames start_index .. start_index + count - 1.
+// Call with g_state.mutex held. Nothing needs ending on failure.
+static int frame_batch_begin_index(FrameBatch *batch, int start_index, int count, double fps,
+                                   const bool *cancelled) {
+  batch->start_index = start_index;
+  batch->fps = fps;
+  batch->start_ms = 0;
+  batch->step_ms = 0;
+  return frame_batch_start(batch, count, cancelled);
+}
+
+// Set up a batch of count frames every step_ms from start_ms.
+// Call with g_state.mutex held. Nothing needs ending on failure.
+static int frame_batch_begin_ts(FrameBatch *batch, int64_t start_ms, int64_t step_ms, int count,
+                                const bool *cancelled) {
+  batch->start_index = 0;
+  batch->fps = 0.0;
+  batch->start_ms = start_ms;
+  batch->step_ms = step_ms;
+  return frame_batch_start(batch, count, cancelled);
+}
+
+// Leave the next frame of the batch in g_state.video_frame
+static int frame_batch_next(FrameBatch *batch) {
+  if (batch->next >= batch->count) return -1;
+  int i = batch->next++;
+  
+  if (!batch->frames) return decode_video_frame_until_ts(frame_batch_target(batch, i));
+  
+  if (i >= batch->round_start + batch->round_count) {
+    batch->round_start = i;
+    batch->round_count = FFMIN(batch->round_size, batch->count - i);
+    for (int k = 0; k < batch->round_count; k++) {
+      batch->targets[k] = frame_batch_target(batch, i + k);
+    }
+    frame_batch_decode_round(batch);
+  }
+  
+  AVFrame *frame = batch->frames[i - batch->round_start];
+  if (!frame->buf[0]) return -1;
+  
+  av_frame_unref(g_state.video_frame);
+  av_frame_move_ref(g_state.video_frame, frame);
+  frame_cache_insert(g_state.frame_cache, g_state.media_key, g_state.video_frame,
+                     get_video_frame_ts_ms());
+  return 0;
+}
+
+// --- Decode Ahead ---
+
+// Timestamp a single frame request decodes, -1 for other requests.
+// Call with g_state.mutex held.
+static int64_t task_frame_target(const AsyncTask *task) {
+  if (task->cancelled) return -1;
+  
+  double fps = get_video_fps();
+  switch (task->type) {
+    case TASK_VIDEO_AT_TIMESTAMP:
+    case TASK_HANDLE_AT_TIMESTAMP:
+      return task->params.single.timestamp_ms;
+    case TASK_PRESENT_AT_TIMESTAMP:
+      // Presented from the proxy when one is attached
+      return g_state.proxy ? -1 : task->params.single.timestamp_ms;
+    case TASK_ENCODED_AT_TIMESTAMP:
+      return task->params.encode.timestamp_ms;
+    case TASK_VIDEO_AT_INDEX:
+    case TASK_HANDLE_AT_INDEX:
+      return fps > 0 ? (int64_t)((task->params.single.frame_index / fps) * 1000.0) : -1;
+    case TASK_ENCODED_AT_INDEX:
+      return fps > 0 ? (int64_t)((task->params.encode.frame_index / fps) * 1000.0) : -1;
+    default:
+      return -1;
+  }
+}
+
+static int ensure_ahead_frames(void) {
+  if (g_state.ahead_frames) return 0;
+  
+  AVFrame **frames = (AVFrame **)calloc(DECODE_AHEAD_MAX, sizeof(AVFrame *));
+  int64_t *targets = (int64_t *)calloc(DECODE_AHEAD_MAX, sizeof(int64_t));
+  bool allocated = frames && targets;
+  for (int i = 0; allocated && i < DECODE_AHEAD_MAX; i++) {
+    frames[i] = av_frame_alloc();
+    allocated = frames[i] != NULL;
+  }
+  if (!allocated) {
+    for (int i = 0; frames && i < DECODE_AHEAD_MAX; i++) av_frame_free(&frames[i]);
+    free(frames);
+    free(targets);
+    return -1;
+  }
+  
+  g_state.ahead_frames = frames;
+  g_state.ahead_targets = targets;
+  return 0;
+}
+
+static void free_ahead_frames(void) {
+  for (int i = 0; g_state.ahead_frames && i < DECODE_AHEAD_MAX; i++) {
+    av_frame_free(&g_state.ahead_frames[i]);
+  }
+  free(g_state.ahead_frames);
+  free(g_state.ahead_targets);
+  g_state.ahead_frames = NULL;
+  g_state.ahead_targets = NULL;
+  g_state.ahead_count = 0;
+}
+
+// Single frame requests on intra-only media and image sequences do not
+// depend on each other, so task and the ones queued right behind it are
+// decoded together, one per pool worker, and served in order from
+// g_state.ahead_frames. The pool runs without g_state.mutex, so requests
+// made meanwhile from other threads are not held up; the frames also go
+// to the frame cache.
+static void decode_ahead(const AsyncTask *task) {
+  pthread_mutex_lock(&g_state.mutex);
+  
+  int64_t target = -1;
+  int64_t tolerance_ms = 0;
+  if (g_state.fmt_ctx && g_state.video_stream_idx >= 0 &&
+      (g_state.intra_only || g_state.sequence)) {
+    target = task_frame_target(task);
+    tolerance_ms = get_cache_tolerance_ms();
+  }
+  if (target < 0 || find_decoded_ahead(target) >= 0 ||
+      frame_cache_contains(g_state.frame_cache, g_state.media_key, target, tolerance_ms)) {
+    pthread_mutex_unlock(&g_state.mutex);
+    return;
+  }
+  
+  int64_t targets[DECODE_AHEAD_MAX];
+  int count = 0;
+  targets[count++] = target;
+  
+  pthread_mutex_lock(&g_task_queue.mutex);
+  for (const AsyncTask *next = g_task_queue.head; next && count < DECODE_AHEAD_MAX;
+       next = next->next) {
+    int64_t ts = task_frame_target(next);
+    if (ts < 0) break;
+    
+    bool known = frame_cache_contains(g_state.frame_cache, g_state.media_key, ts, tolerance_ms);
+    for (int i = 0; !known && i < count; i++) known = targets[i] == ts;
+    if (!known) targets[count++] = ts;
+  }
+  pthread_mutex_unlock(&g_task_queue.mutex);
+  
+  // A request on its own decodes on the main decoder, without a pool
+  int pool_size = count > 1 && ensure_ahead_frames() == 0 ? frame_batch_pool_size() : 0;
+  if (pool_size < 2) {
+    pthread_mutex_unlock(&g_state.mutex);
+    return;
+  }
+  count = FFMIN(count, pool_size);
+  
+  int64_t positions[DECODE_AHEAD_MAX];
+  for (int i = 0; i < DECODE_AHEAD_MAX; i++) av_frame_unref(g_state.ahead_frames[i]);
+  for (int i = 0; i < count; i++) {
+    g_state.ahead_targets[i] = targets[i];
+    positions[i] = g_state.sequence ? sequence_index_at_ts(targets[i]) : targets[i];
+  }
+  g_state.ahead_count = count;
+  
+  // ffmpeg_stop and batches wait for the pool before touching it
+  IntraPool *intra_pool = g_state.sequence ? NULL : g_state.intra_pool;
+  SequencePool *sequence_pool = g_state.sequence_pool;
+  AVFrame **frames = g_state.ahead_frames;
+  g_state.pool_busy = 1;
+  pthread_mutex_unlock(&g_state.mutex);
   
-  while (av_read_frame(g_state.fmt_ctx, g_state.work_packet) >= 0) {
-    if (g_state.work_packet->stream_index == g_state.video_stream_idx) {
-      int ret = avcodec_send_packet(g_state.video_codec_ctx, g_state.work_packet);
-      if (ret < 0) {
-        av_packet_unref(g_state.work_packet);
-        continue;
-      }
-      
-      while (ret >= 0) {
-        ret = avcodec_receive_frame(g_state.video_codec_ctx, g_state.video_frame);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-          break;
-        } else if (ret < 0) {
-          av_packet_unref(g_state.work_packet);
-          return -1;
-        }
-        
-        AVRational time_base = g_state.fmt_ctx->streams[g_state.video_stream_idx]->time_base;
-        int64_t frame_ts_ms = g_state.video_frame->pts * 1000 * time_base.num / time_base.den;
-        
-        if (frame_ts_ms >= target_ts_ms) {
-          *out_frame = create_video_frame_copy();
-          av_packet_unref(g_state.work_packet);
-          return *out_frame ? 0 : -1;
-        }
-      }
-    }
-    av_packet_unref(g_state.work_packet);
+  if (intra_pool) {
+    intra_pool_decode(intra_pool, positions, count, frames, NULL);
+  } else {
+    sequence_pool_decode(sequence_pool, positions, count, frames, NULL);
   }
   
-  return -1;
+  pthread_mutex_lock(&g_state.mutex);
+  g_state.pool_busy = 0;
+  pthread_cond_broadcast(&g_state.pool_idle);
+  for (int i = 0; i < count; i++) {
+    if (!frames[i]->buf[0]) continue;
+    frame_cache_insert(g_state.frame_cache, g_state.media_key, frames[i],
+                       get_frame_ts_ms(frames[i]));
+  }
+  pthread_mutex_unlock(&g_state.mutex);
 }
 
 static int decode_audio_until_ts(int64_t target_ts_ms, AudioFrame **out_frame) {
@@ -338,9 +1422,7 @@ static void process_video_task(AsyncTask *task) {
   
   if (task->type == TASK_VIDEO_AT_TIMESTAMP) {
     int64_t timestamp_ms = task->params.single.timestamp_ms;
-    if (seek_to_frame_before_ts(timestamp_ms) >= 0) {
-      result = decode_video_until_ts(timestamp_ms, &frame);
-    }
+    result = fetch_video_at_ts(timestamp_ms, &task->output_options, &frame);
   } else if (task->type == TASK_VIDEO_AT_INDEX) {
     int frame_index = task->params.single.frame_index;
     
@@ -353,9 +1435,7 @@ static void process_video_task(AsyncTask *task) {
     
     if (fps > 0) {
       int64_t target_ts_ms = (int64_t)((frame_index / fps) * 1000.0);
-      if (seek_to_frame_before_ts(target_ts_ms) >= 0) {
-        result = decode_video_until_ts(target_ts_ms, &frame);
-      }
+      result = fetch_video_at_ts(target_ts_ms, &task->output_options, &frame);
     }
   }
   
@@ -428,26 +1508,20 @@ static void process_video_range_task(AsyncTask *task) {
   }
   
   // Optimized: seek once to start, then decode sequentially
-  int64_t start_ts_ms = (int64_t)((start_index / fps) * 1000.0);
-  int64_t end_ts_ms = (int64_t)((end_index / fps) * 1000.0);
-  
-  if (seek_to_frame_before_ts(start_ts_ms) < 0) {
+  FrameBatch batch;
+  if (frame_batch_begin_index(&batch, start_index, total, fps, &task->cancelled) < 0) {
     pthread_mutex_unlock(&g_state.mutex);
     return;
   }
   
   int processed = 0;
-  int current_index = start_index;
   
-  while (current_index <= end_index && !task->cancelled) {
-    int64_t target_ts_ms = (int64_t)((current_index / fps) * 1000.0);
+  while (!task->cancelled && frame_batch_next(&batch) == 0) {
+    VideoFrame *frame = create_video_frame_copy(&task->output_options);
     
-    VideoFrame *frame = NULL;
-    int result = decode_video_until_ts(target_ts_ms, &frame);
-    
-    if (result >= 0 && frame && task->video_callback && !task->cancelled) {
+    if (frame && task->video_callback && !task->cancelled) {
       pthread_mutex_unlock(&g_state.mutex);
-      task->video_callback(task->user_data, frame, result);
+      task->video_callback(task->user_data, frame, 0);
       pthread_mutex_lock(&g_state.mutex);
       
       processed++;
@@ -460,11 +1534,409 @@ static void process_video_range_task(AsyncTask *task) {
       if (frame) ffmpeg_free_video_frame(frame);
       break;
     }
+  }
+  
+  frame_batch_end(&batch);
+  pthread_mutex_unlock(&g_state.mutex);
+}
+
+static void process_encoded_frame_task(AsyncTask *task) {
+  EncodedFrame *frame = NULL;
+  int result = -6;
+  
+  if (!task->cancelled) {
+    pthread_mutex_lock(&g_state.mutex);
+    
+    result = -1;
+    if (g_state.fmt_ctx && g_state.video_stream_idx >= 0) {
+      int64_t target_ts_ms = task->params.encode.timestamp_ms;
+      if (task->type == TASK_ENCODED_AT_INDEX) {
+        double fps = get_video_fps();
+        target_ts_ms = fps > 0 ? (int64_t)((task->params.encode.frame_index / fps) * 1000.0) : -1;
+      }
+      
+      if (target_ts_ms >= 0 && fetch_video_frame_at_ts(target_ts_ms) >= 0) {
+        frame = create_encoded_frame(&task->output_options, task->params.encode.image_format,
+                                     task->params.encode.quality);
+        result = frame ? 0 : -2;
+      }
+    }
+    
+    pthread_mutex_unlock(&g_state.mutex);
+  }
+  
+  // Like sprite sheets, cancelled requests still report back with -6
+  if (task->encoded_callback) {
+    task->encoded_callback(task->user_data, frame, result);
+  } else if (frame) {
+    ffmpeg_free_encoded_frame(frame);
+  }
+}
+
+// Reference g_state.video_frame as it came out of the decoder
+static FrameHandle* create_frame_handle(void) {
+  FrameHandle *handle = (FrameHandle *)calloc(1, sizeof(FrameHandle));
+  if (!handle) return NULL;
+  
+  handle->frame = av_frame_clone(g_state.video_frame);
+  if (!handle->frame) {
+    free(handle);
+    return NULL;
+  }
+  
+  const AVFrame *frame = handle->frame;
+  for (int i = 0; i < 4; i++) {
+    handle->data[i] = frame->data[i];
+    handle->linesize[i] = frame->linesize[i];
+  }
+  handle->width = frame->width;
+  handle->height = frame->height;
+  handle->format = frame->format;
+  handle->pts_ms = get_video_frame_ts_ms();
+  double fps = get_video_fps();
+  handle->frame_id = fps > 0 ? (int64_t)(handle->pts_ms * fps / 1000.0) : 0;
+  handle->key_frame = (frame->flags & AV_FRAME_FLAG_KEY) != 0;
+  handle->color_space = frame->colorspace;
+  handle->color_range = frame->color_range;
+  handle->color_primaries = frame->color_primaries;
+  handle->color_trc = frame->color_trc;
+  return handle;
+}
+
+static void process_frame_handle_task(AsyncTask *task) {
+  if (task->cancelled) return;
+  
+  pthread_mutex_lock(&g_state.mutex);
+  
+  FrameHandle *handle = NULL;
+  int result = -1;
+  
+  if (g_state.fmt_ctx && g_state.video_stream_idx >= 0) {
+    int64_t target_ts_ms = task->params.single.timestamp_ms;
+    if (task->type == TASK_HANDLE_AT_INDEX) {
+      double fps = get_video_fps();
+      target_ts_ms = fps > 0 ? (int64_t)((task->params.single.frame_index / fps) * 1000.0) : -1;
+    }
+    
+    if (target_ts_ms >= 0 && fetch_video_frame_at_ts(target_ts_ms) >= 0) {
+      handle = create_frame_handle();
+      result = handle ? 0 : -2;
+    }
+  }
+  
+  pthread_mutex_unlock(&g_state.mutex);
+  
+  if (task->handle_callback && !task->cancelled) {
+    task->handle_callback(task->user_data, handle, result);
+  } else {
+    ffmpeg_frame_release(handle);
+  }
+}
+
+static void process_present_task(AsyncTask *task) {
+  if (task->cancelled) return;
+  
+  VideoOutputOptions options = task->output_options;
+  options.pixel_format = VIDEO_PIXEL_FORMAT_RGBA;
+  options.pyramid_levels = 0;
+  
+  pthread_mutex_lock(&g_state.mutex);
+  
+  VideoFrame *frame = NULL;
+  int64_t timestamp_ms = task->params.single.timestamp_ms;
+  if (g_state.fmt_ctx && g_state.video_stream_idx >= 0) {
+    // Scrubbing is served from the proxy when there is one
+    if (fetch_proxy_at_ts(timestamp_ms, &options, &frame) < 0) {
+      fetch_video_at_ts(timestamp_ms, &options, &frame);
+    }
+  }
+  
+  pthread_mutex_unlock(&g_state.mutex);
+  
+  if (!frame) return;
+  
+  // The listener is called under the lock, so once it is removed its
+  // user_data is no longer used
+  pthread_mutex_lock(&g_display_mutex);
+  VideoFrame *previous = g_display_frame;
+  g_display_frame = frame;
+  if (g_display_listener) g_display_listener(g_display_listener_data);
+  pthread_mutex_unlock(&g_display_mutex);
+  
+  ffmpeg_free_video_frame(previous);
+}
+
+// Convert g_state.video_frame straight into a ring slot
+static int render_shm_slot(const VideoOutputOptions *options, ShmSlotHeader *slot,
+                           uint8_t *pixels, size_t capacity) {
+  VideoOutputPlan plan;
+  if (plan_video_output(options, &plan) < 0) return -1;
+  
+  int gray = options->pixel_format == VIDEO_PIXEL_FORMAT_GRAY8;
+  int linesize = plan.out_width * (gray ? 1 : 4);
+  size_t size = (size_t)linesize * plan.out_height;
+  if (size > capacity) return -3;
+  
+  if (gray) {
+    // The gray path may hand out the decoder's plane, so copy from there
+    VideoFrame vf;
+    memset(&vf, 0, sizeof(vf));
+    if (render_gray_output(&plan, &vf) < 0) return -1;
+    for (int y = 0; y < plan.out_height; y++) {
+      memcpy(pixels + (size_t)y * linesize, vf.data + (size_t)y * vf.linesize, linesize);
+    }
+    if (vf.source_frame) {
+      av_frame_free(&vf.source_frame);
+    } else {
+      free(vf.data);
+    }
+  } else if (render_video_output(&plan, pixels, linesize) < 0) {
+    return -1;
+  }
+  
+  int64_t pts_ms = get_video_frame_ts_ms();
+  double fps = get_video_fps();
+  slot->width = plan.out_width;
+  slot->height = plan.out_height;
+  slot->linesize = linesize;
+  slot->format = gray ? VIDEO_PIXEL_FORMAT_GRAY8 : VIDEO_PIXEL_FORMAT_RGBA;
+  slot->pts_ms = pts_ms;
+  slot->frame_id = fps > 0 ? (int64_t)(pts_ms * fps / 1000.0) : 0;
+  slot->size = size;
+  return 0;
+}
+
+static int write_shm_stream(AsyncTask *task, ShmRing *ring, int *frames_written) {
+  VideoOutputOptions options = task->output_options;
+  options.pyramid_levels = 0;
+  
+  int64_t end_ms = task->params.shm.end_ms;
+  int64_t target_ms = task->params.shm.start_ms;
+  size_t capacity = shm_ring_slot_capacity(ring);
+  int64_t position_ms = INT64_MIN;  // Where the stream left the decoder
+  int result = 0;
+  
+  pthread_mutex_lock(&g_state.mutex);
+  if (!g_state.fmt_ctx || g_state.video_stream_idx < 0 ||
+      seek_to_frame_before_ts(target_ms) < 0) {
+    result = -1;
+  }
+  pthread_mutex_unlock(&g_state.mutex);
+  
+  while (result == 0) {
+    // Wait for a free slot without holding up the decoder state
+    uint8_t *pixels = NULL;
+    ShmSlotHeader *slot = shm_ring_begin_write(ring, &task->cancelled, &pixels);
+    if (!slot) break;
+    
+    pthread_mutex_lock(&g_state.mutex);
+    // The stream runs on its own thread, so queued requests may have
+    // moved the decoder in between
+    int decoded = (g_state.decode_position_ms == position_ms ||
+                   seek_to_frame_before_ts(target_ms) == 0) &&
+                  decode_video_frame_until_ts(target_ms) >= 0 &&
+                  (end_ms < 0 || get_video_frame_ts_ms() <= end_ms);
+    if (decoded) {
+      position_ms = g_state.decode_position_ms;
+      target_ms = get_video_frame_ts_ms() + 1;
+      result = render_shm_slot(&options, slot, pixels, capacity);
+    }
+    pthread_mutex_unlock(&g_state.mutex);
+    
+    // The claimed slot ends the stream when there is nothing to put in it
+    if (!decoded || result < 0) {
+      memset(&slot->width, 0, sizeof(*slot) - offsetof(ShmSlotHeader, width));
+      slot->flags = SHM_SLOT_END_OF_STREAM;
+      shm_ring_publish(ring, slot);
+      return result;
+    }
     
-    current_index++;
+    shm_ring_publish(ring, slot);
+    (*frames_written)++;
   }
   
+  // Cancelled, closed or failed before a slot was claimed
+  uint8_t *pixels = NULL;
+  ShmSlotHeader *slot = shm_ring_begin_write(ring, &task->cancelled, &pixels);
+  if (slot) {
+    slot->flags = SHM_SLOT_END_OF_STREAM;
+    shm_ring_publish(ring, slot);
+  }
+  return result;
+}
+
+static void process_shm_stream_task(AsyncTask *task) {
+  int frames_written = 0;
+  int result = -6;
+  
+  if (!task->cancelled) {
+    pthread_mutex_lock(&g_shm_write_mutex);
+    pthread_mutex_lock(&g_shm_mutex);
+    ShmRing *ring = g_shm_ring;
+    pthread_mutex_unlock(&g_shm_mutex);
+    
+    result = ring ? write_shm_stream(task, ring, &frames_written) : -1;
+    pthread_mutex_unlock(&g_shm_write_mutex);
+    if (task->cancelled) result = -6;
+  }
+  
+  if (task->shm_callback) {
+    task->shm_callback(task->user_data, frames_written, result);
+  }
+}
+
+// Background jobs run on private readers and only need the path
+static char* copy_media_url(void) {
+  pthread_mutex_lock(&g_state.mutex);
+  char *url = g_state.media_url ? strdup(g_state.media_url) : NULL;
+  pthread_mutex_unlock(&g_state.mutex);
+  return url;
+}
+
+// Thumbnails are fine at proxy quality, so they come from the proxy when
+// one is attached
+static char* copy_thumbnail_url(void) {
+  pthread_mutex_lock(&g_state.mutex);
+  const char *url = g_state.proxy ? proxy_source_url(g_state.proxy) : g_state.media_url;
+  char *copy = url ? strdup(url) : NULL;
   pthread_mutex_unlock(&g_state.mutex);
+  return copy;
+}
+
+static void process_sprite_sheet_task(AsyncTask *task) {
+  SpriteSheet *sheet = NULL;
+  int result = -6;
+  
+  if (!task->cancelled) {
+    char *url = copy_thumbnail_url();
+    result = url ? sprite_generate(url, &task->params.sprite, &task->cancelled, &sheet) : -1;
+    free(url);
+  }
+  
+  // Always report back, cancelled jobs with -6, so callers can clean up
+  if (task->sprite_callback) {
+    task->sprite_callback(task->user_data, sheet, result);
+  } else {
+    sprite_free(sheet);
+  }
+}
+
+static void process_scene_detect_task(AsyncTask *task) {
+  SceneCutList *cuts = NULL;
+  int result = -6;
+  
+  if (!task->cancelled) {
+    char *url = copy_media_url();
+    result = url ? analysis_detect_scenes(url, &task->params.scene, &task->cancelled, &cuts) : -1;
+    free(url);
+  }
+  
+  if (task->scene_callback) {
+    task->scene_callback(task->user_data, cuts, result);
+  } else {
+    analysis_free_scene_cuts(cuts);
+  }
+}
+
+static void process_packet_stats_task(AsyncTask *task) {
+  PacketStats *stats = NULL;
+  int result = -6;
+  
+  if (!task->cancelled) {
+    char *url = copy_media_url();
+    result = url ? analysis_packet_stats(url, &task->params.packet_stats, &task->cancelled,
+                                         task->progress_callback, task->user_data, &stats)
+                 : -1;
+    free(url);
+  }
+  
+  if (task->packet_stats_callback) {
+    task->packet_stats_callback(task->user_data, stats, result);
+  } else {
+    analysis_free_packet_stats(stats);
+  }
+}
+
+static void process_black_freeze_task(AsyncTask *task) {
+  BlackFreezeResult *scan = NULL;
+  int result = -6;
+  
+  if (!task->cancelled) {
+    char *url = copy_media_url();
+    result = url ? analysis_detect_black_freeze(url, &task->params.black_freeze,
+                                                &task->cancelled, &scan)
+                 : -1;
+    free(url);
+  }
+  
+  if (task->black_freeze_callback) {
+    task->black_freeze_callback(task->user_data, scan, result);
+  } else {
+    analysis_free_black_freeze(scan);
+  }
+}
+
+static void process_motion_vectors_task(AsyncTask *task) {
+  MotionVectorTrack *track = NULL;
+  int result = -6;
+  
+  if (!task->cancelled) {
+    char *url = copy_media_url();
+    result = url ? analysis_motion_vectors(url, &task->params.motion, &task->cancelled, &track)
+                 : -1;
+    free(url);
+  }
+  
+  if (task->motion_callback) {
+    task->motion_callback(task->user_data, track, result);
+  } else {
+    analysis_free_motion_vectors(track);
+  }
+}
+
+static void process_task(AsyncTask *task) {
+  switch (task->type) {
+    case TASK_VIDEO_AT_TIMESTAMP:
+    case TASK_VIDEO_AT_INDEX:
+      process_video_task(task);
+      break;
+    case TASK_AUDIO_AT_TIMESTAMP:
+    case TASK_AUDIO_AT_INDEX:
+      process_audio_task(task);
+      break;
+    case TASK_VIDEO_RANGE:
+      process_video_range_task(task);
+      break;
+    case TASK_SPRITE_SHEET:
+      process_sprite_sheet_task(task);
+      break;
+    case TASK_ENCODED_AT_TIMESTAMP:
+    case TASK_ENCODED_AT_INDEX:
+      process_encoded_frame_task(task);
+      break;
+    case TASK_SCENE_DETECT:
+      process_scene_detect_task(task);
+      break;
+    case TASK_PACKET_STATS:
+      process_packet_stats_task(task);
+      break;
+    case TASK_BLACK_FREEZE:
+      process_black_freeze_task(task);
+      break;
+    case TASK_MOTION_VECTORS:
+      process_motion_vectors_task(task);
+      break;
+    case TASK_HANDLE_AT_TIMESTAMP:
+    case TASK_HANDLE_AT_INDEX:
+      process_frame_handle_task(task);
+      break;
+    case TASK_PRESENT_AT_TIMESTAMP:
+      process_present_task(task);
+      break;
+    case TASK_SHM_STREAM:
+      process_shm_stream_task(task);
+      break;
+  }
 }
 
 static void* worker_thread_func(void *arg) {
@@ -474,43 +1946,187 @@ static void* worker_thread_func(void *arg) {
     AsyncTask *task = task_queue_pop();
     if (!task) break;
     
-    switch (task->type) {
-      case TASK_VIDEO_AT_TIMESTAMP:
-      case TASK_VIDEO_AT_INDEX:
-        process_video_task(task);
-        break;
-      case TASK_AUDIO_AT_TIMESTAMP:
-      case TASK_AUDIO_AT_INDEX:
-        process_audio_task(task);
-        break;
-      case TASK_VIDEO_RANGE:
-        process_video_range_task(task);
-        break;
-    }
-    
+    decode_ahead(task);
+    process_task(task);
     free(task);
   }
   
   return NULL;
 }
 
+// --- File Jobs ---
+
+// Replace the attached proxy. Call with g_state.mutex held.
+static int attach_proxy_locked(const char *path) {
+  proxy_source_close(&g_state.proxy);
+  if (!path) return 0;
+  if (!g_state.media_url) return -1;
+  return proxy_source_open(path, &g_state.proxy) < 0 ? -2 : 0;
+}
+
+static void file_job_free(FileJob *job) {
+  free(job->task);
+  free(job->url);
+  free(job->output_path);
+  free(job);
+}
+
+static void* file_job_thread(void *arg) {
+  FileJob *job = (FileJob *)arg;
+  
+  int result = -6;
+  if (job->type == FILE_JOB_TASK) {
+    // Checks the task's own flag and reports through the task's callbacks
+    process_task(job->task);
+  } else if (!job->cancelled && job->type == FILE_JOB_PROXY) {
+    result = proxy_generate(job->url, job->output_path, &job->proxy_options, &job->cancelled,
+                            job->progress_callback, job->user_data);
+  } else if (!job->cancelled) {
+    result = export_range(job->url, job->output_path, job->start_ms, job->end_ms,
+                          &job->export_options, &job->cancelled, job->progress_callback,
+                          job->user_data);
+  }
+  
+  // Only attach to the media the proxy was made from
+  if (result == 0 && job->type == FILE_JOB_PROXY) {
+    pthread_mutex_lock(&g_state.mutex);
+    if (g_state.media_url && strcmp(g_state.media_url, job->url) == 0) {
+      attach_proxy_locked(job->output_path);
+    }
+    pthread_mutex_unlock(&g_state.mutex);
+  }
+  
+  // Always report back, cancelled jobs with -6, so callers can clean up
+  if (job->callback) job->callback(job->user_data, result);
+  
+  pthread_mutex_lock(&g_file_job_mutex);
+  FileJob **link = &g_file_jobs;
+  while (*link != job) link = &(*link)->next;
+  *link = job->next;
+  pthread_cond_broadcast(&g_file_job_cond);
+  pthread_mutex_unlock(&g_file_job_mutex);
+  
+  file_job_free(job);
+  return NULL;
+}
+
+// Allocate a job writing output_path from the open media
+static FileJob* file_job_create(FileJobType type, const char *output_path,
+                                void (*callback)(void *, int),
+                                OnFrameRangeProgressCallback progress_callback,
+                                void *user_data) {
+  FileJob *job = (FileJob *)calloc(1, sizeof(FileJob));
+  if (!job) return NULL;
+  
+  // Without open media the job fails in its callback, like queued requests
+  job->type = type;
+  job->url = copy_media_url();
+  job->output_path = strdup(output_path);
+  if (!job->output_path) {
+    file_job_free(job);
+    return NULL;
+  }
+  job->callback = callback;
+  job->progress_callback = progress_callback;
+  job->user_data = user_data;
+  return job;
+}
+
+// Start job on a thread of its own. Returns its id, -1 on failure, which
+// frees it.
+static RequestId file_job_start(FileJob *job) {
+  pthread_mutex_lock(&g_task_queue.mutex);
+  RequestId id = g_task_queue.next_request_id++;
+  pthread_mutex_unlock(&g_task_queue.mutex);
+  job->id = id;
+  
+  // Linked before the thread starts, which unlinks it under the same lock
+  pthread_mutex_lock(&g_file_job_mutex);
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, file_job_thread, job) != 0) {
+    pthread_mutex_unlock(&g_file_job_mutex);
+    file_job_free(job);
+    return -1;
+  }
+  pthread_detach(thread);
+  job->next = g_file_jobs;
+  g_file_jobs = job;
+  pthread_mutex_unlock(&g_file_job_mutex);
+  
+  return id;
+}
+
+// Run task on a thread of its own rather than the queue. Returns its id,
+// -1 on failure, which frees it.
+static RequestId file_job_start_task(AsyncTask *task) {
+  FileJob *job = (FileJob *)calloc(1, sizeof(FileJob));
+  if (!job) {
+    free(task);
+    return -1;
+  }
+  
+  job->type = FILE_JOB_TASK;
+  job->task = task;
+  return file_job_start(job);
+}
+
+static void file_job_cancel(FileJob *job) {
+  job->cancelled = true;
+  if (job->task) job->task->cancelled = true;
+}
+
 // --- Public API Implementation ---
 
 void ffmpeg_init(void) {
   avformat_network_init();
   pthread_mutex_init(&g_state.mutex, NULL);
+  pthread_cond_init(&g_state.pool_idle, NULL);
+  
+  // Pick the pixel conversion kernels for this CPU once
+  convert_init();
+  g_state.tone_map = tonemap_alloc();
+  g_state.tone_mapping_enabled = 1;
+  g_state.convert = convert_alloc();
+  g_state.frame_cache = frame_cache_alloc();
   
   task_queue_init();
   
   g_state.video_stream_idx = -1;
   g_state.audio_stream_idx = -1;
+  g_state.decode_position_ms = INT64_MIN;
   g_state.is_initialized = 1;
   
   // Start worker thread
   pthread_create(&g_task_queue.worker_thread, NULL, worker_thread_func, NULL);
 }
 
-int ffmpeg_open_media(const char *file_path) {
+// Cache key of a sequence. A pattern names no file, so its first and last
+// images and their directory stand in, and re-rendering the sequence in
+// place changes the key.
+static uint64_t sequence_media_key(const char *pattern, const ImageSequence *sequence) {
+  char first[4096];
+  char last[4096];
+  char dir[4096];
+  if (sequence_path(sequence, 0, first, sizeof(first)) < 0 ||
+      sequence_path(sequence, sequence_count(sequence) - 1, last, sizeof(last)) < 0) {
+    return frame_cache_media_key(pattern);
+  }
+  
+  memcpy(dir, first, sizeof(dir));
+  char *slash = strrchr(dir, '/');
+  if (slash) {
+    slash[slash == dir ? 1 : 0] = '\0';
+  } else {
+    strcpy(dir, ".");
+  }
+  
+  const char *paths[3] = { first, last, dir };
+  return frame_cache_files_key(pattern, paths, 3);
+}
+
+// Open file_path as the session's media; as an image sequence at
+// sequence_fps when that is set
+static int open_media(const char *file_path, double sequence_fps) {
   if (!file_path) return -1;
   
   pthread_mutex_lock(&g_state.mutex);
@@ -523,21 +2139,29 @@ int ffmpeg_open_media(const char *file_path) {
   }
   
   // 1. Open Input File
-  if (avformat_open_input(&g_state.fmt_ctx, file_path, NULL, NULL) != 0) {
+  int open_ret = sequence_fps > 0
+      ? sequence_open_input(&g_state.fmt_ctx, file_path, sequence_fps)
+      : avformat_open_input(&g_state.fmt_ctx, file_path, NULL, NULL);
+  if (open_ret != 0) {
     pthread_mutex_unlock(&g_state.mutex);
     return -2;
   }
+  g_state.media_url = strdup(file_path);
+  g_state.media_key = frame_cache_media_key(file_path);
   
   // 2. Get Stream Info
   if (avformat_find_stream_info(g_state.fmt_ctx, NULL) < 0) {
     avformat_close_input(&g_state.fmt_ctx);
     g_state.fmt_ctx = NULL;
+    free(g_state.media_url);
+    g_state.media_url = NULL;
     pthread_mutex_unlock(&g_state.mutex);
     return -2;
   }
   
   g_state.video_stream_idx = -1;
   g_state.audio_stream_idx = -1;
+  g_state.decode_position_ms = INT64_MIN;
   
   // 3. Find Codecs
   for (unsigned int i = 0; i < g_state.fmt_ctx->nb_streams; i++) {
@@ -554,6 +2178,8 @@ int ffmpeg_open_media(const char *file_path) {
       if (!g_state.video_codec_ctx) {
         avformat_close_input(&g_state.fmt_ctx);
         g_state.fmt_ctx = NULL;
+        free(g_state.media_url);
+        g_state.media_url = NULL;
         pthread_mutex_unlock(&g_state.mutex);
         return -3;
       }
@@ -563,6 +2189,12 @@ int ffmpeg_open_media(const char *file_path) {
         g_state.video_stream_idx = -1;
         continue;
       }
+      // Intra-only frames decode alone, so only slice threads speed one up
+      g_state.intra_only = intra_stream_supported(stream);
+      if (g_state.intra_only) {
+        g_state.video_codec_ctx->thread_count = 0;
+        g_state.video_codec_ctx->thread_type = FF_THREAD_SLICE;
+      }
       if (avcodec_open2(g_state.video_codec_ctx, codec, NULL) < 0) {
         avcodec_free_context(&g_state.video_codec_ctx);
         g_state.video_codec_ctx = NULL;
@@ -610,11 +2242,13 @@ int ffmpeg_open_media(const char *file_path) {
           g_state.video_buffer, AV_PIX_FMT_RGBA,
           g_state.video_codec_ctx->width, g_state.video_codec_ctx->height, 1);
       
-      g_state.sws_ctx = sws_getContext(
+      g_state.video_buffer_size = num_bytes;
+      
+      ensure_sws_context(
           g_state.video_codec_ctx->width, g_state.video_codec_ctx->height,
           g_state.video_codec_ctx->pix_fmt, g_state.video_codec_ctx->width,
-          g_state.video_codec_ctx->height, AV_PIX_FMT_RGBA, SWS_BILINEAR,
-          NULL, NULL, NULL);
+          g_state.video_codec_ctx->height);
+      read_display_matrix(stream);
       
       if (!g_state.sws_ctx) {
         av_free(g_state.video_buffer);
@@ -632,6 +2266,8 @@ int ffmpeg_open_media(const char *file_path) {
       if (!g_state.audio_codec_ctx) {
         avformat_close_input(&g_state.fmt_ctx);
         g_state.fmt_ctx = NULL;
+        free(g_state.media_url);
+        g_state.media_url = NULL;
         pthread_mutex_unlock(&g_state.mutex);
         return -3;
       }
@@ -720,10 +2356,33 @@ int ffmpeg_open_media(const char *file_path) {
     return -3;
   }
   
+  // 5. List the images of a sequence, so frames map to their files
+  if (sequence_fps > 0) {
+    int ret = g_state.video_codec_ctx ? sequence_open(file_path, &g_state.sequence) : -1;
+    if (ret < 0) {
+      pthread_mutex_unlock(&g_state.mutex);
+      ffmpeg_stop();
+      return ret == -3 ? -3 : -2;
+    }
+    g_state.media_key = sequence_media_key(file_path, g_state.sequence);
+  }
+  
   pthread_mutex_unlock(&g_state.mutex);
   return 0;
 }
 
+int ffmpeg_open_media(const char *file_path) {
+  return open_media(file_path, 0.0);
+}
+
+int ffmpeg_open_image_sequence(const char *pattern, double fps) {
+  if (!pattern || fps <= 0) return -1;
+  
+  // Background jobs open the pattern again by url
+  sequence_register_rate(pattern, fps);
+  return open_media(pattern, fps);
+}
+
 MediaInfo ffmpeg_get_media_info(void) {
   MediaInfo info = {0};
   info.duration_ms = -1;
@@ -735,6 +2394,7 @@ MediaInfo ffmpeg_get_media_info(void) {
     if (g_state.video_codec_ctx) {
       info.width = g_state.video_codec_ctx->width;
       info.height = g_state.video_codec_ctx->height;
+      info.rotation = g_state.display_rotation;
       
       double fps = 0.0;
       if (g_state.fmt_ctx->streams[g_state.video_stream_idx]->avg_frame_rate.den != 0) {
@@ -760,6 +2420,7 @@ MediaInfo ffmpeg_get_media_info(void) {
 
 void ffmpeg_stop(void) {
   pthread_mutex_lock(&g_state.mutex);
+  wait_for_pool();
   
   // Cleanup Resources
   if (g_state.video_codec_ctx) {
@@ -777,6 +2438,11 @@ void ffmpeg_stop(void) {
     g_state.sws_ctx = NULL;
   }
   
+  if (g_state.gray_sws_ctx) {
+    sws_freeContext(g_state.gray_sws_ctx);
+    g_state.gray_sws_ctx = NULL;
+  }
+  
   if (g_state.swr_ctx) {
     swr_free(&g_state.swr_ctx);
     g_state.swr_ctx = NULL;
@@ -796,6 +2462,7 @@ void ffmpeg_stop(void) {
     av_free(g_state.video_buffer);
     g_state.video_buffer = NULL;
   }
+  g_state.video_buffer_size = 0;
   
   if (g_state.audio_frame) {
     av_frame_free(&g_state.audio_frame);
@@ -819,16 +2486,83 @@ void ffmpeg_stop(void) {
     avformat_close_input(&g_state.fmt_ctx);
     g_state.fmt_ctx = NULL;
   }
-  
-  g_state.video_stream_idx = -1;
-  g_state.audio_stream_idx = -1;
-  
+  
+  g_state.video_stream_idx = -1;
+  g_state.audio_stream_idx = -1;
+  g_state.decode_position_ms = INT64_MIN;
+  g_state.display_rotation = 0;
+  g_state.display_flip = 0;
+  free(g_state.media_url);
+  g_state.media_url = NULL;
+  proxy_source_close(&g_state.proxy);
+  intra_pool_close(&g_state.intra_pool);
+  g_state.intra_only = 0;
+  g_state.intra_pool_failed = 0;
+  sequence_pool_close(&g_state.sequence_pool);
+  sequence_close(&g_state.sequence);
+  g_state.sequence_pool_failed = 0;
+  for (int i = 0; i < g_state.ahead_count; i++) av_frame_unref(g_state.ahead_frames[i]);
+  g_state.ahead_count = 0;
+  image_encoder_free(&g_state.image_encoder);
+  av_frame_free(&g_state.previous_video_frame);
+  
+  pthread_mutex_unlock(&g_state.mutex);
+  
+  pthread_mutex_lock(&g_display_mutex);
+  ffmpeg_free_video_frame(g_display_frame);
+  g_display_frame = NULL;
+  pthread_mutex_unlock(&g_display_mutex);
+}
+
+void ffmpeg_set_hdr_tone_mapping(int enabled) {
+  pthread_mutex_lock(&g_state.mutex);
+  g_state.tone_mapping_enabled = enabled ? 1 : 0;
+  pthread_mutex_unlock(&g_state.mutex);
+}
+
+void ffmpeg_set_video_output_options(const VideoOutputOptions *options) {
+  pthread_mutex_lock(&g_output_options_mutex);
+  if (options) {
+    g_output_options = *options;
+  } else {
+    memset(&g_output_options, 0, sizeof(g_output_options));
+  }
+  pthread_mutex_unlock(&g_output_options_mutex);
+}
+
+void ffmpeg_set_frame_cache_size(size_t max_bytes) {
+  pthread_mutex_lock(&g_state.mutex);
+  frame_cache_set_budget(g_state.frame_cache, max_bytes);
+  pthread_mutex_unlock(&g_state.mutex);
+}
+
+void ffmpeg_set_compressed_frame_cache_size(size_t max_bytes) {
+  pthread_mutex_lock(&g_state.mutex);
+  frame_cache_set_packed_budget(g_state.frame_cache, max_bytes);
+  pthread_mutex_unlock(&g_state.mutex);
+}
+
+int ffmpeg_set_frame_spill_file(const char *path, size_t max_bytes, int persistent) {
+  pthread_mutex_lock(&g_state.mutex);
+  // Close the old file first: reopening the same path may truncate it
+  frame_cache_set_spill(g_state.frame_cache, NULL);
+  FrameSpill *spill = NULL;
+  int ret = 0;
+  if (path && max_bytes > 0) {
+    ret = frame_spill_open(path, max_bytes, persistent != 0, &spill);
+    if (ret == 0) frame_cache_set_spill(g_state.frame_cache, spill);
+  }
   pthread_mutex_unlock(&g_state.mutex);
+  return ret;
 }
 
 void ffmpeg_free_video_frame(VideoFrame *frame) {
   if (frame) {
-    if (frame->data) free(frame->data);
+    if (frame->source_frame) {
+      av_frame_free(&frame->source_frame);
+    } else if (frame->data) {
+      free(frame->data);
+    }
     free(frame);
   }
 }
@@ -846,14 +2580,13 @@ RequestId ffmpeg_get_video_frame_at_timestamp_async(
     OnVideoFrameCallback callback,
     void *user_data) {
   
-  AsyncTask *task = (AsyncTask *)malloc(sizeof(AsyncTask));
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
   if (!task) return -1;
   
   task->type = TASK_VIDEO_AT_TIMESTAMP;
+  get_output_options(&task->output_options);
   task->params.single.timestamp_ms = timestamp_ms;
   task->video_callback = callback;
-  task->audio_callback = NULL;
-  task->progress_callback = NULL;
   task->user_data = user_data;
   
   return task_queue_add(task);
@@ -864,14 +2597,13 @@ RequestId ffmpeg_get_video_frame_at_index_async(
     OnVideoFrameCallback callback,
     void *user_data) {
   
-  AsyncTask *task = (AsyncTask *)malloc(sizeof(AsyncTask));
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
   if (!task) return -1;
   
   task->type = TASK_VIDEO_AT_INDEX;
+  get_output_options(&task->output_options);
   task->params.single.frame_index = frame_index;
   task->video_callback = callback;
-  task->audio_callback = NULL;
-  task->progress_callback = NULL;
   task->user_data = user_data;
   
   return task_queue_add(task);
@@ -882,14 +2614,12 @@ RequestId ffmpeg_get_audio_frame_at_timestamp_async(
     OnAudioFrameCallback callback,
     void *user_data) {
   
-  AsyncTask *task = (AsyncTask *)malloc(sizeof(AsyncTask));
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
   if (!task) return -1;
   
   task->type = TASK_AUDIO_AT_TIMESTAMP;
   task->params.single.timestamp_ms = timestamp_ms;
-  task->video_callback = NULL;
   task->audio_callback = callback;
-  task->progress_callback = NULL;
   task->user_data = user_data;
   
   return task_queue_add(task);
@@ -900,14 +2630,12 @@ RequestId ffmpeg_get_audio_frame_at_index_async(
     OnAudioFrameCallback callback,
     void *user_data) {
   
-  AsyncTask *task = (AsyncTask *)malloc(sizeof(AsyncTask));
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
   if (!task) return -1;
   
   task->type = TASK_AUDIO_AT_INDEX;
   task->params.single.frame_index = frame_index;
-  task->video_callback = NULL;
   task->audio_callback = callback;
-  task->progress_callback = NULL;
   task->user_data = user_data;
   
   return task_queue_add(task);
@@ -920,14 +2648,14 @@ RequestId ffmpeg_get_video_frames_range_async(
     OnFrameRangeProgressCallback progress_callback,
     void *user_data) {
   
-  AsyncTask *task = (AsyncTask *)malloc(sizeof(AsyncTask));
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
   if (!task) return -1;
   
   task->type = TASK_VIDEO_RANGE;
+  get_output_options(&task->output_options);
   task->params.range.start_index = start_index;
   task->params.range.end_index = end_index;
   task->video_callback = frame_callback;
-  task->audio_callback = NULL;
   task->progress_callback = progress_callback;
   task->user_data = user_data;
   
@@ -942,6 +2670,9 @@ int ffmpeg_get_video_frames_range_by_index(
   
   if (!out_batch || !g_state.fmt_ctx || g_state.video_stream_idx < 0) return -1;
   
+  VideoOutputOptions options;
+  get_output_options(&options);
+  
   pthread_mutex_lock(&g_state.mutex);
   
   double fps = 0.0;
@@ -954,39 +2685,34 @@ int ffmpeg_get_video_frames_range_by_index(
     return -1;
   }
   
-  int64_t start_ts_ms = (int64_t)((start_index / fps) * 1000.0);
-  
-  if (seek_to_frame_before_ts(start_ts_ms) < 0) {
+  FrameBatch batch;
+  if (frame_batch_begin_index(&batch, start_index, end_index - start_index + 1, fps,
+                              NULL) < 0) {
     pthread_mutex_unlock(&g_state.mutex);
     return -1;
   }
   
   int count = 0;
-  int current_index = start_index;
   
-  while (current_index <= end_index) {
-    int64_t target_ts_ms = (int64_t)((current_index / fps) * 1000.0);
-    
-    VideoFrame *frame = NULL;
-    int result = decode_video_until_ts(target_ts_ms, &frame);
+  while (frame_batch_next(&batch) == 0) {
+    VideoFrame *frame = create_video_frame_copy(&options);
     
-    if (result >= 0 && frame) {
+    if (frame) {
       if (out_batch->video_frames) {
         out_batch->video_frames[count] = frame;
       }
       if (out_batch->result_codes) {
-        out_batch->result_codes[count] = result;
+        out_batch->result_codes[count] = 0;
       }
       count++;
     } else {
       break;
     }
-    
-    current_index++;
   }
   
   out_batch->count = count;
   
+  frame_batch_end(&batch);
   pthread_mutex_unlock(&g_state.mutex);
   return count;
 }
@@ -999,38 +2725,171 @@ int ffmpeg_get_video_frames_range_by_timestamp(
   
   if (!out_batch || !g_state.fmt_ctx || g_state.video_stream_idx < 0) return -1;
   
+  VideoOutputOptions options;
+  get_output_options(&options);
+  
   pthread_mutex_lock(&g_state.mutex);
   
-  if (seek_to_frame_before_ts(start_ms) < 0) {
+  FrameBatch batch;
+  if (frame_batch_begin_ts(&batch, start_ms, step_ms, frame_batch_count(start_ms, end_ms, step_ms),
+                           NULL) < 0) {
     pthread_mutex_unlock(&g_state.mutex);
     return -1;
   }
   
   int count = 0;
-  int64_t current_ts = start_ms;
   
-  while (current_ts <= end_ms) {
-    VideoFrame *frame = NULL;
-    int result = decode_video_until_ts(current_ts, &frame);
+  while (frame_batch_next(&batch) == 0) {
+    VideoFrame *frame = create_video_frame_copy(&options);
     
-    if (result >= 0 && frame) {
+    if (frame) {
       if (out_batch->video_frames) {
         out_batch->video_frames[count] = frame;
       }
       if (out_batch->result_codes) {
-        out_batch->result_codes[count] = result;
+        out_batch->result_codes[count] = 0;
       }
       count++;
     } else {
       break;
     }
-    
-    current_ts += step_ms;
   }
   
   out_batch->count = count;
   
+  frame_batch_end(&batch);
+  pthread_mutex_unlock(&g_state.mutex);
+  return count;
+}
+
+static void init_tensor_writer(const TensorOptions *options, TensorWriter *writer) {
+  int pad = options->pad_value < 0 ? 0 : (options->pad_value > 255 ? 255 : options->pad_value);
+  tensor_writer_init(writer, options->width, options->height,
+                     options->format == TENSOR_FORMAT_FLOAT32_NCHW, options->bgr,
+                     options->mean, options->std, (uint8_t)pad);
+}
+
+size_t ffmpeg_get_tensor_size(const TensorOptions *options) {
+  if (!options || options->width <= 0 || options->height <= 0) return 0;
+  
+  TensorWriter writer;
+  init_tensor_writer(options, &writer);
+  return tensor_writer_frame_size(&writer);
+}
+
+int ffmpeg_get_video_tensors_range_by_index(
+    int start_index,
+    int end_index,
+    const TensorOptions *options,
+    TensorBatch *out_batch) {
+  
+  if (!options || !out_batch || !out_batch->data || !g_state.fmt_ctx ||
+      g_state.video_stream_idx < 0) return -1;
+  
+  size_t tensor_size = ffmpeg_get_tensor_size(options);
+  if (tensor_size == 0) return -1;
+  int capacity = (int)FFMIN(out_batch->data_size / tensor_size, INT32_MAX);
+  
+  TensorWriter writer;
+  init_tensor_writer(options, &writer);
+  
+  VideoOutputOptions output;
+  get_output_options(&output);
+  
+  pthread_mutex_lock(&g_state.mutex);
+  
+  double fps = 0.0;
+  if (g_state.fmt_ctx->streams[g_state.video_stream_idx]->avg_frame_rate.den != 0) {
+    fps = av_q2d(g_state.fmt_ctx->streams[g_state.video_stream_idx]->avg_frame_rate);
+  }
+  
+  if (fps <= 0) {
+    pthread_mutex_unlock(&g_state.mutex);
+    return -1;
+  }
+  
+  FrameBatch batch;
+  if (frame_batch_begin_index(&batch, start_index,
+                              FFMIN(end_index - start_index + 1, capacity), fps, NULL) < 0) {
+    pthread_mutex_unlock(&g_state.mutex);
+    return -1;
+  }
+  
+  uint8_t *scratch = NULL;
+  size_t scratch_size = 0;
+  int count = 0;
+  
+  while (frame_batch_next(&batch) == 0) {
+    void *dst = (uint8_t *)out_batch->data + (size_t)count * tensor_size;
+    if (write_video_tensor(&output, options, &writer, &scratch, &scratch_size,
+                           dst, out_batch) < 0) {
+      break;
+    }
+    if (out_batch->pts_ms) {
+      out_batch->pts_ms[count] = get_video_frame_ts_ms();
+    }
+    count++;
+  }
+  
+  out_batch->count = count;
+  
+  frame_batch_end(&batch);
   pthread_mutex_unlock(&g_state.mutex);
+  free(scratch);
+  return count;
+}
+
+int ffmpeg_get_video_tensors_range_by_timestamp(
+    int64_t start_ms,
+    int64_t end_ms,
+    int64_t step_ms,
+    const TensorOptions *options,
+    TensorBatch *out_batch) {
+  
+  if (!options || !out_batch || !out_batch->data || step_ms <= 0 || !g_state.fmt_ctx ||
+      g_state.video_stream_idx < 0) return -1;
+  
+  size_t tensor_size = ffmpeg_get_tensor_size(options);
+  if (tensor_size == 0) return -1;
+  int capacity = (int)FFMIN(out_batch->data_size / tensor_size, INT32_MAX);
+  
+  TensorWriter writer;
+  init_tensor_writer(options, &writer);
+  
+  VideoOutputOptions output;
+  get_output_options(&output);
+  
+  pthread_mutex_lock(&g_state.mutex);
+  
+  FrameBatch batch;
+  if (frame_batch_begin_ts(&batch, start_ms, step_ms,
+                           FFMIN(frame_batch_count(start_ms, end_ms, step_ms), capacity),
+                           NULL) < 0) {
+    pthread_mutex_unlock(&g_state.mutex);
+    return -1;
+  }
+  
+  uint8_t *scratch = NULL;
+  size_t scratch_size = 0;
+  int count = 0;
+  
+  while (frame_batch_next(&batch) == 0) {
+    void *dst = (uint8_t *)out_batch->data + (size_t)count * tensor_size;
+    if (write_video_tensor(&output, options, &writer, &scratch, &scratch_size,
+                           dst, out_batch) < 0) {
+      break;
+    }
+    if (out_batch->pts_ms) {
+      out_batch->pts_ms[count] = get_video_frame_ts_ms();
+    }
+    count++;
+  }
+  
+  out_batch->count = count;
+  
+  frame_batch_end(&batch);
+  pthread_mutex_unlock(&g_state.mutex);
+  free(scratch);
   return count;
 }
 
@@ -1054,6 +2913,358 @@ void ffmpeg_free_frame_range_batch(FrameRangeBatch *batch) {
   }
 }
 
+// --- Sprite Sheets ---
+
+RequestId ffmpeg_generate_sprite_sheet_async(
+    const SpriteSheetOptions *options,
+    OnSpriteSheetCallback callback,
+    void *user_data) {
+  
+  if (!options) return -1;
+  
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = TASK_SPRITE_SHEET;
+  task->params.sprite = *options;
+  task->sprite_callback = callback;
+  task->user_data = user_data;
+  
+  return file_job_start_task(task);
+}
+
+void ffmpeg_free_sprite_sheet(SpriteSheet *sheet) {
+  sprite_free(sheet);
+}
+
+// --- Scene Detection ---
+
+RequestId ffmpeg_detect_scenes_async(
+    const SceneDetectOptions *options,
+    OnSceneCutsCallback callback,
+    void *user_data) {
+  
+  if (!options) return -1;
+  
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = TASK_SCENE_DETECT;
+  task->params.scene = *options;
+  task->scene_callback = callback;
+  task->user_data = user_data;
+  
+  return file_job_start_task(task);
+}
+
+void ffmpeg_free_scene_cuts(SceneCutList *cuts) {
+  analysis_free_scene_cuts(cuts);
+}
+
+// --- Black and Freeze Detection ---
+
+RequestId ffmpeg_detect_black_freeze_async(
+    const BlackFreezeOptions *options,
+    OnBlackFreezeCallback callback,
+    void *user_data) {
+  
+  if (!options) return -1;
+  
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = TASK_BLACK_FREEZE;
+  task->params.black_freeze = *options;
+  task->black_freeze_callback = callback;
+  task->user_data = user_data;
+  
+  return file_job_start_task(task);
+}
+
+void ffmpeg_free_black_freeze(BlackFreezeResult *result) {
+  analysis_free_black_freeze(result);
+}
+
+// --- Motion Vectors ---
+
+RequestId ffmpeg_get_motion_vectors_async(
+    const MotionVectorOptions *options,
+    OnMotionVectorsCallback callback,
+    void *user_data) {
+  
+  if (!options) return -1;
+  
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = TASK_MOTION_VECTORS;
+  task->params.motion = *options;
+  task->motion_callback = callback;
+  task->user_data = user_data;
+  
+  return file_job_start_task(task);
+}
+
+void ffmpeg_free_motion_vectors(MotionVectorTrack *track) {
+  analysis_free_motion_vectors(track);
+}
+
+// --- Packet Statistics ---
+
+RequestId ffmpeg_get_packet_stats_async(
+    const PacketStatsOptions *options,
+    OnPacketStatsCallback callback,
+    OnFrameRangeProgressCallback progress_callback,
+    void *user_data) {
+  
+  if (!options) return -1;
+  
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = TASK_PACKET_STATS;
+  task->params.packet_stats = *options;
+  task->progress_callback = progress_callback;
+  task->packet_stats_callback = callback;
+  task->user_data = user_data;
+  
+  return file_job_start_task(task);
+}
+
+void ffmpeg_free_packet_stats(PacketStats *stats) {
+  analysis_free_packet_stats(stats);
+}
+
+// --- Encoded Frames ---
+
+static RequestId add_encoded_frame_task(TaskType type, int64_t timestamp_ms, int frame_index,
+                                        int image_format, int quality,
+                                        OnEncodedFrameCallback callback, void *user_data) {
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = type;
+  get_output_options(&task->output_options);
+  task->params.encode.timestamp_ms = timestamp_ms;
+  task->params.encode.frame_index = frame_index;
+  task->params.encode.image_format = image_format;
+  task->params.encode.quality = quality;
+  task->encoded_callback = callback;
+  task->user_data = user_data;
+  
+  return task_queue_add(task);
+}
+
+RequestId ffmpeg_get_encoded_frame_at_timestamp_async(
+    int64_t timestamp_ms,
+    int image_format,
+    int quality,
+    OnEncodedFrameCallback callback,
+    void *user_data) {
+  return add_encoded_frame_task(TASK_ENCODED_AT_TIMESTAMP, timestamp_ms, 0,
+                                image_format, quality, callback, user_data);
+}
+
+RequestId ffmpeg_get_encoded_frame_at_index_async(
+    int frame_index,
+    int image_format,
+    int quality,
+    OnEncodedFrameCallback callback,
+    void *user_data) {
+  return add_encoded_frame_task(TASK_ENCODED_AT_INDEX, 0, frame_index,
+                                image_format, quality, callback, user_data);
+}
+
+void ffmpeg_free_encoded_frame(EncodedFrame *frame) {
+  if (!frame) return;
+  free(frame->data);
+  free(frame);
+}
+
+// --- Frame Handles ---
+
+static RequestId add_frame_handle_task(TaskType type, int64_t timestamp_ms, int frame_index,
+                                       OnFrameHandleCallback callback, void *user_data) {
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = type;
+  get_output_options(&task->output_options);
+  task->params.single.timestamp_ms = timestamp_ms;
+  task->params.single.frame_index = frame_index;
+  task->handle_callback = callback;
+  task->user_data = user_data;
+  
+  return task_queue_add(task);
+}
+
+RequestId ffmpeg_get_frame_handle_at_timestamp_async(
+    int64_t timestamp_ms,
+    OnFrameHandleCallback callback,
+    void *user_data) {
+  return add_frame_handle_task(TASK_HANDLE_AT_TIMESTAMP, timestamp_ms, 0, callback, user_data);
+}
+
+RequestId ffmpeg_get_frame_handle_at_index_async(
+    int frame_index,
+    OnFrameHandleCallback callback,
+    void *user_data) {
+  return add_frame_handle_task(TASK_HANDLE_AT_INDEX, 0, frame_index, callback, user_data);
+}
+
+void ffmpeg_frame_release(FrameHandle *handle) {
+  if (!handle) return;
+  av_frame_free(&handle->frame);
+  free(handle);
+}
+
+// --- Display Output ---
+
+RequestId ffmpeg_present_video_frame_at_timestamp_async(int64_t timestamp_ms) {
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = TASK_PRESENT_AT_TIMESTAMP;
+  get_output_options(&task->output_options);
+  task->params.single.timestamp_ms = timestamp_ms;
+  
+  return task_queue_add(task);
+}
+
+void ffmpeg_set_display_listener(OnDisplayFrameCallback listener, void *user_data) {
+  pthread_mutex_lock(&g_display_mutex);
+  g_display_listener = listener;
+  g_display_listener_data = user_data;
+  pthread_mutex_unlock(&g_display_mutex);
+}
+
+int ffmpeg_copy_display_frame(uint8_t **buffer, size_t *capacity, int *width, int *height) {
+  int result = -1;
+  
+  pthread_mutex_lock(&g_display_mutex);
+  const VideoFrame *frame = g_display_frame;
+  if (frame) {
+    size_t row_size = (size_t)frame->width * 4;
+    size_t size = row_size * frame->height;
+    if (size > *capacity) {
+      uint8_t *grown = (uint8_t *)realloc(*buffer, size);
+      if (grown) {
+        *buffer = grown;
+        *capacity = size;
+      }
+    }
+    if (size <= *capacity) {
+      for (int y = 0; y < frame->height; y++) {
+        memcpy(*buffer + y * row_size, frame->data + (size_t)y * frame->linesize, row_size);
+      }
+      *width = frame->width;
+      *height = frame->height;
+      result = 0;
+    }
+  }
+  pthread_mutex_unlock(&g_display_mutex);
+  
+  return result;
+}
+
+// --- Shared Memory Ring ---
+
+static void swap_shm_ring(ShmRing *ring) {
+  pthread_mutex_lock(&g_shm_mutex);
+  ShmRing *previous = g_shm_ring;
+  g_shm_ring = ring;
+  // A stream may be parked waiting for its reader; this sends it home
+  shm_ring_wake(previous);
+  pthread_mutex_unlock(&g_shm_mutex);
+  
+  if (previous) {
+    pthread_mutex_lock(&g_shm_write_mutex);
+    shm_ring_destroy(&previous);
+    pthread_mutex_unlock(&g_shm_write_mutex);
+  }
+}
+
+int ffmpeg_shm_sink_open(const char *name, int slot_count, size_t slot_capacity, int blocking) {
+  // Close first: reusing the name would otherwise truncate the object the
+  // old ring still maps, and unlinking the old ring would remove the new one
+  swap_shm_ring(NULL);
+  
+  ShmRing *ring = NULL;
+  int result = shm_ring_create(name, slot_count, slot_capacity, blocking, &ring);
+  if (result < 0) return result;
+  
+  swap_shm_ring(ring);
+  return 0;
+}
+
+void ffmpeg_shm_sink_close(void) {
+  swap_shm_ring(NULL);
+}
+
+RequestId ffmpeg_stream_to_shm_async(
+    int64_t start_ms,
+    int64_t end_ms,
+    OnShmStreamCallback callback,
+    void *user_data) {
+  
+  AsyncTask *task = (AsyncTask *)calloc(1, sizeof(AsyncTask));
+  if (!task) return -1;
+  
+  task->type = TASK_SHM_STREAM;
+  get_output_options(&task->output_options);
+  task->params.shm.start_ms = start_ms;
+  task->params.shm.end_ms = end_ms;
+  task->shm_callback = callback;
+  task->user_data = user_data;
+  
+  return file_job_start_task(task);
+}
+
+// --- Proxies ---
+
+RequestId ffmpeg_generate_proxy_async(
+    const char *output_path,
+    const ProxyOptions *options,
+    OnProxyCallback callback,
+    OnFrameRangeProgressCallback progress_callback,
+    void *user_data) {
+  
+  if (!output_path || !options) return -1;
+  
+  FileJob *job = file_job_create(FILE_JOB_PROXY, output_path, callback, progress_callback,
+                                 user_data);
+  if (!job) return -1;
+  job->proxy_options = *options;
+  return file_job_start(job);
+}
+
+RequestId ffmpeg_export_range_async(
+    int64_t start_ms,
+    int64_t end_ms,
+    const char *output_path,
+    const ExportOptions *options,
+    OnExportCallback callback,
+    OnFrameRangeProgressCallback progress_callback,
+    void *user_data) {
+  
+  if (!output_path || !options) return -1;
+  
+  FileJob *job = file_job_create(FILE_JOB_EXPORT, output_path, callback, progress_callback,
+                                 user_data);
+  if (!job) return -1;
+  job->export_options = *options;
+  job->start_ms = start_ms;
+  job->end_ms = end_ms;
+  return file_job_start(job);
+}
+
+int ffmpeg_attach_proxy(const char *path) {
+  pthread_mutex_lock(&g_state.mutex);
+  int ret = attach_proxy_locked(path);
+  pthread_mutex_unlock(&g_state.mutex);
+  return ret;
+}
+
 void ffmpeg_cancel_request(RequestId request_id) {
   pthread_mutex_lock(&g_task_queue.mutex);
   
@@ -1067,11 +3278,26 @@ void ffmpeg_cancel_request(RequestId request_id) {
   }
   
   pthread_mutex_unlock(&g_task_queue.mutex);
+  
+  pthread_mutex_lock(&g_file_job_mutex);
+  for (FileJob *job = g_file_jobs; job; job = job->next) {
+    if (job->id == request_id) file_job_cancel(job);
+  }
+  pthread_mutex_unlock(&g_file_job_mutex);
 }
 
 void ffmpeg_release(void) {
   ffmpeg_stop();
   
+  // Wakes a stream blocked on its reader, which the wait below would hang on
+  ffmpeg_shm_sink_close();
+  
+  // File jobs stop at their next frame or packet; wait for them to leave
+  pthread_mutex_lock(&g_file_job_mutex);
+  for (FileJob *job = g_file_jobs; job; job = job->next) file_job_cancel(job);
+  while (g_file_jobs) pthread_cond_wait(&g_file_job_cond, &g_file_job_mutex);
+  pthread_mutex_unlock(&g_file_job_mutex);
+  
   // Stop worker thread
   pthread_mutex_lock(&g_task_queue.mutex);
   g_task_queue.should_exit = true;
@@ -1081,7 +3307,12 @@ void ffmpeg_release(void) {
   pthread_join(g_task_queue.worker_thread, NULL);
   
   task_queue_destroy();
+  free_ahead_frames();
+  tonemap_free(&g_state.tone_map);
+  convert_free(&g_state.convert);
+  frame_cache_free(&g_state.frame_cache);
   avformat_network_deinit();
+  pthread_cond_destroy(&g_state.pool_idle);
   pthread_mutex_destroy(&g_state.mutex);
   
   g_state.is_initialized = 0;
@@ -21,6 +21,12 @@ extern "C" {
 
 // Forward declarations
 typedef struct VideoFrame VideoFrame;
+struct ToneMapContext;
+struct ConvertContext;
+struct ImageEncoder;
+struct FrameCache;
+struct ProxySource;
+struct IntraPool;
 typedef struct AudioFrame AudioFrame;
 
 // Callback types for async operations
@@ -41,10 +47,82 @@ typedef struct {
   AVFrame *audio_frame_converted;
   AVPacket *work_packet;
   uint8_t *video_buffer;
+  int video_buffer_size;
   int video_stream_idx;
   int audio_stream_idx;
   int is_initialized;
   
+  // Geometry sws_ctx was created for
+  int sws_src_width;
+  int sws_src_height;
+  enum AVPixelFormat sws_src_format;
+  int sws_dst_width;
+  int sws_dst_height;
+  
+  // Colorspace currently applied to sws_ctx
+  enum AVColorSpace sws_colorspace;
+  int sws_full_range;
+  
+  // HDR -> SDR conversion for 10-bit sources
+  struct ToneMapContext *tone_map;
+  int tone_mapping_enabled;
+  
+  // Scratch for rotated/flipped output
+  struct ConvertContext *convert;
+  
+  // Display matrix of the video stream: clockwise rotation in degrees,
+  // applied after a horizontal flip when display_flip is set
+  int display_rotation;
+  int display_flip;
+  
+  // Path of the open media, for jobs that open their own readers
+  char *media_url;
+  
+  // Decoded frames kept across requests and media, and the key of the open
+  // media in it
+  struct FrameCache *frame_cache;
+  uint64_t media_key;
+  
+  // Timestamp of the last frame out of the video decoder, INT64_MIN when
+  // unknown (after a seek, at the end, or before the first decode)
+  int64_t decode_position_ms;
+  
+  // Encoder kept across encoded frame requests of this session
+  struct ImageEncoder *image_encoder;
+  
+  // Reference to the last frame returned with FrameStats, for the
+  // difference to the next one
+  AVFrame *previous_video_frame;
+  
+  // Luma scaler of the GRAY8 output
+  SwsContext *gray_sws_ctx;
+  
+  // Intra-only proxy of the open media, for scrubbing and thumbnails
+  struct ProxySource *proxy;
+  
+  // Set when every video frame decodes on its own and the index finds it;
+  // batches and queued single frame requests then decode in parallel on
+  // the pool, opened on first use
+  int intra_only;
+  struct IntraPool *intra_pool;
+  int intra_pool_failed;
+  
+  // Images of a sequence session. Frames decode straight from their files,
+  // and batches and queued single frame requests on the pool, opened on
+  // first use.
+  struct ImageSequence *sequence;
+  struct SequencePool *sequence_pool;
+  int sequence_pool_failed;
+  
+  // Frames of the single frame requests waiting in the queue, decoded
+  // ahead together on the pool for ahead_targets. The pool runs without
+  // the lock; pool_busy is set meanwhile and pool_idle signalled after.
+  AVFrame **ahead_frames;
+  int64_t *ahead_targets;
+  int ahead_count;
+  int pool_busy;
+  pthread_cond_t pool_idle;
+  
   // Thread safety
   pthread_mutex_t mutex;
 } FFmpegState;
@@ -57,8 +135,82 @@ typedef struct {
   int audio_sample_rate;
   int audio_channels;
   int64_t total_frames;
+  int rotation;  // Clockwise display rotation of the video stream in degrees
 } MediaInfo;
 
+// Orientation of returned video frames
+typedef enum {
+  VIDEO_ROTATION_AUTO = 0,  // Follow the stream's display matrix
+  VIDEO_ROTATION_0 = 1,
+  VIDEO_ROTATION_90 = 2,    // Clockwise
+  VIDEO_ROTATION_180 = 3,
+  VIDEO_ROTATION_270 = 4
+} VideoRotation;
+
+// Pixel layout of VideoFrame.data
+typedef enum {
+  VIDEO_PIXEL_FORMAT_RGBA = 0,
+  VIDEO_PIXEL_FORMAT_GRAY8 = 1   // Luma only, one byte per pixel
+} VideoPixelFormat;
+
+// Options applied while converting decoded video frames.
+// A zeroed struct gives the default output.
+typedef struct {
+  int rotation;         // VideoRotation
+  int flip_horizontal;  // Mirror left/right after rotating
+  int flip_vertical;    // Mirror top/bottom after rotating
+  
+  // Region of interest, in output coordinates (after rotation). Only this
+  // part of the frame is converted. A zero width or height keeps the whole
+  // frame.
+  int crop_x;
+  int crop_y;
+  int crop_width;
+  int crop_height;
+  
+  // Scaled output size, after rotation and crop. Zero keeps the cropped
+  // size; if only one is set the other follows the aspect ratio.
+  int output_width;
+  int output_height;
+  
+  // Half-size levels to return with each frame, e.g. 2 adds 1/2 and 1/4.
+  // Each level is box filtered from the previous one. Levels stop before
+  // a side would drop below 1 pixel.
+  int pyramid_levels;
+  
+  // Fill VideoFrame.stats
+  int frame_stats;
+  
+  // VideoPixelFormat. GRAY8 hands out the decoder's own Y plane when
+  // neither scaling nor rotation is needed, and never converts to RGBA.
+  // Pyramid levels are only produced for RGBA.
+  int pixel_format;
+} VideoOutputOptions;
+
+#define FRAME_STATS_HISTOGRAM_BINS 16
+
+// Luma statistics computed on the decoded Y plane, before any conversion.
+// Values use an 8-bit scale whatever the bit depth.
+typedef struct {
+  int valid;             // 0 when not requested or the frame has no luma plane
+  float mean;            // Mean luma, 0-255
+  float variance;
+  float black_ratio;     // Share of pixels within 10% of the black level
+  float difference;      // Mean absolute luma difference to the previously
+                         // returned frame, -1 if there is none
+  uint32_t histogram[FRAME_STATS_HISTOGRAM_BINS];
+} FrameStats;
+
+// One level of a frame pyramid, stored in VideoFrame.data
+typedef struct {
+  size_t offset;  // Byte offset of the level in VideoFrame.data
+  int width;
+  int height;
+  int linesize;
+} VideoFrameLevel;
+
+#define VIDEO_FRAME_MAX_LEVELS 16
+
 struct VideoFrame {
   uint8_t *data;
   int width;
@@ -66,6 +218,21 @@ struct VideoFrame {
   int linesize;
   int64_t pts_ms;
   int64_t frame_id;
+  
+  // Pyramid levels, 0 when none were requested. Level 0 is the frame
+  // itself, level n is half the size of level n - 1. Levels share the data
+  // allocation and are freed with the frame.
+  int level_count;
+  VideoFrameLevel *levels;
+  
+  // Set when VideoOutputOptions.frame_stats is enabled
+  FrameStats stats;
+  
+  int format;  // VideoPixelFormat
+  
+  // Decoded frame that data points into, NULL when data is a private copy.
+  // Released by ffmpeg_free_video_frame.
+  AVFrame *source_frame;
 };
 
 struct AudioFrame {
@@ -86,6 +253,13 @@ void ffmpeg_init(void);
 // Returns 0 on success, negative error code on failure.
 int ffmpeg_open_media(const char *url);
 
+// Open numbered images as media, one image per frame at fps. pattern is
+// printf style ("shot_%04d.png", from the first of 0..4 up to the first
+// missing number) or a glob ("shot_*.exr", in name order; not on Windows
+// or Android before API 28).
+// Returns 0 on success, negative error code on failure.
+int ffmpeg_open_image_sequence(const char *pattern, double fps);
+
 // Get information about the currently opened media.
 // Returns a MediaInfo struct. Check duration_ms == -1 for validity if needed.
 MediaInfo ffmpeg_get_media_info(void);
@@ -93,6 +267,46 @@ MediaInfo ffmpeg_get_media_info(void);
 // Stop and release per-media resources (but keep core initialized).
 void ffmpeg_stop(void);
 
+// Enable or disable the 10-bit (yuv420p10/p010) conversion stage.
+// When enabled (the default), PQ and HLG sources are tone mapped to SDR and
+// 10-bit SDR sources are converted without swscale. When disabled, 10-bit
+// frames go through swscale as-is.
+void ffmpeg_set_hdr_tone_mapping(int enabled);
+
+// Set the output options for video frame requests made after this call.
+// Queued async requests keep the options that were set when they were made.
+// Pass NULL to restore the defaults. VideoFrame width/height are reported
+// after rotation.
+void ffmpeg_set_video_output_options(const VideoOutputOptions *options);
+
+// Keep up to max_bytes of decoded frames, across media, so requests for a
+// frame decoded earlier (or near one: a seek decodes its whole GOP) skip
+// the seek and decode and only pay for the conversion. Range requests
+// fill the cache but always decode. 0, the default, disables the cache
+// and drops its frames.
+void ffmpeg_set_frame_cache_size(size_t max_bytes);
+
+// Keep up to max_bytes of LZ4 compressed frames behind the frame cache.
+// Frames the cache evicts are compressed instead of dropped; flat UI and
+// screen content typically shrinks 3 to 10 times, camera footage far
+// less. A hit costs a decompression and a copy, still much less than a
+// seek and decode. Compressing costs a few milliseconds per evicted HD
+// frame on the worker. 0, the default, disables it.
+void ffmpeg_set_compressed_frame_cache_size(size_t max_bytes);
+
+// Spill frames leaving the in-memory caches to a file at path (on local
+// storage, ideally NVMe) instead of dropping them. The file is preallocated
+// to hold max_bytes of frames, compressed where that helps, overwriting the
+// oldest once full. Frames are keyed by media (path, size and modification
+// time; first and last image for sequences) and timestamp, so they outlive
+// closing and reopening a clip. With persistent set the file is kept and
+// reused by the next run, and takes no frames of media without that
+// identity, such as URLs; otherwise it is deleted right away and vanishes
+// with the process. Needs the frame
+// cache enabled. A NULL path or 0 max_bytes turns spilling off. Returns 0
+// on success, -1 on failure, -2 where spilling is not supported (Windows).
+int ffmpeg_set_frame_spill_file(const char *path, size_t max_bytes, int persistent);
+
 // Free a VideoFrame allocated by async callbacks.
 void ffmpeg_free_video_frame(VideoFrame *frame);
 
@@ -175,6 +389,568 @@ RequestId ffmpeg_get_video_frames_range_async(
 // Free a batch of frames
 void ffmpeg_free_frame_range_batch(FrameRangeBatch *batch);
 
+// --- Tensor Output ---
+
+// Layout of tensors written by the tensor APIs
+typedef enum {
+  TENSOR_FORMAT_FLOAT32_NCHW = 0,  // Planar float32, normalized with mean/std
+  TENSOR_FORMAT_UINT8_NHWC = 1     // Packed 8-bit channels, not normalized
+} TensorFormat;
+
+typedef struct {
+  int width;        // Tensor width in pixels
+  int height;       // Tensor height in pixels
+  int format;       // TensorFormat
+  int letterbox;    // Keep the aspect ratio and pad instead of stretching
+  int pad_value;    // Pixel value (0-255) of the letterbox padding
+  int bgr;          // Channel order B, G, R instead of R, G, B
+  float mean[3];    // float32 output: (value / 255 - mean) / std, per channel
+  float std[3];     // Zero counts as 1
+} TensorOptions;
+
+// Tensor batch: frames are written back to back into one caller buffer,
+// so N frames form a single NCHW (or NHWC) block.
+typedef struct {
+  void *data;           // Caller allocated tensor buffer
+  size_t data_size;     // Size of data in bytes, bounds the number of frames
+  int64_t *pts_ms;      // Optional per-frame timestamps (caller allocated)
+  int count;            // Number of frames written
+  
+  // Image area inside each tensor, to map results back through the letterbox
+  int content_x;
+  int content_y;
+  int content_width;
+  int content_height;
+} TensorBatch;
+
+// Bytes taken by one tensor with these options.
+size_t ffmpeg_get_tensor_size(const TensorOptions *options);
+
+// Decode a range of video frames by index straight into tensors. Rotation
+// and crop follow the current video output options; the output size comes
+// from the tensor options.
+// Returns number of frames written, or negative error code
+int ffmpeg_get_video_tensors_range_by_index(
+    int start_index,
+    int end_index,
+    const TensorOptions *options,
+    TensorBatch *out_batch);
+
+// Same as above, by timestamp
+// Returns number of frames written, or negative error code
+int ffmpeg_get_video_tensors_range_by_timestamp(
+    int64_t start_ms,
+    int64_t end_ms,
+    int64_t step_ms,
+    const TensorOptions *options,
+    TensorBatch *out_batch);
+
+// --- Sprite Sheets ---
+
+// Encoding applied to a finished sprite sheet
+typedef enum {
+  IMAGE_FORMAT_NONE = 0,  // Raw RGBA atlas only
+  IMAGE_FORMAT_JPEG = 1,
+  IMAGE_FORMAT_PNG = 2,
+  IMAGE_FORMAT_WEBP = 3   // Needs an FFmpeg build with libwebp
+} ImageFormat;
+
+typedef struct {
+  int columns;            // Grid size, columns * rows tiles
+  int rows;
+  int tile_width;         // Tile size in pixels, a zero height follows the
+  int tile_height;        // display aspect ratio of the video
+  int64_t start_ms;       // Time range to sample, tiles are evenly spaced
+  int64_t end_ms;         // <= 0 means the end of the media
+  int keyframe_aligned;   // Snap to the keyframe before each timestamp (much faster)
+  int threads;            // Parallel decoders, 0 = one per CPU core
+  int image_format;       // ImageFormat
+  int quality;            // 1-100 for JPEG and WebP, 0 = default
+} SpriteSheetOptions;
+
+typedef struct {
+  uint8_t *data;          // RGBA atlas, tiles in row-major order
+  int width;
+  int height;
+  int linesize;
+  int columns;
+  int rows;
+  int tile_width;
+  int tile_height;
+  int tile_count;
+  int64_t *tile_pts_ms;   // Timestamp shown by each tile, -1 if it failed to decode
+  uint8_t *image_data;    // Encoded atlas, NULL for IMAGE_FORMAT_NONE
+  size_t image_size;
+} SpriteSheet;
+
+typedef void (*OnSpriteSheetCallback)(void *user_data, SpriteSheet *sheet, int error_code);
+
+// Build a thumbnail sprite sheet of the open media in the background. The
+// job decodes on its own readers, in parallel, so playback and other
+// requests are not blocked by it. Free the sheet with
+// ffmpeg_free_sprite_sheet. The callback runs even when the request is
+// cancelled, with a NULL sheet.
+RequestId ffmpeg_generate_sprite_sheet_async(
+    const SpriteSheetOptions *options,
+    OnSpriteSheetCallback callback,
+    void *user_data);
+
+void ffmpeg_free_sprite_sheet(SpriteSheet *sheet);
+
+// --- Encoded Frames ---
+
+// A video frame compressed in native code
+typedef struct {
+  uint8_t *data;          // Encoded image bytes
+  size_t size;
+  int format;             // ImageFormat
+  int width;
+  int height;
+  int64_t pts_ms;
+  int64_t frame_id;
+} EncodedFrame;
+
+typedef void (*OnEncodedFrameCallback)(void *user_data, EncodedFrame *frame, int error_code);
+
+// Decode a video frame and encode it as JPEG, PNG or WebP on the worker
+// thread. The frame follows the current video output options. quality is
+// 1-100 (0 = default) and ignored by PNG. The encoder is reused across
+// requests until the media is closed. The callback also runs for
+// cancelled requests, with a NULL frame and -6.
+RequestId ffmpeg_get_encoded_frame_at_timestamp_async(
+    int64_t timestamp_ms,
+    int image_format,
+    int quality,
+    OnEncodedFrameCallback callback,
+    void *user_data);
+
+RequestId ffmpeg_get_encoded_frame_at_index_async(
+    int frame_index,
+    int image_format,
+    int quality,
+    OnEncodedFrameCallback callback,
+    void *user_data);
+
+void ffmpeg_free_encoded_frame(EncodedFrame *frame);
+
+// --- Scene Detection ---
+
+typedef struct {
+  float threshold;         // Cut score (0-1) needed for a cut, 0 = default
+  int analysis_width;      // Luma is downscaled to this width, 0 = default (128)
+  int64_t start_ms;        // Time range to analyze
+  int64_t end_ms;          // <= 0 means the end of the media
+  int64_t min_scene_ms;    // Minimum distance between two cuts
+  int threads;             // Parallel decoders, 0 = one per CPU core
+} SceneDetectOptions;
+
+typedef struct {
+  int64_t pts_ms;          // First frame of the new shot
+  float score;             // Combined score compared against the threshold
+  float sad;               // Mean absolute luma difference to the previous frame, 0-1
+  float histogram;         // Luma histogram distance to the previous frame, 0-1
+} SceneCut;
+
+typedef struct {
+  SceneCut *cuts;          // In timestamp order
+  int count;
+  int frames_analyzed;
+} SceneCutList;
+
+typedef void (*OnSceneCutsCallback)(void *user_data, SceneCutList *cuts, int error_code);
+
+// Find shot boundaries in the background. Segments of the range are
+// decoded in parallel on private readers, so playback is not blocked. The
+// callback also runs for cancelled requests, with a NULL list and -6.
+RequestId ffmpeg_detect_scenes_async(
+    const SceneDetectOptions *options,
+    OnSceneCutsCallback callback,
+    void *user_data);
+
+void ffmpeg_free_scene_cuts(SceneCutList *cuts);
+
+// --- Packet Statistics ---
+
+typedef struct {
+  int64_t start_ms;          // Time range to scan
+  int64_t end_ms;            // <= 0 means the end of the media
+  int64_t bitrate_window_ms; // Bucket size of the bitrate curve, 0 = 1000
+  float cut_sensitivity;     // Size over the local median that flags a cut, 0 = default (3)
+} PacketStatsOptions;
+
+typedef struct {
+  int64_t pts_ms;            // Presentation time, -1 if unknown
+  int64_t dts_ms;            // Decode time, -1 if unknown
+  int size;                  // Compressed size in bytes
+  int keyframe;
+  int pict_type;             // AVPictureType from the parser, 0 if unknown
+  float activity;            // Size over the median of neighbouring packets of the same type
+} PacketInfo;
+
+// Per-packet statistics of the video stream in decode order, plus
+// features derived from them. Nothing is decoded.
+typedef struct {
+  PacketInfo *packets;
+  int packet_count;
+  
+  // Bitrate curve, one value per window from start_ms
+  float *bitrate_kbps;
+  int bitrate_count;
+  int64_t bitrate_window_ms;
+  
+  // GOP structure, in packets between keyframes
+  int gop_count;
+  int min_gop_length;
+  int max_gop_length;
+  float average_gop_length;
+  
+  // Likely shot boundaries: size spikes and off-cadence keyframes
+  int64_t *likely_cuts_ms;
+  int likely_cut_count;
+} PacketStats;
+
+typedef void (*OnPacketStatsCallback)(void *user_data, PacketStats *stats, int error_code);
+
+// Scan the video packets of the open media without decoding, at demuxer
+// speed, on a private reader. progress_callback (optional) reports packets
+// read against the stream's frame count, which is 0 when unknown. The
+// callback also runs for cancelled requests, with NULL stats and -6.
+RequestId ffmpeg_get_packet_stats_async(
+    const PacketStatsOptions *options,
+    OnPacketStatsCallback callback,
+    OnFrameRangeProgressCallback progress_callback,
+    void *user_data);
+
+void ffmpeg_free_packet_stats(PacketStats *stats);
+
+// --- Black and Freeze Detection ---
+
+typedef struct {
+  int64_t start_ms;          // Time range to scan
+  int64_t end_ms;            // <= 0 means the end of the media
+  float black_ratio;         // Share of dark pixels for a black frame, 0 = default (0.98)
+  float freeze_difference;   // Largest mean luma difference (0-255) of a frozen frame, 0 = default (0.5)
+  int64_t min_black_ms;      // Shortest reported interval, 0 = default (1000)
+  int64_t min_freeze_ms;     // Shortest reported interval, 0 = default (1000)
+  int threads;               // Parallel decoders, 0 = one per CPU core
+} BlackFreezeOptions;
+
+typedef struct {
+  int64_t start_ms;
+  int64_t end_ms;            // Exclusive
+} TimeInterval;
+
+typedef struct {
+  TimeInterval *black;
+  int black_count;
+  TimeInterval *frozen;
+  int frozen_count;
+  int frames_analyzed;
+} BlackFreezeResult;
+
+typedef void (*OnBlackFreezeCallback)(void *user_data, BlackFreezeResult *result, int error_code);
+
+// Find black and frozen intervals in the background, with the same
+// statistics as FrameStats. Segments are decoded in parallel on private
+// readers. The callback also runs for cancelled requests, with a NULL
+// result and -6.
+RequestId ffmpeg_detect_black_freeze_async(
+    const BlackFreezeOptions *options,
+    OnBlackFreezeCallback callback,
+    void *user_data);
+
+void ffmpeg_free_black_freeze(BlackFreezeResult *result);
+
+// --- Motion Vectors ---
+
+typedef struct {
+  int64_t start_ms;          // Time range to scan
+  int64_t end_ms;            // <= 0 means the end of the media
+  int include_vectors;       // Return every vector, not only the per-frame summary
+  int threads;               // Parallel decoders, 0 = one per CPU core
+} MotionVectorOptions;
+
+// One motion compensated block, from the codec's own vectors
+typedef struct {
+  int16_t x;                 // Block centre in the frame
+  int16_t y;
+  int16_t dx;                // Offset to the reference block, 1/4 pixel
+  int16_t dy;
+  uint8_t width;             // Block size in pixels
+  uint8_t height;
+  int8_t source;             // < 0 past reference, > 0 future reference
+  uint8_t reserved;
+} MotionVector;
+
+typedef struct {
+  int64_t pts_ms;
+  int pict_type;             // AVPictureType
+  int vector_offset;         // First vector in MotionVectorTrack.vectors
+  int vector_count;
+  float mean_magnitude;      // Block area weighted mean length, pixels
+  float max_magnitude;       // Pixels
+} MotionFrame;
+
+typedef struct {
+  MotionFrame *frames;
+  int frame_count;
+  MotionVector *vectors;     // NULL unless include_vectors was set
+  int vector_count;
+  int width;                 // Coded frame size the vectors refer to
+  int height;
+} MotionVectorTrack;
+
+typedef void (*OnMotionVectorsCallback)(void *user_data, MotionVectorTrack *track, int error_code);
+
+// Decode with motion vector export and collect the vectors of each frame
+// in the background. No pixel conversion is done, so this costs about as
+// much as decoding. The callback also runs for cancelled requests, with a
+// NULL track and -6.
+RequestId ffmpeg_get_motion_vectors_async(
+    const MotionVectorOptions *options,
+    OnMotionVectorsCallback callback,
+    void *user_data);
+
+void ffmpeg_free_motion_vectors(MotionVectorTrack *track);
+
+// --- Frame Handles ---
+
+// A reference to a decoded frame, for native consumers that link this
+// library directly. No pixels are copied: the planes are the decoder's own
+// buffers, kept alive until ffmpeg_frame_release. The decoder carries on
+// with fresh buffers from its pool. Output options do not apply.
+typedef struct {
+  const uint8_t *data[4];
+  int linesize[4];
+  int width;
+  int height;
+  int format;             // AVPixelFormat
+  int64_t pts_ms;
+  int64_t frame_id;
+  int key_frame;
+  int color_space;        // AVColorSpace
+  int color_range;        // AVColorRange
+  int color_primaries;    // AVColorPrimaries
+  int color_trc;          // AVColorTransferCharacteristic
+  AVFrame *frame;         // The referenced frame, for FFmpeg aware callers
+} FrameHandle;
+
+typedef void (*OnFrameHandleCallback)(void *user_data, FrameHandle *handle, int error_code);
+
+RequestId ffmpeg_get_frame_handle_at_timestamp_async(
+    int64_t timestamp_ms,
+    OnFrameHandleCallback callback,
+    void *user_data);
+
+RequestId ffmpeg_get_frame_handle_at_index_async(
+    int frame_index,
+    OnFrameHandleCallback callback,
+    void *user_data);
+
+// Drop the reference. The handle must not be used afterwards.
+void ffmpeg_frame_release(FrameHandle *handle);
+
+// --- Display Output ---
+//
+// A single displayed frame for platform textures, which read it straight
+// from native memory on the compositor's thread.
+
+typedef void (*OnDisplayFrameCallback)(void *user_data);
+
+// Decode the frame at timestamp_ms and make it the displayed frame. Output
+// options apply, except that the frame is always RGBA without levels.
+RequestId ffmpeg_present_video_frame_at_timestamp_async(int64_t timestamp_ms);
+
+// Called on the worker thread after each presented frame, with the display
+// frame locked, so it must return quickly and not call
+// ffmpeg_copy_display_frame. NULL removes it, waiting for a call in
+// progress, after which user_data is no longer used.
+void ffmpeg_set_display_listener(OnDisplayFrameCallback listener, void *user_data);
+
+// Copy the displayed frame into *buffer as tightly packed RGBA, growing it
+// with realloc when *capacity is too small. Never waits on a decode.
+// Returns 0 on success, -1 when nothing is displayed or on allocation
+// failure.
+int ffmpeg_copy_display_frame(uint8_t **buffer, size_t *capacity, int *width, int *height);
+
+// --- Shared Memory Ring ---
+//
+// Frames written into a POSIX shared memory object, for consumers in other
+// processes. The object starts with a ShmRingHeader. Slot i starts at
+// header_size + i * slot_stride with a ShmSlotHeader, and its pixels follow
+// slot_header_size bytes later. Frame n goes to slot n % slot_count.
+//
+// Each slot is a seqlock: sequence is odd while the slot is written, so a
+// reader takes the header, reads the pixels and then checks sequence has
+// not moved. write_count is bumped after every published slot and is a
+// futex word on Linux; elsewhere readers poll it. In blocking mode the
+// single reader advances read_count and the writer never laps it.
+//
+// Not available on Windows and Android.
+
+#define SHM_RING_MAGIC 0x4D524646u  // "FFRM"
+#define SHM_RING_VERSION 1
+
+#define SHM_SLOT_END_OF_STREAM 1  // Last slot of a stream, carries no pixels
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t header_size;
+  uint32_t slot_header_size;
+  uint32_t blocking;
+  uint64_t slot_stride;
+  uint64_t slot_capacity;   // Pixel bytes per slot
+  uint32_t write_count;     // Slots published so far
+  uint32_t read_count;      // Slots released by the reader (blocking mode)
+  uint32_t closed;          // Set when the writer goes away
+  uint32_t reserved[3];
+} ShmRingHeader;
+
+typedef struct {
+  uint32_t sequence;
+  uint32_t number;          // write_count before this slot was published
+  uint32_t flags;           // SHM_SLOT_*
+  int32_t width;
+  int32_t height;
+  int32_t linesize;
+  int32_t format;           // VideoPixelFormat
+  int32_t reserved0;
+  int64_t pts_ms;
+  int64_t frame_id;
+  uint64_t size;            // Pixel bytes
+  uint64_t reserved[2];
+} ShmSlotHeader;
+
+// Called once per stream, with the number of frames written.
+// error_code is 0 on success, -3 if a frame did not fit a slot and -6 when
+// cancelled.
+typedef void (*OnShmStreamCallback)(void *user_data, int frames_written, int error_code);
+
+// Create the shared memory object name ("/something") and make it the
+// sink for ffmpeg_stream_to_shm_async. slot_capacity is the pixel bytes a
+// slot holds, e.g. width * height * 4 for RGBA. With blocking set the
+// writer waits for the reader instead of overwriting unread frames.
+// Replaces any open sink. Returns 0 on success, -1 on failure, -2 where
+// shared memory is not supported.
+int ffmpeg_shm_sink_open(const char *name, int slot_count, size_t slot_capacity, int blocking);
+
+// Close and unlink the sink. A running stream stops at its next frame.
+void ffmpeg_shm_sink_close(void);
+
+// Decode every frame from start_ms to end_ms (-1 for the end) straight
+// into the sink's slots, converted per the output options (RGBA or GRAY8,
+// without levels). Ends with a SHM_SLOT_END_OF_STREAM slot. The stream
+// runs on a thread of its own, so a blocked ring holds up neither the
+// request queue nor ffmpeg_cancel_request.
+RequestId ffmpeg_stream_to_shm_async(
+    int64_t start_ms,
+    int64_t end_ms,
+    OnShmStreamCallback callback,
+    void *user_data);
+
+// Consumer side, for a process that links this library.
+typedef struct ShmRingReader ShmRingReader;
+
+typedef struct {
+  const uint8_t *data;      // Points into the shared slot
+  int width;
+  int height;
+  int linesize;
+  int format;               // VideoPixelFormat
+  int64_t pts_ms;
+  int64_t frame_id;
+  size_t size;
+  int end_of_stream;
+  uint32_t dropped;         // Frames overwritten before they could be read
+} ShmFrameView;
+
+ShmRingReader *ffmpeg_shm_reader_open(const char *name);
+void ffmpeg_shm_reader_close(ShmRingReader *reader);
+
+// Wait up to timeout_ms (-1 for no limit) for the next frame.
+// Returns 0 with view filled, 1 on timeout, -1 once the writer has closed.
+int ffmpeg_shm_reader_acquire(ShmRingReader *reader, int timeout_ms, ShmFrameView *view);
+
+// Done with the acquired frame. Returns 0 if it stayed intact, -1 if the
+// writer overwrote it meanwhile, in which case what was read is torn.
+int ffmpeg_shm_reader_release(ShmRingReader *reader);
+
+// --- Proxies ---
+//
+// A low resolution, all-intra copy of the open media. Seeking in it costs
+// one decode instead of up to a GOP, so once attached, presented frames
+// and sprite sheets come from it while every other request still decodes
+// the original.
+
+typedef struct {
+  int height;   // Proxy height in lines, 0 = 360; never larger than the source
+  int quality;  // 1-100 JPEG quality, 0 = 60
+} ProxyOptions;
+
+// Called once per job. error_code is 0 on success, -2 if the media could
+// not be opened, -4 if decoding, encoding or writing failed, -5 without an
+// MJPEG encoder and -6 when cancelled.
+typedef void (*OnProxyCallback)(void *user_data, int error_code);
+
+// Transcode the open media into an MJPEG proxy at output_path on a thread
+// of its own, so the request queue keeps going meanwhile. The container
+// follows the extension (.mkv, .mov, ...), Matroska when unknown.
+// progress_callback (optional) reports milliseconds done against the
+// duration. On success the proxy is attached if the same media is still
+// open. Cancel with ffmpeg_cancel_request.
+RequestId ffmpeg_generate_proxy_async(
+    const char *output_path,
+    const ProxyOptions *options,
+    OnProxyCallback callback,
+    OnFrameRangeProgressCallback progress_callback,
+    void *user_data);
+
+// Serve presented frames and sprite sheets of the open media from the
+// proxy at path; NULL detaches. Closing the media detaches it too.
+// Returns 0 on success, -1 if no media is open, -2 if the proxy could
+// not be opened.
+int ffmpeg_attach_proxy(const char *path);
+
+// --- Export ---
+//
+// Sub-clips of the open media, stream-copied without re-encoding. Reading
+// and writing packets is all there is to it, so it runs at disk speed.
+// A smart render re-encodes just the partial GOPs at the cuts.
+
+typedef struct {
+  // Trim to start_ms exactly with an edit list, in containers that have
+  // one (MP4, MOV). Otherwise the export starts at the keyframe at or
+  // before start_ms.
+  int exact;
+  // Frame-accurate cuts in any container: the frames from start_ms to the
+  // next keyframe, and from the last keyframe to end_ms, are re-encoded
+  // like the source and the GOPs in between copied. H.264, HEVC and
+  // codecs without extradata only. Takes precedence over exact.
+  int smart;
+} ExportOptions;
+
+// Called once per job. error_code is 0 on success, -1 for an invalid
+// range, -2 if the media could not be opened, -4 if reading or writing
+// failed, -5 if the container cannot hold the video codec, or a smart
+// render cannot re-encode it, and -6 when cancelled.
+typedef void (*OnExportCallback)(void *user_data, int error_code);
+
+// Copy start_ms .. end_ms of the open media into output_path on a thread
+// of its own, with every video, audio and subtitle stream the container
+// can hold. The container follows the extension, Matroska when unknown.
+// progress_callback (optional) reports milliseconds done against the
+// range. Cancel with ffmpeg_cancel_request.
+RequestId ffmpeg_export_range_async(
+    int64_t start_ms,
+    int64_t end_ms,
+    const char *output_path,
+    const ExportOptions *options,
+    OnExportCallback callback,
+    OnFrameRangeProgressCallback progress_callback,
+    void *user_data);
+
 // Cancel an async request (best effort)
 void ffmpeg_cancel_request(RequestId request_id);
 
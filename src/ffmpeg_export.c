@@ -0,0 +1,869 @@
+#include "ffmpeg_export.h"
+#include "ffmpeg_reader.h"
+
+#include <libavformat/avformat.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXPORT_PROGRESS_INTERVAL 200  // Video packets between progress reports
+#define EXPORT_INTERLEAVE_MS 10000    // Read past the end for streams muxed late
+
+typedef enum {
+  EXPORT_VIDEO_COPY,
+  EXPORT_VIDEO_ENCODE,
+  EXPORT_VIDEO_DONE
+} ExportVideoPhase;
+
+// Where a smart render copies and where it re-encodes, as timestamps in
+// the video time base. Re-encoded frames get dts = pts - shift, which puts
+// them in the decode order slots of the source frames they replace.
+typedef struct {
+  int64_t start;
+  int64_t end;
+  int64_t first;        // Keyframe at or before start
+  int64_t copy_from;    // First keyframe at or after start, AV_NOPTS_VALUE to re-encode it all
+  int64_t head_shift;   // pts - dts of copy_from, of first when re-encoding it all
+  int64_t tail_key;     // Keyframe the re-encoded tail starts at, AV_NOPTS_VALUE if none
+  int64_t tail_start;   // First frame shown of the tail, ahead of tail_key in an open GOP
+  int64_t tail_shift;   // tail_start - dts of tail_key
+  int64_t decode_from;  // Keyframe decoding starts at for the tail
+} ExportPlan;
+
+// Source demuxer and output muxer of one export. Input stream i goes to
+// output stream map[i], or nowhere when -1.
+typedef struct {
+  MediaReader reader;
+  AVFormatContext *out_ctx;
+  int *map;
+  int file_opened;
+
+  // Smart render. While decoding, video packets also go to the reader's
+  // decoder, whose frames in [segment_start, segment_end) are re-encoded.
+  const ExportPlan *plan;
+  ExportVideoPhase phase;
+  int decoding;
+  int keep_decoding;          // decode_from was read, the tail needs the frames
+  int segment_open;
+  int segment_complete;       // A frame at or past segment_end was decoded
+  int segment_past_end;       // A keyframe at or past segment_end was read
+  int64_t segment_start;
+  int64_t segment_end;
+  int64_t segment_shift;
+  int segment_frames;
+  AVCodecContext *enc_ctx;
+  AVPacket *enc_packet;
+  AVPacket **held;            // Copied packets that follow the open segment
+  int held_count;
+  int held_capacity;
+  int nal_length_size;        // Of the source packets, 0 for Annex B
+  uint8_t *parameter_sets;    // Source parameter sets, in the packets' form
+  int parameter_sets_size;
+  int resend_parameter_sets;
+} ExportWriter;
+
+// Keep stream side data, the display matrix above all. Newer versions copy
+// it along with the codec parameters.
+static int export_copy_side_data(const AVStream *src, AVStream *dst) {
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(60, 29, 100)
+  for (int i = 0; i < src->nb_side_data; i++) {
+    const AVPacketSideData *sd = &src->side_data[i];
+    uint8_t *copy = av_stream_new_side_data(dst, sd->type, sd->size);
+    if (!copy) return -1;
+    memcpy(copy, sd->data, sd->size);
+  }
+#else
+  (void)src;
+  (void)dst;
+#endif
+  return 0;
+}
+
+static int export_add_streams(ExportWriter *writer) {
+  AVFormatContext *in_ctx = writer->reader.fmt_ctx;
+  writer->map = (int *)malloc(in_ctx->nb_streams * sizeof(int));
+  if (!writer->map) return -3;
+
+  for (unsigned int i = 0; i < in_ctx->nb_streams; i++) {
+    const AVStream *src = in_ctx->streams[i];
+    enum AVMediaType type = src->codecpar->codec_type;
+    writer->map[i] = -1;
+
+    if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO &&
+        type != AVMEDIA_TYPE_SUBTITLE) {
+      continue;
+    }
+    if (src->disposition & AV_DISPOSITION_ATTACHED_PIC) continue;
+    // Other streams the container cannot hold are left out
+    if (avformat_query_codec(writer->out_ctx->oformat, src->codecpar->codec_id,
+                             FF_COMPLIANCE_NORMAL) == 0) {
+      if ((int)i == writer->reader.stream_idx) return -5;
+      continue;
+    }
+
+    AVStream *dst = avformat_new_stream(writer->out_ctx, NULL);
+    if (!dst) return -3;
+    if (avcodec_parameters_copy(dst->codecpar, src->codecpar) < 0) return -3;
+    // The tag of one container may mean nothing in another
+    dst->codecpar->codec_tag = 0;
+    dst->time_base = src->time_base;
+    dst->sample_aspect_ratio = src->sample_aspect_ratio;
+    dst->avg_frame_rate = src->avg_frame_rate;
+    dst->disposition = src->disposition;
+    if (av_dict_copy(&dst->metadata, src->metadata, 0) < 0) return -3;
+    if (export_copy_side_data(src, dst) < 0) return -3;
+    writer->map[i] = dst->index;
+  }
+  return 0;
+}
+
+// Length of the NAL size fields of avcC/hvcC extradata, 0 for Annex B
+static int export_nal_length_size(const AVCodecParameters *par) {
+  if (!par->extradata || par->extradata_size < 7 || par->extradata[0] != 1) return 0;
+  if (par->codec_id == AV_CODEC_ID_H264) return (par->extradata[4] & 3) + 1;
+  if (par->codec_id == AV_CODEC_ID_HEVC && par->extradata_size >= 23) {
+    return (par->extradata[21] & 3) + 1;
+  }
+  return 0;
+}
+
+static void export_put_nal(uint8_t *dst, const uint8_t *nal, int size, int length_size) {
+  for (int i = 0; i < length_size; i++) {
+    dst[i] = (uint8_t)(size >> (8 * (length_size - 1 - i)));
+  }
+  memcpy(dst + length_size, nal, size);
+}
+
+// Read the NAL units of count entries of 16-bit length + data at *p
+static int export_read_nal_array(ExportWriter *writer, const uint8_t **p, const uint8_t *end,
+                                 int count) {
+  for (int i = 0; i < count; i++) {
+    if (end - *p < 2) return -1;
+    int size = ((*p)[0] << 8) | (*p)[1];
+    *p += 2;
+    if (end - *p < size) return -1;
+    export_put_nal(writer->parameter_sets + writer->parameter_sets_size, *p, size,
+                   writer->nal_length_size);
+    writer->parameter_sets_size += writer->nal_length_size + size;
+    *p += size;
+  }
+  return 0;
+}
+
+// Re-encoded segments carry their own parameter sets, which replace the
+// source's in the decoder, so the first keyframe copied after one gets the
+// source's back in front. They come from the extradata, as is for Annex B,
+// and out of the avcC/hvcC arrays otherwise.
+static int export_read_parameter_sets(ExportWriter *writer, const AVCodecParameters *par) {
+  if (!par->extradata || par->extradata_size <= 0) return 0;
+
+  // avcC and hvcC store each NAL with a 2-byte length, packets with at
+  // most 4 bytes
+  writer->parameter_sets = (uint8_t *)av_malloc(par->extradata_size * 2);
+  if (!writer->parameter_sets) return -3;
+  if (writer->nal_length_size == 0) {
+    memcpy(writer->parameter_sets, par->extradata, par->extradata_size);
+    writer->parameter_sets_size = par->extradata_size;
+    return 0;
+  }
+
+  const uint8_t *p = par->extradata;
+  const uint8_t *end = p + par->extradata_size;
+  if (par->codec_id == AV_CODEC_ID_H264) {
+    // Sequence, then picture parameter sets
+    p += 5;
+    if (export_read_nal_array(writer, &p, end, *p++ & 0x1f) < 0) return -5;
+    if (p >= end || export_read_nal_array(writer, &p, end, *p++) < 0) return -5;
+    return 0;
+  }
+
+  // Arrays of VPS, SPS, PPS and SEI, each with its NAL type first
+  p += 22;
+  int arrays = *p++;
+  for (int i = 0; i < arrays; i++) {
+    if (end - p < 3) return -5;
+    int count = (p[1] << 8) | p[2];
+    p += 3;
+    if (export_read_nal_array(writer, &p, end, count) < 0) return -5;
+  }
+  return 0;
+}
+
+static int export_writer_open(ExportWriter *writer, const char *url, const char *output_path,
+                              const char *part_path, bool decode) {
+  memset(writer, 0, sizeof(*writer));
+
+  // Slice threads hand frames out as soon as the packets allow, so a
+  // segment can be closed right after its last frame
+  ReaderOptions options = {0};
+  options.slice_threads = 1;
+  int ret = decode ? reader_open_with(&writer->reader, url, &options)
+                   : reader_open_demuxer(&writer->reader, url);
+  if (ret < 0) return ret == -3 ? -3 : -2;
+
+  // The container follows the final name, since the .part name has no
+  // usable extension. Unknown extensions get Matroska.
+  if (avformat_alloc_output_context2(&writer->out_ctx, NULL, NULL, output_path) < 0 &&
+      avformat_alloc_output_context2(&writer->out_ctx, NULL, "matroska", NULL) < 0) {
+    return -3;
+  }
+
+  ret = export_add_streams(writer);
+  if (ret < 0) return ret;
+  if (av_dict_copy(&writer->out_ctx->metadata, writer->reader.fmt_ctx->metadata, 0) < 0) {
+    return -3;
+  }
+
+  if (!(writer->out_ctx->oformat->flags & AVFMT_NOFILE)) {
+    if (avio_open(&writer->out_ctx->pb, part_path, AVIO_FLAG_WRITE) < 0) return -4;
+    writer->file_opened = 1;
+  }
+  if (avformat_write_header(writer->out_ctx, NULL) < 0) return -4;
+  return 0;
+}
+
+static void export_writer_close(ExportWriter *writer) {
+  avcodec_free_context(&writer->enc_ctx);
+  av_packet_free(&writer->enc_packet);
+  av_freep(&writer->parameter_sets);
+  for (int i = 0; i < writer->held_count; i++) av_packet_free(&writer->held[i]);
+  free(writer->held);
+  if (writer->out_ctx) {
+    if (writer->file_opened) avio_closep(&writer->out_ctx->pb);
+    avformat_free_context(writer->out_ctx);
+    writer->out_ctx = NULL;
+  }
+  free(writer->map);
+  writer->map = NULL;
+  reader_close(&writer->reader);
+}
+
+static int64_t export_packet_ts(const AVPacket *packet) {
+  return packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+}
+
+// Timestamp of the keyframe a seek to start_ms lands on, in the video
+// stream's time base
+static int export_find_keyframe(ExportWriter *writer, int64_t start_ms, int64_t *out) {
+  MediaReader *reader = &writer->reader;
+  if (reader_seek(reader, start_ms) < 0) return -4;
+
+  while (reader_read_packet(reader) == 0) {
+    int64_t ts = export_packet_ts(reader->packet);
+    int key = reader->packet->flags & AV_PKT_FLAG_KEY;
+    av_packet_unref(reader->packet);
+    if (key && ts != AV_NOPTS_VALUE) {
+      *out = ts;
+      return 0;
+    }
+  }
+  return -4;
+}
+
+// Shift packet of input stream index so that origin (video time base)
+// becomes 0 and mux it. The packet is consumed.
+static int export_write_packet(ExportWriter *writer, AVPacket *packet, int index,
+                               int64_t origin) {
+  const AVStream *src = writer->reader.fmt_ctx->streams[index];
+  AVStream *dst = writer->out_ctx->streams[writer->map[index]];
+  int64_t offset = av_rescale_q(origin, writer->reader.time_base, src->time_base);
+
+  if (packet->pts != AV_NOPTS_VALUE) packet->pts -= offset;
+  if (packet->dts != AV_NOPTS_VALUE) packet->dts -= offset;
+  av_packet_rescale_ts(packet, src->time_base, dst->time_base);
+  packet->stream_index = dst->index;
+  packet->pos = -1;
+  return av_interleaved_write_frame(writer->out_ctx, packet) < 0 ? -4 : 0;
+}
+
+// --- Smart Render ---
+
+static const uint8_t *export_find_start_code(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 3; p++) {
+    if (p[0] == 0 && p[1] == 0 && p[2] == 1) return p;
+  }
+  return end;
+}
+
+// Put prefix in front of packet's data, converting that from Annex B to
+// length prefixed NAL units first when annexb is set
+static int export_rewrite_packet(AVPacket *packet, int length_size, bool annexb,
+                                 const uint8_t *prefix, int prefix_size) {
+  // A start code of 3 bytes may grow to a 4-byte length
+  size_t capacity = prefix_size + packet->size + (annexb ? packet->size / 3 + 4 : 0);
+  AVBufferRef *buf = av_buffer_alloc(capacity + AV_INPUT_BUFFER_PADDING_SIZE);
+  if (!buf) return -3;
+
+  uint8_t *out = buf->data;
+  if (prefix_size > 0) memcpy(out, prefix, prefix_size);
+  out += prefix_size;
+
+  const uint8_t *end = packet->data + packet->size;
+  if (!annexb) {
+    memcpy(out, packet->data, packet->size);
+    out += packet->size;
+  } else {
+    const uint8_t *nal = export_find_start_code(packet->data, end);
+    while (nal < end) {
+      nal += 3;
+      const uint8_t *next = export_find_start_code(nal, end);
+      // Zeros before the next start code belong to it, or are padding
+      const uint8_t *nal_end = next;
+      while (nal_end > nal && nal_end[-1] == 0) nal_end--;
+
+      int size = (int)(nal_end - nal);
+      if (size > 0) {
+        if (length_size < 4 && size >= 1 << (8 * length_size)) {
+          av_buffer_unref(&buf);
+          return -4;
+        }
+        export_put_nal(out, nal, size, length_size);
+        out += length_size + size;
+      }
+      nal = next;
+    }
+  }
+  memset(out, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+  av_buffer_unref(&packet->buf);
+  packet->buf = buf;
+  packet->data = buf->data;
+  packet->size = (int)(out - buf->data);
+  return 0;
+}
+
+// Video codecs a smart render can splice re-encoded GOPs into: H.264 and
+// HEVC, whose parameter sets are handled here, and codecs without
+// extradata
+static bool export_smart_supported(const AVCodecParameters *par) {
+  return par->codec_id == AV_CODEC_ID_H264 || par->codec_id == AV_CODEC_ID_HEVC ||
+         par->extradata_size == 0;
+}
+
+// A GOP read by export_plan. Leading frames of an open GOP follow the
+// keyframe in decode order but are shown before it, from lead on.
+typedef struct {
+  int64_t key;
+  int64_t key_dts;
+  int64_t lead;
+  int64_t max;
+} ExportGop;
+
+// Find the keyframes around start_ms and end_ms, reading video packets
+// without decoding them
+static int export_plan(ExportWriter *writer, int64_t start_ms, int64_t end_ms,
+                       ExportPlan *plan) {
+  MediaReader *reader = &writer->reader;
+  plan->start = av_rescale_q(start_ms, (AVRational){1, 1000}, reader->time_base);
+  plan->end = av_rescale_q(end_ms, (AVRational){1, 1000}, reader->time_base);
+  plan->first = AV_NOPTS_VALUE;
+  plan->copy_from = AV_NOPTS_VALUE;
+  plan->head_shift = 0;
+  plan->tail_key = AV_NOPTS_VALUE;
+  plan->tail_start = AV_NOPTS_VALUE;
+  plan->tail_shift = 0;
+  plan->decode_from = AV_NOPTS_VALUE;
+  if (reader_seek(reader, start_ms) < 0) return -4;
+
+  // The GOP being read, the one before it and the keyframe before that
+  ExportGop gop = {AV_NOPTS_VALUE, 0, AV_NOPTS_VALUE, AV_NOPTS_VALUE};
+  ExportGop last = gop;
+  int64_t before_last = AV_NOPTS_VALUE;
+  bool past_end = false;  // gop starts at or after the end
+  int64_t first_shift = 0;
+  while (reader_read_packet(reader) == 0) {
+    int64_t ts = export_packet_ts(reader->packet);
+    int64_t dts = reader->packet->dts != AV_NOPTS_VALUE ? reader->packet->dts : ts;
+    int key = reader->packet->flags & AV_PKT_FLAG_KEY;
+    av_packet_unref(reader->packet);
+    if (ts == AV_NOPTS_VALUE || (gop.key == AV_NOPTS_VALUE && !key)) continue;
+
+    if (key) {
+      if (past_end) break;
+      before_last = last.key;
+      last = gop;
+      gop = (ExportGop){ts, dts, ts, ts};
+      if (plan->first == AV_NOPTS_VALUE) {
+        plan->first = ts;
+        first_shift = ts - dts;
+      }
+      if (ts >= plan->end) {
+        past_end = true;
+      } else if (plan->copy_from == AV_NOPTS_VALUE && ts >= plan->start) {
+        plan->copy_from = ts;
+        plan->head_shift = ts - dts;
+      }
+      continue;
+    }
+
+    // Past the end only the leading frames matter, which come first
+    if (past_end && ts > gop.key) break;
+    if (ts < gop.lead) gop.lead = ts;
+    if (ts > gop.max) gop.max = ts;
+  }
+  if (plan->first == AV_NOPTS_VALUE) return -4;
+  if (plan->copy_from == AV_NOPTS_VALUE) {
+    plan->head_shift = first_shift;
+    return 0;
+  }
+
+  // The last GOP that starts before the end
+  const ExportGop *final = past_end ? &last : &gop;
+  int64_t before_final = past_end ? before_last : last.key;
+  if (past_end && gop.lead < plan->end) {
+    // The keyframe past the end has leading frames before it, which are
+    // decoded from the last GOP and re-encoded
+    plan->tail_key = gop.key;
+    plan->tail_start = gop.lead;
+    plan->tail_shift = gop.lead - gop.key_dts;
+    plan->decode_from = final->key;
+  } else if (final->max >= plan->end) {
+    // The last GOP shows frames past the end. Its leading frames need the
+    // GOP before it decoded as well.
+    plan->tail_key = final->key;
+    plan->tail_start = final->lead;
+    plan->tail_shift = final->lead - final->key_dts;
+    plan->decode_from = final->lead < final->key ? before_final : final->key;
+  }
+
+  // A tail in the first copied GOP leaves nothing to copy
+  if (plan->tail_key != AV_NOPTS_VALUE &&
+      (plan->tail_key == plan->copy_from || plan->decode_from == AV_NOPTS_VALUE)) {
+    plan->copy_from = AV_NOPTS_VALUE;
+    plan->tail_key = AV_NOPTS_VALUE;
+    plan->decode_from = AV_NOPTS_VALUE;
+    plan->head_shift = first_shift;
+  }
+  return 0;
+}
+
+// Encoder for the source's codec, set up like the source from its first
+// decoded frame. Without B-frames, encoded packets come out in display
+// order, so their dts can be pts minus the segment's shift.
+static int export_open_encoder(ExportWriter *writer, const AVFrame *frame) {
+  const AVStream *src = writer->reader.fmt_ctx->streams[writer->reader.stream_idx];
+  const AVCodecParameters *par = src->codecpar;
+  const AVCodec *codec = avcodec_find_encoder(par->codec_id);
+  if (!codec) return -5;
+
+  AVCodecContext *ctx = avcodec_alloc_context3(codec);
+  writer->enc_ctx = ctx;
+  if (!ctx) return -3;
+
+  ctx->width = frame->width;
+  ctx->height = frame->height;
+  ctx->pix_fmt = (enum AVPixelFormat)frame->format;
+  ctx->sample_aspect_ratio = par->sample_aspect_ratio;
+  ctx->time_base = src->time_base;
+  ctx->framerate = src->avg_frame_rate;
+  ctx->color_range = frame->color_range;
+  ctx->color_primaries = frame->color_primaries;
+  ctx->color_trc = frame->color_trc;
+  ctx->colorspace = frame->colorspace;
+  ctx->profile = par->profile;
+  ctx->level = par->level;
+  if (par->bit_rate > 0) ctx->bit_rate = par->bit_rate;
+  ctx->max_b_frames = 0;
+  ctx->thread_count = 0;
+  // No global header: parameter sets go in-band, ahead of the keyframe
+  if (avcodec_open2(ctx, codec, NULL) < 0) return -5;
+  return 0;
+}
+
+// Mux whatever the encoder has ready
+static int export_write_encoded(ExportWriter *writer) {
+  int index = writer->reader.stream_idx;
+  AVRational time_base = writer->reader.time_base;
+
+  while (1) {
+    int ret = avcodec_receive_packet(writer->enc_ctx, writer->enc_packet);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return 0;
+    if (ret < 0) return -4;
+
+    AVPacket *packet = writer->enc_packet;
+    av_packet_rescale_ts(packet, writer->enc_ctx->time_base, time_base);
+    if (packet->pts != AV_NOPTS_VALUE) packet->dts = packet->pts - writer->segment_shift;
+    if (writer->nal_length_size > 0 &&
+        export_rewrite_packet(packet, writer->nal_length_size, true, NULL, 0) < 0) {
+      av_packet_unref(packet);
+      return -4;
+    }
+    ret = export_write_packet(writer, packet, index, writer->plan->start);
+    if (ret < 0) return ret;
+  }
+}
+
+// Encode frame if it falls in the segment. Frames come out in display
+// order, so the first one at or past the end completes the segment.
+static int export_encode_frame(ExportWriter *writer, AVFrame *frame) {
+  int64_t pts = frame->best_effort_timestamp;
+  if (pts == AV_NOPTS_VALUE) pts = frame->pts;
+  if (!writer->segment_open || pts == AV_NOPTS_VALUE || pts < writer->segment_start) return 0;
+  if (pts >= writer->segment_end) {
+    writer->segment_complete = 1;
+    return 0;
+  }
+
+  if (!writer->enc_ctx) {
+    int ret = export_open_encoder(writer, frame);
+    if (ret < 0) return ret;
+  }
+
+  // Picture types of the source would override the encoder's choice
+  frame->pts = pts;
+  frame->pict_type = writer->segment_frames++ == 0 ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+  if (avcodec_send_frame(writer->enc_ctx, frame) < 0) return -4;
+  return export_write_encoded(writer);
+}
+
+// Decode packet, NULL to drain, and encode the frames that come out
+static int export_decode_packet(ExportWriter *writer, const AVPacket *packet) {
+  MediaReader *reader = &writer->reader;
+  // A broken packet costs a frame rather than the export
+  if (avcodec_send_packet(reader->codec_ctx, packet) < 0 && packet) return 0;
+
+  while (1) {
+    int ret = avcodec_receive_frame(reader->codec_ctx, reader->frame);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return 0;
+    if (ret < 0) return -4;
+
+    ret = export_encode_frame(writer, reader->frame);
+    av_frame_unref(reader->frame);
+    if (ret < 0) return ret;
+  }
+}
+
+// Start decoding at the keyframe being read, unless already decoding
+static void export_start_decoding(ExportWriter *writer) {
+  if (writer->decoding) return;
+  avcodec_flush_buffers(writer->reader.codec_ctx);
+  writer->decoding = 1;
+}
+
+static void export_open_segment(ExportWriter *writer, int64_t start, int64_t end, int64_t shift) {
+  writer->segment_open = 1;
+  writer->segment_complete = 0;
+  writer->segment_past_end = 0;
+  writer->segment_start = start;
+  writer->segment_end = end;
+  writer->segment_shift = shift;
+  writer->segment_frames = 0;
+}
+
+// Copied packets read while the segment was open come after it in decode
+// order, so they wait for it
+static int export_hold_packet(ExportWriter *writer, AVPacket *packet) {
+  if (writer->held_count == writer->held_capacity) {
+    int capacity = writer->held_capacity > 0 ? writer->held_capacity * 2 : 16;
+    AVPacket **held = (AVPacket **)realloc(writer->held, capacity * sizeof(AVPacket *));
+    if (!held) {
+      av_packet_unref(packet);
+      return -3;
+    }
+    writer->held = held;
+    writer->held_capacity = capacity;
+  }
+
+  AVPacket *copy = av_packet_alloc();
+  if (!copy) {
+    av_packet_unref(packet);
+    return -3;
+  }
+  av_packet_move_ref(copy, packet);
+  writer->held[writer->held_count++] = copy;
+  return 0;
+}
+
+// Flush the encoder, which a next segment opens afresh, and write the held
+// packets. With drain, the decoder is drained first for frames it still
+// holds, and stops decoding; otherwise it keeps decoding only for the tail.
+static int export_close_segment(ExportWriter *writer, int drain) {
+  int ret = 0;
+  if (drain) ret = export_decode_packet(writer, NULL);
+  if (drain || !writer->keep_decoding) {
+    avcodec_flush_buffers(writer->reader.codec_ctx);
+    writer->decoding = 0;
+    writer->keep_decoding = 0;
+  }
+  writer->segment_open = 0;
+
+  if (ret == 0 && writer->enc_ctx) {
+    if (avcodec_send_frame(writer->enc_ctx, NULL) < 0) ret = -4;
+    if (ret == 0) ret = export_write_encoded(writer);
+    avcodec_free_context(&writer->enc_ctx);
+  }
+
+  for (int i = 0; i < writer->held_count; i++) {
+    if (ret == 0) {
+      ret = export_write_packet(writer, writer->held[i], writer->reader.stream_idx,
+                                writer->plan->start);
+    }
+    av_packet_free(&writer->held[i]);
+  }
+  writer->held_count = 0;
+
+  // Segments re-encoded while the video is not copied run to the end
+  if (writer->phase == EXPORT_VIDEO_ENCODE) writer->phase = EXPORT_VIDEO_DONE;
+  return ret;
+}
+
+// Route a video packet of a smart render; the packet is consumed. Keyframes
+// switch between re-encoding and copying, but a segment stays open past
+// its end keyframe until the decoder has handed out every frame before
+// it, which in an open GOP includes the leading frames after it.
+static int export_smart_video_packet(ExportWriter *writer, AVPacket *packet) {
+  const ExportPlan *plan = writer->plan;
+  int64_t ts = export_packet_ts(packet);
+  int ret = 0;
+
+  if ((packet->flags & AV_PKT_FLAG_KEY) && ts != AV_NOPTS_VALUE) {
+    // By the second keyframe past it, the segment's frames were all sent.
+    // A decoder too slow to hand them out by then is drained.
+    if (writer->segment_open && ts >= writer->segment_end) {
+      if (writer->segment_past_end) {
+        ret = export_close_segment(writer, 1);
+      } else {
+        writer->segment_past_end = 1;
+      }
+    }
+    if (ret < 0) {
+      av_packet_unref(packet);
+      return ret;
+    }
+
+    if (writer->phase == EXPORT_VIDEO_ENCODE && ts == plan->copy_from) {
+      writer->phase = EXPORT_VIDEO_COPY;
+      writer->resend_parameter_sets = 1;
+    }
+    if (writer->phase == EXPORT_VIDEO_COPY) {
+      if (ts == plan->decode_from) {
+        export_start_decoding(writer);
+        writer->keep_decoding = 1;
+      }
+      if (ts == plan->tail_key) {
+        export_start_decoding(writer);
+        export_open_segment(writer, plan->tail_start, plan->end, plan->tail_shift);
+        writer->segment_past_end = ts >= plan->end;
+        writer->phase = EXPORT_VIDEO_ENCODE;
+      } else if (ts >= plan->end) {
+        writer->phase = EXPORT_VIDEO_DONE;
+      }
+    }
+  }
+
+  if (writer->phase == EXPORT_VIDEO_DONE) {
+    av_packet_unref(packet);
+    return 0;
+  }
+
+  if (writer->decoding) {
+    ret = export_decode_packet(writer, packet);
+    if (ret == 0 && writer->segment_open && writer->segment_complete) {
+      ret = export_close_segment(writer, 0);
+    }
+  }
+
+  // Leading frames before copy_from were re-encoded with the head
+  if (ret < 0 || writer->phase != EXPORT_VIDEO_COPY ||
+      (ts != AV_NOPTS_VALUE && ts < plan->copy_from)) {
+    av_packet_unref(packet);
+    return ret;
+  }
+
+  if (writer->resend_parameter_sets && (packet->flags & AV_PKT_FLAG_KEY)) {
+    writer->resend_parameter_sets = 0;
+    if (export_rewrite_packet(packet, writer->nal_length_size, false, writer->parameter_sets,
+                              writer->parameter_sets_size) < 0) {
+      av_packet_unref(packet);
+      return -3;
+    }
+  }
+  if (writer->segment_open) return export_hold_packet(writer, packet);
+  return export_write_packet(writer, packet, writer->reader.stream_idx, plan->start);
+}
+
+// Set up a smart render of plan: the partial GOP at the start is
+// re-encoded, or the whole range when no keyframe falls inside it
+static int export_smart_begin(ExportWriter *writer, const ExportPlan *plan) {
+  const AVStream *src = writer->reader.fmt_ctx->streams[writer->reader.stream_idx];
+  writer->plan = plan;
+  writer->nal_length_size = export_nal_length_size(src->codecpar);
+  writer->enc_packet = av_packet_alloc();
+  if (!writer->enc_packet) return -3;
+  int ret = export_read_parameter_sets(writer, src->codecpar);
+  if (ret < 0) return ret;
+
+  if (plan->copy_from == plan->first) {
+    writer->phase = EXPORT_VIDEO_COPY;
+  } else {
+    writer->phase = EXPORT_VIDEO_ENCODE;
+    writer->decoding = 1;
+    export_open_segment(writer, plan->start,
+                        plan->copy_from != AV_NOPTS_VALUE ? plan->copy_from : plan->end,
+                        plan->head_shift);
+  }
+  return 0;
+}
+
+// Copy packets from the keyframe on, shifted so that origin (video time
+// base) becomes 0, until every video and audio stream passes end_ms.
+// With a smart render plan, video goes through export_smart_video_packet.
+static int export_copy_packets(ExportWriter *writer, int64_t origin, int64_t start_ms,
+                               int64_t end_ms, const bool *cancelled,
+                               OnFrameRangeProgressCallback progress, void *progress_user_data) {
+  MediaReader *reader = &writer->reader;
+  AVFormatContext *in_ctx = reader->fmt_ctx;
+  AVPacket *packet = reader->packet;
+  int total = (int)FFMIN(end_ms - start_ms, INT_MAX);
+
+  int running = 0;
+  bool *done = (bool *)calloc(in_ctx->nb_streams, sizeof(bool));
+  if (!done) return -3;
+  for (unsigned int i = 0; i < in_ctx->nb_streams; i++) {
+    enum AVMediaType type = in_ctx->streams[i]->codecpar->codec_type;
+    if (writer->map[i] >= 0 && (type == AVMEDIA_TYPE_VIDEO || type == AVMEDIA_TYPE_AUDIO)) {
+      running++;
+    }
+  }
+
+  if (reader_seek(reader, start_ms) < 0) {
+    free(done);
+    return -4;
+  }
+
+  int result = 0;
+  bool started = false;  // Video is copied from its first keyframe
+  int packets = 0;
+  while (running > 0 && av_read_frame(in_ctx, packet) >= 0) {
+    if (cancelled && *cancelled) {
+      av_packet_unref(packet);
+      result = -6;
+      break;
+    }
+
+    int index = packet->stream_index;
+    const AVStream *src = in_ctx->streams[index];
+    bool is_video = index == reader->stream_idx;
+    if (writer->map[index] < 0 || done[index] || (is_video && !started &&
+                                                  !(packet->flags & AV_PKT_FLAG_KEY))) {
+      av_packet_unref(packet);
+      continue;
+    }
+
+    int64_t ts = export_packet_ts(packet);
+    int64_t ts_ms = ts != AV_NOPTS_VALUE
+        ? av_rescale_q(ts, src->time_base, (AVRational){1, 1000}) : INT64_MIN;
+    if (ts_ms > end_ms + EXPORT_INTERLEAVE_MS) {
+      av_packet_unref(packet);
+      break;
+    }
+
+    if (is_video && writer->plan) {
+      started = true;
+      result = export_smart_video_packet(writer, packet);
+      if (result < 0) break;
+      if (writer->phase == EXPORT_VIDEO_DONE) {
+        done[index] = true;
+        running--;
+      }
+    } else {
+      // Video ends in decode order, so frames shown before the end keep
+      // the frames they reference
+      int64_t end_ts = is_video && packet->dts != AV_NOPTS_VALUE ? packet->dts : ts;
+      if (end_ts != AV_NOPTS_VALUE &&
+          av_compare_ts(end_ts, src->time_base, end_ms, (AVRational){1, 1000}) >= 0) {
+        enum AVMediaType type = src->codecpar->codec_type;
+        if (type == AVMEDIA_TYPE_VIDEO || type == AVMEDIA_TYPE_AUDIO) running--;
+        done[index] = true;
+        av_packet_unref(packet);
+        continue;
+      }
+
+      // Audio and subtitles that are over before the origin are dropped
+      int64_t offset = av_rescale_q(origin, reader->time_base, src->time_base);
+      if (!is_video && ts != AV_NOPTS_VALUE && ts + packet->duration <= offset) {
+        av_packet_unref(packet);
+        continue;
+      }
+      if (is_video) started = true;
+
+      result = export_write_packet(writer, packet, index, origin);
+      if (result < 0) break;
+    }
+
+    if (is_video && progress && ++packets % EXPORT_PROGRESS_INTERVAL == 0 &&
+        ts_ms != INT64_MIN) {
+      progress(progress_user_data, (int)av_clip64(ts_ms - start_ms, 0, total), total);
+    }
+  }
+  free(done);
+  if (result < 0) return result;
+  if (!started) return -4;
+
+  // A segment still being re-encoded at the end of the file
+  if (writer->plan && writer->segment_open) {
+    result = export_close_segment(writer, 1);
+    if (result < 0) return result;
+  }
+
+  if (av_write_trailer(writer->out_ctx) < 0) return -4;
+  if (progress) progress(progress_user_data, total, total);
+  return 0;
+}
+
+int export_range(const char *url, const char *output_path, int64_t start_ms, int64_t end_ms,
+                 const ExportOptions *options, const bool *cancelled,
+                 OnFrameRangeProgressCallback progress, void *progress_user_data) {
+  if (!url || !output_path || !*output_path || !options || start_ms < 0 ||
+      end_ms <= start_ms) {
+    return -1;
+  }
+
+  size_t length = strlen(output_path);
+  char *part_path = (char *)malloc(length + sizeof(".part"));
+  if (!part_path) return -3;
+  memcpy(part_path, output_path, length);
+  memcpy(part_path + length, ".part", sizeof(".part"));
+
+  ExportWriter writer;
+  ExportPlan plan;
+  int64_t keyframe = 0;
+  int result = export_writer_open(&writer, url, output_path, part_path, options->smart != 0);
+  if (result == 0 && options->smart) {
+    const AVStream *src = writer.reader.fmt_ctx->streams[writer.reader.stream_idx];
+    result = export_smart_supported(src->codecpar) ? export_plan(&writer, start_ms, end_ms, &plan)
+                                                   : -5;
+    if (result == 0) result = export_smart_begin(&writer, &plan);
+    if (result == 0) {
+      result = export_copy_packets(&writer, plan.start, start_ms, end_ms, cancelled, progress,
+                                   progress_user_data);
+    }
+  } else if (result == 0) {
+    result = export_find_keyframe(&writer, start_ms, &keyframe);
+    if (result == 0) {
+      // An exact trim starts the timeline at start_ms; the frames from the
+      // keyframe up to it get negative timestamps, which the edit list
+      // hides. Containers without negative timestamps would shift them
+      // back into view, so those start at the keyframe.
+      int64_t origin = keyframe;
+      if (options->exact && (writer.out_ctx->oformat->flags & AVFMT_TS_NEGATIVE)) {
+        origin = FFMAX(keyframe, av_rescale_q(start_ms, (AVRational){1, 1000},
+                                              writer.reader.time_base));
+      }
+      result = export_copy_packets(&writer, origin, start_ms, end_ms, cancelled, progress,
+                                   progress_user_data);
+    }
+  }
+  int file_opened = writer.file_opened;
+  export_writer_close(&writer);
+
+  if (result == 0) {
+    // rename does not replace an existing file on Windows
+    remove(output_path);
+    if (rename(part_path, output_path) != 0) result = -4;
+  }
+  if (result != 0 && file_opened) remove(part_path);
+  free(part_path);
+  return result;
+}
@@ -0,0 +1,41 @@
+#ifndef FFMPEG_EXPORT_H
+#define FFMPEG_EXPORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ffmpeg_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Range Export ---
+
+// Copy start_ms .. end_ms of url into output_path without re-encoding.
+// Every video, audio and subtitle stream the container can hold is
+// copied, the first video stream is required. Video starts at the
+// keyframe at or before start_ms and the export's timestamps start at 0.
+// With options->exact, in containers that take negative timestamps
+// (MP4, MOV) the frames before start_ms are kept for decoding but cut
+// from playback by the edit list; elsewhere the export starts at the
+// keyframe. With options->smart, video starts at start_ms exactly, which
+// becomes timestamp 0: the partial GOPs at either end, leading frames of
+// open GOPs included, are decoded and re-encoded with the source's codec
+// and settings, and everything between is copied. The file is written
+// next to output_path and renamed into place once complete. progress
+// reports milliseconds done against the range. cancelled is polled
+// between packets and may be NULL.
+// Returns 0 on success, negative on failure:
+// -1 invalid range or options, -2 open failed, -3 out of memory,
+// -4 reading or writing failed, -5 the container cannot hold the video
+// codec or a smart render cannot re-encode it, -6 cancelled.
+int export_range(const char *url, const char *output_path, int64_t start_ms, int64_t end_ms,
+                 const ExportOptions *options, const bool *cancelled,
+                 OnFrameRangeProgressCallback progress, void *progress_user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_EXPORT_H
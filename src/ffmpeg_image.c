@@ -0,0 +1,196 @@
+#include "ffmpeg_image.h"
+#include "ffmpeg_core.h"
+
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ImageEncoder {
+  AVCodecContext *ctx;
+  struct SwsContext *sws_ctx;
+  AVFrame *frame;
+  AVPacket *packet;
+
+  // Settings ctx was opened with
+  enum AVCodecID codec_id;
+  int quality;
+  int width;
+  int height;
+};
+
+ImageEncoder *image_encoder_alloc(void) {
+  ImageEncoder *encoder = (ImageEncoder *)calloc(1, sizeof(ImageEncoder));
+  if (!encoder) return NULL;
+
+  encoder->frame = av_frame_alloc();
+  encoder->packet = av_packet_alloc();
+  if (!encoder->frame || !encoder->packet) {
+    image_encoder_free(&encoder);
+    return NULL;
+  }
+  return encoder;
+}
+
+void image_encoder_free(ImageEncoder **encoder) {
+  if (!encoder || !*encoder) return;
+  avcodec_free_context(&(*encoder)->ctx);
+  sws_freeContext((*encoder)->sws_ctx);
+  av_frame_free(&(*encoder)->frame);
+  av_packet_free(&(*encoder)->packet);
+  free(*encoder);
+  *encoder = NULL;
+}
+
+enum AVCodecID image_codec_id(int image_format) {
+  switch (image_format) {
+    case IMAGE_FORMAT_JPEG: return AV_CODEC_ID_MJPEG;
+    case IMAGE_FORMAT_PNG: return AV_CODEC_ID_PNG;
+    case IMAGE_FORMAT_WEBP: return AV_CODEC_ID_WEBP;
+    default: return AV_CODEC_ID_NONE;
+  }
+}
+
+static enum AVPixelFormat image_pixel_format(enum AVCodecID codec_id) {
+  switch (codec_id) {
+    case AV_CODEC_ID_PNG:
+      return AV_PIX_FMT_RGBA;
+    case AV_CODEC_ID_MJPEG:
+      // Full range 4:2:0, what JFIF decoders expect
+      return AV_PIX_FMT_YUVJ420P;
+    default:
+      return AV_PIX_FMT_YUV420P;
+  }
+}
+
+// (Re)open the codec context when the settings changed
+static int image_encoder_open(ImageEncoder *encoder, enum AVCodecID codec_id, int quality,
+                              int width, int height) {
+  if (encoder->ctx && encoder->codec_id == codec_id && encoder->quality == quality &&
+      encoder->width == width && encoder->height == height) {
+    return 0;
+  }
+  avcodec_free_context(&encoder->ctx);
+
+  const AVCodec *codec = avcodec_find_encoder(codec_id);
+  if (!codec) return -1;
+
+  AVCodecContext *ctx = avcodec_alloc_context3(codec);
+  if (!ctx) return -2;
+
+  ctx->width = width;
+  ctx->height = height;
+  ctx->pix_fmt = image_pixel_format(codec_id);
+  ctx->time_base = (AVRational){1, 1};
+  if (codec_id == AV_CODEC_ID_MJPEG) {
+    // Map 1-100 onto the MJPEG qscale range 31 (worst) to 2 (best)
+    ctx->color_range = AVCOL_RANGE_JPEG;
+    ctx->flags |= AV_CODEC_FLAG_QSCALE;
+    ctx->global_quality = FF_QP2LAMBDA * (2 + (100 - quality) * 29 / 99);
+  } else if (codec_id != AV_CODEC_ID_PNG) {
+    // libwebp reads global_quality / FF_QP2LAMBDA as its 0-100 quality
+    ctx->global_quality = FF_QP2LAMBDA * quality;
+  }
+
+  if (avcodec_open2(ctx, codec, NULL) < 0) {
+    avcodec_free_context(&ctx);
+    return -2;
+  }
+
+  encoder->ctx = ctx;
+  encoder->codec_id = codec_id;
+  encoder->quality = quality;
+  encoder->width = width;
+  encoder->height = height;
+  return 0;
+}
+
+// Fill the frame from the RGBA source, converting when the encoder wants YUV
+static int image_encoder_fill_frame(ImageEncoder *encoder, const uint8_t *rgba, int linesize) {
+  AVFrame *frame = encoder->frame;
+  AVCodecContext *ctx = encoder->ctx;
+
+  if (frame->buf[0] && (frame->format != ctx->pix_fmt || frame->width != ctx->width ||
+                        frame->height != ctx->height)) {
+    av_frame_unref(frame);
+  }
+  if (!frame->buf[0]) {
+    frame->format = ctx->pix_fmt;
+    frame->width = ctx->width;
+    frame->height = ctx->height;
+    if (av_frame_get_buffer(frame, 0) < 0) return -1;
+  }
+  // The encoder may still hold a reference to the last picture
+  if (av_frame_make_writable(frame) < 0) return -1;
+
+  if (frame->format == AV_PIX_FMT_RGBA) {
+    for (int y = 0; y < frame->height; y++) {
+      memcpy(frame->data[0] + (size_t)y * frame->linesize[0],
+             rgba + (size_t)y * linesize, (size_t)frame->width * 4);
+    }
+    return 0;
+  }
+
+  encoder->sws_ctx = sws_getCachedContext(encoder->sws_ctx, frame->width, frame->height,
+                                          AV_PIX_FMT_RGBA, frame->width, frame->height,
+                                          frame->format, SWS_BICUBIC, NULL, NULL, NULL);
+  if (!encoder->sws_ctx) return -1;
+
+  const uint8_t *src_data[4] = {rgba, NULL, NULL, NULL};
+  int src_linesize[4] = {linesize, 0, 0, 0};
+  sws_scale(encoder->sws_ctx, src_data, src_linesize, 0, frame->height,
+            frame->data, frame->linesize);
+  return 0;
+}
+
+int image_encoder_encode(ImageEncoder *encoder, enum AVCodecID codec_id, int quality,
+                         const uint8_t *rgba, int linesize, int width, int height,
+                         uint8_t **out_data, size_t *out_size) {
+  *out_data = NULL;
+  *out_size = 0;
+
+  if (quality <= 0) quality = 85;
+  if (quality > 100) quality = 100;
+
+  int ret = image_encoder_open(encoder, codec_id, quality, width, height);
+  if (ret < 0) return ret;
+  if (image_encoder_fill_frame(encoder, rgba, linesize) < 0) return -2;
+
+  encoder->frame->pts = 0;
+  // The MJPEG encoder takes its qscale from each frame, not the context
+  if (codec_id == AV_CODEC_ID_MJPEG) encoder->frame->quality = encoder->ctx->global_quality;
+  if (avcodec_send_frame(encoder->ctx, encoder->frame) < 0) return -2;
+
+  // Image encoders emit a packet per frame. One that buffers has to be
+  // drained, after which the context is spent and reopened next time.
+  ret = avcodec_receive_packet(encoder->ctx, encoder->packet);
+  if (ret == AVERROR(EAGAIN)) {
+    avcodec_send_frame(encoder->ctx, NULL);
+    ret = avcodec_receive_packet(encoder->ctx, encoder->packet);
+    avcodec_free_context(&encoder->ctx);
+  }
+  if (ret < 0) return -2;
+
+  *out_data = (uint8_t *)malloc(encoder->packet->size);
+  if (*out_data) {
+    memcpy(*out_data, encoder->packet->data, encoder->packet->size);
+    *out_size = encoder->packet->size;
+  }
+  av_packet_unref(encoder->packet);
+  return *out_data ? 0 : -2;
+}
+
+int image_encode_rgba(enum AVCodecID codec_id, int quality,
+                      const uint8_t *rgba, int linesize, int width, int height,
+                      uint8_t **out_data, size_t *out_size) {
+  *out_data = NULL;
+  *out_size = 0;
+
+  ImageEncoder *encoder = image_encoder_alloc();
+  if (!encoder) return -2;
+
+  int ret = image_encoder_encode(encoder, codec_id, quality, rgba, linesize,
+                                 width, height, out_data, out_size);
+  image_encoder_free(&encoder);
+  return ret;
+}
@@ -0,0 +1,43 @@
+#ifndef FFMPEG_IMAGE_H
+#define FFMPEG_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libavcodec/avcodec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Still Image Encoding ---
+
+// Reusable encoder state. The codec context, scaler and frame buffer are
+// kept while codec, quality and size stay the same, so encoding a stream
+// of same-sized frames only pays for the encode itself. Not thread safe.
+typedef struct ImageEncoder ImageEncoder;
+
+ImageEncoder *image_encoder_alloc(void);
+void image_encoder_free(ImageEncoder **encoder);
+
+// Encode one RGBA picture with a libavcodec image encoder (MJPEG, PNG or
+// WebP). quality is 1-100, 0 for the default, and ignored by lossless
+// codecs. On success *out_data is malloc'd and owned by the caller.
+// Returns 0 on success, negative on failure (-1 if the encoder is missing).
+int image_encoder_encode(ImageEncoder *encoder, enum AVCodecID codec_id, int quality,
+                         const uint8_t *rgba, int linesize, int width, int height,
+                         uint8_t **out_data, size_t *out_size);
+
+// Encoder for an ImageFormat value, AV_CODEC_ID_NONE for IMAGE_FORMAT_NONE.
+enum AVCodecID image_codec_id(int image_format);
+
+// One-shot version of image_encoder_encode.
+int image_encode_rgba(enum AVCodecID codec_id, int quality,
+                      const uint8_t *rgba, int linesize, int width, int height,
+                      uint8_t **out_data, size_t *out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_IMAGE_H
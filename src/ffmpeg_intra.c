@@ -0,0 +1,185 @@
+#include "ffmpeg_intra.h"
+#include "ffmpeg_reader.h"
+
+#include <libavutil/cpu.h>
+#include <stdlib.h>
+
+#define INTRA_MAX_WORKERS 16
+
+typedef struct {
+  MediaReader reader;
+  const int64_t *targets;
+  AVFrame **frames;
+  int first;
+  int count;
+  const bool *cancelled;
+  int decoded;
+} IntraWorker;
+
+struct IntraPool {
+  IntraWorker *workers;
+  int worker_count;
+  ReaderThreads *threads;  // Kept between batches
+};
+
+bool intra_stream_supported(const AVStream *stream) {
+  const AVCodecDescriptor *desc = avcodec_descriptor_get(stream->codecpar->codec_id);
+  if (!desc || !(desc->props & AV_CODEC_PROP_INTRA_ONLY)) return false;
+  // Without an index a frame can only be found by reading up to it
+  return avformat_index_get_entries_count(stream) > 0;
+}
+
+static int64_t intra_packet_ts(const AVPacket *packet) {
+  return packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+}
+
+// Frame threaded decoders hold frames back until they have a packet per
+// thread, so those are drained
+int intra_decode_packet(AVCodecContext *codec_ctx, AVPacket *packet, AVFrame *frame) {
+  if (avcodec_send_packet(codec_ctx, packet) < 0) return -1;
+
+  int ret = avcodec_receive_frame(codec_ctx, frame);
+  if (ret == AVERROR(EAGAIN)) {
+    avcodec_send_packet(codec_ctx, NULL);
+    ret = avcodec_receive_frame(codec_ctx, frame);
+    avcodec_flush_buffers(codec_ctx);
+  }
+  return ret < 0 ? -1 : 0;
+}
+
+int intra_decode_at(AVFormatContext *fmt_ctx, int stream_idx, AVCodecContext *codec_ctx,
+                    AVPacket *packet, AVFrame *frame, int64_t ts_ms) {
+  AVStream *stream = fmt_ctx->streams[stream_idx];
+
+  // First timestamp that truncates to ts_ms or later, as the callers'
+  // millisecond timestamps do
+  int64_t target = av_rescale_q_rnd(ts_ms, (AVRational){1, 1000}, stream->time_base,
+                                    AV_ROUND_UP);
+
+  // The index may only hold some of the frames, e.g. Matroska cues, so
+  // start at the last entry at or before the target
+  const AVIndexEntry *entry = avformat_index_get_entry_from_timestamp(
+      stream, target, AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY);
+  if (!entry) entry = avformat_index_get_entry(stream, 0);
+  if (!entry) return -1;
+
+  if (av_seek_frame(fmt_ctx, stream_idx, entry->timestamp,
+                    AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY) < 0) {
+    return -1;
+  }
+  avcodec_flush_buffers(codec_ctx);
+
+  while (av_read_frame(fmt_ctx, packet) >= 0) {
+    int64_t ts = intra_packet_ts(packet);
+    // Earlier frames are skipped without being decoded
+    if (packet->stream_index != stream_idx || (ts != AV_NOPTS_VALUE && ts < target)) {
+      av_packet_unref(packet);
+      continue;
+    }
+
+    int ret = intra_decode_packet(codec_ctx, packet, frame);
+    av_packet_unref(packet);
+    if (ret < 0) continue;
+
+    if (frame->pts == AV_NOPTS_VALUE) frame->pts = ts;
+    return 0;
+  }
+  return -1;
+}
+
+// --- Intra Reader Pool ---
+
+static void *intra_worker_run(void *arg) {
+  IntraWorker *worker = (IntraWorker *)arg;
+  MediaReader *reader = &worker->reader;
+
+  for (int i = worker->first; i < worker->first + worker->count; i++) {
+    if (worker->cancelled && *worker->cancelled) break;
+
+    AVFrame *frame = worker->frames[i];
+    av_frame_unref(frame);
+    if (intra_decode_at(reader->fmt_ctx, reader->stream_idx, reader->codec_ctx,
+                        reader->packet, frame, worker->targets[i]) == 0) {
+      worker->decoded++;
+    }
+  }
+
+  return NULL;
+}
+
+int intra_pool_open(const char *url, int stream_idx, int worker_count, IntraPool **out) {
+  *out = NULL;
+  if (worker_count <= 0) worker_count = av_cpu_count();
+  if (worker_count > INTRA_MAX_WORKERS) worker_count = INTRA_MAX_WORKERS;
+  if (worker_count < 1) worker_count = 1;
+
+  IntraPool *pool = (IntraPool *)calloc(1, sizeof(IntraPool));
+  IntraWorker *workers = (IntraWorker *)calloc(worker_count, sizeof(IntraWorker));
+  if (!pool || !workers) {
+    free(pool);
+    free(workers);
+    return -3;
+  }
+  pool->workers = workers;
+
+  // Frames are decoded in parallel across readers, one thread each
+  for (int i = 0; i < worker_count; i++) {
+    int ret = reader_open(&workers[i].reader, url, 1);
+    if (ret < 0) {
+      intra_pool_close(&pool);
+      return ret == -3 ? -3 : -2;
+    }
+    pool->worker_count++;
+
+    const MediaReader *reader = &workers[i].reader;
+    if (reader->stream_idx != stream_idx ||
+        !intra_stream_supported(reader->fmt_ctx->streams[stream_idx])) {
+      intra_pool_close(&pool);
+      return -1;
+    }
+  }
+  pool->threads = reader_threads_create(worker_count);
+
+  *out = pool;
+  return 0;
+}
+
+void intra_pool_close(IntraPool **pool) {
+  if (!pool || !*pool) return;
+  reader_threads_destroy(&(*pool)->threads);
+  for (int i = 0; i < (*pool)->worker_count; i++) {
+    reader_close(&(*pool)->workers[i].reader);
+  }
+  free((*pool)->workers);
+  free(*pool);
+  *pool = NULL;
+}
+
+int intra_pool_worker_count(const IntraPool *pool) {
+  return pool->worker_count;
+}
+
+int intra_pool_decode(IntraPool *pool, const int64_t *targets, int count, AVFrame **frames,
+                      const bool *cancelled) {
+  int worker_count = pool->worker_count < count ? pool->worker_count : count;
+
+  // Contiguous runs, so each reader keeps reading forward
+  int first = 0;
+  for (int i = 0; i < worker_count; i++) {
+    IntraWorker *worker = &pool->workers[i];
+    worker->targets = targets;
+    worker->frames = frames;
+    worker->first = first;
+    worker->count = count / worker_count + (i < count % worker_count ? 1 : 0);
+    worker->cancelled = cancelled;
+    worker->decoded = 0;
+    first += worker->count;
+  }
+
+  reader_threads_run(pool->threads, intra_worker_run, pool->workers, sizeof(IntraWorker),
+                     worker_count);
+
+  int decoded = 0;
+  for (int i = 0; i < worker_count; i++) decoded += pool->workers[i].decoded;
+  return decoded;
+}
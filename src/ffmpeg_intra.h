@@ -0,0 +1,61 @@
+#ifndef FFMPEG_INTRA_H
+#define FFMPEG_INTRA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Intra-Only Random Access ---
+//
+// In intra-only streams (MJPEG, ProRes, DNxHD, ...) every frame decodes on
+// its own. A frame is found through the demuxer's index, the packets shown
+// before it are skipped without decoding, and only its own packet goes
+// through the decoder.
+
+// Whether stream is intra-only and indexed, so intra_decode_at applies.
+bool intra_stream_supported(const AVStream *stream);
+
+// Decode the frame of one packet that needs no other, into frame. Frame
+// threaded decoders are drained and flushed. Returns 0 on success, -1 on
+// failure.
+int intra_decode_packet(AVCodecContext *codec_ctx, AVPacket *packet, AVFrame *frame);
+
+// Decode the first frame of stream_idx shown at or after ts_ms into frame,
+// decoding no other packet. The decoder is flushed first. packet is
+// scratch. Returns 0 on success, -1 on failure.
+int intra_decode_at(AVFormatContext *fmt_ctx, int stream_idx, AVCodecContext *codec_ctx,
+                    AVPacket *packet, AVFrame *frame, int64_t ts_ms);
+
+// --- Intra Reader Pool ---
+//
+// Private readers of one intra-only stream, which decode independent frames
+// on as many threads. Not thread safe.
+
+typedef struct IntraPool IntraPool;
+
+// Open worker_count readers (0 = one per core) of stream stream_idx of url.
+// Returns 0 on success, -1 if that stream is not intra-only or not the
+// one readers pick, -2 if url could not be opened, -3 out of memory.
+int intra_pool_open(const char *url, int stream_idx, int worker_count, IntraPool **out);
+void intra_pool_close(IntraPool **pool);
+
+int intra_pool_worker_count(const IntraPool *pool);
+
+// Decode the frame at or after each of targets[0..count) into frames[i],
+// spread over the readers, which run in parallel. Timestamps stay in the
+// stream's time base. A frame that failed to decode is left without
+// buffers. cancelled may be NULL. Returns the number of frames decoded.
+int intra_pool_decode(IntraPool *pool, const int64_t *targets, int count, AVFrame **frames,
+                      const bool *cancelled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_INTRA_H
@@ -0,0 +1,183 @@
+#include "ffmpeg_lz4.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define LZ4_HASH_BITS 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_MF_LIMIT 12       // No match starts within this many bytes of the end
+#define LZ4_LAST_LITERALS 5   // The last bytes are always literals
+#define LZ4_RUN_MASK 15
+
+static uint32_t lz4_read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint64_t lz4_read64(const uint8_t *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint32_t lz4_hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+size_t lz4_compress_bound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+// Bytes equal at a and b, stopping at limit. Compares a word at a time.
+static size_t lz4_match_length(const uint8_t *a, const uint8_t *b, const uint8_t *limit) {
+  const uint8_t *start = a;
+  while (a + 8 <= limit && lz4_read64(a) == lz4_read64(b)) {
+    a += 8;
+    b += 8;
+  }
+  while (a < limit && *a == *b) {
+    a++;
+    b++;
+  }
+  return (size_t)(a - start);
+}
+
+static uint8_t *lz4_write_length(uint8_t *op, size_t length) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = (uint8_t)length;
+  return op;
+}
+
+static uint8_t *lz4_write_literals(uint8_t *op, uint8_t *token, const uint8_t *literals,
+                                   size_t length) {
+  *token = (uint8_t)((length >= LZ4_RUN_MASK ? LZ4_RUN_MASK : length) << 4);
+  if (length >= LZ4_RUN_MASK) op = lz4_write_length(op, length - LZ4_RUN_MASK);
+  memcpy(op, literals, length);
+  return op + length;
+}
+
+size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity) {
+  // With the worst case room up front the loop needs no output checks
+  if (size > UINT32_MAX || capacity < lz4_compress_bound(size)) return 0;
+
+  uint32_t table[1 << LZ4_HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  const uint8_t *end = src + size;
+  uint8_t *op = dst;
+
+  if (size > LZ4_MF_LIMIT) {
+    const uint8_t *mf_limit = end - LZ4_MF_LIMIT;
+    const uint8_t *match_limit = end - LZ4_LAST_LITERALS;
+
+    while (ip < mf_limit) {
+      uint32_t sequence = lz4_read32(ip);
+      uint32_t hash = lz4_hash(sequence);
+      const uint8_t *ref = src + table[hash];
+      table[hash] = (uint32_t)(ip - src);
+
+      if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || lz4_read32(ref) != sequence) {
+        // Step faster the longer nothing matches, so noise costs little
+        ip += 1 + ((ip - anchor) >> 6);
+        continue;
+      }
+
+      while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+        ip--;
+        ref--;
+      }
+
+      size_t match_length =
+          LZ4_MIN_MATCH + lz4_match_length(ip + LZ4_MIN_MATCH, ref + LZ4_MIN_MATCH, match_limit);
+      size_t offset = (size_t)(ip - ref);
+
+      uint8_t *token = op++;
+      op = lz4_write_literals(op, token, anchor, (size_t)(ip - anchor));
+      *op++ = (uint8_t)(offset & 0xff);
+      *op++ = (uint8_t)(offset >> 8);
+
+      size_t run = match_length - LZ4_MIN_MATCH;
+      *token |= (uint8_t)(run >= LZ4_RUN_MASK ? LZ4_RUN_MASK : run);
+      if (run >= LZ4_RUN_MASK) op = lz4_write_length(op, run - LZ4_RUN_MASK);
+
+      ip += match_length;
+      anchor = ip;
+      if (ip < mf_limit) table[lz4_hash(lz4_read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+    }
+  }
+
+  uint8_t *token = op++;
+  op = lz4_write_literals(op, token, anchor, (size_t)(end - anchor));
+  return (size_t)(op - dst);
+}
+
+// Extend a length whose nibble was saturated. Returns false past the input.
+static bool lz4_read_length(const uint8_t **ip, const uint8_t *end, size_t *length) {
+  uint8_t byte;
+  do {
+    if (*ip >= end) return false;
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+int lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size) {
+  const uint8_t *ip = src;
+  const uint8_t *end = src + size;
+  uint8_t *op = dst;
+  uint8_t *out_end = dst + dst_size;
+
+  while (ip < end) {
+    uint8_t token = *ip++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == LZ4_RUN_MASK && !lz4_read_length(&ip, end, &literal_length)) {
+      return -1;
+    }
+    if (literal_length > (size_t)(end - ip) || literal_length > (size_t)(out_end - op)) {
+      return -1;
+    }
+    // Short runs copy one 16 byte word when both buffers have the slack
+    if (literal_length <= 16 && end - ip >= 16 && out_end - op >= 16) {
+      memcpy(op, ip, 16);
+    } else {
+      memcpy(op, ip, literal_length);
+    }
+    ip += literal_length;
+    op += literal_length;
+
+    // The last sequence is literals only
+    if (ip == end) break;
+
+    if (end - ip < 2) return -1;
+    size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst)) return -1;
+
+    size_t match_length = token & LZ4_RUN_MASK;
+    if (match_length == LZ4_RUN_MASK && !lz4_read_length(&ip, end, &match_length)) {
+      return -1;
+    }
+    match_length += LZ4_MIN_MATCH;
+    if (match_length > (size_t)(out_end - op)) return -1;
+
+    const uint8_t *match = op - offset;
+    if (offset >= 16 && (size_t)(out_end - op) >= match_length + 15) {
+      // Source words never overlap the bytes being written
+      for (size_t i = 0; i < match_length; i += 16) memcpy(op + i, match + i, 16);
+    } else {
+      for (size_t i = 0; i < match_length; i++) op[i] = match[i];
+    }
+    op += match_length;
+  }
+
+  return op == out_end ? 0 : -1;
+}
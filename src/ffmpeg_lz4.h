@@ -0,0 +1,33 @@
+#ifndef FFMPEG_LZ4_H
+#define FFMPEG_LZ4_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- LZ4 Block Codec ---
+//
+// Raw LZ4 block format (no frame header or checksum), so blocks interoperate
+// with liblz4's LZ4_compress_default / LZ4_decompress_safe. Greedy single
+// pass compressor with a 4096 entry hash table; both directions copy in
+// 8 and 16 byte words. Inputs are limited to 4 GiB.
+
+// Worst case compressed size of size bytes.
+size_t lz4_compress_bound(size_t size);
+
+// Compress src into dst. Returns the compressed size, or 0 if capacity is
+// below lz4_compress_bound(size) or size is too large.
+size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+
+// Decompress a block that expands to exactly dst_size bytes. Returns 0, or -1
+// on malformed input; never reads or writes out of bounds.
+int lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_LZ4_H
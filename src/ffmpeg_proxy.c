@@ -0,0 +1,345 @@
+#include "ffmpeg_proxy.h"
+#include "ffmpeg_reader.h"
+
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROXY_DEFAULT_HEIGHT 360
+#define PROXY_DEFAULT_QUALITY 60
+#define PROXY_PROGRESS_INTERVAL 30  // Frames between progress reports
+
+// Source reader and output muxer of one proxy job
+typedef struct {
+  MediaReader reader;
+  AVFormatContext *out_ctx;
+  AVCodecContext *enc_ctx;
+  AVStream *stream;
+  AVFrame *frame;       // Scaled frame handed to the encoder
+  AVPacket *packet;
+  int file_opened;
+
+  struct SwsContext *sws_ctx;
+  int sws_colorspace;
+  int sws_full_range;
+
+  int64_t last_ts_ms;
+} ProxyWriter;
+
+struct ProxySource {
+  MediaReader reader;
+  char *url;
+};
+
+// Proxy size for a source, never larger than it and even for 4:2:0
+static void proxy_scaled_size(int src_width, int src_height, int height,
+                              int *out_width, int *out_height) {
+  if (height <= 0) height = PROXY_DEFAULT_HEIGHT;
+  if (height > src_height) height = src_height;
+
+  int width = (int)(((int64_t)src_width * height + src_height / 2) / src_height);
+  *out_width = FFMAX(2, width & ~1);
+  *out_height = FFMAX(2, height & ~1);
+}
+
+// Carry the display matrix over, so the proxy displays like the original
+static int proxy_copy_display_matrix(const AVStream *src, AVStream *dst) {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(60, 29, 100)
+  const AVPacketSideData *sd = av_packet_side_data_get(
+      src->codecpar->coded_side_data, src->codecpar->nb_coded_side_data,
+      AV_PKT_DATA_DISPLAYMATRIX);
+  if (!sd) return 0;
+
+  AVPacketSideData *copy = av_packet_side_data_new(
+      &dst->codecpar->coded_side_data, &dst->codecpar->nb_coded_side_data,
+      AV_PKT_DATA_DISPLAYMATRIX, sd->size, 0);
+  if (!copy) return -1;
+  memcpy(copy->data, sd->data, sd->size);
+#else
+  size_t size = 0;
+  const uint8_t *matrix = av_stream_get_side_data(src, AV_PKT_DATA_DISPLAYMATRIX, &size);
+  if (!matrix) return 0;
+
+  uint8_t *copy = av_stream_new_side_data(dst, AV_PKT_DATA_DISPLAYMATRIX, size);
+  if (!copy) return -1;
+  memcpy(copy, matrix, size);
+#endif
+  return 0;
+}
+
+// Same matrix handling as the playback path; the proxy itself is BT.601
+// full range, which is what JPEG decoders assume
+static void proxy_update_colorspace(ProxyWriter *writer, const AVFrame *frame) {
+  int full_range = frame->color_range == AVCOL_RANGE_JPEG;
+  if ((int)frame->colorspace == writer->sws_colorspace && full_range == writer->sws_full_range) {
+    return;
+  }
+
+  int sws_cs = SWS_CS_DEFAULT;
+  if (frame->colorspace == AVCOL_SPC_BT709) {
+    sws_cs = SWS_CS_ITU709;
+  } else if (frame->colorspace == AVCOL_SPC_BT2020_NCL || frame->colorspace == AVCOL_SPC_BT2020_CL) {
+    sws_cs = SWS_CS_BT2020;
+  }
+
+  sws_setColorspaceDetails(writer->sws_ctx, sws_getCoefficients(sws_cs), full_range,
+                           sws_getCoefficients(SWS_CS_DEFAULT), 1, 0, 1 << 16, 1 << 16);
+  writer->sws_colorspace = frame->colorspace;
+  writer->sws_full_range = full_range;
+}
+
+static int proxy_open_encoder(ProxyWriter *writer, const AVStream *src, const ProxyOptions *options) {
+  const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+  if (!codec) return -5;
+
+  int width, height;
+  proxy_scaled_size(src->codecpar->width, src->codecpar->height, options->height,
+                    &width, &height);
+
+  AVCodecContext *ctx = avcodec_alloc_context3(codec);
+  writer->enc_ctx = ctx;
+  writer->frame = av_frame_alloc();
+  writer->packet = av_packet_alloc();
+  if (!ctx || !writer->frame || !writer->packet) return -3;
+
+  int quality = options->quality > 0 ? options->quality : PROXY_DEFAULT_QUALITY;
+  ctx->width = width;
+  ctx->height = height;
+  ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+  ctx->color_range = AVCOL_RANGE_JPEG;
+  ctx->sample_aspect_ratio = src->codecpar->sample_aspect_ratio;
+  ctx->time_base = (AVRational){1, 1000};
+  ctx->framerate = src->avg_frame_rate;
+  ctx->thread_count = 0;
+  // Same 1-100 to qscale mapping as encoded frames
+  ctx->flags |= AV_CODEC_FLAG_QSCALE;
+  ctx->global_quality = FF_QP2LAMBDA * (2 + (100 - quality) * 29 / 99);
+  if (writer->out_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+    ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+  if (avcodec_open2(ctx, codec, NULL) < 0) return -4;
+
+  writer->frame->format = AV_PIX_FMT_YUVJ420P;
+  writer->frame->width = width;
+  writer->frame->height = height;
+  writer->frame->color_range = AVCOL_RANGE_JPEG;
+  if (av_frame_get_buffer(writer->frame, 0) < 0) return -3;
+  return 0;
+}
+
+static int proxy_writer_open(ProxyWriter *writer, const char *url, const char *output_path,
+                             const char *part_path, const ProxyOptions *options) {
+  memset(writer, 0, sizeof(*writer));
+  writer->sws_colorspace = -1;
+  writer->last_ts_ms = -1;
+
+  int ret = reader_open(&writer->reader, url, 0);
+  if (ret < 0) return ret == -3 ? -3 : -2;
+  const AVStream *src = writer->reader.fmt_ctx->streams[writer->reader.stream_idx];
+  if (src->codecpar->width <= 0 || src->codecpar->height <= 0) return -2;
+
+  // The container follows the final name, since the .part name has no
+  // usable extension. Unknown extensions get Matroska.
+  if (avformat_alloc_output_context2(&writer->out_ctx, NULL, NULL, output_path) < 0 &&
+      avformat_alloc_output_context2(&writer->out_ctx, NULL, "matroska", NULL) < 0) {
+    return -3;
+  }
+
+  ret = proxy_open_encoder(writer, src, options);
+  if (ret < 0) return ret;
+
+  writer->stream = avformat_new_stream(writer->out_ctx, NULL);
+  if (!writer->stream) return -3;
+  if (avcodec_parameters_from_context(writer->stream->codecpar, writer->enc_ctx) < 0) return -3;
+  writer->stream->time_base = writer->enc_ctx->time_base;
+  writer->stream->sample_aspect_ratio = writer->enc_ctx->sample_aspect_ratio;
+  writer->stream->avg_frame_rate = src->avg_frame_rate;
+  if (proxy_copy_display_matrix(src, writer->stream) < 0) return -3;
+
+  if (!(writer->out_ctx->oformat->flags & AVFMT_NOFILE)) {
+    if (avio_open(&writer->out_ctx->pb, part_path, AVIO_FLAG_WRITE) < 0) return -4;
+    writer->file_opened = 1;
+  }
+  if (avformat_write_header(writer->out_ctx, NULL) < 0) return -4;
+  return 0;
+}
+
+static void proxy_writer_close(ProxyWriter *writer) {
+  if (writer->sws_ctx) sws_freeContext(writer->sws_ctx);
+  av_frame_free(&writer->frame);
+  av_packet_free(&writer->packet);
+  avcodec_free_context(&writer->enc_ctx);
+  if (writer->out_ctx) {
+    if (writer->file_opened) avio_closep(&writer->out_ctx->pb);
+    avformat_free_context(writer->out_ctx);
+    writer->out_ctx = NULL;
+  }
+  reader_close(&writer->reader);
+}
+
+// Mux whatever the encoder has ready
+static int proxy_write_packets(ProxyWriter *writer) {
+  while (1) {
+    int ret = avcodec_receive_packet(writer->enc_ctx, writer->packet);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return 0;
+    if (ret < 0) return -4;
+
+    writer->packet->stream_index = writer->stream->index;
+    writer->packet->flags |= AV_PKT_FLAG_KEY;
+    av_packet_rescale_ts(writer->packet, writer->enc_ctx->time_base, writer->stream->time_base);
+    if (av_interleaved_write_frame(writer->out_ctx, writer->packet) < 0) return -4;
+  }
+}
+
+// Scale the reader's current frame and encode it at ts_ms
+static int proxy_encode_frame(ProxyWriter *writer, int64_t ts_ms) {
+  const AVFrame *src = writer->reader.frame;
+  AVFrame *dst = writer->frame;
+
+  struct SwsContext *ctx = sws_getCachedContext(
+      writer->sws_ctx, src->width, src->height, (enum AVPixelFormat)src->format,
+      dst->width, dst->height, AV_PIX_FMT_YUVJ420P, SWS_BILINEAR, NULL, NULL, NULL);
+  if (!ctx) return -3;
+  if (ctx != writer->sws_ctx) {
+    writer->sws_ctx = ctx;
+    writer->sws_colorspace = -1;
+  }
+  proxy_update_colorspace(writer, src);
+
+  // The encoder may still hold the previous frame's buffer
+  if (av_frame_make_writable(dst) < 0) return -3;
+  if (sws_scale(ctx, (const uint8_t *const *)src->data, src->linesize, 0, src->height,
+                dst->data, dst->linesize) < 0) {
+    return -4;
+  }
+
+  dst->pts = ts_ms;
+  // MJPEG reads the qscale from the frame
+  dst->quality = writer->enc_ctx->global_quality;
+  if (avcodec_send_frame(writer->enc_ctx, dst) < 0) return -4;
+  return proxy_write_packets(writer);
+}
+
+static int proxy_transcode(ProxyWriter *writer, const bool *cancelled,
+                           OnFrameRangeProgressCallback progress, void *progress_user_data) {
+  int64_t duration = writer->reader.fmt_ctx->duration;
+  int total = duration > 0 ? (int)FFMIN(duration / 1000, INT_MAX) : 0;
+  int frames = 0;
+
+  int ret;
+  while ((ret = reader_next_frame(&writer->reader)) == 0) {
+    if (cancelled && *cancelled) return -6;
+
+    // Muxers need increasing timestamps, and a repeated one adds nothing
+    // to scrub to
+    int64_t ts_ms = reader_frame_ts_ms(&writer->reader);
+    if (ts_ms <= writer->last_ts_ms) continue;
+    writer->last_ts_ms = ts_ms;
+
+    int result = proxy_encode_frame(writer, ts_ms);
+    if (result < 0) return result;
+
+    frames++;
+    if (progress && frames % PROXY_PROGRESS_INTERVAL == 0) {
+      progress(progress_user_data, (int)FFMIN(ts_ms, INT_MAX), total);
+    }
+  }
+  if (ret != AVERROR_EOF || frames == 0) return -4;
+
+  if (avcodec_send_frame(writer->enc_ctx, NULL) < 0) return -4;
+  ret = proxy_write_packets(writer);
+  if (ret < 0) return ret;
+  if (av_write_trailer(writer->out_ctx) < 0) return -4;
+
+  if (progress) {
+    progress(progress_user_data, total > 0 ? total : (int)FFMIN(writer->last_ts_ms, INT_MAX),
+             total);
+  }
+  return 0;
+}
+
+int proxy_generate(const char *url, const char *output_path, const ProxyOptions *options,
+                   const bool *cancelled, OnFrameRangeProgressCallback progress,
+                   void *progress_user_data) {
+  if (!url || !output_path || !*output_path || !options || options->height < 0 ||
+      options->quality < 0 || options->quality > 100) {
+    return -1;
+  }
+
+  size_t length = strlen(output_path);
+  char *part_path = (char *)malloc(length + sizeof(".part"));
+  if (!part_path) return -3;
+  memcpy(part_path, output_path, length);
+  memcpy(part_path + length, ".part", sizeof(".part"));
+
+  ProxyWriter writer;
+  int result = proxy_writer_open(&writer, url, output_path, part_path, options);
+  if (result == 0) result = proxy_transcode(&writer, cancelled, progress, progress_user_data);
+  int file_opened = writer.file_opened;
+  proxy_writer_close(&writer);
+
+  if (result == 0) {
+    // rename does not replace an existing file on Windows
+    remove(output_path);
+    if (rename(part_path, output_path) != 0) result = -4;
+  }
+  if (result != 0 && file_opened) remove(part_path);
+  free(part_path);
+  return result;
+}
+
+// --- Proxy Source ---
+
+int proxy_source_open(const char *url, ProxySource **out) {
+  *out = NULL;
+  if (!url) return -1;
+
+  ProxySource *source = (ProxySource *)calloc(1, sizeof(ProxySource));
+  if (!source) return -3;
+  source->url = strdup(url);
+  if (!source->url) {
+    free(source);
+    return -3;
+  }
+
+  // Intra frames decode on their own; extra threads only delay a seek
+  int ret = reader_open(&source->reader, url, 1);
+  if (ret < 0) {
+    free(source->url);
+    free(source);
+    return ret;
+  }
+
+  *out = source;
+  return 0;
+}
+
+void proxy_source_close(ProxySource **source) {
+  if (!source || !*source) return;
+  reader_close(&(*source)->reader);
+  free((*source)->url);
+  free(*source);
+  *source = NULL;
+}
+
+int proxy_source_decode_at(ProxySource *source, int64_t ts_ms, AVRational time_base,
+                           AVFrame *dst) {
+  if (reader_decode_at(&source->reader, ts_ms, 0) < 0) return -1;
+
+  av_frame_unref(dst);
+  if (av_frame_ref(dst, source->reader.frame) < 0) return -1;
+
+  int64_t pts = dst->best_effort_timestamp;
+  if (pts == AV_NOPTS_VALUE) pts = dst->pts;
+  if (pts != AV_NOPTS_VALUE) pts = av_rescale_q(pts, source->reader.time_base, time_base);
+  dst->pts = pts;
+  dst->best_effort_timestamp = pts;
+  return 0;
+}
+
+const char* proxy_source_url(const ProxySource *source) {
+  return source->url;
+}
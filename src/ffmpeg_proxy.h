@@ -0,0 +1,52 @@
+#ifndef FFMPEG_PROXY_H
+#define FFMPEG_PROXY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libavutil/frame.h>
+
+#include "ffmpeg_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Proxy Job ---
+
+// Transcode the video stream of url into an all-intra MJPEG proxy at
+// output_path, at options->height lines (0 = 360, never upscaled). Frames
+// keep their decoded orientation and the display matrix is carried over.
+// The file is written next to output_path and renamed into place once
+// complete. progress reports milliseconds done against the duration.
+// cancelled is polled between frames and may be NULL.
+// Returns 0 on success, negative on failure:
+// -1 invalid options, -2 open failed, -3 out of memory, -4 decoding,
+// encoding or writing failed, -5 no MJPEG encoder, -6 cancelled.
+int proxy_generate(const char *url, const char *output_path, const ProxyOptions *options,
+                   const bool *cancelled, OnFrameRangeProgressCallback progress,
+                   void *progress_user_data);
+
+// --- Proxy Source ---
+//
+// A proxy opened for decoding. Every proxy frame is a keyframe, so a seek
+// costs one decode. Not thread safe.
+
+typedef struct ProxySource ProxySource;
+
+// Returns 0 on success, negative on failure.
+int proxy_source_open(const char *url, ProxySource **out);
+void proxy_source_close(ProxySource **source);
+
+// Decode the first proxy frame at or after ts_ms into dst, with its
+// timestamps rescaled to time_base. Returns 0 on success, -1 on failure.
+int proxy_source_decode_at(ProxySource *source, int64_t ts_ms, AVRational time_base,
+                           AVFrame *dst);
+
+const char* proxy_source_url(const ProxySource *source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_PROXY_H
@@ -0,0 +1,330 @@
+#include "ffmpeg_reader.h"
+#include "ffmpeg_sequence.h"
+
+#include <libavutil/display.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+void reader_get_display_orientation(const AVStream *stream, int *rotation, int *flip) {
+  *rotation = 0;
+  *flip = 0;
+
+  const int32_t *matrix = NULL;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(60, 29, 100)
+  const AVPacketSideData *sd = av_packet_side_data_get(
+      stream->codecpar->coded_side_data, stream->codecpar->nb_coded_side_data,
+      AV_PKT_DATA_DISPLAYMATRIX);
+  if (sd && sd->size >= 9 * sizeof(int32_t)) {
+    matrix = (const int32_t *)sd->data;
+  }
+#else
+  size_t size = 0;
+  matrix = (const int32_t *)av_stream_get_side_data(stream, AV_PKT_DATA_DISPLAYMATRIX, &size);
+  if (size < 9 * sizeof(int32_t)) matrix = NULL;
+#endif
+  if (!matrix) return;
+
+  int32_t m[9];
+  memcpy(m, matrix, sizeof(m));
+
+  // A negative determinant means the image is mirrored as well as rotated
+  if ((int64_t)m[0] * m[4] - (int64_t)m[1] * m[3] < 0) {
+    *flip = 1;
+    av_display_matrix_flip(m, 1, 0);
+  }
+
+  // av_display_rotation_get is counterclockwise, we want clockwise
+  double theta = -av_display_rotation_get(m);
+  if (theta != theta) return;  // NaN for degenerate matrices
+  *rotation = convert_normalize_rotation((int)(theta < 0 ? theta - 0.5 : theta + 0.5));
+}
+
+int reader_open_demuxer(MediaReader *reader, const char *url) {
+  memset(reader, 0, sizeof(*reader));
+  reader->stream_idx = -1;
+
+  if (!url) return -1;
+  // Sequences open as the session did, so frames get the same timestamps
+  double sequence_fps = sequence_lookup_rate(url);
+  if (sequence_fps > 0) {
+    if (sequence_open_input(&reader->fmt_ctx, url, sequence_fps) < 0) return -2;
+  } else if (avformat_open_input(&reader->fmt_ctx, url, NULL, NULL) != 0) {
+    return -2;
+  }
+  if (avformat_find_stream_info(reader->fmt_ctx, NULL) < 0) {
+    reader_close(reader);
+    return -2;
+  }
+
+  int idx = av_find_best_stream(reader->fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+  reader->packet = av_packet_alloc();
+  if (idx < 0 || !reader->packet) {
+    reader_close(reader);
+    return -3;
+  }
+
+  AVStream *stream = reader->fmt_ctx->streams[idx];
+  reader->stream_idx = idx;
+  reader->time_base = stream->time_base;
+
+  int rotation, flip;
+  reader_get_display_orientation(stream, &rotation, &flip);
+  // Mirroring then rotating equals rotating the other way then mirroring
+  reader->display.rotation = flip ? (360 - rotation) % 360 : rotation;
+  reader->display.flip_horizontal = flip;
+  reader->display.flip_vertical = 0;
+
+  return 0;
+}
+
+int reader_open(MediaReader *reader, const char *url, int decoder_threads) {
+  ReaderOptions options = {0};
+  options.decoder_threads = decoder_threads;
+  return reader_open_with(reader, url, &options);
+}
+
+int reader_open_with(MediaReader *reader, const char *url, const ReaderOptions *options) {
+  int ret = reader_open_demuxer(reader, url);
+  if (ret < 0) return ret;
+
+  const AVCodecParameters *par = reader->fmt_ctx->streams[reader->stream_idx]->codecpar;
+  const AVCodec *codec = avcodec_find_decoder(par->codec_id);
+  if (!codec) {
+    reader_close(reader);
+    return -3;
+  }
+
+  reader->codec_ctx = avcodec_alloc_context3(codec);
+  reader->frame = av_frame_alloc();
+  reader->scratch = av_frame_alloc();
+  if (!reader->codec_ctx || !reader->frame || !reader->scratch ||
+      avcodec_parameters_to_context(reader->codec_ctx, par) < 0) {
+    reader_close(reader);
+    return -3;
+  }
+
+  reader->codec_ctx->thread_count = options->decoder_threads;
+  if (options->export_motion_vectors) {
+    reader->codec_ctx->flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+#ifdef AV_CODEC_EXPORT_DATA_MVS
+    reader->codec_ctx->export_side_data |= AV_CODEC_EXPORT_DATA_MVS;
+#endif
+  }
+  if (options->skip_loop_filter) reader->codec_ctx->skip_loop_filter = AVDISCARD_ALL;
+  if (options->slice_threads) reader->codec_ctx->thread_type = FF_THREAD_SLICE;
+  if (avcodec_open2(reader->codec_ctx, codec, NULL) < 0) {
+    reader_close(reader);
+    return -3;
+  }
+
+  return 0;
+}
+
+void reader_close(MediaReader *reader) {
+  if (reader->codec_ctx) avcodec_free_context(&reader->codec_ctx);
+  if (reader->packet) av_packet_free(&reader->packet);
+  if (reader->frame) av_frame_free(&reader->frame);
+  if (reader->scratch) av_frame_free(&reader->scratch);
+  if (reader->fmt_ctx) avformat_close_input(&reader->fmt_ctx);
+  reader->stream_idx = -1;
+}
+
+int64_t reader_frame_ts_ms(const MediaReader *reader) {
+  int64_t pts = reader->frame->best_effort_timestamp;
+  if (pts == AV_NOPTS_VALUE) pts = reader->frame->pts;
+  if (pts == AV_NOPTS_VALUE) return -1;
+  return av_rescale_q(pts, reader->time_base, (AVRational){1, 1000});
+}
+
+// Receive one frame into reader->frame. Frames go through scratch so the
+// previous frame survives EAGAIN/EOF.
+static int reader_receive(MediaReader *reader) {
+  int ret = avcodec_receive_frame(reader->codec_ctx, reader->scratch);
+  if (ret < 0) return ret;
+  av_frame_unref(reader->frame);
+  av_frame_move_ref(reader->frame, reader->scratch);
+  return 0;
+}
+
+int reader_seek(MediaReader *reader, int64_t ts_ms) {
+  if (!reader->fmt_ctx) return -1;
+
+  int64_t target = av_rescale_q(ts_ms, (AVRational){1, 1000}, reader->time_base);
+  if (av_seek_frame(reader->fmt_ctx, reader->stream_idx, target, AVSEEK_FLAG_BACKWARD) < 0) {
+    return -1;
+  }
+  if (reader->codec_ctx) avcodec_flush_buffers(reader->codec_ctx);
+  return 0;
+}
+
+int reader_read_packet(MediaReader *reader) {
+  while (av_read_frame(reader->fmt_ctx, reader->packet) >= 0) {
+    if (reader->packet->stream_index == reader->stream_idx) return 0;
+    av_packet_unref(reader->packet);
+  }
+  return AVERROR_EOF;
+}
+
+int reader_next_frame(MediaReader *reader) {
+  if (!reader->codec_ctx) return -1;
+
+  while (1) {
+    int ret = reader_receive(reader);
+    if (ret == 0) return 0;
+    if (ret != AVERROR(EAGAIN)) return ret == AVERROR_EOF ? AVERROR_EOF : -1;
+
+    // Decoder wants input: feed the next packet of our stream, or flush
+    while (1) {
+      if (reader_read_packet(reader) < 0) {
+        avcodec_send_packet(reader->codec_ctx, NULL);
+        break;
+      }
+      ret = avcodec_send_packet(reader->codec_ctx, reader->packet);
+      av_packet_unref(reader->packet);
+      if (ret >= 0 || ret == AVERROR(EAGAIN)) break;
+    }
+  }
+}
+
+int reader_decode_at(MediaReader *reader, int64_t ts_ms, int keyframe_only) {
+  if (reader_seek(reader, ts_ms) < 0) return -1;
+  reader->codec_ctx->skip_frame = keyframe_only ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+
+  // Near the end of the stream, settle for the last frame
+  int have_frame = 0;
+  while (reader_next_frame(reader) == 0) {
+    have_frame = 1;
+    if (keyframe_only || reader_frame_ts_ms(reader) >= ts_ms) return 0;
+  }
+
+  return have_frame ? 0 : -1;
+}
+
+// --- Reader Threads ---
+
+typedef struct {
+  ReaderThreads *owner;
+  int index;  // Job this thread runs
+  pthread_t thread;
+} ReaderThread;
+
+struct ReaderThreads {
+  ReaderThread *threads;
+  int thread_count;
+  pthread_mutex_t mutex;
+  pthread_cond_t start_cond;
+  pthread_cond_t done_cond;
+  unsigned batch;  // Bumped to start a batch
+  int busy;        // Threads still on the current batch
+  bool quit;
+  void *(*run)(void *);
+  char *jobs;
+  size_t job_size;
+  int job_count;
+};
+
+static void *reader_thread_main(void *arg) {
+  ReaderThread *self = (ReaderThread *)arg;
+  ReaderThreads *threads = self->owner;
+  unsigned batch = 0;
+
+  pthread_mutex_lock(&threads->mutex);
+  for (;;) {
+    while (!threads->quit && threads->batch == batch) {
+      pthread_cond_wait(&threads->start_cond, &threads->mutex);
+    }
+    if (threads->quit) break;
+    batch = threads->batch;
+
+    if (self->index < threads->job_count) {
+      void *(*run)(void *) = threads->run;
+      void *job = threads->jobs + (size_t)self->index * threads->job_size;
+      pthread_mutex_unlock(&threads->mutex);
+      run(job);
+      pthread_mutex_lock(&threads->mutex);
+    }
+    if (--threads->busy == 0) pthread_cond_signal(&threads->done_cond);
+  }
+  pthread_mutex_unlock(&threads->mutex);
+  return NULL;
+}
+
+ReaderThreads *reader_threads_create(int count) {
+  if (count < 2) return NULL;
+
+  ReaderThreads *threads = (ReaderThreads *)calloc(1, sizeof(ReaderThreads));
+  ReaderThread *list = (ReaderThread *)calloc(count - 1, sizeof(ReaderThread));
+  if (!threads || !list) {
+    free(threads);
+    free(list);
+    return NULL;
+  }
+  threads->threads = list;
+  pthread_mutex_init(&threads->mutex, NULL);
+  pthread_cond_init(&threads->start_cond, NULL);
+  pthread_cond_init(&threads->done_cond, NULL);
+
+  // Job 0 runs on the calling thread
+  for (int i = 0; i < count - 1; i++) {
+    list[i].owner = threads;
+    list[i].index = i + 1;
+    if (pthread_create(&list[i].thread, NULL, reader_thread_main, &list[i]) != 0) break;
+    threads->thread_count++;
+  }
+
+  if (threads->thread_count == 0) reader_threads_destroy(&threads);
+  return threads;
+}
+
+void reader_threads_destroy(ReaderThreads **threads) {
+  if (!threads || !*threads) return;
+  ReaderThreads *t = *threads;
+
+  pthread_mutex_lock(&t->mutex);
+  t->quit = true;
+  pthread_cond_broadcast(&t->start_cond);
+  pthread_mutex_unlock(&t->mutex);
+  for (int i = 0; i < t->thread_count; i++) {
+    pthread_join(t->threads[i].thread, NULL);
+  }
+
+  pthread_cond_destroy(&t->done_cond);
+  pthread_cond_destroy(&t->start_cond);
+  pthread_mutex_destroy(&t->mutex);
+  free(t->threads);
+  free(t);
+  *threads = NULL;
+}
+
+void reader_threads_run(ReaderThreads *threads, void *(*run)(void *), void *jobs,
+                        size_t job_size, int count) {
+  if (count <= 0) return;
+  char *bytes = (char *)jobs;
+  int thread_count = threads && count > 1 ? threads->thread_count : 0;
+
+  if (thread_count > 0) {
+    pthread_mutex_lock(&threads->mutex);
+    threads->run = run;
+    threads->jobs = bytes;
+    threads->job_size = job_size;
+    threads->job_count = count;
+    threads->busy = thread_count;
+    threads->batch++;
+    pthread_cond_broadcast(&threads->start_cond);
+    pthread_mutex_unlock(&threads->mutex);
+  }
+
+  // Job 0, then the jobs past the last thread
+  run(bytes);
+  for (int i = thread_count + 1; i < count; i++) {
+    run(bytes + (size_t)i * job_size);
+  }
+
+  if (thread_count > 0) {
+    pthread_mutex_lock(&threads->mutex);
+    while (threads->busy > 0) pthread_cond_wait(&threads->done_cond, &threads->mutex);
+    pthread_mutex_unlock(&threads->mutex);
+  }
+}
@@ -0,0 +1,105 @@
+#ifndef FFMPEG_READER_H
+#define FFMPEG_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+#include "ffmpeg_convert.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Media Reader ---
+//
+// A demuxer and video decoder on their own AVFormatContext. Background jobs
+// open one per thread, so they can seek and decode in parallel without
+// touching the shared playback state.
+
+typedef struct {
+  AVFormatContext *fmt_ctx;
+  AVCodecContext *codec_ctx;
+  AVPacket *packet;
+  AVFrame *frame;      // Last decoded frame
+  AVFrame *scratch;
+  int stream_idx;
+  AVRational time_base;
+  ConvertTransform display;  // Orientation from the display matrix
+} MediaReader;
+
+// Open the best video stream of url for demuxing only; codec_ctx, frame
+// and scratch stay NULL. Returns 0 on success, negative on failure.
+int reader_open_demuxer(MediaReader *reader, const char *url);
+
+// Decoder settings that are read when the decoder opens, so they cannot
+// be changed on an open reader
+typedef struct {
+  int decoder_threads;        // thread_count, 0 lets FFmpeg decide
+  int export_motion_vectors;  // Attach AV_FRAME_DATA_MOTION_VECTORS to frames
+  int skip_loop_filter;       // Skip deblocking
+  int slice_threads;          // No frame threads, which hold frames back a packet per thread
+} ReaderOptions;
+
+// Open the best video stream of url. decoder_threads is passed to the
+// decoder as thread_count (0 lets FFmpeg decide).
+// Returns 0 on success, negative on failure.
+int reader_open(MediaReader *reader, const char *url, int decoder_threads);
+
+// reader_open with the decoder set up by options.
+int reader_open_with(MediaReader *reader, const char *url, const ReaderOptions *options);
+void reader_close(MediaReader *reader);
+
+// Seek to the keyframe at or before ts_ms and reset the decoder.
+// Returns 0 on success, negative on failure.
+int reader_seek(MediaReader *reader, int64_t ts_ms);
+
+// Read the next packet of the video stream into reader->packet, which
+// the caller unrefs. Returns 0 on success, AVERROR_EOF at the end.
+int reader_read_packet(MediaReader *reader);
+
+// Decode the next frame in stream order into reader->frame.
+// Returns 0 on success, AVERROR_EOF at the end, negative on failure.
+int reader_next_frame(MediaReader *reader);
+
+// Seek and decode the first frame at or after ts_ms into reader->frame.
+// With keyframe_only, the keyframe the seek lands on is returned instead,
+// which skips decoding the rest of the GOP. Near the end of the stream the
+// last decoded frame is returned.
+// Returns 0 on success, negative on failure.
+int reader_decode_at(MediaReader *reader, int64_t ts_ms, int keyframe_only);
+
+// Timestamp of reader->frame in milliseconds.
+int64_t reader_frame_ts_ms(const MediaReader *reader);
+
+// Orientation needed to display a stream upright, from its display matrix.
+// rotation is clockwise in degrees, applied after a horizontal flip when
+// flip is set.
+void reader_get_display_orientation(const AVStream *stream, int *rotation, int *flip);
+
+// --- Reader Threads ---
+//
+// Threads for running one job per reader in parallel. The calling thread
+// runs the first job, and the threads wait between batches, so pools that
+// decode batch after batch start them once.
+
+typedef struct ReaderThreads ReaderThreads;
+
+// Start threads for jobs 1 to count - 1. Returns NULL when none could be
+// started, in which case reader_threads_run runs every job itself.
+ReaderThreads *reader_threads_create(int count);
+void reader_threads_destroy(ReaderThreads **threads);
+
+// Call run on each of count jobs laid out job_size bytes apart, and
+// return once all are done. Jobs without a thread run on the calling
+// thread. threads may be NULL.
+void reader_threads_run(ReaderThreads *threads, void *(*run)(void *), void *jobs,
+                        size_t job_size, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_READER_H
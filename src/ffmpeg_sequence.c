@@ -0,0 +1,414 @@
+#include "ffmpeg_sequence.h"
+#include "ffmpeg_intra.h"
+#include "ffmpeg_reader.h"
+
+#include <libavutil/cpu.h>
+#include <libavutil/dict.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 28
+#define SEQUENCE_GLOB_SUPPORTED 1
+#include <glob.h>
+#endif
+#endif
+
+#define SEQUENCE_PATH_MAX 4096
+#define SEQUENCE_START_RANGE 5  // image2 looks for the first image in 0..4
+#define SEQUENCE_MAX_RATES 16
+#define SEQUENCE_MAX_WORKERS 16
+
+struct ImageSequence {
+  char *pattern;
+  int start_number;  // Of a printf pattern
+  char **paths;      // Of a glob, sorted
+  int count;
+
+  // Images last advised to the OS
+  int64_t advised_first;
+  int64_t advised_end;
+};
+
+typedef struct {
+  char *pattern;
+  double fps;
+} SequenceRate;
+
+typedef struct {
+  const ImageSequence *sequence;
+  AVCodecContext *codec_ctx;
+  AVPacket *packet;
+  const int64_t *indices;
+  AVFrame **frames;
+  int first;
+  int count;
+  const bool *cancelled;
+  int decoded;
+} SequenceWorker;
+
+struct SequencePool {
+  SequenceWorker *workers;
+  int worker_count;
+  ReaderThreads *threads;  // Kept between batches
+};
+
+static SequenceRate g_sequence_rates[SEQUENCE_MAX_RATES];
+static int g_sequence_rate_next = 0;
+static pthread_mutex_t g_sequence_rate_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+bool sequence_is_glob(const char *pattern) {
+  return strpbrk(pattern, "*?[") != NULL;
+}
+
+static bool sequence_file_exists(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0;
+}
+
+static int sequence_expand_numbered(ImageSequence *sequence) {
+  char path[SEQUENCE_PATH_MAX];
+
+  int start = -1;
+  for (int n = 0; n < SEQUENCE_START_RANGE && start < 0; n++) {
+    // Fails unless the pattern has exactly one number
+    if (av_get_frame_filename(path, sizeof(path), sequence->pattern, n) < 0) return -1;
+    if (sequence_file_exists(path)) start = n;
+  }
+  if (start < 0) return -1;
+
+  // Like image2, the sequence ends at the first missing number
+  int count = 1;
+  while (count < INT_MAX - start &&
+         av_get_frame_filename(path, sizeof(path), sequence->pattern, start + count) == 0 &&
+         sequence_file_exists(path)) {
+    count++;
+  }
+
+  sequence->start_number = start;
+  sequence->count = count;
+  return 0;
+}
+
+static int sequence_expand_glob(ImageSequence *sequence) {
+#ifdef SEQUENCE_GLOB_SUPPORTED
+  glob_t matches;
+  if (glob(sequence->pattern, 0, NULL, &matches) != 0) return -1;
+  if (matches.gl_pathc == 0 || matches.gl_pathc > INT_MAX) {
+    globfree(&matches);
+    return -1;
+  }
+
+  sequence->paths = (char **)calloc(matches.gl_pathc, sizeof(char *));
+  if (!sequence->paths) {
+    globfree(&matches);
+    return -3;
+  }
+  // Name order, as glob sorts and image2 reads
+  for (size_t i = 0; i < matches.gl_pathc; i++) {
+    sequence->paths[i] = strdup(matches.gl_pathv[i]);
+    if (!sequence->paths[i]) {
+      globfree(&matches);
+      return -3;
+    }
+    sequence->count++;
+  }
+  globfree(&matches);
+  return 0;
+#else
+  (void)sequence;
+  return -2;
+#endif
+}
+
+int sequence_open(const char *pattern, ImageSequence **out) {
+  *out = NULL;
+  if (!pattern) return -1;
+
+  ImageSequence *sequence = (ImageSequence *)calloc(1, sizeof(ImageSequence));
+  if (!sequence) return -3;
+  sequence->pattern = strdup(pattern);
+  if (!sequence->pattern) {
+    free(sequence);
+    return -3;
+  }
+
+  int ret = sequence_is_glob(pattern) ? sequence_expand_glob(sequence)
+                                      : sequence_expand_numbered(sequence);
+  if (ret < 0) {
+    sequence_close(&sequence);
+    return ret;
+  }
+
+  *out = sequence;
+  return 0;
+}
+
+void sequence_close(ImageSequence **sequence) {
+  if (!sequence || !*sequence) return;
+  if ((*sequence)->paths) {
+    for (int i = 0; i < (*sequence)->count; i++) free((*sequence)->paths[i]);
+    free((*sequence)->paths);
+  }
+  free((*sequence)->pattern);
+  free(*sequence);
+  *sequence = NULL;
+}
+
+int sequence_count(const ImageSequence *sequence) {
+  return sequence->count;
+}
+
+int sequence_path(const ImageSequence *sequence, int64_t index, char *buf, size_t size) {
+  if (index < 0 || index >= sequence->count) return -1;
+
+  if (sequence->paths) {
+    size_t length = strlen(sequence->paths[index]);
+    if (length >= size) return -1;
+    memcpy(buf, sequence->paths[index], length + 1);
+    return 0;
+  }
+  return av_get_frame_filename(buf, (int)FFMIN(size, INT_MAX), sequence->pattern,
+                               sequence->start_number + (int)index) < 0 ? -1 : 0;
+}
+
+int sequence_open_input(AVFormatContext **fmt_ctx, const char *pattern, double fps) {
+  const AVInputFormat *format = av_find_input_format("image2");
+  if (!format || fps <= 0) return -2;
+
+  AVRational rate = av_d2q(fps, 1001000);
+  char rate_str[32];
+  snprintf(rate_str, sizeof(rate_str), "%d/%d", rate.num, rate.den);
+
+  AVDictionary *options = NULL;
+  av_dict_set(&options, "framerate", rate_str, 0);
+  av_dict_set(&options, "pattern_type", sequence_is_glob(pattern) ? "glob" : "sequence", 0);
+  int ret = avformat_open_input(fmt_ctx, pattern, format, &options);
+  av_dict_free(&options);
+  return ret == 0 ? 0 : -2;
+}
+
+void sequence_register_rate(const char *pattern, double fps) {
+  pthread_mutex_lock(&g_sequence_rate_mutex);
+
+  SequenceRate *slot = NULL;
+  for (int i = 0; i < SEQUENCE_MAX_RATES && !slot; i++) {
+    if (g_sequence_rates[i].pattern && strcmp(g_sequence_rates[i].pattern, pattern) == 0) {
+      slot = &g_sequence_rates[i];
+    }
+  }
+  // Otherwise the oldest entry makes way
+  if (!slot) {
+    slot = &g_sequence_rates[g_sequence_rate_next];
+    g_sequence_rate_next = (g_sequence_rate_next + 1) % SEQUENCE_MAX_RATES;
+    free(slot->pattern);
+    slot->pattern = strdup(pattern);
+  }
+  slot->fps = slot->pattern ? fps : 0.0;
+
+  pthread_mutex_unlock(&g_sequence_rate_mutex);
+}
+
+double sequence_lookup_rate(const char *url) {
+  double fps = 0.0;
+  pthread_mutex_lock(&g_sequence_rate_mutex);
+  for (int i = 0; i < SEQUENCE_MAX_RATES; i++) {
+    if (g_sequence_rates[i].pattern && strcmp(g_sequence_rates[i].pattern, url) == 0) {
+      fps = g_sequence_rates[i].fps;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_sequence_rate_mutex);
+  return fps;
+}
+
+#ifndef _WIN32
+static void sequence_advise_file(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return;
+#if defined(POSIX_FADV_WILLNEED)
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#elif defined(F_RDADVISE)
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    struct radvisory advice = { .ra_offset = 0, .ra_count = (int)FFMIN(st.st_size, INT_MAX) };
+    fcntl(fd, F_RDADVISE, &advice);
+  }
+#endif
+  close(fd);
+}
+#endif
+
+void sequence_prefetch(ImageSequence *sequence, int64_t first, int count) {
+#ifndef _WIN32
+  int64_t end = FFMIN(first + count, (int64_t)sequence->count);
+  if (first < 0 || first >= end) return;
+
+  // Within the advised run only the images past it are new
+  int64_t start = first;
+  if (first >= sequence->advised_first && first <= sequence->advised_end) {
+    start = FFMAX(first, sequence->advised_end);
+  } else {
+    sequence->advised_first = first;
+    sequence->advised_end = first;
+  }
+
+  char path[SEQUENCE_PATH_MAX];
+  for (int64_t i = start; i < end; i++) {
+    if (sequence_path(sequence, i, path, sizeof(path)) == 0) sequence_advise_file(path);
+  }
+  if (end > sequence->advised_end) sequence->advised_end = end;
+#else
+  (void)sequence;
+  (void)first;
+  (void)count;
+#endif
+}
+
+// Read a whole file into packet
+static int sequence_read_file(const char *path, AVPacket *packet) {
+  FILE *file = fopen(path, "rb");
+  if (!file) return -1;
+
+  int ret = -1;
+  long size = -1;
+  if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+  if (size > 0 && size <= INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE &&
+      fseek(file, 0, SEEK_SET) == 0 && av_new_packet(packet, (int)size) == 0) {
+    if (fread(packet->data, 1, (size_t)size, file) == (size_t)size) {
+      ret = 0;
+    } else {
+      av_packet_unref(packet);
+    }
+  }
+  fclose(file);
+  return ret;
+}
+
+int sequence_decode_image(const ImageSequence *sequence, int64_t index,
+                          AVCodecContext *codec_ctx, AVPacket *packet, AVFrame *frame) {
+  char path[SEQUENCE_PATH_MAX];
+  if (sequence_path(sequence, index, path, sizeof(path)) < 0) return -1;
+  if (sequence_read_file(path, packet) < 0) return -1;
+
+  // Every image is a keyframe, and its index its pts
+  packet->pts = index;
+  packet->dts = index;
+  packet->flags |= AV_PKT_FLAG_KEY;
+  int ret = intra_decode_packet(codec_ctx, packet, frame);
+  av_packet_unref(packet);
+  if (ret < 0) return -1;
+
+  if (frame->pts == AV_NOPTS_VALUE) frame->pts = index;
+  return 0;
+}
+
+// --- Sequence Decoder Pool ---
+
+static void *sequence_worker_run(void *arg) {
+  SequenceWorker *worker = (SequenceWorker *)arg;
+
+  for (int i = worker->first; i < worker->first + worker->count; i++) {
+    if (worker->cancelled && *worker->cancelled) break;
+
+    AVFrame *frame = worker->frames[i];
+    av_frame_unref(frame);
+    if (sequence_decode_image(worker->sequence, worker->indices[i], worker->codec_ctx,
+                              worker->packet, frame) == 0) {
+      worker->decoded++;
+    }
+  }
+
+  return NULL;
+}
+
+int sequence_pool_open(const ImageSequence *sequence, const AVCodecParameters *codecpar,
+                       int worker_count, SequencePool **out) {
+  *out = NULL;
+  const AVCodec *codec = avcodec_find_decoder(codecpar->codec_id);
+  if (!codec) return -1;
+
+  if (worker_count <= 0) worker_count = av_cpu_count();
+  if (worker_count > SEQUENCE_MAX_WORKERS) worker_count = SEQUENCE_MAX_WORKERS;
+  if (worker_count < 1) worker_count = 1;
+
+  SequencePool *pool = (SequencePool *)calloc(1, sizeof(SequencePool));
+  SequenceWorker *workers = (SequenceWorker *)calloc(worker_count, sizeof(SequenceWorker));
+  if (!pool || !workers) {
+    free(pool);
+    free(workers);
+    return -3;
+  }
+  pool->workers = workers;
+
+  // Images are decoded in parallel across decoders, one thread each
+  for (int i = 0; i < worker_count; i++) {
+    SequenceWorker *worker = &workers[i];
+    worker->sequence = sequence;
+    worker->codec_ctx = avcodec_alloc_context3(codec);
+    worker->packet = av_packet_alloc();
+    pool->worker_count++;
+    if (!worker->codec_ctx || !worker->packet) {
+      sequence_pool_close(&pool);
+      return -3;
+    }
+
+    worker->codec_ctx->thread_count = 1;
+    if (avcodec_parameters_to_context(worker->codec_ctx, codecpar) < 0 ||
+        avcodec_open2(worker->codec_ctx, codec, NULL) < 0) {
+      sequence_pool_close(&pool);
+      return -1;
+    }
+  }
+  pool->threads = reader_threads_create(worker_count);
+
+  *out = pool;
+  return 0;
+}
+
+void sequence_pool_close(SequencePool **pool) {
+  if (!pool || !*pool) return;
+  reader_threads_destroy(&(*pool)->threads);
+  for (int i = 0; i < (*pool)->worker_count; i++) {
+    avcodec_free_context(&(*pool)->workers[i].codec_ctx);
+    av_packet_free(&(*pool)->workers[i].packet);
+  }
+  free((*pool)->workers);
+  free(*pool);
+  *pool = NULL;
+}
+
+int sequence_pool_worker_count(const SequencePool *pool) {
+  return pool->worker_count;
+}
+
+int sequence_pool_decode(SequencePool *pool, const int64_t *indices, int count,
+                         AVFrame **frames, const bool *cancelled) {
+  int worker_count = pool->worker_count < count ? pool->worker_count : count;
+
+  // Contiguous runs, so each decoder reads neighbouring files
+  int first = 0;
+  for (int i = 0; i < worker_count; i++) {
+    SequenceWorker *worker = &pool->workers[i];
+    worker->indices = indices;
+    worker->frames = frames;
+    worker->first = first;
+    worker->count = count / worker_count + (i < count % worker_count ? 1 : 0);
+    worker->cancelled = cancelled;
+    worker->decoded = 0;
+    first += worker->count;
+  }
+
+  reader_threads_run(pool->threads, sequence_worker_run, pool->workers, sizeof(SequenceWorker),
+                     worker_count);
+
+  int decoded = 0;
+  for (int i = 0; i < worker_count; i++) decoded += pool->workers[i].decoded;
+  return decoded;
+}
@@ -0,0 +1,87 @@
+#ifndef FFMPEG_SEQUENCE_H
+#define FFMPEG_SEQUENCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Image Sequences ---
+//
+// Numbered stills opened as one video stream. A pattern is either printf
+// style, "shot_%04d.png", numbered from the first of 0..4 that exists up
+// to the first missing number, or a glob, "shot_*.exr", in name order.
+// Both match what the image2 demuxer reads, so frame i of the stream is
+// image i of the list, and with image2's time base its pts is i too.
+
+typedef struct ImageSequence ImageSequence;
+
+// Whether pattern is a glob rather than a printf pattern.
+bool sequence_is_glob(const char *pattern);
+
+// List the images of pattern. Returns 0 on success, -1 if nothing
+// matches, -2 for a glob where globbing is unsupported (Windows, Android
+// before API 28), -3 out of memory.
+int sequence_open(const char *pattern, ImageSequence **out);
+void sequence_close(ImageSequence **sequence);
+
+int sequence_count(const ImageSequence *sequence);
+
+// Path of image index into buf. Returns 0 on success, -1 out of range or
+// too long for buf.
+int sequence_path(const ImageSequence *sequence, int64_t index, char *buf, size_t size);
+
+// Open pattern through the image2 demuxer at fps frames per second.
+// Returns 0 on success, -2 on failure.
+int sequence_open_input(AVFormatContext **fmt_ctx, const char *pattern, double fps);
+
+// Remember the frame rate pattern was opened at, so readers opening the
+// same pattern for background jobs number its frames alike.
+void sequence_register_rate(const char *pattern, double fps);
+
+// Frame rate url was registered with, 0 if it is not a sequence.
+double sequence_lookup_rate(const char *url);
+
+// Ask the OS to read images first .. first + count - 1 into the page
+// cache in the background. Images advised since the last jump are skipped.
+// No-op where the OS has no such hint.
+void sequence_prefetch(ImageSequence *sequence, int64_t first, int count);
+
+// Decode image index into frame, its pts set to index, reading the whole
+// file as one packet. The decoder is not flushed. packet is scratch.
+// Returns 0 on success, -1 on failure.
+int sequence_decode_image(const ImageSequence *sequence, int64_t index,
+                          AVCodecContext *codec_ctx, AVPacket *packet, AVFrame *frame);
+
+// --- Sequence Decoder Pool ---
+//
+// Decoders of one sequence, which decode different images on as many
+// threads. The sequence must outlive the pool. Not thread safe.
+
+typedef struct SequencePool SequencePool;
+
+// Open worker_count decoders (0 = one per core) for images described by
+// codecpar. Returns 0 on success, -1 no decoder, -3 out of memory.
+int sequence_pool_open(const ImageSequence *sequence, const AVCodecParameters *codecpar,
+                       int worker_count, SequencePool **out);
+void sequence_pool_close(SequencePool **pool);
+
+int sequence_pool_worker_count(const SequencePool *pool);
+
+// Decode image indices[i] into frames[i] for i in [0, count), spread over
+// the decoders, which run in parallel. An image that failed to decode or
+// is out of range is left without buffers. cancelled may be NULL.
+// Returns the number of images decoded.
+int sequence_pool_decode(SequencePool *pool, const int64_t *indices, int count,
+                         AVFrame **frames, const bool *cancelled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_SEQUENCE_H
@@ -0,0 +1,439 @@
+#include "ffmpeg_shm.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(__ANDROID__)
+#define SHM_SUPPORTED 1
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(SHM_SUPPORTED) && defined(__linux__)
+#define SHM_HAVE_FUTEX 1
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define SHM_ALIGN 64
+#define SHM_WRITER_POLL_MS 50  // How often a blocked writer rechecks cancellation
+#define SHM_READER_POLL_MS 1   // Polling interval without futexes
+
+#define SHM_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SHM_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+struct ShmRing {
+  char *name;
+  uint8_t *base;
+  size_t size;
+  ShmRingHeader *header;
+  uint32_t next;  // Number of the next slot to write
+};
+
+struct ShmRingReader {
+  uint8_t *base;
+  size_t size;
+  ShmRingHeader *header;
+  uint32_t next;           // Number of the next frame to read
+  ShmSlotHeader *acquired;
+  uint32_t acquired_sequence;
+};
+
+#ifdef SHM_SUPPORTED
+
+// --- Signaling ---
+
+// Wait while *word == expected, at most timeout_ms (-1 for no limit). May
+// return early; callers recheck.
+static void shm_wait(uint32_t *word, uint32_t expected, int timeout_ms) {
+#ifdef SHM_HAVE_FUTEX
+  struct timespec ts = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+  // Not FUTEX_PRIVATE: the word is shared with other processes
+  syscall(SYS_futex, word, FUTEX_WAIT, expected, timeout_ms >= 0 ? &ts : NULL, NULL, 0);
+#else
+  if (SHM_LOAD(word) != expected) return;
+  int sleep_ms = timeout_ms >= 0 && timeout_ms < SHM_READER_POLL_MS ? timeout_ms
+                                                                    : SHM_READER_POLL_MS;
+  struct timespec ts = { 0, (long)sleep_ms * 1000000L };
+  nanosleep(&ts, NULL);
+#endif
+}
+
+static void shm_wake(uint32_t *word) {
+#ifdef SHM_HAVE_FUTEX
+  syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#else
+  (void)word;
+#endif
+}
+
+static int64_t shm_now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static ShmSlotHeader *shm_slot(uint8_t *base, const ShmRingHeader *header, uint32_t number) {
+  size_t index = number % header->slot_count;
+  return (ShmSlotHeader *)(base + header->header_size + index * header->slot_stride);
+}
+
+// Map the ring another writer created and check its layout
+static ShmRingHeader *shm_map_existing(const char *name, size_t *out_size) {
+  if (!name) return NULL;
+
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) return NULL;
+
+  struct stat st;
+  void *base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ShmRingHeader)) {
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) return NULL;
+
+  ShmRingHeader *header = (ShmRingHeader *)base;
+  size_t size = (size_t)st.st_size;
+  if (SHM_LOAD(&header->magic) != SHM_RING_MAGIC || header->version != SHM_RING_VERSION ||
+      header->slot_count == 0 ||
+      header->header_size + header->slot_stride * header->slot_count > size) {
+    munmap(base, size);
+    return NULL;
+  }
+  *out_size = size;
+  return header;
+}
+
+// --- Writer ---
+
+int shm_ring_create(const char *name, int slot_count, size_t slot_capacity, int blocking,
+                    ShmRing **out_ring) {
+  *out_ring = NULL;
+  if (!name || name[0] != '/' || slot_count < 1 || slot_capacity == 0) return -1;
+
+  size_t header_size = (sizeof(ShmRingHeader) + SHM_ALIGN - 1) & ~(size_t)(SHM_ALIGN - 1);
+  size_t slot_header_size = (sizeof(ShmSlotHeader) + SHM_ALIGN - 1) & ~(size_t)(SHM_ALIGN - 1);
+  size_t slot_stride = (slot_header_size + slot_capacity + SHM_ALIGN - 1) &
+                       ~(size_t)(SHM_ALIGN - 1);
+  if (slot_stride > (SIZE_MAX - header_size) / (size_t)slot_count) return -1;
+  size_t size = header_size + slot_stride * slot_count;
+
+  ShmRing *ring = (ShmRing *)calloc(1, sizeof(ShmRing));
+  if (!ring) return -1;
+  ring->name = strdup(name);
+
+  int fd = ring->name ? shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600) : -1;
+  if (fd < 0) {
+    free(ring->name);
+    free(ring);
+    return -1;
+  }
+
+  void *base = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) == 0) {
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(name);
+    free(ring->name);
+    free(ring);
+    return -1;
+  }
+
+  ring->base = (uint8_t *)base;
+  ring->size = size;
+  ring->header = (ShmRingHeader *)base;
+
+  // ftruncate zero-filled the object, so only the layout needs writing.
+  // The magic goes last: readers treat the ring as ready once it is set.
+  ShmRingHeader *header = ring->header;
+  header->version = SHM_RING_VERSION;
+  header->slot_count = (uint32_t)slot_count;
+  header->header_size = (uint32_t)header_size;
+  header->slot_header_size = (uint32_t)slot_header_size;
+  header->blocking = blocking ? 1 : 0;
+  header->slot_stride = slot_stride;
+  header->slot_capacity = slot_capacity;
+  SHM_STORE(&header->magic, SHM_RING_MAGIC);
+
+  *out_ring = ring;
+  return 0;
+}
+
+void shm_ring_wake(ShmRing *ring) {
+  if (!ring) return;
+  SHM_STORE(&ring->header->closed, 1);
+  shm_wake(&ring->header->write_count);
+  shm_wake(&ring->header->read_count);
+}
+
+void shm_ring_destroy(ShmRing **ring) {
+  if (!ring || !*ring) return;
+  shm_ring_wake(*ring);
+  munmap((*ring)->base, (*ring)->size);
+  shm_unlink((*ring)->name);
+  free((*ring)->name);
+  free(*ring);
+  *ring = NULL;
+}
+
+int shm_ring_attach(const char *name, ShmRing **out_ring) {
+  *out_ring = NULL;
+  size_t size = 0;
+  ShmRingHeader *header = shm_map_existing(name, &size);
+  if (!header) return -1;
+
+  ShmRing *ring = (ShmRing *)calloc(1, sizeof(ShmRing));
+  if (!ring) {
+    munmap(header, size);
+    return -1;
+  }
+  ring->base = (uint8_t *)header;
+  ring->size = size;
+  ring->header = header;
+  ring->next = SHM_LOAD(&header->write_count);
+  *out_ring = ring;
+  return 0;
+}
+
+void shm_ring_detach(ShmRing **ring) {
+  if (!ring || !*ring) return;
+  munmap((*ring)->base, (*ring)->size);
+  free((*ring)->name);
+  free(*ring);
+  *ring = NULL;
+}
+
+ShmSlotHeader *shm_ring_begin_write(ShmRing *ring, const bool *cancelled, uint8_t **pixels) {
+  return shm_ring_begin_write_timeout(ring, cancelled, -1, pixels);
+}
+
+ShmSlotHeader *shm_ring_begin_write_timeout(ShmRing *ring, const bool *cancelled, int timeout_ms,
+                                            uint8_t **pixels) {
+  ShmRingHeader *header = ring->header;
+  int64_t deadline = timeout_ms >= 0 ? shm_now_ms() + timeout_ms : INT64_MAX;
+
+  // Never lap a blocking reader: the slot must have been released
+  while (header->blocking) {
+    uint32_t read_count = SHM_LOAD(&header->read_count);
+    if (ring->next - read_count < header->slot_count) break;
+    if ((cancelled && *cancelled) || SHM_LOAD(&header->closed)) return NULL;
+    int64_t left = deadline - shm_now_ms();
+    if (left <= 0) return NULL;
+    shm_wait(&header->read_count, read_count,
+             left < SHM_WRITER_POLL_MS ? (int)left : SHM_WRITER_POLL_MS);
+  }
+  if ((cancelled && *cancelled) || SHM_LOAD(&header->closed)) return NULL;
+
+  ShmSlotHeader *slot = shm_slot(ring->base, header, ring->next);
+  uint32_t sequence = slot->sequence + 1;
+  SHM_STORE(&slot->sequence, sequence);
+  // Order the odd sequence before the payload stores that follow
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  slot->number = ring->next;
+  slot->flags = 0;
+  slot->size = 0;
+  *pixels = (uint8_t *)slot + header->slot_header_size;
+  return slot;
+}
+
+void shm_ring_publish(ShmRing *ring, ShmSlotHeader *slot) {
+  SHM_STORE(&slot->sequence, slot->sequence + 1);
+  ring->next++;
+  SHM_STORE(&ring->header->write_count, ring->next);
+  shm_wake(&ring->header->write_count);
+}
+
+size_t shm_ring_slot_capacity(const ShmRing *ring) {
+  return (size_t)ring->header->slot_capacity;
+}
+
+// --- Reader ---
+
+ShmRingReader *ffmpeg_shm_reader_open(const char *name) {
+  size_t size = 0;
+  ShmRingHeader *header = shm_map_existing(name, &size);
+  if (!header) return NULL;
+
+  ShmRingReader *reader = (ShmRingReader *)calloc(1, sizeof(ShmRingReader));
+  if (!reader) {
+    munmap(header, size);
+    return NULL;
+  }
+  reader->base = (uint8_t *)header;
+  reader->size = size;
+  reader->header = header;
+  // Blocking readers pick up where the last one released; others join live
+  reader->next = header->blocking ? SHM_LOAD(&header->read_count)
+                                  : SHM_LOAD(&header->write_count);
+  return reader;
+}
+
+void ffmpeg_shm_reader_close(ShmRingReader *reader) {
+  if (!reader) return;
+  munmap(reader->base, reader->size);
+  free(reader);
+}
+
+int ffmpeg_shm_reader_acquire(ShmRingReader *reader, int timeout_ms, ShmFrameView *view) {
+  ShmRingHeader *header = reader->header;
+  int64_t deadline = timeout_ms >= 0 ? shm_now_ms() + timeout_ms : 0;
+
+  memset(view, 0, sizeof(*view));
+  reader->acquired = NULL;
+
+  while (true) {
+    uint32_t write_count = SHM_LOAD(&header->write_count);
+
+    if (write_count == reader->next) {
+      if (SHM_LOAD(&header->closed)) return -1;
+      int wait_ms = -1;
+      if (timeout_ms >= 0) {
+        int64_t left = deadline - shm_now_ms();
+        if (left <= 0) return 1;
+        wait_ms = (int)left;
+      }
+      shm_wait(&header->write_count, write_count, wait_ms);
+      continue;
+    }
+
+    // Skip whatever the writer has already overwritten
+    if (write_count - reader->next > header->slot_count) {
+      uint32_t skipped = write_count - header->slot_count - reader->next;
+      view->dropped += skipped;
+      reader->next += skipped;
+    }
+
+    ShmSlotHeader *slot = shm_slot(reader->base, header, reader->next);
+    uint32_t sequence = SHM_LOAD(&slot->sequence);
+    if ((sequence & 1) || slot->number != reader->next) {
+      // Being rewritten for a later frame: ours is gone
+      view->dropped++;
+      reader->next++;
+      continue;
+    }
+
+    view->data = (const uint8_t *)slot + header->slot_header_size;
+    view->width = slot->width;
+    view->height = slot->height;
+    view->linesize = slot->linesize;
+    view->format = slot->format;
+    view->pts_ms = slot->pts_ms;
+    view->frame_id = slot->frame_id;
+    view->size = (size_t)slot->size;
+    view->end_of_stream = (slot->flags & SHM_SLOT_END_OF_STREAM) != 0;
+
+    // The header copy must not be torn either
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (SHM_LOAD(&slot->sequence) != sequence || view->size > header->slot_capacity) {
+      continue;
+    }
+
+    reader->acquired = slot;
+    reader->acquired_sequence = sequence;
+    return 0;
+  }
+}
+
+int ffmpeg_shm_reader_release(ShmRingReader *reader) {
+  ShmSlotHeader *slot = reader->acquired;
+  if (!slot) return -1;
+
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  int intact = SHM_LOAD(&slot->sequence) == reader->acquired_sequence;
+
+  reader->acquired = NULL;
+  reader->next++;
+  if (reader->header->blocking) {
+    SHM_STORE(&reader->header->read_count, reader->next);
+    shm_wake(&reader->header->read_count);
+  }
+  return intact ? 0 : -1;
+}
+
+#else
+
+int shm_ring_create(const char *name, int slot_count, size_t slot_capacity, int blocking,
+                    ShmRing **out_ring) {
+  (void)name;
+  (void)slot_count;
+  (void)slot_capacity;
+  (void)blocking;
+  *out_ring = NULL;
+  return -2;
+}
+
+void shm_ring_destroy(ShmRing **ring) {
+  (void)ring;
+}
+
+int shm_ring_attach(const char *name, ShmRing **out_ring) {
+  (void)name;
+  *out_ring = NULL;
+  return -2;
+}
+
+void shm_ring_detach(ShmRing **ring) {
+  (void)ring;
+}
+
+void shm_ring_wake(ShmRing *ring) {
+  (void)ring;
+}
+
+ShmSlotHeader *shm_ring_begin_write(ShmRing *ring, const bool *cancelled, uint8_t **pixels) {
+  (void)ring;
+  (void)cancelled;
+  (void)pixels;
+  return NULL;
+}
+
+ShmSlotHeader *shm_ring_begin_write_timeout(ShmRing *ring, const bool *cancelled, int timeout_ms,
+                                            uint8_t **pixels) {
+  (void)ring;
+  (void)cancelled;
+  (void)timeout_ms;
+  (void)pixels;
+  return NULL;
+}
+
+void shm_ring_publish(ShmRing *ring, ShmSlotHeader *slot) {
+  (void)ring;
+  (void)slot;
+}
+
+size_t shm_ring_slot_capacity(const ShmRing *ring) {
+  (void)ring;
+  return 0;
+}
+
+ShmRingReader *ffmpeg_shm_reader_open(const char *name) {
+  (void)name;
+  return NULL;
+}
+
+void ffmpeg_shm_reader_close(ShmRingReader *reader) {
+  (void)reader;
+}
+
+int ffmpeg_shm_reader_acquire(ShmRingReader *reader, int timeout_ms, ShmFrameView *view) {
+  (void)reader;
+  (void)timeout_ms;
+  (void)view;
+  return -1;
+}
+
+int ffmpeg_shm_reader_release(ShmRingReader *reader) {
+  (void)reader;
+  return -1;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef FFMPEG_SHM_H
+#define FFMPEG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffmpeg_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Shared Memory Ring Writer ---
+//
+// The producer side of the ring described in ffmpeg_core.h. One thread
+// writes; shm_ring_wake may be called from any thread.
+
+typedef struct ShmRing ShmRing;
+
+// Create (or replace) the shared memory object name and map it.
+// Returns 0 on success, -1 on failure, -2 where shared memory is not
+// supported.
+int shm_ring_create(const char *name, int slot_count, size_t slot_capacity, int blocking,
+                    ShmRing **out_ring);
+
+// Mark the ring closed, unmap and unlink it.
+void shm_ring_destroy(ShmRing **ring);
+
+// Map a ring created elsewhere, typically by another process, to write
+// into it. Writing continues after the last published slot; only one
+// writer may use the ring at a time. Returns 0 on success, -1 on failure,
+// -2 where shared memory is not supported.
+int shm_ring_attach(const char *name, ShmRing **out_ring);
+
+// Unmap a ring from shm_ring_attach, leaving it open for its creator.
+void shm_ring_detach(ShmRing **ring);
+
+// Mark the ring closed and wake every waiter, without unmapping it.
+void shm_ring_wake(ShmRing *ring);
+
+// Claim the next slot and mark it as being written. In blocking mode this
+// waits until the reader has released it. Returns NULL when cancelled or
+// the ring is closed. *pixels receives the slot's pixel area.
+ShmSlotHeader *shm_ring_begin_write(ShmRing *ring, const bool *cancelled, uint8_t **pixels);
+
+// shm_ring_begin_write waiting at most timeout_ms (-1 for no limit) for
+// the reader. Also returns NULL on timeout.
+ShmSlotHeader *shm_ring_begin_write_timeout(ShmRing *ring, const bool *cancelled, int timeout_ms,
+                                            uint8_t **pixels);
+
+// Publish the slot claimed by shm_ring_begin_write and wake readers.
+void shm_ring_publish(ShmRing *ring, ShmSlotHeader *slot);
+
+size_t shm_ring_slot_capacity(const ShmRing *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_SHM_H
@@ -0,0 +1,276 @@
+#include "ffmpeg_spill.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#define SPILL_SUPPORTED 1
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SPILL_MAGIC 0x4C505346  // "FSPL"
+#define SPILL_VERSION 1
+#define SPILL_ALIGN 64
+#define SPILL_HEADER_SIZE 4096
+#define SPILL_BYTES_PER_SLOT (256 * 1024)  // Capacity per index slot
+#define SPILL_MIN_SLOTS 64
+#define SPILL_MAX_SLOTS 16384
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_size;  // sizeof(FrameSpillRecord), to reject other builds
+  uint32_t slot_count;
+  uint64_t capacity;
+  uint64_t head;       // Payload offset of the next store
+  uint64_t next_slot;  // Index slot of the next store
+  uint64_t sequence;   // Last sequence number given out
+} SpillHeader;
+
+typedef struct {
+  uint64_t sequence;  // 0 for a free slot
+  uint64_t offset;
+  uint64_t size;
+  FrameSpillRecord record;
+} SpillSlot;
+
+struct FrameSpill {
+  uint8_t *base;
+  size_t size;
+  SpillHeader *header;
+  SpillSlot *slots;
+  uint8_t *data;
+  bool persistent;
+};
+
+#ifdef SPILL_SUPPORTED
+
+static size_t spill_align(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Reserve the file's blocks, so a full disk fails here rather than with
+// SIGBUS on a later write through the mapping.
+static int spill_preallocate(int fd, size_t size) {
+#ifdef __APPLE__
+  fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t)size, 0 };
+  if (fcntl(fd, F_PREALLOCATE, &store) < 0) {
+    store.fst_flags = F_ALLOCATEALL;
+    if (fcntl(fd, F_PREALLOCATE, &store) < 0) return -1;
+  }
+  return ftruncate(fd, (off_t)size) == 0 ? 0 : -1;
+#else
+  if (ftruncate(fd, (off_t)size) != 0) return -1;
+  return posix_fallocate(fd, 0, (off_t)size) == 0 ? 0 : -1;
+#endif
+}
+
+static bool spill_header_matches(const SpillHeader *header, size_t capacity,
+                                 uint32_t slot_count) {
+  return header->magic == SPILL_MAGIC && header->version == SPILL_VERSION &&
+         header->record_size == sizeof(FrameSpillRecord) && header->slot_count == slot_count &&
+         header->capacity == capacity && header->head <= capacity &&
+         header->next_slot < slot_count;
+}
+
+int frame_spill_open(const char *path, size_t capacity, bool persistent, FrameSpill **out) {
+  *out = NULL;
+  if (!path || capacity == 0) return -1;
+
+  capacity = spill_align(capacity, SPILL_ALIGN);
+  size_t slot_count = capacity / SPILL_BYTES_PER_SLOT;
+  if (slot_count < SPILL_MIN_SLOTS) slot_count = SPILL_MIN_SLOTS;
+  if (slot_count > SPILL_MAX_SLOTS) slot_count = SPILL_MAX_SLOTS;
+  size_t index_size = spill_align(slot_count * sizeof(SpillSlot), SPILL_HEADER_SIZE);
+  if (capacity > SIZE_MAX - SPILL_HEADER_SIZE - index_size) return -1;
+  size_t size = SPILL_HEADER_SIZE + index_size + capacity;
+
+  // Only a file made here is removed on failure, so a persistent file the
+  // caller keeps survives e.g. a transient mmap failure
+  bool created = true;
+  int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    created = false;
+    fd = open(path, O_RDWR);
+  }
+  if (fd < 0) return -1;
+  bool remove_on_failure = created || !persistent;
+
+  // A persistent file keeps its frames when it was written with this layout
+  bool reuse = false;
+  struct stat st;
+  if (persistent && fstat(fd, &st) == 0 && (size_t)st.st_size == size) {
+    SpillHeader header;
+    reuse = pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+            spill_header_matches(&header, capacity, (uint32_t)slot_count);
+  }
+  // Truncating first zeroes the index of a file that is not reused
+  if (!reuse && (ftruncate(fd, 0) != 0 || spill_preallocate(fd, size) != 0)) {
+    close(fd);
+    if (remove_on_failure) unlink(path);
+    return -1;
+  }
+
+  void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    if (remove_on_failure) unlink(path);
+    return -1;
+  }
+  if (!persistent) unlink(path);
+
+  FrameSpill *spill = (FrameSpill *)calloc(1, sizeof(FrameSpill));
+  if (!spill) {
+    munmap(base, size);
+    return -1;
+  }
+  spill->base = (uint8_t *)base;
+  spill->size = size;
+  spill->header = (SpillHeader *)base;
+  spill->slots = (SpillSlot *)(spill->base + SPILL_HEADER_SIZE);
+  spill->data = spill->base + SPILL_HEADER_SIZE + index_size;
+  spill->persistent = persistent;
+
+  if (!reuse) {
+    SpillHeader *header = spill->header;
+    header->version = SPILL_VERSION;
+    header->record_size = sizeof(FrameSpillRecord);
+    header->slot_count = (uint32_t)slot_count;
+    header->capacity = capacity;
+    header->magic = SPILL_MAGIC;
+  }
+
+  *out = spill;
+  return 0;
+}
+
+void frame_spill_close(FrameSpill **spill) {
+  if (!spill || !*spill) return;
+  munmap((*spill)->base, (*spill)->size);
+  free(*spill);
+  *spill = NULL;
+}
+
+bool frame_spill_persistent(const FrameSpill *spill) {
+  return spill->persistent;
+}
+
+int frame_spill_store(FrameSpill *spill, const FrameSpillRecord *record, const uint8_t *payload,
+                      size_t size) {
+  SpillHeader *header = spill->header;
+  size_t stride = spill_align(size, SPILL_ALIGN);
+  if (stride > header->capacity) return -1;
+
+  uint64_t offset = header->head;
+  if (offset + stride > header->capacity) offset = 0;
+
+  // Forget the frames about to be overwritten before touching their bytes,
+  // so a crash mid-copy leaves no slot pointing at torn data
+  for (uint32_t i = 0; i < header->slot_count; i++) {
+    SpillSlot *slot = &spill->slots[i];
+    if (slot->sequence && slot->offset < offset + stride && offset < slot->offset + slot->size) {
+      slot->sequence = 0;
+    }
+  }
+  SpillSlot *slot = &spill->slots[header->next_slot];
+  slot->sequence = 0;
+
+  memcpy(spill->data + offset, payload, size);
+  slot->offset = offset;
+  slot->size = size;
+  slot->record = *record;
+  slot->sequence = ++header->sequence;
+
+  header->head = offset + stride;
+  header->next_slot = (header->next_slot + 1) % header->slot_count;
+  return 0;
+}
+
+bool frame_spill_contains(const FrameSpill *spill, uint64_t media_key, int64_t ts_ms) {
+  for (uint32_t i = 0; i < spill->header->slot_count; i++) {
+    const SpillSlot *slot = &spill->slots[i];
+    if (slot->sequence && slot->record.media_key == media_key && slot->record.ts_ms == ts_ms) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int frame_spill_find(const FrameSpill *spill, uint64_t media_key, int64_t ts_ms,
+                     int64_t tolerance_ms, FrameSpillRecord *record, const uint8_t **payload,
+                     size_t *size) {
+  const SpillSlot *best = NULL;
+  for (uint32_t i = 0; i < spill->header->slot_count; i++) {
+    const SpillSlot *slot = &spill->slots[i];
+    if (!slot->sequence || slot->record.media_key != media_key ||
+        slot->record.ts_ms < ts_ms || slot->record.ts_ms >= ts_ms + tolerance_ms) {
+      continue;
+    }
+    // Slots come from the file, which a persistent spill may have had torn
+    if (slot->size > spill->header->capacity ||
+        slot->offset > spill->header->capacity - slot->size) {
+      continue;
+    }
+    if (!best || slot->record.ts_ms < best->record.ts_ms) best = slot;
+  }
+  if (!best) return -1;
+
+  *record = best->record;
+  *payload = spill->data + best->offset;
+  *size = best->size;
+  return 0;
+}
+
+#else // !SPILL_SUPPORTED
+
+int frame_spill_open(const char *path, size_t capacity, bool persistent, FrameSpill **out) {
+  (void)path;
+  (void)capacity;
+  (void)persistent;
+  *out = NULL;
+  return -2;
+}
+
+void frame_spill_close(FrameSpill **spill) {
+  (void)spill;
+}
+
+bool frame_spill_persistent(const FrameSpill *spill) {
+  (void)spill;
+  return false;
+}
+
+int frame_spill_store(FrameSpill *spill, const FrameSpillRecord *record, const uint8_t *payload,
+                      size_t size) {
+  (void)spill;
+  (void)record;
+  (void)payload;
+  (void)size;
+  return -1;
+}
+
+bool frame_spill_contains(const FrameSpill *spill, uint64_t media_key, int64_t ts_ms) {
+  (void)spill;
+  (void)media_key;
+  (void)ts_ms;
+  return false;
+}
+
+int frame_spill_find(const FrameSpill *spill, uint64_t media_key, int64_t ts_ms,
+                     int64_t tolerance_ms, FrameSpillRecord *record, const uint8_t **payload,
+                     size_t *size) {
+  (void)spill;
+  (void)media_key;
+  (void)ts_ms;
+  (void)tolerance_ms;
+  (void)record;
+  (void)payload;
+  (void)size;
+  return -1;
+}
+
+#endif // SPILL_SUPPORTED
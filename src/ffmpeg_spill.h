@@ -0,0 +1,77 @@
+#ifndef FFMPEG_SPILL_H
+#define FFMPEG_SPILL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Frame Spill File ---
+//
+// A preallocated file, mapped into memory, that holds frame payloads in a
+// ring: each write goes after the previous one and overwrites the oldest
+// frames once the end wraps. The index of what the ring holds lives in the
+// file too, so a persistent spill file is found again by the next run.
+// Not thread safe.
+
+#define FRAME_SPILL_LZ4 (1u << 0)  // Payload is an LZ4 block, not raw rows
+
+// What the cache needs to rebuild a frame: its key, layout and properties.
+// Stored in the file as is, so the layout is versioned with it.
+typedef struct {
+  uint64_t media_key;
+  int64_t ts_ms;
+  int32_t format;
+  int32_t width;
+  int32_t height;
+  uint32_t flags;     // FRAME_SPILL_*
+  uint64_t raw_size;  // Bytes of the rows once decompressed
+  int64_t pts;
+  int64_t duration;
+  int32_t sample_aspect_num;
+  int32_t sample_aspect_den;
+  int32_t color_range;
+  int32_t color_primaries;
+  int32_t color_trc;
+  int32_t colorspace;
+  int32_t frame_flags;
+  int32_t reserved;
+} FrameSpillRecord;
+
+typedef struct FrameSpill FrameSpill;
+
+// Map capacity bytes of frame payloads at path, creating or resizing the
+// file as needed and reserving its blocks up front. With persistent set an
+// existing file of the same capacity keeps its frames and stays on disk
+// afterwards; otherwise the file is unlinked once mapped and only lives as
+// long as the mapping. Returns 0 on success, -1 on failure, -2 where
+// spilling is not supported.
+int frame_spill_open(const char *path, size_t capacity, bool persistent, FrameSpill **out);
+
+void frame_spill_close(FrameSpill **spill);
+
+// Whether the file outlives this run, opened with persistent set.
+bool frame_spill_persistent(const FrameSpill *spill);
+
+// Append a payload. Frames it overwrites, or whose index slot it takes,
+// are forgotten. Returns 0, or -1 if size exceeds the capacity.
+int frame_spill_store(FrameSpill *spill, const FrameSpillRecord *record, const uint8_t *payload,
+                      size_t size);
+
+bool frame_spill_contains(const FrameSpill *spill, uint64_t media_key, int64_t ts_ms);
+
+// Find the earliest frame of media_key shown in [ts_ms, ts_ms + tolerance_ms).
+// On a hit *payload points into the mapping until the next store. Returns
+// 0 on a hit, -1 otherwise.
+int frame_spill_find(const FrameSpill *spill, uint64_t media_key, int64_t ts_ms,
+                     int64_t tolerance_ms, FrameSpillRecord *record, const uint8_t **payload,
+                     size_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_SPILL_H
@@ -0,0 +1,295 @@
+#include "ffmpeg_sprite.h"
+#include "ffmpeg_convert.h"
+#include "ffmpeg_image.h"
+#include "ffmpeg_reader.h"
+
+#include <libavutil/cpu.h>
+#include <libswscale/swscale.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPRITE_DEFAULT_TILE_WIDTH 160
+
+// One thread's share of the grid: a contiguous run of tiles
+typedef struct {
+  const char *url;
+  SpriteSheet *sheet;
+  const int64_t *targets;
+  int first_tile;
+  int tile_count;
+  int keyframe_only;
+  const bool *cancelled;
+
+  MediaReader reader;
+  int reader_open;
+  int decoder_threads;
+
+  struct SwsContext *sws_ctx;
+  int sws_colorspace;
+  int sws_full_range;
+  ConvertContext *convert;
+  uint8_t *scratch;
+
+  int decoded;
+} SpriteWorker;
+
+// Same matrix and range handling as the playback path
+static void sprite_update_colorspace(SpriteWorker *worker, const AVFrame *frame) {
+  int full_range = frame->color_range == AVCOL_RANGE_JPEG;
+  if ((int)frame->colorspace == worker->sws_colorspace && full_range == worker->sws_full_range) {
+    return;
+  }
+
+  int sws_cs = SWS_CS_DEFAULT;
+  if (frame->colorspace == AVCOL_SPC_BT709) {
+    sws_cs = SWS_CS_ITU709;
+  } else if (frame->colorspace == AVCOL_SPC_BT2020_NCL || frame->colorspace == AVCOL_SPC_BT2020_CL) {
+    sws_cs = SWS_CS_BT2020;
+  }
+
+  sws_setColorspaceDetails(worker->sws_ctx, sws_getCoefficients(sws_cs), full_range,
+                           sws_getCoefficients(SWS_CS_DEFAULT), 1, 0, 1 << 16, 1 << 16);
+  worker->sws_colorspace = frame->colorspace;
+  worker->sws_full_range = full_range;
+}
+
+// Scale the reader's current frame into its slot in the atlas
+static int sprite_render_tile(SpriteWorker *worker, int tile) {
+  SpriteSheet *sheet = worker->sheet;
+  const AVFrame *frame = worker->reader.frame;
+  const ConvertTransform *transform = &worker->reader.display;
+
+  int scaled_width = sheet->tile_width;
+  int scaled_height = sheet->tile_height;
+  if (transform->rotation == 90 || transform->rotation == 270) {
+    scaled_width = sheet->tile_height;
+    scaled_height = sheet->tile_width;
+  }
+
+  struct SwsContext *sws = sws_getCachedContext(
+      worker->sws_ctx, frame->width, frame->height, frame->format,
+      scaled_width, scaled_height, AV_PIX_FMT_RGBA, SWS_AREA, NULL, NULL, NULL);
+  if (!sws) return -1;
+  if (sws != worker->sws_ctx) {
+    worker->sws_ctx = sws;
+    worker->sws_colorspace = -1;
+  }
+  sprite_update_colorspace(worker, frame);
+
+  int col = tile % sheet->columns;
+  int row = tile / sheet->columns;
+  uint8_t *dst = sheet->data + (size_t)row * sheet->tile_height * sheet->linesize +
+                 (size_t)col * sheet->tile_width * 4;
+
+  ConvertRowSink sink;
+  if (convert_sink_init(&sink, worker->convert, transform, scaled_width, scaled_height,
+                        dst, sheet->linesize) < 0) {
+    return -1;
+  }
+
+  int ret;
+  if (sink.identity) {
+    uint8_t *dst_data[4] = { dst, NULL, NULL, NULL };
+    int dst_linesize[4] = { sheet->linesize, 0, 0, 0 };
+    ret = sws_scale(sws, (const uint8_t *const *)frame->data, frame->linesize, 0,
+                    frame->height, dst_data, dst_linesize);
+  } else {
+    uint8_t *dst_data[4] = { worker->scratch, NULL, NULL, NULL };
+    int dst_linesize[4] = { scaled_width * 4, 0, 0, 0 };
+    ret = sws_scale(sws, (const uint8_t *const *)frame->data, frame->linesize, 0,
+                    frame->height, dst_data, dst_linesize);
+    if (ret >= 0) {
+      convert_sink_store_rows(&sink, worker->scratch, scaled_width * 4, 0, scaled_height);
+    }
+  }
+  convert_sink_finish(&sink);
+
+  return ret < 0 ? -1 : 0;
+}
+
+static void *sprite_worker_run(void *arg) {
+  SpriteWorker *worker = (SpriteWorker *)arg;
+  SpriteSheet *sheet = worker->sheet;
+
+  if (!worker->reader_open) {
+    if (reader_open(&worker->reader, worker->url, worker->decoder_threads) < 0) return NULL;
+    worker->reader_open = 1;
+  }
+
+  worker->convert = convert_alloc();
+  worker->scratch = (uint8_t *)malloc((size_t)sheet->tile_width * sheet->tile_height * 4);
+  if (!worker->convert || !worker->scratch) return NULL;
+
+  for (int i = 0; i < worker->tile_count; i++) {
+    if (worker->cancelled && *worker->cancelled) break;
+
+    int tile = worker->first_tile + i;
+    if (reader_decode_at(&worker->reader, worker->targets[tile], worker->keyframe_only) < 0) {
+      continue;
+    }
+    if (sprite_render_tile(worker, tile) < 0) continue;
+
+    sheet->tile_pts_ms[tile] = reader_frame_ts_ms(&worker->reader);
+    worker->decoded++;
+  }
+
+  return NULL;
+}
+
+static void sprite_worker_cleanup(SpriteWorker *worker) {
+  if (worker->reader_open) reader_close(&worker->reader);
+  worker->reader_open = 0;
+  if (worker->sws_ctx) sws_freeContext(worker->sws_ctx);
+  worker->sws_ctx = NULL;
+  convert_free(&worker->convert);
+  free(worker->scratch);
+  worker->scratch = NULL;
+}
+
+// Fill in the tile size missing from the options from the display aspect
+static void sprite_resolve_tile_size(const SpriteSheetOptions *options, const MediaReader *reader,
+                                     int *tile_width, int *tile_height) {
+  const AVCodecContext *codec = reader->codec_ctx;
+  double aspect = codec->height > 0 ? (double)codec->width / codec->height : 16.0 / 9.0;
+  if (codec->sample_aspect_ratio.num > 0 && codec->sample_aspect_ratio.den > 0) {
+    aspect *= av_q2d(codec->sample_aspect_ratio);
+  }
+  if (reader->display.rotation == 90 || reader->display.rotation == 270) {
+    aspect = 1.0 / aspect;
+  }
+
+  *tile_width = options->tile_width;
+  *tile_height = options->tile_height;
+  if (*tile_width <= 0 && *tile_height <= 0) *tile_width = SPRITE_DEFAULT_TILE_WIDTH;
+  if (*tile_height <= 0) *tile_height = (int)(*tile_width / aspect + 0.5);
+  if (*tile_width <= 0) *tile_width = (int)(*tile_height * aspect + 0.5);
+  if (*tile_width < 1) *tile_width = 1;
+  if (*tile_height < 1) *tile_height = 1;
+}
+
+int sprite_generate(const char *url, const SpriteSheetOptions *options,
+                    const bool *cancelled, SpriteSheet **out_sheet) {
+  *out_sheet = NULL;
+  if (!url || !options || options->columns <= 0 || options->rows <= 0 ||
+      options->columns > 4096 / options->rows) {
+    return -1;
+  }
+
+  int tile_count = options->columns * options->rows;
+  int thread_count = options->threads > 0 ? options->threads : av_cpu_count();
+  if (thread_count > tile_count) thread_count = tile_count;
+  if (thread_count < 1) thread_count = 1;
+
+  SpriteWorker *workers = (SpriteWorker *)calloc(thread_count, sizeof(SpriteWorker));
+  SpriteSheet *sheet = (SpriteSheet *)calloc(1, sizeof(SpriteSheet));
+  int64_t *targets = (int64_t *)malloc(tile_count * sizeof(int64_t));
+  if (!workers || !sheet || !targets) {
+    free(workers);
+    free(sheet);
+    free(targets);
+    return -3;
+  }
+
+  // The first worker's reader doubles as the probe for size and duration
+  int decoder_threads = thread_count > 1 ? 1 : 0;
+  if (reader_open(&workers[0].reader, url, decoder_threads) < 0) {
+    free(workers);
+    free(sheet);
+    free(targets);
+    return -2;
+  }
+  workers[0].reader_open = 1;
+
+  int tile_width, tile_height;
+  sprite_resolve_tile_size(options, &workers[0].reader, &tile_width, &tile_height);
+
+  sheet->columns = options->columns;
+  sheet->rows = options->rows;
+  sheet->tile_width = tile_width;
+  sheet->tile_height = tile_height;
+  sheet->tile_count = tile_count;
+  sheet->width = tile_width * options->columns;
+  sheet->height = tile_height * options->rows;
+  sheet->linesize = sheet->width * 4;
+  sheet->data = (uint8_t *)calloc((size_t)sheet->linesize * sheet->height, 1);
+  sheet->tile_pts_ms = (int64_t *)malloc(tile_count * sizeof(int64_t));
+  if (!sheet->data || !sheet->tile_pts_ms) {
+    sprite_worker_cleanup(&workers[0]);
+    sprite_free(sheet);
+    free(workers);
+    free(targets);
+    return -3;
+  }
+
+  // Sample the middle of each of tile_count equal slices of the range
+  int64_t start_ms = options->start_ms > 0 ? options->start_ms : 0;
+  int64_t end_ms = options->end_ms;
+  if (end_ms <= 0) {
+    int64_t duration = workers[0].reader.fmt_ctx->duration;
+    end_ms = duration > 0 ? duration / (AV_TIME_BASE / 1000) : start_ms;
+  }
+  if (end_ms < start_ms) end_ms = start_ms;
+  for (int i = 0; i < tile_count; i++) {
+    targets[i] = start_ms + (2 * i + 1) * (end_ms - start_ms) / (2 * tile_count);
+    sheet->tile_pts_ms[i] = -1;
+  }
+
+  int first = 0;
+  for (int i = 0; i < thread_count; i++) {
+    SpriteWorker *worker = &workers[i];
+    int count = tile_count / thread_count + (i < tile_count % thread_count ? 1 : 0);
+    worker->url = url;
+    worker->sheet = sheet;
+    worker->targets = targets;
+    worker->first_tile = first;
+    worker->tile_count = count;
+    worker->keyframe_only = options->keyframe_aligned;
+    worker->cancelled = cancelled;
+    worker->decoder_threads = decoder_threads;
+    worker->sws_colorspace = -1;
+    first += count;
+  }
+
+  ReaderThreads *threads = reader_threads_create(thread_count);
+  reader_threads_run(threads, sprite_worker_run, workers, sizeof(SpriteWorker), thread_count);
+  reader_threads_destroy(&threads);
+
+  int decoded = 0;
+  for (int i = 0; i < thread_count; i++) {
+    decoded += workers[i].decoded;
+    sprite_worker_cleanup(&workers[i]);
+  }
+  free(workers);
+  free(targets);
+
+  int result = 0;
+  if (cancelled && *cancelled) {
+    result = -6;
+  } else if (decoded == 0) {
+    result = -4;
+  } else if (options->image_format != IMAGE_FORMAT_NONE) {
+    enum AVCodecID codec_id = image_codec_id(options->image_format);
+    if (codec_id == AV_CODEC_ID_NONE ||
+        image_encode_rgba(codec_id, options->quality, sheet->data, sheet->linesize,
+                          sheet->width, sheet->height,
+                          &sheet->image_data, &sheet->image_size) < 0) {
+      result = -5;
+    }
+  }
+
+  if (result < 0) {
+    sprite_free(sheet);
+    return result;
+  }
+
+  *out_sheet = sheet;
+  return 0;
+}
+
+void sprite_free(SpriteSheet *sheet) {
+  if (!sheet) return;
+  free(sheet->data);
+  free(sheet->tile_pts_ms);
+  free(sheet->image_data);
+  free(sheet);
+}
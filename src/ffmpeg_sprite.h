@@ -0,0 +1,28 @@
+#ifndef FFMPEG_SPRITE_H
+#define FFMPEG_SPRITE_H
+
+#include <stdbool.h>
+
+#include "ffmpeg_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Sprite Sheet Job ---
+
+// Generate a sprite sheet from url on private readers, decoding tiles in
+// parallel. cancelled is polled between tiles and may be NULL.
+// Returns 0 on success, negative on failure:
+// -1 invalid options, -2 open failed, -3 out of memory, -4 no tile decoded,
+// -5 image encoding failed, -6 cancelled.
+int sprite_generate(const char *url, const SpriteSheetOptions *options,
+                    const bool *cancelled, SpriteSheet **out_sheet);
+
+void sprite_free(SpriteSheet *sheet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_SPRITE_H
@@ -0,0 +1,161 @@
+#include "ffmpeg_tensor.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TENSOR_HAVE_SSE2 1
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define TENSOR_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+void tensor_writer_init(TensorWriter *writer, int width, int height, int planar_float,
+                        int bgr, const float mean[3], const float std[3], uint8_t pad_value) {
+  memset(writer, 0, sizeof(*writer));
+  writer->width = width;
+  writer->height = height;
+  writer->planar_float = planar_float ? 1 : 0;
+  writer->bgr = bgr ? 1 : 0;
+  writer->pad_value = pad_value;
+
+  for (int c = 0; c < 3; c++) {
+    // Tensor channel c reads source channel src_c
+    int src_c = writer->bgr ? 2 - c : c;
+    float m = mean ? mean[c] : 0.0f;
+    float s = (std && std[c] != 0.0f) ? std[c] : 1.0f;
+    writer->scale[src_c] = 1.0f / (255.0f * s);
+    writer->bias[src_c] = -m / s;
+  }
+}
+
+size_t tensor_writer_frame_size(const TensorWriter *writer) {
+  size_t pixels = (size_t)writer->width * writer->height;
+  return writer->planar_float ? pixels * 3 * sizeof(float) : pixels * 3;
+}
+
+// --- Float CHW ---
+
+static void rgba_to_planes_row(const uint8_t *src, float *r, float *g, float *b, int width,
+                               const TensorWriter *w) {
+  int x = 0;
+
+#if defined(TENSOR_HAVE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 sr = _mm_set1_ps(w->scale[0]), br = _mm_set1_ps(w->bias[0]);
+  const __m128 sg = _mm_set1_ps(w->scale[1]), bg = _mm_set1_ps(w->bias[1]);
+  const __m128 sb = _mm_set1_ps(w->scale[2]), bb = _mm_set1_ps(w->bias[2]);
+
+  for (; x + 4 <= width; x += 4) {
+    // 4 pixels -> one RGBA float vector each, then transpose to planes
+    __m128i px = _mm_loadu_si128((const __m128i *)(src + x * 4));
+    __m128i lo = _mm_unpacklo_epi8(px, zero);
+    __m128i hi = _mm_unpackhi_epi8(px, zero);
+    __m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+    __m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+    __m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+    __m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+
+    _mm_storeu_ps(r + x, _mm_add_ps(_mm_mul_ps(p0, sr), br));
+    _mm_storeu_ps(g + x, _mm_add_ps(_mm_mul_ps(p1, sg), bg));
+    _mm_storeu_ps(b + x, _mm_add_ps(_mm_mul_ps(p2, sb), bb));
+  }
+#elif defined(TENSOR_HAVE_NEON)
+  const float32x4_t sr = vdupq_n_f32(w->scale[0]), br = vdupq_n_f32(w->bias[0]);
+  const float32x4_t sg = vdupq_n_f32(w->scale[1]), bg = vdupq_n_f32(w->bias[1]);
+  const float32x4_t sb = vdupq_n_f32(w->scale[2]), bb = vdupq_n_f32(w->bias[2]);
+
+  for (; x + 8 <= width; x += 8) {
+    uint8x8x4_t px = vld4_u8(src + x * 4);
+    uint16x8_t r16 = vmovl_u8(px.val[0]);
+    uint16x8_t g16 = vmovl_u8(px.val[1]);
+    uint16x8_t b16 = vmovl_u8(px.val[2]);
+
+    vst1q_f32(r + x, vmlaq_f32(br, vcvtq_f32_u32(vmovl_u16(vget_low_u16(r16))), sr));
+    vst1q_f32(r + x + 4, vmlaq_f32(br, vcvtq_f32_u32(vmovl_u16(vget_high_u16(r16))), sr));
+    vst1q_f32(g + x, vmlaq_f32(bg, vcvtq_f32_u32(vmovl_u16(vget_low_u16(g16))), sg));
+    vst1q_f32(g + x + 4, vmlaq_f32(bg, vcvtq_f32_u32(vmovl_u16(vget_high_u16(g16))), sg));
+    vst1q_f32(b + x, vmlaq_f32(bb, vcvtq_f32_u32(vmovl_u16(vget_low_u16(b16))), sb));
+    vst1q_f32(b + x + 4, vmlaq_f32(bb, vcvtq_f32_u32(vmovl_u16(vget_high_u16(b16))), sb));
+  }
+#endif
+
+  for (; x < width; x++) {
+    r[x] = src[x * 4 + 0] * w->scale[0] + w->bias[0];
+    g[x] = src[x * 4 + 1] * w->scale[1] + w->bias[1];
+    b[x] = src[x * 4 + 2] * w->scale[2] + w->bias[2];
+  }
+}
+
+static void fill_float(float *dst, size_t count, float value) {
+  for (size_t i = 0; i < count; i++) dst[i] = value;
+}
+
+static void write_planar_float(const TensorWriter *w, const uint8_t *rgba, int linesize,
+                               int width, int height, int x0, int y0, float *dst) {
+  size_t plane_size = (size_t)w->width * w->height;
+  float *planes[3];
+  float pad[3];
+
+  // Source channel c goes to tensor plane c, or 2 - c for BGR
+  for (int c = 0; c < 3; c++) {
+    planes[c] = dst + plane_size * (w->bgr ? 2 - c : c);
+    pad[c] = w->pad_value * w->scale[c] + w->bias[c];
+  }
+
+  for (int c = 0; c < 3; c++) {
+    float *plane = planes[c];
+    fill_float(plane, (size_t)y0 * w->width, pad[c]);
+    fill_float(plane + (size_t)(y0 + height) * w->width,
+               (size_t)(w->height - y0 - height) * w->width, pad[c]);
+    for (int y = y0; y < y0 + height; y++) {
+      float *row = plane + (size_t)y * w->width;
+      fill_float(row, x0, pad[c]);
+      fill_float(row + x0 + width, w->width - x0 - width, pad[c]);
+    }
+  }
+
+  for (int y = 0; y < height; y++) {
+    size_t offset = (size_t)(y0 + y) * w->width + x0;
+    rgba_to_planes_row(rgba + (ptrdiff_t)y * linesize,
+                       planes[0] + offset, planes[1] + offset, planes[2] + offset, width, w);
+  }
+}
+
+// --- uint8 HWC ---
+
+static void write_packed_u8(const TensorWriter *w, const uint8_t *rgba, int linesize,
+                            int width, int height, int x0, int y0, uint8_t *dst) {
+  size_t row_size = (size_t)w->width * 3;
+  int c0 = w->bgr ? 2 : 0;
+  int c2 = w->bgr ? 0 : 2;
+
+  memset(dst, w->pad_value, (size_t)y0 * row_size);
+  memset(dst + (size_t)(y0 + height) * row_size, w->pad_value,
+         (size_t)(w->height - y0 - height) * row_size);
+
+  for (int y = 0; y < height; y++) {
+    const uint8_t *src = rgba + (ptrdiff_t)y * linesize;
+    uint8_t *row = dst + (size_t)(y0 + y) * row_size;
+    memset(row, w->pad_value, (size_t)x0 * 3);
+    memset(row + (size_t)(x0 + width) * 3, w->pad_value, (size_t)(w->width - x0 - width) * 3);
+
+    uint8_t *out = row + (size_t)x0 * 3;
+    for (int x = 0; x < width; x++) {
+      out[x * 3 + 0] = src[x * 4 + c0];
+      out[x * 3 + 1] = src[x * 4 + 1];
+      out[x * 3 + 2] = src[x * 4 + c2];
+    }
+  }
+}
+
+void tensor_writer_write(const TensorWriter *writer, const uint8_t *rgba, int linesize,
+                         int width, int height, int x, int y, void *dst) {
+  if (writer->planar_float) {
+    write_planar_float(writer, rgba, linesize, width, height, x, y, (float *)dst);
+  } else {
+    write_packed_u8(writer, rgba, linesize, width, height, x, y, (uint8_t *)dst);
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef FFMPEG_TENSOR_H
+#define FFMPEG_TENSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Tensor Output ---
+//
+// Writes RGBA images into model input tensors: planar float32 (CHW) with
+// per channel normalization, or packed uint8 (HWC). The image can be placed
+// anywhere inside the tensor; the rest is filled with a padding value so a
+// letterboxed frame is written in one go.
+
+typedef struct {
+  int width;
+  int height;
+  int planar_float;  // 1: float32 CHW, 0: uint8 HWC
+  int bgr;           // Tensor channel order is B, G, R
+
+  // float = value * scale + bias, indexed by source channel (R, G, B)
+  float scale[3];
+  float bias[3];
+  uint8_t pad_value;
+} TensorWriter;
+
+// Set up a writer. mean and std are in tensor channel order and in 0..1
+// units, i.e. float = (value / 255 - mean) / std. A zero std counts as 1.
+void tensor_writer_init(TensorWriter *writer, int width, int height, int planar_float,
+                        int bgr, const float mean[3], const float std[3], uint8_t pad_value);
+
+// Bytes taken by one tensor.
+size_t tensor_writer_frame_size(const TensorWriter *writer);
+
+// Write a width x height RGBA image at (x, y) into the tensor at dst and
+// pad everything around it.
+void tensor_writer_write(const TensorWriter *writer, const uint8_t *rgba, int linesize,
+                         int width, int height, int x, int y, void *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_TENSOR_H
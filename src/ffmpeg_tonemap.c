@@ -0,0 +1,381 @@
+#include "ffmpeg_tonemap.h"
+
+#include <libavutil/mastering_display_metadata.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TONEMAP_HAVE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define TONEMAP_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define TONEMAP_LUT_BITS 12
+#define TONEMAP_LUT_SIZE (1 << TONEMAP_LUT_BITS)
+#define TONEMAP_LUT_MAX ((float)(TONEMAP_LUT_SIZE - 1))
+
+// BT.2408 reference white: HDR signal level that maps to SDR white
+#define TONEMAP_REFERENCE_WHITE_NITS 203.0
+#define TONEMAP_DEFAULT_PEAK_NITS 1000.0
+
+typedef struct {
+  float y_offset;
+  float y_scale;
+  float c_scale;
+  float v_to_r;
+  float u_to_g;
+  float v_to_g;
+  float u_to_b;
+} YuvFloatCoeffs;
+
+struct ToneMapContext {
+  // LUT configuration
+  int lut_valid;
+  enum AVColorTransferCharacteristic trc;
+  enum AVColorPrimaries primaries;
+  double peak_nits;
+
+  float linear_lut[TONEMAP_LUT_SIZE];   // R'G'B' code -> tone mapped linear
+  uint8_t output_lut[TONEMAP_LUT_SIZE]; // linear code -> 8-bit sRGB
+  uint8_t direct_lut[TONEMAP_LUT_SIZE]; // R'G'B' code -> 8-bit sRGB, no gamut change
+  float gamut[9];
+  int apply_gamut;
+
+  // Per-row scratch, grown on demand
+  float *row_float;
+  int32_t *row_index;
+  int row_capacity;
+};
+
+// --- Transfer Functions ---
+
+static double pq_to_nits(double e) {
+  const double m1 = 2610.0 / 16384.0;
+  const double m2 = 2523.0 / 4096.0 * 128.0;
+  const double c1 = 3424.0 / 4096.0;
+  const double c2 = 2413.0 / 4096.0 * 32.0;
+  const double c3 = 2392.0 / 4096.0 * 32.0;
+
+  double p = pow(e, 1.0 / m2);
+  double num = p - c1;
+  if (num < 0.0) num = 0.0;
+  return 10000.0 * pow(num / (c2 - c3 * p), 1.0 / m1);
+}
+
+static double hlg_to_nits(double e) {
+  const double a = 0.17883277;
+  const double b = 0.28466892;
+  const double c = 0.55991073;
+
+  double scene = e <= 0.5 ? (e * e) / 3.0 : (exp((e - c) / a) + b) / 12.0;
+  // Per-channel approximation of the BT.2100 OOTF for a 1000 nit display
+  return TONEMAP_DEFAULT_PEAK_NITS * pow(scene, 1.2);
+}
+
+static double linear_to_srgb(double l) {
+  if (l <= 0.0031308) return 12.92 * l;
+  return 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+}
+
+static void build_luts(ToneMapContext *ctx) {
+  int hdr = tonemap_is_hdr(ctx->trc);
+  double peak = (ctx->trc == AVCOL_TRC_ARIB_STD_B67 ? TONEMAP_DEFAULT_PEAK_NITS : ctx->peak_nits) /
+                TONEMAP_REFERENCE_WHITE_NITS;
+
+  for (int i = 0; i < TONEMAP_LUT_SIZE; i++) {
+    double e = i / (double)TONEMAP_LUT_MAX;
+    double mapped = e;
+
+    if (hdr) {
+      double nits = ctx->trc == AVCOL_TRC_SMPTE2084 ? pq_to_nits(e) : hlg_to_nits(e);
+      double l = nits / TONEMAP_REFERENCE_WHITE_NITS;
+      // Extended Reinhard: maps the source peak exactly to SDR white
+      mapped = peak > 1.0 ? l * (1.0 + l / (peak * peak)) / (1.0 + l) : l;
+    }
+
+    ctx->linear_lut[i] = (float)(mapped > 1.0 ? 1.0 : mapped);
+
+    double out = hdr ? linear_to_srgb(e) : e;
+    ctx->output_lut[i] = (uint8_t)lrint(out * 255.0);
+  }
+
+  // Without a gamut change the tone curve and OETF collapse per channel
+  for (int i = 0; i < TONEMAP_LUT_SIZE; i++) {
+    ctx->direct_lut[i] = ctx->output_lut[(int)lrintf(ctx->linear_lut[i] * TONEMAP_LUT_MAX)];
+  }
+
+  // BT.2020 -> BT.709 primaries, applied in linear light
+  static const float bt2020_to_bt709[9] = {
+     1.6605f, -0.5876f, -0.0728f,
+    -0.1246f,  1.1329f, -0.0083f,
+    -0.0182f, -0.1006f,  1.1187f,
+  };
+  ctx->apply_gamut = hdr && ctx->primaries == AVCOL_PRI_BT2020;
+  memcpy(ctx->gamut, bt2020_to_bt709, sizeof(ctx->gamut));
+
+  ctx->lut_valid = 1;
+}
+
+// --- Row Stages ---
+
+// Stage 1: float Y'CbCr -> clamped R'G'B' LUT indices
+static void yuv_to_index_row(const float *yf, const float *uf, const float *vf,
+                             int32_t *ri, int32_t *gi, int32_t *bi,
+                             int width, const YuvFloatCoeffs *c) {
+  int x = 0;
+
+#if defined(TONEMAP_HAVE_SSE2)
+  const __m128 y_off = _mm_set1_ps(c->y_offset), y_scale = _mm_set1_ps(c->y_scale);
+  const __m128 c_off = _mm_set1_ps(512.0f), c_scale = _mm_set1_ps(c->c_scale);
+  const __m128 v_to_r = _mm_set1_ps(c->v_to_r), u_to_g = _mm_set1_ps(c->u_to_g);
+  const __m128 v_to_g = _mm_set1_ps(c->v_to_g), u_to_b = _mm_set1_ps(c->u_to_b);
+  const __m128 zero = _mm_setzero_ps(), lut_max = _mm_set1_ps(TONEMAP_LUT_MAX);
+  for (; x + 4 <= width; x += 4) {
+    __m128 yn = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(yf + x), y_off), y_scale);
+    __m128 un = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(uf + x), c_off), c_scale);
+    __m128 vn = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(vf + x), c_off), c_scale);
+    __m128 r = _mm_add_ps(yn, _mm_mul_ps(vn, v_to_r));
+    __m128 g = _mm_sub_ps(yn, _mm_add_ps(_mm_mul_ps(un, u_to_g), _mm_mul_ps(vn, v_to_g)));
+    __m128 b = _mm_add_ps(yn, _mm_mul_ps(un, u_to_b));
+    r = _mm_mul_ps(_mm_min_ps(_mm_max_ps(r, zero), _mm_set1_ps(1.0f)), lut_max);
+    g = _mm_mul_ps(_mm_min_ps(_mm_max_ps(g, zero), _mm_set1_ps(1.0f)), lut_max);
+    b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(b, zero), _mm_set1_ps(1.0f)), lut_max);
+    _mm_storeu_si128((__m128i *)(ri + x), _mm_cvtps_epi32(r));
+    _mm_storeu_si128((__m128i *)(gi + x), _mm_cvtps_epi32(g));
+    _mm_storeu_si128((__m128i *)(bi + x), _mm_cvtps_epi32(b));
+  }
+#elif defined(TONEMAP_HAVE_NEON)
+  const float32x4_t y_off = vdupq_n_f32(c->y_offset), c_off = vdupq_n_f32(512.0f);
+  const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+  for (; x + 4 <= width; x += 4) {
+    float32x4_t yn = vmulq_n_f32(vsubq_f32(vld1q_f32(yf + x), y_off), c->y_scale);
+    float32x4_t un = vmulq_n_f32(vsubq_f32(vld1q_f32(uf + x), c_off), c->c_scale);
+    float32x4_t vn = vmulq_n_f32(vsubq_f32(vld1q_f32(vf + x), c_off), c->c_scale);
+    float32x4_t r = vmlaq_n_f32(yn, vn, c->v_to_r);
+    float32x4_t g = vmlsq_n_f32(vmlsq_n_f32(yn, un, c->u_to_g), vn, c->v_to_g);
+    float32x4_t b = vmlaq_n_f32(yn, un, c->u_to_b);
+    r = vmulq_n_f32(vminq_f32(vmaxq_f32(r, zero), one), TONEMAP_LUT_MAX);
+    g = vmulq_n_f32(vminq_f32(vmaxq_f32(g, zero), one), TONEMAP_LUT_MAX);
+    b = vmulq_n_f32(vminq_f32(vmaxq_f32(b, zero), one), TONEMAP_LUT_MAX);
+    // Add 0.5 and truncate: inputs are clamped non-negative
+    vst1q_s32(ri + x, vcvtq_s32_f32(vaddq_f32(r, vdupq_n_f32(0.5f))));
+    vst1q_s32(gi + x, vcvtq_s32_f32(vaddq_f32(g, vdupq_n_f32(0.5f))));
+    vst1q_s32(bi + x, vcvtq_s32_f32(vaddq_f32(b, vdupq_n_f32(0.5f))));
+  }
+#endif
+
+  for (; x < width; x++) {
+    float yn = (yf[x] - c->y_offset) * c->y_scale;
+    float un = (uf[x] - 512.0f) * c->c_scale;
+    float vn = (vf[x] - 512.0f) * c->c_scale;
+    float rgb[3] = {
+      yn + vn * c->v_to_r,
+      yn - (un * c->u_to_g + vn * c->v_to_g),
+      yn + un * c->u_to_b,
+    };
+    int32_t *out[3] = {ri + x, gi + x, bi + x};
+    for (int i = 0; i < 3; i++) {
+      float v = rgb[i] < 0.0f ? 0.0f : (rgb[i] > 1.0f ? 1.0f : rgb[i]);
+      *out[i] = (int32_t)(v * TONEMAP_LUT_MAX + 0.5f);
+    }
+  }
+}
+
+// Stage 3: linear BT.2020 -> linear BT.709, back to LUT indices (in place over ri/gi/bi)
+static void gamut_to_index_row(const float *lr, const float *lg, const float *lb,
+                               int32_t *ri, int32_t *gi, int32_t *bi,
+                               int width, const float *m) {
+  int x = 0;
+
+#if defined(TONEMAP_HAVE_SSE2)
+  const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+  const __m128 lut_max = _mm_set1_ps(TONEMAP_LUT_MAX);
+  for (; x + 4 <= width; x += 4) {
+    __m128 r = _mm_loadu_ps(lr + x), g = _mm_loadu_ps(lg + x), b = _mm_loadu_ps(lb + x);
+    __m128 out[3];
+    for (int i = 0; i < 3; i++) {
+      __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(m[i * 3 + 0])),
+                                       _mm_mul_ps(g, _mm_set1_ps(m[i * 3 + 1]))),
+                            _mm_mul_ps(b, _mm_set1_ps(m[i * 3 + 2])));
+      out[i] = _mm_mul_ps(_mm_min_ps(_mm_max_ps(v, zero), one), lut_max);
+    }
+    _mm_storeu_si128((__m128i *)(ri + x), _mm_cvtps_epi32(out[0]));
+    _mm_storeu_si128((__m128i *)(gi + x), _mm_cvtps_epi32(out[1]));
+    _mm_storeu_si128((__m128i *)(bi + x), _mm_cvtps_epi32(out[2]));
+  }
+#elif defined(TONEMAP_HAVE_NEON)
+  const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+  for (; x + 4 <= width; x += 4) {
+    float32x4_t r = vld1q_f32(lr + x), g = vld1q_f32(lg + x), b = vld1q_f32(lb + x);
+    int32_t *dst[3] = {ri + x, gi + x, bi + x};
+    for (int i = 0; i < 3; i++) {
+      float32x4_t v = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(r, m[i * 3 + 0]), g, m[i * 3 + 1]),
+                                  b, m[i * 3 + 2]);
+      v = vmulq_n_f32(vminq_f32(vmaxq_f32(v, zero), one), TONEMAP_LUT_MAX);
+      vst1q_s32(dst[i], vcvtq_s32_f32(vaddq_f32(v, vdupq_n_f32(0.5f))));
+    }
+  }
+#endif
+
+  for (; x < width; x++) {
+    int32_t *dst[3] = {ri + x, gi + x, bi + x};
+    for (int i = 0; i < 3; i++) {
+      float v = lr[x] * m[i * 3 + 0] + lg[x] * m[i * 3 + 1] + lb[x] * m[i * 3 + 2];
+      v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+      *dst[i] = (int32_t)(v * TONEMAP_LUT_MAX + 0.5f);
+    }
+  }
+}
+
+// Unpack one row of 10-bit samples to float, upsampling chroma horizontally
+static void load_row(const ConvertSource *src, int y, float *yf, float *uf, float *vf) {
+  const uint16_t *yp = (const uint16_t *)(src->data[0] + (ptrdiff_t)y * src->linesize[0]);
+
+  if (src->format == AV_PIX_FMT_P010LE) {
+    const uint16_t *uvp = (const uint16_t *)(src->data[1] + (ptrdiff_t)(y >> 1) * src->linesize[1]);
+    for (int x = 0; x < src->width; x++) {
+      int cx = (x >> 1) * 2;
+      yf[x] = (float)(yp[x] >> 6);
+      uf[x] = (float)(uvp[cx] >> 6);
+      vf[x] = (float)(uvp[cx + 1] >> 6);
+    }
+  } else {
+    const uint16_t *up = (const uint16_t *)(src->data[1] + (ptrdiff_t)(y >> 1) * src->linesize[1]);
+    const uint16_t *vp = (const uint16_t *)(src->data[2] + (ptrdiff_t)(y >> 1) * src->linesize[2]);
+    for (int x = 0; x < src->width; x++) {
+      yf[x] = (float)(yp[x] & 0x3FF);
+      uf[x] = (float)(up[x >> 1] & 0x3FF);
+      vf[x] = (float)(vp[x >> 1] & 0x3FF);
+    }
+  }
+}
+
+static void get_float_coeffs(const ConvertSource *src, YuvFloatCoeffs *c) {
+  double kr = 0.299, kb = 0.114;
+  if (src->colorspace == AVCOL_SPC_BT709) {
+    kr = 0.2126;
+    kb = 0.0722;
+  } else if (src->colorspace == AVCOL_SPC_BT2020_NCL || src->colorspace == AVCOL_SPC_BT2020_CL ||
+             (src->colorspace == AVCOL_SPC_UNSPECIFIED && tonemap_is_hdr(src->color_trc))) {
+    kr = 0.2627;
+    kb = 0.0593;
+  }
+  double kg = 1.0 - kr - kb;
+  int full_range = src->color_range == AVCOL_RANGE_JPEG;
+
+  c->y_offset = full_range ? 0.0f : 64.0f;
+  c->y_scale = full_range ? 1.0f / 1023.0f : 1.0f / 876.0f;
+  c->c_scale = full_range ? 1.0f / 1023.0f : 1.0f / 896.0f;
+  c->v_to_r = (float)(2.0 * (1.0 - kr));
+  c->u_to_g = (float)(2.0 * kb * (1.0 - kb) / kg);
+  c->v_to_g = (float)(2.0 * kr * (1.0 - kr) / kg);
+  c->u_to_b = (float)(2.0 * (1.0 - kb));
+}
+
+// --- Public API ---
+
+ToneMapContext *tonemap_alloc(void) {
+  return (ToneMapContext *)calloc(1, sizeof(ToneMapContext));
+}
+
+void tonemap_free(ToneMapContext **ctx) {
+  if (!ctx || !*ctx) return;
+  free((*ctx)->row_float);
+  free((*ctx)->row_index);
+  free(*ctx);
+  *ctx = NULL;
+}
+
+int tonemap_supports_format(enum AVPixelFormat format) {
+  return format == AV_PIX_FMT_YUV420P10LE || format == AV_PIX_FMT_P010LE;
+}
+
+int tonemap_is_hdr(enum AVColorTransferCharacteristic trc) {
+  return trc == AVCOL_TRC_SMPTE2084 || trc == AVCOL_TRC_ARIB_STD_B67;
+}
+
+double tonemap_get_source_peak(const AVFrame *frame) {
+  AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL);
+  if (sd) {
+    const AVContentLightMetadata *clm = (const AVContentLightMetadata *)sd->data;
+    if (clm->MaxCLL > 0) return (double)clm->MaxCLL;
+  }
+
+  sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA);
+  if (sd) {
+    const AVMasteringDisplayMetadata *mdm = (const AVMasteringDisplayMetadata *)sd->data;
+    if (mdm->has_luminance && mdm->max_luminance.den != 0) {
+      double peak = av_q2d(mdm->max_luminance);
+      if (peak > 0.0) return peak;
+    }
+  }
+
+  return TONEMAP_DEFAULT_PEAK_NITS;
+}
+
+int tonemap_frame_to_rgba(ToneMapContext *ctx, const ConvertSource *src,
+                          double peak_nits, ConvertRowSink *sink) {
+  if (!ctx || !src || !sink || !tonemap_supports_format(src->format)) return -1;
+
+  int width = src->width;
+
+  if (width > ctx->row_capacity) {
+    float *row_float = (float *)realloc(ctx->row_float, (size_t)width * 3 * sizeof(float));
+    if (!row_float) return -1;
+    ctx->row_float = row_float;
+    int32_t *row_index = (int32_t *)realloc(ctx->row_index, (size_t)width * 3 * sizeof(int32_t));
+    if (!row_index) return -1;
+    ctx->row_index = row_index;
+    ctx->row_capacity = width;
+  }
+
+  if (!ctx->lut_valid || ctx->trc != src->color_trc ||
+      ctx->primaries != src->color_primaries || ctx->peak_nits != peak_nits) {
+    ctx->trc = src->color_trc;
+    ctx->primaries = src->color_primaries;
+    ctx->peak_nits = peak_nits;
+    build_luts(ctx);
+  }
+
+  YuvFloatCoeffs coeffs;
+  get_float_coeffs(src, &coeffs);
+
+  float *f0 = ctx->row_float, *f1 = f0 + width, *f2 = f1 + width;
+  int32_t *ri = ctx->row_index, *gi = ri + width, *bi = gi + width;
+
+  for (int y = 0; y < src->height; y++) {
+    load_row(src, y, f0, f1, f2);
+    yuv_to_index_row(f0, f1, f2, ri, gi, bi, width, &coeffs);
+
+    uint8_t *out = convert_sink_row(sink, y);
+
+    if (ctx->apply_gamut) {
+      // Scratch floats are free again: reuse them for linear RGB
+      for (int x = 0; x < width; x++) {
+        f0[x] = ctx->linear_lut[ri[x]];
+        f1[x] = ctx->linear_lut[gi[x]];
+        f2[x] = ctx->linear_lut[bi[x]];
+      }
+      gamut_to_index_row(f0, f1, f2, ri, gi, bi, width, ctx->gamut);
+
+      for (int x = 0; x < width; x++) {
+        out[x * 4 + 0] = ctx->output_lut[ri[x]];
+        out[x * 4 + 1] = ctx->output_lut[gi[x]];
+        out[x * 4 + 2] = ctx->output_lut[bi[x]];
+        out[x * 4 + 3] = 255;
+      }
+    } else {
+      for (int x = 0; x < width; x++) {
+        out[x * 4 + 0] = ctx->direct_lut[ri[x]];
+        out[x * 4 + 1] = ctx->direct_lut[gi[x]];
+        out[x * 4 + 2] = ctx->direct_lut[bi[x]];
+        out[x * 4 + 3] = 255;
+      }
+    }
+  }
+
+  return 0;
+}
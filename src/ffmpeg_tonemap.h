@@ -0,0 +1,50 @@
+#ifndef FFMPEG_TONEMAP_H
+#define FFMPEG_TONEMAP_H
+
+#include <stdint.h>
+
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+#include "ffmpeg_convert.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- HDR to SDR Tone Mapping ---
+//
+// Converts 10-bit 4:2:0 sources (yuv420p10, p010) to 8-bit RGBA without
+// swscale. PQ and HLG sources are tone mapped through precomputed LUTs:
+//
+//   Y'CbCr -> R'G'B' -> [EOTF + tone curve LUT] -> gamut matrix -> [OETF LUT]
+//
+// 10-bit SDR sources use identity LUTs, which makes this a plain (and much
+// cheaper) 10-bit to 8-bit conversion.
+
+typedef struct ToneMapContext ToneMapContext;
+
+ToneMapContext *tonemap_alloc(void);
+void tonemap_free(ToneMapContext **ctx);
+
+// Whether the tone mapper can convert this pixel format.
+int tonemap_supports_format(enum AVPixelFormat format);
+
+// Whether the transfer characteristic is HDR (PQ or HLG).
+int tonemap_is_hdr(enum AVColorTransferCharacteristic trc);
+
+// Peak luminance of the source in nits, from content light level or
+// mastering display side data. Defaults to 1000 when neither is present.
+double tonemap_get_source_peak(const AVFrame *frame);
+
+// Convert a frame to RGBA, writing every row through the sink. LUTs are
+// rebuilt when the transfer, primaries or peak change between calls.
+// Returns 0 on success, negative on failure.
+int tonemap_frame_to_rgba(ToneMapContext *ctx, const ConvertSource *src,
+                          double peak_nits, ConvertRowSink *sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_TONEMAP_H
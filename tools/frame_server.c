@@ -0,0 +1,851 @@
+// Local frame server: decoder cores shared by every process on the
+// machine, driven over a Unix domain socket. Frames travel through a
+// shared memory ring per client (see ffmpeg_core.h), so the socket only
+// carries short text lines.
+//
+//   ffmpeg_frame_server <socket path> [cache MiB]
+//
+// Requests, one per line, each answered with "OK ..." or "ERR <code>":
+//
+//   RING <slots> <slot bytes>        create the client's ring -> OK <shm name>
+//   OPEN <path>                      -> OK <width> <height> <duration ms> <fps> <frames>
+//   OUTPUT <width> <height> <gray>   output size (0 keeps the source) and GRAY8 flag
+//   FRAME <timestamp ms>             -> OK 1
+//   RANGE <first index> <last index> -> OK <frames written>
+//   THUMBS <columns> <rows> <tile width> -> OK 1
+//   QUIT
+//
+// FRAME, RANGE and THUMBS write their frames into the ring, then a
+// SHM_SLOT_END_OF_STREAM slot, then answer. The ring is blocking, so the
+// client reads it while the request runs. THUMBS writes one RGBA slot
+// with the whole sheet. A ring left full for SERVER_WRITE_TIMEOUT_MS ends
+// the request with ERR -6 and no end slot, so a client that stops reading
+// holds up the others on its media for no longer than that.
+//
+// The core holds one media per process, so every open media gets a media
+// worker: this program started again as a process of its own, with its
+// own core and decoded frame cache of up to cache MiB. The worker opens
+// its media once and serves every client of that path, interleaving
+// their requests in its core's queue; clients on different files run in
+// parallel. The server process keeps the sockets and rings, hands each
+// client a connection to its worker and forwards requests there, and the
+// worker writes straight into the client's ring. A worker without clients
+// lives on for SERVER_WORKER_IDLE_MS. With SERVER_MAX_WORKERS busy, OPEN
+// of another path answers ERR -3.
+
+#define _GNU_SOURCE  // accept4
+
+#include "ffmpeg_core.h"
+#include "ffmpeg_shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVER_DEFAULT_CACHE_MB 512
+#define SERVER_LINE_MAX 4096
+#define SERVER_HANGUP_POLL_MS 100
+#define SERVER_REQUESTS_IN_FLIGHT 8
+#define SERVER_WRITE_TIMEOUT_MS 1000  // Longest wait for a ring slot
+#define SERVER_MAX_WORKERS 4
+#define SERVER_WORKER_IDLE_MS 60000   // How long a worker without clients stays
+#define SERVER_WORKER_FLAG "--worker"
+
+// A client's connection as seen by its media worker
+typedef struct {
+  int fd;
+  ShmRing *ring;  // The client's ring, attached from the server process
+  VideoOutputOptions output;
+
+  // Request in flight, completed from the core's worker thread
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int pending;
+  int written;
+  int failed;
+  bool hangup;
+  bool stalled;  // The ring stayed full; the rest of the request is dropped
+} Client;
+
+typedef struct MediaWorker {
+  char *path;
+  int control_fd;  // Carries client connections to the worker process
+  int clients;
+  bool retired;    // Gone from the list; freed with its last client
+  int64_t idle_since_ms;
+  struct MediaWorker *next;
+} MediaWorker;
+
+// A client's socket as seen by the server process
+typedef struct {
+  int fd;
+  int id;
+  ShmRing *ring;
+  char ring_name[64];
+  char output[80];  // Last OUTPUT request, replayed to a new worker
+  MediaWorker *worker;
+  int worker_fd;
+  bool hangup;
+} Connection;
+
+// Output options are process wide: each submission sets its client's
+static pthread_mutex_t g_core_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t g_workers_lock = PTHREAD_MUTEX_INITIALIZER;
+static MediaWorker *g_workers = NULL;
+static int g_worker_count = 0;
+static char g_self_path[PATH_MAX];
+static long g_cache_mb = SERVER_DEFAULT_CACHE_MB;
+
+// --- Ring Output ---
+
+// Claim the next slot, waiting a bounded time while the client's ring is
+// full. Every client of the media goes through the worker's one core, so
+// a stalled ring would hold them all up.
+static ShmSlotHeader *ring_begin_write(Client *client, uint8_t **pixels) {
+  if (client->stalled) return NULL;
+  ShmSlotHeader *slot = shm_ring_begin_write_timeout(client->ring, &client->hangup,
+                                                     SERVER_WRITE_TIMEOUT_MS, pixels);
+  if (!slot && !client->hangup) client->stalled = true;
+  return slot;
+}
+
+// Copy a picture into the next slot. Runs on the core's worker thread and
+// waits there while the client's ring is full.
+static int ring_write(Client *client, const uint8_t *data, int linesize, int width, int height,
+                      int format, int64_t pts_ms, int64_t frame_id) {
+  int row_size = width * (format == VIDEO_PIXEL_FORMAT_GRAY8 ? 1 : 4);
+  size_t size = (size_t)row_size * height;
+  if (size > shm_ring_slot_capacity(client->ring)) return -3;
+
+  uint8_t *pixels = NULL;
+  ShmSlotHeader *slot = ring_begin_write(client, &pixels);
+  if (!slot) return -6;
+
+  for (int y = 0; y < height; y++) {
+    memcpy(pixels + (size_t)y * row_size, data + (size_t)y * linesize, row_size);
+  }
+  slot->width = width;
+  slot->height = height;
+  slot->linesize = row_size;
+  slot->format = format;
+  slot->pts_ms = pts_ms;
+  slot->frame_id = frame_id;
+  slot->size = size;
+  shm_ring_publish(client->ring, slot);
+  return 0;
+}
+
+static void ring_end_stream(Client *client) {
+  uint8_t *pixels = NULL;
+  ShmSlotHeader *slot = ring_begin_write(client, &pixels);
+  if (!slot) return;
+  slot->flags = SHM_SLOT_END_OF_STREAM;
+  shm_ring_publish(client->ring, slot);
+}
+
+static void complete_one(Client *client, int result) {
+  pthread_mutex_lock(&client->mutex);
+  if (result < 0) {
+    client->failed = result;
+  } else {
+    client->written++;
+  }
+  client->pending--;
+  pthread_cond_signal(&client->cond);
+  pthread_mutex_unlock(&client->mutex);
+}
+
+static void on_video_frame(void *user_data, VideoFrame *frame, int error_code) {
+  Client *client = (Client *)user_data;
+  int result = error_code < 0 || !frame ? -1 : 0;
+  if (result == 0) {
+    result = ring_write(client, frame->data, frame->linesize, frame->width, frame->height,
+                        frame->format, frame->pts_ms, frame->frame_id);
+  }
+  ffmpeg_free_video_frame(frame);
+  complete_one(client, result);
+}
+
+static void on_sprite_sheet(void *user_data, SpriteSheet *sheet, int error_code) {
+  Client *client = (Client *)user_data;
+  int result = error_code < 0 || !sheet ? -1 : 0;
+  if (result == 0) {
+    result = ring_write(client, sheet->data, sheet->linesize, sheet->width, sheet->height,
+                        VIDEO_PIXEL_FORMAT_RGBA, sheet->tile_count > 0 ? sheet->tile_pts_ms[0] : 0,
+                        0);
+  }
+  ffmpeg_free_sprite_sheet(sheet);
+  complete_one(client, result);
+}
+
+// Wait until at most max_pending requests are in flight. A hangup is
+// noticed here and flags the client, which makes the core's worker thread
+// drop the rest of its frames instead of waiting for ring slots nobody
+// will free.
+static void wait_for_requests(Client *client, int max_pending) {
+  pthread_mutex_lock(&client->mutex);
+  while (client->pending > max_pending) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += SERVER_HANGUP_POLL_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    if (pthread_cond_timedwait(&client->cond, &client->mutex, &deadline) != ETIMEDOUT ||
+        client->hangup) {
+      continue;
+    }
+
+    struct pollfd pfd = { client->fd, POLLIN, 0 };
+    char probe;
+    if (poll(&pfd, 1, 0) > 0 &&
+        ((pfd.revents & (POLLHUP | POLLERR)) || recv(client->fd, &probe, 1, MSG_PEEK) <= 0)) {
+      client->hangup = true;
+    }
+  }
+  pthread_mutex_unlock(&client->mutex);
+}
+
+// --- Requests ---
+
+static void reply(int fd, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void reply(int fd, const char *format, ...) {
+  char line[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line) - 1, format, args);
+  va_end(args);
+  if (length < 0) return;
+  if (length > (int)sizeof(line) - 2) length = (int)sizeof(line) - 2;
+  line[length++] = '\n';
+  send(fd, line, length, MSG_NOSIGNAL);
+}
+
+// Run count requests submitted by submit(i) and stream their frames
+static void run_requests(Client *client, int count,
+                         RequestId (*submit)(Client *client, int i, void *arg), void *arg) {
+  if (!client->ring) {
+    reply(client->fd, "ERR -1");
+    return;
+  }
+
+  client->pending = 0;
+  client->written = 0;
+  client->failed = 0;
+  client->stalled = false;
+
+  // The core runs requests in order, and frame by frame requests decode
+  // on instead of seeking. A short window keeps a hangup cheap and lets
+  // other clients' requests in between.
+  for (int i = 0; i < count && !client->hangup && !client->stalled; i++) {
+    wait_for_requests(client, SERVER_REQUESTS_IN_FLIGHT - 1);
+    pthread_mutex_lock(&client->mutex);
+    client->pending++;
+    pthread_mutex_unlock(&client->mutex);
+
+    // Requests take the output options current when they are submitted
+    pthread_mutex_lock(&g_core_lock);
+    ffmpeg_set_video_output_options(&client->output);
+    RequestId id = submit(client, i, arg);
+    pthread_mutex_unlock(&g_core_lock);
+    if (id < 0) complete_one(client, -1);
+  }
+  wait_for_requests(client, 0);
+  ring_end_stream(client);
+
+  if (client->stalled) {
+    reply(client->fd, "ERR -6");
+  } else if (client->failed < 0 && client->written == 0) {
+    reply(client->fd, "ERR %d", client->failed);
+  } else {
+    reply(client->fd, "OK %d", client->written);
+  }
+}
+
+static RequestId submit_frame(Client *client, int i, void *arg) {
+  (void)i;
+  return ffmpeg_get_video_frame_at_timestamp_async(*(const int64_t *)arg, on_video_frame, client);
+}
+
+static RequestId submit_index(Client *client, int i, void *arg) {
+  return ffmpeg_get_video_frame_at_index_async(*(const int *)arg + i, on_video_frame, client);
+}
+
+static RequestId submit_thumbs(Client *client, int i, void *arg) {
+  (void)i;
+  // The sprite job decodes on parallel readers of its own
+  return ffmpeg_generate_sprite_sheet_async((const SpriteSheetOptions *)arg, on_sprite_sheet,
+                                            client);
+}
+
+static void handle_line(Client *client, char *line) {
+  long long a = 0, b = 0, c = 0;
+
+  if (strncmp(line, "ATTACH ", 7) == 0) {
+    shm_ring_detach(&client->ring);
+    int result = shm_ring_attach(line + 7, &client->ring);
+    if (result < 0) {
+      reply(client->fd, "ERR %d", result);
+    } else {
+      reply(client->fd, "OK");
+    }
+  } else if (strncmp(line, "OPEN ", 5) == 0) {
+    // The server only routes clients of this worker's path here
+    MediaInfo info = ffmpeg_get_media_info();
+    reply(client->fd, "OK %d %d %lld %.3f %lld", info.width, info.height,
+          (long long)info.duration_ms, info.fps, (long long)info.total_frames);
+  } else if (sscanf(line, "OUTPUT %lld %lld %lld", &a, &b, &c) == 3) {
+    memset(&client->output, 0, sizeof(client->output));
+    client->output.output_width = (int)a;
+    client->output.output_height = (int)b;
+    client->output.pixel_format = c ? VIDEO_PIXEL_FORMAT_GRAY8 : VIDEO_PIXEL_FORMAT_RGBA;
+    reply(client->fd, "OK");
+  } else if (sscanf(line, "FRAME %lld", &a) == 1) {
+    int64_t timestamp_ms = a;
+    run_requests(client, 1, submit_frame, &timestamp_ms);
+  } else if (sscanf(line, "RANGE %lld %lld", &a, &b) == 2 && a >= 0 && b >= a) {
+    int first = (int)a;
+    run_requests(client, (int)(b - a + 1), submit_index, &first);
+  } else if (sscanf(line, "THUMBS %lld %lld %lld", &a, &b, &c) == 3) {
+    SpriteSheetOptions options;
+    memset(&options, 0, sizeof(options));
+    options.columns = (int)a;
+    options.rows = (int)b;
+    options.tile_width = (int)c;
+    options.keyframe_aligned = 1;
+    run_requests(client, 1, submit_thumbs, &options);
+  } else {
+    reply(client->fd, "ERR -1");
+  }
+}
+
+// --- Lines ---
+
+// Read newline terminated lines from fd and pass each to handle until the
+// peer goes away, sends QUIT or *stop is set.
+static void read_lines(int fd, bool *stop, void (*handle)(void *context, char *line),
+                       void *context) {
+  char buffer[SERVER_LINE_MAX];
+  size_t used = 0;
+
+  while (!*stop) {
+    ssize_t n = recv(fd, buffer + used, sizeof(buffer) - 1 - used, 0);
+    if (n <= 0) break;
+    used += (size_t)n;
+
+    char *start = buffer;
+    char *end;
+    while ((end = memchr(start, '\n', used - (start - buffer))) != NULL) {
+      *end = '\0';
+      if (end > start && end[-1] == '\r') end[-1] = '\0';
+      if (strcmp(start, "QUIT") == 0) {
+        *stop = true;
+        break;
+      }
+      handle(context, start);
+      start = end + 1;
+    }
+
+    used -= (size_t)(start - buffer);
+    memmove(buffer, start, used);
+    if (used == sizeof(buffer) - 1) break;  // Line too long
+  }
+}
+
+// Send fd over the Unix socket channel. Returns 0 on success.
+static int send_fd(int channel, int fd) {
+  char byte = 0;
+  struct iovec iov = { &byte, 1 };
+  union {
+    struct cmsghdr header;
+    char data[CMSG_SPACE(sizeof(int))];
+  } control;
+  memset(&control, 0, sizeof(control));
+
+  struct msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data;
+  message.msg_controllen = sizeof(control.data);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  return sendmsg(channel, &message, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
+
+// Receive a descriptor sent by send_fd. Returns it, -1 once the channel
+// is closed, or -2 for a message without one.
+static int receive_fd(int channel) {
+  char byte;
+  struct iovec iov = { &byte, 1 };
+  union {
+    struct cmsghdr header;
+    char data[CMSG_SPACE(sizeof(int))];
+  } control;
+
+  struct msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data;
+  message.msg_controllen = sizeof(control.data);
+
+  ssize_t n = recvmsg(channel, &message, MSG_CMSG_CLOEXEC);
+  if (n < 0 && errno == EINTR) return -2;
+  if (n <= 0) return -1;
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return -2;
+  int fd;
+  memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  return fd;
+}
+
+static int64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// --- Media Worker Process ---
+
+static void handle_client_line(void *context, char *line) {
+  handle_line((Client *)context, line);
+}
+
+static void *client_thread(void *arg) {
+  Client *client = (Client *)arg;
+  read_lines(client->fd, &client->hangup, handle_client_line, client);
+
+  close(client->fd);
+  shm_ring_detach(&client->ring);
+  pthread_mutex_destroy(&client->mutex);
+  pthread_cond_destroy(&client->cond);
+  free(client);
+  return NULL;
+}
+
+// Open path once and serve the connections arriving on control_fd. The
+// server closes control_fd once the worker has no clients left.
+static int worker_main(int control_fd, long cache_mb, const char *path) {
+  ffmpeg_init();
+  ffmpeg_set_frame_cache_size(cache_mb > 0 ? (size_t)cache_mb << 20 : 0);
+  // Exiting closes the control channel, which the server reads as ERR -2
+  if (ffmpeg_open_media(path) < 0) {
+    ffmpeg_release();
+    return 1;
+  }
+
+  while (true) {
+    int fd = receive_fd(control_fd);
+    if (fd == -1) break;
+    if (fd < 0) continue;
+
+    Client *client = (Client *)calloc(1, sizeof(Client));
+    if (!client) {
+      close(fd);
+      continue;
+    }
+    client->fd = fd;
+    pthread_mutex_init(&client->mutex, NULL);
+    pthread_cond_init(&client->cond, NULL);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, client_thread, client) != 0) {
+      close(fd);
+      pthread_mutex_destroy(&client->mutex);
+      pthread_cond_destroy(&client->cond);
+      free(client);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+
+  close(control_fd);
+  ffmpeg_release();
+  return 0;
+}
+
+// --- Media Workers ---
+
+// Start a worker process for path. Called with g_workers_lock held.
+static MediaWorker *spawn_worker(const char *path) {
+  MediaWorker *worker = (MediaWorker *)calloc(1, sizeof(MediaWorker));
+  if (!worker) return NULL;
+  worker->path = strdup(path);
+
+  int channel[2];
+  if (!worker->path || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channel) < 0) {
+    free(worker->path);
+    free(worker);
+    return NULL;
+  }
+
+  // Everything the child needs is prepared before fork: other threads
+  // may hold locks the child would never see released
+  char fd_arg[16];
+  char cache_arg[32];
+  snprintf(fd_arg, sizeof(fd_arg), "%d", channel[1]);
+  snprintf(cache_arg, sizeof(cache_arg), "%ld", g_cache_mb);
+  char *args[] = { g_self_path, SERVER_WORKER_FLAG, fd_arg, cache_arg, worker->path, NULL };
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Every other descriptor is close-on-exec, so the worker inherits
+    // only its end of the channel
+    fcntl(channel[1], F_SETFD, 0);
+    execv(g_self_path, args);
+    _exit(127);
+  }
+  close(channel[1]);
+  if (pid < 0) {
+    close(channel[0]);
+    free(worker->path);
+    free(worker);
+    return NULL;
+  }
+
+  worker->control_fd = channel[0];
+  worker->next = g_workers;
+  g_workers = worker;
+  g_worker_count++;
+  return worker;
+}
+
+// Take worker off the list. Closing its channel lets the process exit
+// once its connections are gone. Called with g_workers_lock held.
+static void retire_worker(MediaWorker *worker) {
+  if (worker->retired) return;
+  for (MediaWorker **link = &g_workers; *link; link = &(*link)->next) {
+    if (*link == worker) {
+      *link = worker->next;
+      break;
+    }
+  }
+  worker->retired = true;
+  close(worker->control_fd);
+  g_worker_count--;
+}
+
+static void free_worker(MediaWorker *worker) {
+  free(worker->path);
+  free(worker);
+}
+
+// The worker for path, started if needed, with a client counted on it.
+// NULL when SERVER_MAX_WORKERS are busy or the worker cannot start.
+static MediaWorker *acquire_worker(const char *path) {
+  pthread_mutex_lock(&g_workers_lock);
+  int64_t now = now_ms();
+  MediaWorker *found = NULL;
+  MediaWorker *oldest_idle = NULL;
+  for (MediaWorker *worker = g_workers, *next; worker; worker = next) {
+    next = worker->next;
+    if (strcmp(worker->path, path) == 0) {
+      found = worker;
+    } else if (worker->clients == 0) {
+      if (now - worker->idle_since_ms >= SERVER_WORKER_IDLE_MS) {
+        retire_worker(worker);
+        free_worker(worker);
+      } else if (!oldest_idle || worker->idle_since_ms < oldest_idle->idle_since_ms) {
+        oldest_idle = worker;
+      }
+    }
+  }
+
+  if (!found) {
+    if (g_worker_count >= SERVER_MAX_WORKERS && oldest_idle) {
+      retire_worker(oldest_idle);
+      free_worker(oldest_idle);
+    }
+    if (g_worker_count < SERVER_MAX_WORKERS) found = spawn_worker(path);
+  }
+  if (found) found->clients++;
+  pthread_mutex_unlock(&g_workers_lock);
+  return found;
+}
+
+// Drop a client from worker; failed retires a worker that went away
+static void release_worker(MediaWorker *worker, bool failed) {
+  pthread_mutex_lock(&g_workers_lock);
+  worker->clients--;
+  if (failed) retire_worker(worker);
+  if (worker->clients == 0) {
+    if (worker->retired) {
+      free_worker(worker);
+    } else {
+      worker->idle_since_ms = now_ms();
+    }
+  }
+  pthread_mutex_unlock(&g_workers_lock);
+}
+
+// A fresh connection to worker. Returns the server's end, or -1.
+static int connect_worker(MediaWorker *worker) {
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) return -1;
+  pthread_mutex_lock(&g_workers_lock);
+  int result = worker->retired ? -1 : send_fd(worker->control_fd, pair[1]);
+  pthread_mutex_unlock(&g_workers_lock);
+  close(pair[1]);
+  if (result < 0) {
+    close(pair[0]);
+    return -1;
+  }
+  return pair[0];
+}
+
+// --- Connections ---
+
+static void disconnect_worker(Connection *conn, bool failed) {
+  if (!conn->worker) return;
+  close(conn->worker_fd);
+  conn->worker_fd = -1;
+  release_worker(conn->worker, failed);
+  conn->worker = NULL;
+}
+
+// Read one answer line from the worker, watching the client for a hangup
+// meanwhile. Returns 0, or -1 when the worker or the client went away.
+static int read_worker_reply(Connection *conn, char *line, size_t size) {
+  size_t used = 0;
+  bool watch_client = true;
+
+  while (true) {
+    struct pollfd pfds[2] = { { conn->worker_fd, POLLIN, 0 }, { conn->fd, POLLIN, 0 } };
+    if (poll(pfds, watch_client ? 2 : 1, -1) < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+
+    if (watch_client && pfds[1].revents) {
+      char probe;
+      if ((pfds[1].revents & (POLLHUP | POLLERR)) || recv(conn->fd, &probe, 1, MSG_PEEK) <= 0) {
+        // Closing the ring stops the worker writing into it right away
+        conn->hangup = true;
+        shm_ring_wake(conn->ring);
+        return -1;
+      }
+      watch_client = false;  // The client's next request is already waiting
+    }
+    if (!pfds[0].revents) continue;
+
+    ssize_t n = recv(conn->worker_fd, line + used, size - 1 - used, MSG_PEEK);
+    if (n <= 0) return -1;
+    char *end = memchr(line + used, '\n', (size_t)n);
+    size_t take = end ? (size_t)(end - (line + used)) + 1 : (size_t)n;
+    if (recv(conn->worker_fd, line + used, take, 0) != (ssize_t)take) return -1;
+    used += take;
+    if (end) {
+      line[used - 1] = '\0';
+      return 0;
+    }
+    if (used == size - 1) return -1;  // Answer too long
+  }
+}
+
+// Send line to the worker and read its answer
+static int forward(Connection *conn, const char *line, char *answer, size_t size) {
+  char buffer[SERVER_LINE_MAX + 1];
+  int length = snprintf(buffer, sizeof(buffer), "%s\n", line);
+  if (length < 0 || length >= (int)sizeof(buffer)) return -1;
+  if (send(conn->worker_fd, buffer, length, MSG_NOSIGNAL) != length) return -1;
+  return read_worker_reply(conn, answer, size);
+}
+
+// Forward line and pass the answer back to the client
+static void relay(Connection *conn, const char *line) {
+  char answer[256];
+  if (forward(conn, line, answer, sizeof(answer)) < 0) {
+    if (conn->hangup) return;
+    disconnect_worker(conn, true);
+    reply(conn->fd, "ERR -2");
+    return;
+  }
+  reply(conn->fd, "%s", answer);
+}
+
+// Move the client to the worker of path, replaying its ring and output
+// options there
+static void handle_open(Connection *conn, const char *path) {
+  if (!conn->worker || strcmp(conn->worker->path, path) != 0) {
+    disconnect_worker(conn, false);
+    MediaWorker *worker = acquire_worker(path);
+    if (!worker) {
+      reply(conn->fd, "ERR -3");
+      return;
+    }
+    conn->worker = worker;
+    conn->worker_fd = connect_worker(worker);
+
+    char line[128];
+    char answer[256];
+    int result = conn->worker_fd < 0 ? -1 : 0;
+    if (result == 0 && conn->ring) {
+      snprintf(line, sizeof(line), "ATTACH %s", conn->ring_name);
+      result = forward(conn, line, answer, sizeof(answer));
+    }
+    if (result == 0 && conn->output[0]) {
+      result = forward(conn, conn->output, answer, sizeof(answer));
+    }
+    if (result < 0) {
+      if (conn->hangup) return;
+      disconnect_worker(conn, true);
+      reply(conn->fd, "ERR -2");
+      return;
+    }
+  }
+
+  char line[SERVER_LINE_MAX];
+  snprintf(line, sizeof(line), "OPEN %s", path);
+  relay(conn, line);
+}
+
+static void handle_ring(Connection *conn, int slots, long long slot_bytes) {
+  shm_ring_destroy(&conn->ring);
+  snprintf(conn->ring_name, sizeof(conn->ring_name), "/ffmpeg_frame_server.%d.%d",
+           (int)getpid(), conn->id);
+
+  int result = slots > 0 && slot_bytes > 0
+                   ? shm_ring_create(conn->ring_name, slots, (size_t)slot_bytes, 1, &conn->ring)
+                   : -1;
+  // Sent even when creating failed: the worker then drops the old ring
+  if (conn->worker) {
+    char line[128];
+    char answer[256];
+    snprintf(line, sizeof(line), "ATTACH %s", conn->ring_name);
+    if (forward(conn, line, answer, sizeof(answer)) < 0) {
+      if (conn->hangup) return;
+      disconnect_worker(conn, true);
+    }
+  }
+
+  if (result < 0) {
+    reply(conn->fd, "ERR %d", result);
+  } else {
+    reply(conn->fd, "OK %s", conn->ring_name);
+  }
+}
+
+static void handle_connection_line(void *context, char *line) {
+  Connection *conn = (Connection *)context;
+  long long a = 0, b = 0, c = 0;
+
+  if (strncmp(line, "OPEN ", 5) == 0) {
+    handle_open(conn, line + 5);
+  } else if (sscanf(line, "RING %lld %lld", &a, &b) == 2) {
+    handle_ring(conn, (int)a, b);
+  } else if (sscanf(line, "OUTPUT %lld %lld %lld", &a, &b, &c) == 3) {
+    snprintf(conn->output, sizeof(conn->output), "OUTPUT %lld %lld %lld", a, b, c);
+    if (conn->worker) {
+      relay(conn, conn->output);
+    } else {
+      reply(conn->fd, "OK");
+    }
+  } else if (!conn->worker || strncmp(line, "ATTACH ", 7) == 0) {
+    reply(conn->fd, "ERR -1");
+  } else {
+    relay(conn, line);
+  }
+}
+
+static void *connection_thread(void *arg) {
+  Connection *conn = (Connection *)arg;
+  read_lines(conn->fd, &conn->hangup, handle_connection_line, conn);
+
+  // The worker notices the closed connection and drops what is in flight
+  disconnect_worker(conn, false);
+  close(conn->fd);
+  shm_ring_destroy(&conn->ring);
+  free(conn);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  signal(SIGPIPE, SIG_IGN);
+  if (argc == 5 && strcmp(argv[1], SERVER_WORKER_FLAG) == 0) {
+    return worker_main((int)strtol(argv[2], NULL, 10), strtol(argv[3], NULL, 10), argv[4]);
+  }
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <socket path> [cache MiB]\n", argv[0]);
+    return 2;
+  }
+  const char *socket_path = argv[1];
+  g_cache_mb = argc > 2 ? strtol(argv[2], NULL, 10) : SERVER_DEFAULT_CACHE_MB;
+
+  ssize_t self_length = readlink("/proc/self/exe", g_self_path, sizeof(g_self_path) - 1);
+  if (self_length > 0) {
+    g_self_path[self_length] = '\0';
+  } else {
+    snprintf(g_self_path, sizeof(g_self_path), "%s", argv[0]);
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "socket path too long\n");
+    return 2;
+  }
+  strcpy(addr.sun_path, socket_path);
+
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  unlink(socket_path);
+  if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(listen_fd, 16) < 0) {
+    perror("frame server");
+    return 1;
+  }
+
+  // Workers are never waited for; let the kernel reap them
+  signal(SIGCHLD, SIG_IGN);
+
+  int next_id = 1;
+  while (true) {
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    Connection *conn = (Connection *)calloc(1, sizeof(Connection));
+    if (!conn) {
+      close(fd);
+      continue;
+    }
+    conn->fd = fd;
+    conn->id = next_id++;
+    conn->worker_fd = -1;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, connection_thread, conn) != 0) {
+      close(fd);
+      free(conn);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+
+  close(listen_fd);
+  unlink(socket_path);
+  return 0;
+}